@@ -1,101 +1,74 @@
-import matplotlib.pyplot as plt
-import sys
-import statistics
-import os
-
-lines = None
-args = None
+import json
+import datetime
+import argparse
 
+# use a matplotlib backend that does not require an X server
+import matplotlib
+matplotlib.use('Agg')
+import matplotlib.pyplot as plt
 
-def get_experiment_results(experiment_name):
-    started = False
-    results = []
-    for i in range(len(lines)):
-        if lines[i] == f"#[Experiment][{experiment_name}]: start":
-            started = True
-            continue
-        if lines[i] == f"#[Experiment][{experiment_name}]: end":
-            return results
-        if lines[i][0] == ";":
-            print(experiment_name, lines[i])
-            continue
-        if started:
-            results.append(tuple(list(map(int, lines[i].split(" ")))))
-    if started:
-        raise Exception(f"experiment {experiment_name} is not terminated!")
-    else:
-        raise Exception(f"experiment {experiment_name} not found!")
-       
+parser = argparse.ArgumentParser(
+	description = 'Plots the results of the pointer array test.'
+)
+parser.add_argument(
+	"-n", "--name", required=True,
+	help="Experiment name (used as title and part of the filename)."
+)
+parser.add_argument(
+	"-i", "--input", required=True, nargs="+",
+	help="List of json files to plot."
+)
 
-def plot_experiment(x_values, y_measure, y_ref, x_text, y_text, title, file_name, func = plt.plot, file_format="csv", show=False):
-    global args
-    func(x_values, y_measure, label="measurement")
-    func(x_values, y_ref, label="reference")
-    plt.xlabel(x_text)
-    plt.ylabel(y_text)
-    plt.title(title)
-    plt.legend()
-    if show:
-        plt.show()
-    os.makedirs(f"plots/{args[2]}", exist_ok=True)
-    plt.savefig(f"plots/{args[2]}/{file_name}.{file_format}")
-    plt.clf()
+# aggregate used for the y axis of each sweep
+SWEEP_AGGREGATES = {
+	"training-pointers": "median",
+	"target-offset": "median",
+	"pointer-array-offset": "hits",
+	"pointer-array-space": "hits",
+}
 
+def save(file_name):
+	output_filename = "plot_" + str(int(datetime.datetime.now().timestamp() * 1000)) + "_" + file_name + ".svg"
+	plt.savefig(output_filename, bbox_inches='tight')
+	plt.clf()
 
-def plot_simple(experiment_name, x_text, y_text, title, file_name, func = plt.plot, file_format="svg", show=False):
-    results = get_experiment_results(experiment_name)
-    x_vals = range(len(results))
-    y_measure = []
-    y_ref = []
-    for measurement, reference in results:
-        y_measure.append(measurement)
-        y_ref.append(reference)
-    plot_experiment(x_vals, y_measure, y_ref, x_text, y_text, title, file_name, func=func, file_format=file_format, show=show)
+def cumulative(histogram):
+	# histogram: list of [timing, count] pairs, sorted by timing
+	total = sum(count for _, count in histogram)
+	timings, fractions, cumulative_count = [], [], 0
+	for timing, count in histogram:
+		cumulative_count += count
+		timings.append(timing)
+		fractions.append(cumulative_count / total)
+	return timings, fractions
 
-def plot_parameterized(experiment_name, x_text, y_text, title, file_name, aggregate, func = plt.plot, file_format="svg", show=False):
-    results = get_experiment_results(experiment_name)
-    params = dict()
-    for i, measurement, reference in results:
-        if i not in params:
-            # measurement, reference
-            params[i] = ([], [])
-        l_measurement, l_reference = params[i]
-        l_measurement.append(measurement)
-        l_reference.append(reference)
-    
-    x_vals = sorted(list(params.keys()))
-    y_measure = []
-    y_ref = []
-    for x in x_vals:
-        l_measurement, l_reference = params[x]
-        y_measure.append(aggregate(l_measurement))
-        y_ref.append(aggregate(l_reference))
-    plot_experiment(x_vals, y_measure, y_ref, x_text, y_text, title, file_name, func=func, file_format=file_format, show=show)
- 
-if len(sys.argv) > 1:
-    runs = [sys.argv]
-else:
-    runs = []
-    for fl in os.listdir("measurements"):
-        runs.append(["blub", f"measurements/{fl}", f"{fl.split('.')[0]}"])
+def plot_experiment(experiment_name, experiment):
+	# cumulative distribution of the timings of both streams
+	for stream in ["measurement", "reference"]:
+		timings, fractions = cumulative(experiment[f"histogram_{stream}"])
+		plt.step(timings, fractions, where="post", label=stream)
+	plt.xlabel("time")
+	plt.ylabel("fraction of repetitions")
+	plt.title(f"{args.name}: {experiment_name}")
+	plt.legend()
+	save(f"{args.name}_{experiment_name}")
 
-def hits(x):
-    return sum(1 for a in x if a < 180)
+def plot_sweep(sweep_name, sweep):
+	aggregate = SWEEP_AGGREGATES.get(sweep_name, "median")
+	summaries = sweep["summaries"]
+	plt.plot(sweep["params"], [s[f"{aggregate}_measurement"] for s in summaries], label="measurement")
+	plt.plot(sweep["params"], [s[f"{aggregate}_reference"] for s in summaries], label="reference")
+	plt.xlabel(sweep_name)
+	plt.ylabel(f"time ({aggregate})" if aggregate == "median" else "hits")
+	plt.title(f"{args.name}: {sweep_name}")
+	plt.legend()
+	save(f"{args.name}_{sweep_name}")
 
-for run in runs:
-    args = run
-    lines = open(args[1]).read().split("\n")
-    
-    plot_simple("existence", "measurement #", "time", "pointer array existence test", "existence", show=False)
-    plot_simple("existence-ref", "measurement #", "time", "pointer array existence test (reference)", "existence_ref", show=False)
-    plot_simple("backwards", "measurement #", "time", "pointer array backwards detection test", "backwards", show=False)
-    plot_simple("backwards-ref", "measurement #", "time", "pointer array backwards detection test (reference)", "backwards-ref", show=False)
-    plot_simple("pc-dependence", "measurement #", "time", "pointer array pc-dependence test", "pc_dependence", show=False)
-    plot_simple("pc-dependence-ref", "measurement #", "time", "pointer array pc-dependence test (reference)", "pc_dependence_ref", show=False)
-    plot_simple("pc-dependence-align", "measurement #", "time", "pointer array pc-dependence aligned test", "pc_dependence_align", show=False)
-    plot_simple("pc-dependence-align-ref", "measurement #", "time", "pointer array pc-dependence aligned test (reference)", "pc_dependence_ref_align", show=False)
-   
-    plot_parameterized("training-pointers", "training pointers", "time (median)", "training pointers test", "training_pointers", statistics.median, show=False)
-    plot_parameterized("target-offset", "offset from entry", "time (median)", "target array offset test", "target_offset", statistics.median, show=False)
-    plot_parameterized("pointer-array-offset", "offset from last training pointer", "time (median)", "measurement offset test", "pointer_array_offset", hits, show=False)
-    plot_parameterized("pointer-array-space", "space between pointers (1 = 8 bytes)", "time (median)", "pointer array space test", "pointer_array_space", hits, show=False)
+args = parser.parse_args()
+for input_filename in args.input:
+	with open(input_filename) as file:
+		trace = json.loads(file.read())
+	for experiment_name, experiment in trace.get("experiments", {}).items():
+		plot_experiment(experiment_name, experiment)
+	for sweep_name, sweep in trace.get("sweeps", {}).items():
+		plot_sweep(sweep_name, sweep)
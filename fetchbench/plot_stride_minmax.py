@@ -34,7 +34,7 @@ fig = plt.gcf()
 ax = plt.gca()
 
 # set figure dimensions
-fig.set_size_inches(30, len(stride_jsons) // 4)
+fig.set_size_inches(30, 1 + len(stride_jsons) // 4)
 plt.tight_layout()
 
 max_steps = -1
@@ -1,2 +0,0 @@
-#!/bin/sh
-build/prefetch-test-parr $1 > parr.log
\ No newline at end of file
@@ -1,2 +0,0 @@
-#!/bin/sh
-build/prefetch-test-pchase $1 > pchase.log
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <sstream>
+
+#include "access_kind.hh"
+#include "logger.hh"
+
+vector<access_kind_t> AccessKinds::selected = {ACCESS_KIND_LOAD};
+
+char const* access_kind_to_string(access_kind_t kind) {
+	switch (kind) {
+		case ACCESS_KIND_LOAD: return "load";
+		case ACCESS_KIND_STORE: return "store";
+		case ACCESS_KIND_STORE_NT: return "store_nt";
+		case ACCESS_KIND_ATOMIC: return "atomic";
+		case ACCESS_KIND_PREFETCH_T0: return "prefetch_t0";
+		case ACCESS_KIND_PREFETCH_T1: return "prefetch_t1";
+		case ACCESS_KIND_PREFETCH_T2: return "prefetch_t2";
+		case ACCESS_KIND_PREFETCH_NTA: return "prefetch_nta";
+		case ACCESS_KIND_LOAD_16: return "load_16";
+		case ACCESS_KIND_LOAD_32: return "load_32";
+		case ACCESS_KIND_LOAD_64: return "load_64";
+		default: return "unknown";
+	}
+}
+
+/**
+ * Looks up an access kind by its name (see access_kind_to_string()).
+ *
+ * @param      name  The name
+ *
+ * @return     The kind, NO_ACCESS_KINDS if the name is unknown.
+ */
+access_kind_t access_kind_from_string(string const& name) {
+	size_t kind = 0;
+	while (kind < NO_ACCESS_KINDS && name != access_kind_to_string((access_kind_t)kind)) {
+		kind++;
+	}
+	return (access_kind_t)kind;
+}
+
+/**
+ * Checks whether the CPU supports the instructions of an access kind
+ * (only the 32 and 64-byte SIMD loads on x86 are optional).
+ *
+ * @param[in]  kind  The access kind
+ *
+ * @return     true if supported.
+ */
+bool access_kind_supported(access_kind_t kind) {
+	#if defined(__i386__) || defined(__x86_64__)
+		if (kind == ACCESS_KIND_LOAD_32) {
+			return __builtin_cpu_supports("avx");
+		}
+		if (kind == ACCESS_KIND_LOAD_64) {
+			return __builtin_cpu_supports("avx512f");
+		}
+	#endif
+	return kind < NO_ACCESS_KINDS;
+}
+
+/**
+ * Parses the access kinds to run the identification tests with.
+ *
+ * @param      spec  "all" for all kinds, or a comma-separated list of kind
+ *                   names (see access_kind_to_string())
+ *
+ * @return     The kinds (without duplicates). Exits on invalid input.
+ */
+vector<access_kind_t> parse_access_kinds(string const& spec) {
+	vector<access_kind_t> kinds;
+	if (spec == "all") {
+		for (size_t kind = 0; kind < NO_ACCESS_KINDS; kind++) {
+			kinds.push_back((access_kind_t)kind);
+		}
+		return kinds;
+	}
+	std::istringstream stream {spec};
+	string item;
+	while (std::getline(stream, item, ',')) {
+		access_kind_t kind = access_kind_from_string(item);
+		if (kind == NO_ACCESS_KINDS) {
+			L::err("Invalid access kind \"%s\"\n", item.c_str());
+			exit(1);
+		}
+		if (std::find(kinds.begin(), kinds.end(), kind) == kinds.end()) {
+			kinds.push_back(kind);
+		}
+	}
+	return kinds;
+}
+
+__attribute__((noinline)) void maccess_kind_noinline(access_kind_t kind, void* addr) {
+	maccess_kind(kind, addr);
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cinttypes>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cacheutils.hh"
+
+using std::string;
+using std::vector;
+
+/**
+ * Kind of the memory accesses a workload trains the prefetchers with.
+ */
+typedef enum {
+	// 8-byte load (maccess)
+	ACCESS_KIND_LOAD = 0,
+	// 8-byte store
+	ACCESS_KIND_STORE,
+	// 8-byte non-temporal store (x86: MOVNTI, ARM: 16-byte STNP)
+	ACCESS_KIND_STORE_NT,
+	// 8-byte atomic read-modify-write (x86: LOCK ADD, ARM: LDXR/STXR)
+	ACCESS_KIND_ATOMIC,
+	// software prefetches (x86: PREFETCHT0/T1/T2/NTA, ARM: PRFM
+	// PLDL1KEEP/PLDL2KEEP/PLDL3KEEP/PLDL1STRM)
+	ACCESS_KIND_PREFETCH_T0,
+	ACCESS_KIND_PREFETCH_T1,
+	ACCESS_KIND_PREFETCH_T2,
+	ACCESS_KIND_PREFETCH_NTA,
+	// SIMD loads (x86: SSE, AVX, AVX-512, ARM: LDR q, LDP q, LD1 x4)
+	ACCESS_KIND_LOAD_16,
+	ACCESS_KIND_LOAD_32,
+	ACCESS_KIND_LOAD_64,
+	NO_ACCESS_KINDS,
+} access_kind_t;
+
+char const* access_kind_to_string(access_kind_t kind);
+access_kind_t access_kind_from_string(string const& name);
+bool access_kind_supported(access_kind_t kind);
+vector<access_kind_t> parse_access_kinds(string const& spec);
+
+/**
+ * Aligns a pointer down to a multiple of the given size (power of two),
+ * such that wide accesses do not cross a cache line boundary.
+ *
+ * @param      p     The pointer
+ * @param[in]  size  The size
+ *
+ * @return     The aligned pointer.
+ */
+__attribute__((always_inline)) static inline void* align_access(void* p, uintptr_t size) {
+	return (void*)((uintptr_t)p & ~(size - 1));
+}
+
+/**
+ * Performs a memory access of the given kind to the given address p. Like
+ * maccess(), this function WILL be inlined, i.e., each call produces a new
+ * instruction with its own PC per kind. SIMD loads, non-temporal stores
+ * and atomics are aligned down to their size. Stores write zeros.
+ *
+ * @param[in]  kind  The access kind
+ * @param      p     The address to access
+ */
+__attribute__((always_inline)) static inline void maccess_kind(access_kind_t kind, void* p) {
+	switch (kind) {
+	#if defined(__i386__) || defined(__x86_64__)
+		case ACCESS_KIND_STORE:
+			asm volatile("movq $0, (%0)\n" : : "c"(p) : "memory");
+			break;
+		case ACCESS_KIND_STORE_NT:
+			asm volatile("movnti %1, (%0)\n" : : "c"(align_access(p, 8)), "r"(0ULL) : "memory");
+			break;
+		case ACCESS_KIND_ATOMIC:
+			asm volatile("lock addq $0, (%0)\n" : : "c"(align_access(p, 8)) : "memory");
+			break;
+		case ACCESS_KIND_PREFETCH_T0:
+			asm volatile("prefetcht0 (%0)\n" : : "c"(p));
+			break;
+		case ACCESS_KIND_PREFETCH_T1:
+			asm volatile("prefetcht1 (%0)\n" : : "c"(p));
+			break;
+		case ACCESS_KIND_PREFETCH_T2:
+			asm volatile("prefetcht2 (%0)\n" : : "c"(p));
+			break;
+		case ACCESS_KIND_PREFETCH_NTA:
+			asm volatile("prefetchnta (%0)\n" : : "c"(p));
+			break;
+		case ACCESS_KIND_LOAD_16:
+			asm volatile("movdqu (%0), %%xmm0\n" : : "c"(align_access(p, 16)) : "xmm0");
+			break;
+		case ACCESS_KIND_LOAD_32:
+			asm volatile("vmovdqu (%0), %%ymm0\nvzeroupper\n" : : "c"(align_access(p, 32)) : "xmm0");
+			break;
+		case ACCESS_KIND_LOAD_64:
+			asm volatile("vmovdqu64 (%0), %%zmm0\nvzeroupper\n" : : "c"(align_access(p, 64)) : "xmm0");
+			break;
+	#elif defined(__aarch64__)
+		case ACCESS_KIND_STORE:
+			asm volatile("STR xzr, [%0]\n\t" : : "r"(p) : "memory");
+			break;
+		case ACCESS_KIND_STORE_NT:
+			asm volatile("STNP xzr, xzr, [%0]\n\t" : : "r"(align_access(p, 16)) : "memory");
+			break;
+		case ACCESS_KIND_ATOMIC: {
+			uint64_t value;
+			uint32_t status;
+			asm volatile(
+				"1: LDXR %0, [%2]\n\t"
+				"STXR %w1, %0, [%2]\n\t"
+				"CBNZ %w1, 1b\n\t"
+				: "=&r"(value), "=&r"(status) : "r"(align_access(p, 8)) : "memory"
+			);
+			break;
+		}
+		case ACCESS_KIND_PREFETCH_T0:
+			asm volatile("PRFM PLDL1KEEP, [%0]\n\t" : : "r"(p));
+			break;
+		case ACCESS_KIND_PREFETCH_T1:
+			asm volatile("PRFM PLDL2KEEP, [%0]\n\t" : : "r"(p));
+			break;
+		case ACCESS_KIND_PREFETCH_T2:
+			asm volatile("PRFM PLDL3KEEP, [%0]\n\t" : : "r"(p));
+			break;
+		case ACCESS_KIND_PREFETCH_NTA:
+			asm volatile("PRFM PLDL1STRM, [%0]\n\t" : : "r"(p));
+			break;
+		case ACCESS_KIND_LOAD_16:
+			asm volatile("LDR q0, [%0]\n\t" : : "r"(align_access(p, 16)) : "v0");
+			break;
+		case ACCESS_KIND_LOAD_32:
+			asm volatile("LDP q0, q1, [%0]\n\t" : : "r"(align_access(p, 32)) : "v0", "v1");
+			break;
+		case ACCESS_KIND_LOAD_64:
+			asm volatile("LD1 {v0.16b, v1.16b, v2.16b, v3.16b}, [%0]\n\t" : : "r"(align_access(p, 64)) : "v0", "v1", "v2", "v3");
+			break;
+	#endif
+		default:
+			maccess(p);
+			break;
+	}
+}
+
+__attribute__((noinline)) void maccess_kind_noinline(access_kind_t kind, void* addr);
+
+/**
+ * Non-inlining access of the given kind. Each N produces a distinct
+ * function, i.e., distinct PCs (the counterpart of maccess_1, maccess_2,
+ * ..., see aligned_maccess.hh).
+ *
+ * @param[in]  kind  The access kind
+ * @param      p     The address to access
+ *
+ * @tparam     N     Number of the function
+ */
+template <size_t N>
+__attribute__((noinline)) void maccess_kind_n(access_kind_t kind, void* p) {
+	// keeps the compiler from folding the identical functions
+	asm volatile("" : : "i"(N));
+	maccess_kind(kind, p);
+}
+
+typedef void (*maccess_kind_func_t)(access_kind_t, void*);
+
+template <size_t... N>
+static inline vector<maccess_kind_func_t> make_maccess_kind_functions(std::index_sequence<N...>) {
+	return { maccess_kind_n<N + 1>... };
+}
+
+/**
+ * Returns NO distinct non-inlining access functions.
+ *
+ * @tparam     NO    Number of functions
+ *
+ * @return     The functions.
+ */
+template <size_t NO>
+static inline vector<maccess_kind_func_t> get_maccess_kind_functions() {
+	return make_maccess_kind_functions(std::make_index_sequence<NO> {});
+}
+
+/**
+ * The access kinds to run the identification tests with (see
+ * TestCaseBase::identify_per_access_kind()). Only ACCESS_KIND_LOAD by
+ * default.
+ */
+class AccessKinds {
+private:
+	static vector<access_kind_t> selected;
+
+public:
+	static inline void configure(vector<access_kind_t> const& kinds) {
+		selected = kinds;
+	}
+
+	static inline vector<access_kind_t> const& get() {
+		return selected;
+	}
+};
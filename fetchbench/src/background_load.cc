@@ -0,0 +1,162 @@
+#include <cassert>
+#include <time.h>
+#include <unistd.h>
+
+#include "background_load.hh"
+#include "cacheutils.hh"
+#include "logger.hh"
+#include "utils.hh"
+
+char const* load_kind_to_string(load_kind_t kind) {
+	switch (kind) {
+		case LOAD_STREAMING: return "streaming";
+		case LOAD_RANDOM: return "random";
+	}
+	return "unknown";
+}
+
+/**
+ * Allocates the buffers of the load threads. The threads are assigned to
+ * the CPUs round-robin (streaming threads first).
+ *
+ * @param[in]  no_streaming_threads  Number of streaming threads
+ * @param[in]  no_random_threads     Number of random-access threads
+ * @param[in]  cpus                  The CPUs to run the threads on (not
+ *                                   empty)
+ */
+BackgroundLoad::BackgroundLoad(size_t no_streaming_threads, size_t no_random_threads, vector<int> cpus)
+: cpus {cpus}
+{
+	assert( ! cpus.empty());
+	if (no_streaming_threads + no_random_threads > cpus.size()) {
+		L::warn("Background load: %zu threads on %zu CPUs, the threads share CPUs\n", no_streaming_threads + no_random_threads, cpus.size());
+	}
+	for (size_t idx = 0; idx < no_streaming_threads + no_random_threads; idx++) {
+		std::unique_ptr<worker_t> worker {new worker_t {}};
+		worker->kind = (idx < no_streaming_threads) ? LOAD_STREAMING : LOAD_RANDOM;
+		worker->cpu = cpus[idx % cpus.size()];
+		worker->buffer = allocate_mapping(BACKGROUND_LOAD_BUFFER_SIZE);
+		workers.push_back(std::move(worker));
+	}
+}
+
+BackgroundLoad::~BackgroundLoad() {
+	if (running) {
+		stop();
+	}
+	for (std::unique_ptr<worker_t> const& worker : workers) {
+		unmap_mapping(worker->buffer);
+	}
+}
+
+/**
+ * The function that is executed in each load thread: pins the thread to
+ * its CPU and reads chunks of its buffer until stop() clears the running
+ * flag, sleeping whenever it is ahead of its bandwidth budget.
+ *
+ * @param      worker  The worker
+ */
+void BackgroundLoad::work(worker_t& worker) {
+	pin_process_to_cpu(0, worker.cpu);
+
+	size_t const no_lines = BACKGROUND_LOAD_BUFFER_SIZE / CACHE_LINE_SIZE;
+	size_t const lines_per_chunk = BACKGROUND_LOAD_CHUNK_SIZE / CACHE_LINE_SIZE;
+	uint8_t* const base = worker.buffer.base_addr;
+	size_t next_line = 0;
+	uint64_t state = 0x9e3779b97f4a7c15ULL * (worker.cpu + 1);
+	uint64_t bytes = 0;
+	uint64_t begin = rdtsc();
+	while (running) {
+		if (worker.kind == LOAD_STREAMING) {
+			for (size_t idx = 0; idx < lines_per_chunk; idx++) {
+				maccess(base + next_line * CACHE_LINE_SIZE);
+				next_line = (next_line + 1) % no_lines;
+			}
+		} else {
+			for (size_t idx = 0; idx < lines_per_chunk; idx++) {
+				// xorshift64
+				state ^= state << 13;
+				state ^= state >> 7;
+				state ^= state << 17;
+				maccess(base + (state % no_lines) * CACHE_LINE_SIZE);
+			}
+		}
+		bytes += BACKGROUND_LOAD_CHUNK_SIZE;
+		uint64_t elapsed = rdtsc() - begin;
+		worker.bytes = bytes;
+		worker.ticks = elapsed;
+
+		// throttle
+		while (bytes_per_tick > 0 && running && (double)bytes > bytes_per_tick * elapsed) {
+			usleep(BACKGROUND_LOAD_SLEEP_US);
+			elapsed = rdtsc() - begin;
+			worker.ticks = elapsed;
+		}
+	}
+}
+
+/**
+ * Measures the ticks per second of the timing source and starts the load
+ * threads.
+ *
+ * @param[in]  target_mbps  The target bandwidth of all threads together
+ *                          in MB/s (BACKGROUND_LOAD_UNTHROTTLED: as fast
+ *                          as possible)
+ */
+void BackgroundLoad::start(double target_mbps) {
+	assert( ! running);
+	struct timespec ts_begin, ts_end;
+	clock_gettime(CLOCK_MONOTONIC, &ts_begin);
+	uint64_t ticks_begin = rdtsc();
+	usleep(BACKGROUND_LOAD_TICK_CALIBRATION_MS * 1000);
+	uint64_t ticks_end = rdtsc();
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	double seconds = (ts_end.tv_sec - ts_begin.tv_sec) + (ts_end.tv_nsec - ts_begin.tv_nsec) / 1e9;
+	ticks_per_sec = (ticks_end - ticks_begin) / seconds;
+
+	this->target_mbps = target_mbps;
+	bytes_per_tick = (target_mbps > 0 && ! workers.empty()) ? target_mbps * 1e6 / workers.size() / ticks_per_sec : 0;
+	L::info("Background load: starting %zu threads, target bandwidth: %s MB/s (%.0f ticks/s)\n", workers.size(), (target_mbps > 0) ? std::to_string((size_t)target_mbps).c_str() : "unthrottled", ticks_per_sec);
+
+	running = true;
+	for (std::unique_ptr<worker_t> const& worker : workers) {
+		worker->bytes = 0;
+		worker->ticks = 0;
+		threads.push_back(std::thread(&BackgroundLoad::work, this, std::ref(*worker)));
+	}
+}
+
+/**
+ * Stops the load threads.
+ *
+ * @return     JSON structure with the target and the achieved bandwidth
+ *             (total and per thread).
+ */
+Json BackgroundLoad::stop() {
+	running = false;
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+
+	Json::array threads_json;
+	double achieved_mbps = 0;
+	for (std::unique_ptr<worker_t> const& worker : workers) {
+		double mbps = (worker->ticks > 0) ? worker->bytes / (worker->ticks / ticks_per_sec) / 1e6 : 0;
+		achieved_mbps += mbps;
+		threads_json.push_back(Json::object {
+			{"kind", load_kind_to_string(worker->kind)},
+			{"cpu", worker->cpu},
+			{"bytes", (double)worker->bytes},
+			{"achieved_mbps", mbps},
+		});
+	}
+	L::info("Background load: stopped, achieved bandwidth: %.0f MB/s\n", achieved_mbps);
+	return Json::object {
+		{"target_mbps", target_mbps},
+		{"throttled", target_mbps > 0},
+		{"achieved_mbps", achieved_mbps},
+		{"ticks_per_sec", ticks_per_sec},
+		{"threads", threads_json},
+	};
+}
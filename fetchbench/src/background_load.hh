@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "mapping.hh"
+
+using json11::Json;
+using std::string;
+using std::vector;
+
+// Buffer of each load thread (larger than the LLC, such that the accesses
+// go to DRAM)
+#define BACKGROUND_LOAD_BUFFER_SIZE (64 * 1024 * 1024)
+// Bytes a load thread accesses between two checks of its bandwidth budget
+#define BACKGROUND_LOAD_CHUNK_SIZE (64 * 1024)
+// Time a load thread sleeps if it is ahead of its bandwidth budget
+#define BACKGROUND_LOAD_SLEEP_US 20
+// Duration of the measurement of the ticks per second of the timing source
+#define BACKGROUND_LOAD_TICK_CALIBRATION_MS 100
+// Target bandwidth to read as fast as possible
+#define BACKGROUND_LOAD_UNTHROTTLED -1
+
+typedef enum {
+	// sequential reads through the buffer (one per cache line)
+	LOAD_STREAMING = 0,
+	// independent reads of random cache lines of the buffer
+	LOAD_RANDOM = 1,
+} load_kind_t;
+
+char const* load_kind_to_string(load_kind_t kind);
+
+/**
+ * Background memory load: threads on other cores that read their own
+ * buffers to put the memory system under bandwidth pressure while a
+ * testcase runs (see run_load_sweep()). Streaming threads read their
+ * buffer sequentially, random-access threads read random lines.
+ *
+ * The threads share a target bandwidth (MB/s, evenly split). Each thread
+ * throttles itself: after each chunk of BACKGROUND_LOAD_CHUNK_SIZE bytes,
+ * it sleeps while it is ahead of its budget. The elapsed time is measured
+ * with the timing source of the measurements (rdtsc()), converted to
+ * seconds with the ticks per second measured at start(). The achieved
+ * bandwidth is reported by stop().
+ */
+class BackgroundLoad {
+private:
+	typedef struct {
+		load_kind_t kind;
+		int cpu;
+		Mapping buffer;
+		// bytes read and ticks elapsed (updated after each chunk)
+		std::atomic<uint64_t> bytes;
+		std::atomic<uint64_t> ticks;
+	} worker_t;
+
+	vector<int> const cpus;
+	vector<std::unique_ptr<worker_t>> workers;
+	vector<std::thread> threads;
+	std::atomic<bool> running {false};
+	// target bandwidth per thread in bytes per tick (0: unthrottled)
+	double bytes_per_tick = 0;
+	double target_mbps = 0;
+	double ticks_per_sec = 0;
+
+	void work(worker_t& worker);
+
+public:
+	BackgroundLoad(size_t no_streaming_threads, size_t no_random_threads, vector<int> cpus);
+	~BackgroundLoad();
+
+	inline size_t no_threads() const {
+		return workers.size();
+	}
+
+	void start(double target_mbps);
+	Json stop();
+};
@@ -0,0 +1,272 @@
+#include "cache_histogram.hh"
+
+/**
+ * Converts the normalized values (per-mille) to a JSON array.
+ *
+ * @return     JSON array with one value per cache line.
+ */
+Json CacheHistogram::normalized_to_json() const {
+	Json::array values;
+	for (size_t idx = 0; idx < size(); idx++) {
+		values.push_back((int)(*this)[idx]);
+	}
+	return values;
+}
+
+/**
+ * Converts the raw hit counts to a JSON array.
+ *
+ * @return     JSON array with one value per cache line.
+ */
+Json CacheHistogram::hits_to_json() const {
+	Json::array values;
+	for (uint32_t const& value : hits) {
+		values.push_back((int)value);
+	}
+	return values;
+}
+
+/**
+ * Converts the probe counts to a JSON array.
+ *
+ * @return     JSON array with one value per cache line.
+ */
+Json CacheHistogram::probes_to_json() const {
+	Json::array values;
+	for (uint32_t const& value : probes) {
+		values.push_back((int)value);
+	}
+	return values;
+}
+
+/**
+ * Converts the probe counts per level to a JSON object with one array per
+ * level (e.g., "L2": [...]).
+ *
+ * @return     JSON object.
+ */
+Json CacheHistogram::levels_to_json() const {
+	Json::object levels;
+	for (size_t level = 0; level < NO_CACHE_LEVELS; level++) {
+		Json::array values;
+		for (size_t idx = 0; idx < size(); idx++) {
+			values.push_back((int)level_count(idx, (cache_level_t)level));
+		}
+		levels[cache_level_to_string((cache_level_t)level)] = values;
+	}
+	return levels;
+}
+
+/**
+ * Determines the level a cache line was prefetched into: the cache level
+ * (L1, L2 or LLC) the most probes of the line were served from.
+ *
+ * @param[in]  idx   The cache line index
+ *
+ * @return     The level, CACHE_LEVEL_UNKNOWN if no probe was served from
+ *             a cache (or the latency bands are not calibrated).
+ */
+cache_level_t CacheHistogram::fill_level(size_t idx) const {
+	cache_level_t fill_level = CACHE_LEVEL_UNKNOWN;
+	uint32_t max_count = 0;
+	for (size_t level = CACHE_LEVEL_L1; level < CACHE_LEVEL_DRAM; level++) {
+		if (level_count(idx, (cache_level_t)level) > max_count) {
+			max_count = level_count(idx, (cache_level_t)level);
+			fill_level = (cache_level_t)level;
+		}
+	}
+	return fill_level;
+}
+
+/**
+ * Lists the fill level of each prefetched cache line.
+ *
+ * @param      prefetch_vector  The prefetched lines
+ *
+ * @return     JSON object mapping the cache line index to the level.
+ */
+Json CacheHistogram::fill_levels_to_json(PrefetchVector const& prefetch_vector) const {
+	Json::object fill_levels;
+	for (size_t idx = prefetch_vector.find_first(); idx < prefetch_vector.size(); idx = prefetch_vector.find_next(idx)) {
+		fill_levels[std::to_string(idx)] = cache_level_to_string(fill_level(idx));
+	}
+	return fill_levels;
+}
+
+/**
+ * Restores a cache histogram from an experiment dump. If the dump
+ * contains raw counts ("cache_histogram_hits" and
+ * "cache_histogram_probes"), they are used. Otherwise, the raw counts are
+ * reconstructed from the normalized values ("cache_histogram") as if each
+ * line was probed 1000 times.
+ *
+ * @param      json  The JSON object of the dump
+ *
+ * @return     The cache histogram.
+ */
+CacheHistogram CacheHistogram::from_json(Json const& json) {
+	Json::array const& normalized = json["cache_histogram"].array_items();
+	Json::array const& hits_json = json["cache_histogram_hits"].array_items();
+	Json::array const& probes_json = json["cache_histogram_probes"].array_items();
+
+	CacheHistogram cache_histogram (normalized.size());
+	bool has_raw_counts = (hits_json.size() == normalized.size() && probes_json.size() == normalized.size());
+	for (size_t idx = 0; idx < normalized.size(); idx++) {
+		if (has_raw_counts) {
+			cache_histogram.hits[idx] = hits_json[idx].int_value();
+			cache_histogram.probes[idx] = probes_json[idx].int_value();
+		} else {
+			cache_histogram.hits[idx] = normalized[idx].int_value();
+			cache_histogram.probes[idx] = 1000;
+		}
+	}
+	// probe counts per level (older dumps do not have them)
+	for (size_t level = 0; level < NO_CACHE_LEVELS; level++) {
+		Json::array const& counts = json["cache_histogram_levels"][cache_level_to_string((cache_level_t)level)].array_items();
+		for (size_t idx = 0; idx < counts.size() && idx < normalized.size(); idx++) {
+			cache_histogram.level_counts[idx * NO_CACHE_LEVELS + level] = counts[idx].int_value();
+		}
+	}
+	return cache_histogram;
+}
+
+/**
+ * Counts the cache lines marked as prefetched.
+ *
+ * @return     Number of set bits.
+ */
+size_t PrefetchVector::count() const {
+	size_t n = 0;
+	for (size_t w = 0; w < no_used_words(); w++) {
+		n += __builtin_popcountll(words[w]);
+	}
+	return n;
+}
+
+/**
+ * Counts the cache lines marked as prefetched in [begin, end).
+ *
+ * @param[in]  begin  The first cache line index (inclusive)
+ * @param[in]  end    The last cache line index (exclusive)
+ *
+ * @return     Number of set bits in the range.
+ */
+size_t PrefetchVector::count(size_t begin, size_t end) const {
+	assert(begin <= end && end <= no_bits);
+	size_t n = 0;
+	for (size_t w = begin / WORD_BITS; w * WORD_BITS < end; w++) {
+		uint64_t word = words[w];
+		// mask out bits before begin and at/after end
+		if (w == begin / WORD_BITS) {
+			word &= ~0ULL << (begin % WORD_BITS);
+		}
+		if (w == end / WORD_BITS) {
+			word &= (1ULL << (end % WORD_BITS)) - 1;
+		}
+		n += __builtin_popcountll(word);
+	}
+	return n;
+}
+
+/**
+ * Returns the index of the first cache line marked as prefetched.
+ *
+ * @return     The index, or size() if no line is marked.
+ */
+size_t PrefetchVector::find_first() const {
+	for (size_t w = 0; w < no_used_words(); w++) {
+		if (words[w] != 0) {
+			return w * WORD_BITS + __builtin_ctzll(words[w]);
+		}
+	}
+	return no_bits;
+}
+
+/**
+ * Returns the index of the next cache line after `idx` that is marked as
+ * prefetched. Together with find_first(), this allows to iterate over all
+ * set bits:
+ *
+ *     for (size_t i = pv.find_first(); i < pv.size(); i = pv.find_next(i))
+ *
+ * @param[in]  idx   The index to start after
+ *
+ * @return     The index, or size() if no further line is marked.
+ */
+size_t PrefetchVector::find_next(size_t idx) const {
+	idx++;
+	if (idx >= no_bits) {
+		return no_bits;
+	}
+	size_t w = idx / WORD_BITS;
+	uint64_t word = words[w] & (~0ULL << (idx % WORD_BITS));
+	while (word == 0) {
+		w++;
+		if (w >= no_used_words()) {
+			return no_bits;
+		}
+		word = words[w];
+	}
+	return w * WORD_BITS + __builtin_ctzll(word);
+}
+
+/**
+ * Returns the lines marked in exactly one of both prefetch vectors.
+ *
+ * @param      other  The other prefetch vector (same size)
+ *
+ * @return     The difference.
+ */
+PrefetchVector PrefetchVector::operator^(PrefetchVector const& other) const {
+	assert(no_bits == other.no_bits);
+	PrefetchVector result (no_bits);
+	for (size_t w = 0; w < no_used_words(); w++) {
+		result.words[w] = words[w] ^ other.words[w];
+	}
+	return result;
+}
+
+/**
+ * Returns the lines marked in both prefetch vectors.
+ *
+ * @param      other  The other prefetch vector (same size)
+ *
+ * @return     The intersection.
+ */
+PrefetchVector PrefetchVector::operator&(PrefetchVector const& other) const {
+	assert(no_bits == other.no_bits);
+	PrefetchVector result (no_bits);
+	for (size_t w = 0; w < no_used_words(); w++) {
+		result.words[w] = words[w] & other.words[w];
+	}
+	return result;
+}
+
+/**
+ * Returns the lines marked in this prefetch vector, but not in `other`.
+ *
+ * @param      other  The other prefetch vector (same size)
+ *
+ * @return     The lines only marked in this prefetch vector.
+ */
+PrefetchVector PrefetchVector::andnot(PrefetchVector const& other) const {
+	assert(no_bits == other.no_bits);
+	PrefetchVector result (no_bits);
+	for (size_t w = 0; w < no_used_words(); w++) {
+		result.words[w] = words[w] & ~other.words[w];
+	}
+	return result;
+}
+
+/**
+ * Converts the prefetch vector to a JSON array of booleans.
+ *
+ * @return     JSON array with one value per cache line.
+ */
+Json PrefetchVector::to_json() const {
+	Json::array values;
+	for (size_t idx = 0; idx < no_bits; idx++) {
+		values.push_back((*this)[idx]);
+	}
+	return values;
+}
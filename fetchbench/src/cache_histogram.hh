@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cassert>
+#include <cinttypes>
+#include <cstring>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "latency_bands.hh"
+
+using json11::Json;
+using std::vector;
+
+class PrefetchVector;
+
+/**
+ * Result of probing a single cache line with Flush+Reload.
+ */
+typedef struct {
+	// below the Flush+Reload threshold
+	bool hit;
+	// level of the memory hierarchy the line was loaded from (see
+	// LatencyBands)
+	cache_level_t level;
+} probe_result_t;
+
+/**
+ * Result of probing a memory area with Flush+Reload over many
+ * repetitions. For each cache line, the raw number of hits and the number
+ * of probes are kept, such that results of different collection methods
+ * (probing all lines, a subset of lines, etc.) can be compared. The
+ * normalized value of a cache line, i.e., its hit rate in per-mille, is
+ * computed on demand with operator[]. If the latency bands are
+ * calibrated, the number of probes served from each level of the memory
+ * hierarchy is counted as well.
+ */
+class CacheHistogram {
+private:
+	// raw number of hits per cache line
+	vector<uint32_t> hits;
+	// number of probes per cache line
+	vector<uint32_t> probes;
+	// number of probes per cache line and level (NO_CACHE_LEVELS entries
+	// per line)
+	vector<uint32_t> level_counts;
+
+public:
+	CacheHistogram() {}
+	explicit CacheHistogram(size_t no_cls)
+	: hits (no_cls, 0)
+	, probes (no_cls, 0)
+	, level_counts (no_cls * NO_CACHE_LEVELS, 0)
+	{}
+
+	inline size_t size() const {
+		return hits.size();
+	}
+
+	/**
+	 * Records the result of probing a cache line.
+	 *
+	 * @param[in]  idx   The cache line index
+	 * @param[in]  hit   Whether the probe was a hit or not
+	 */
+	inline void record(size_t idx, bool hit) __attribute__((always_inline)) {
+		assert(idx < hits.size());
+		hits[idx] += hit ? 1 : 0;
+		probes[idx]++;
+	}
+
+	/**
+	 * Records the result of probing a cache line, incl. the level it was
+	 * loaded from.
+	 *
+	 * @param[in]  idx     The cache line index
+	 * @param[in]  result  The probe result
+	 */
+	inline void record(size_t idx, probe_result_t result) __attribute__((always_inline)) {
+		record(idx, result.hit);
+		if (result.level != CACHE_LEVEL_UNKNOWN) {
+			level_counts[idx * NO_CACHE_LEVELS + result.level]++;
+		}
+	}
+
+	inline uint32_t hit_count(size_t idx) const {
+		assert(idx < hits.size());
+		return hits[idx];
+	}
+
+	inline uint32_t probe_count(size_t idx) const {
+		assert(idx < probes.size());
+		return probes[idx];
+	}
+
+	inline uint32_t level_count(size_t idx, cache_level_t level) const {
+		assert(idx < probes.size() && level < NO_CACHE_LEVELS);
+		return level_counts[idx * NO_CACHE_LEVELS + level];
+	}
+
+	cache_level_t fill_level(size_t idx) const;
+
+	/**
+	 * Returns the normalized value of a cache line.
+	 *
+	 * @param[in]  idx   The cache line index
+	 *
+	 * @return     Hit rate in per-mille, 0 if the line was never probed.
+	 */
+	inline size_t operator[](size_t idx) const {
+		assert(idx < hits.size());
+		if (probes[idx] == 0) {
+			return 0;
+		}
+		return (size_t)hits[idx] * 1000 / probes[idx];
+	}
+
+	/**
+	 * Copies the raw counts of a single cache line from another
+	 * histogram.
+	 *
+	 * @param      other  The other histogram
+	 * @param[in]  idx    The cache line index
+	 */
+	inline void copy_line(CacheHistogram const& other, size_t idx) {
+		assert(idx < hits.size() && idx < other.size());
+		hits[idx] = other.hits[idx];
+		probes[idx] = other.probes[idx];
+		for (size_t level = 0; level < NO_CACHE_LEVELS; level++) {
+			level_counts[idx * NO_CACHE_LEVELS + level] = other.level_counts[idx * NO_CACHE_LEVELS + level];
+		}
+	}
+
+	Json normalized_to_json() const;
+	Json hits_to_json() const;
+	Json probes_to_json() const;
+	Json levels_to_json() const;
+	Json fill_levels_to_json(PrefetchVector const& prefetch_vector) const;
+	static CacheHistogram from_json(Json const& json);
+};
+
+// Maximum number of cache lines in a PrefetchVector
+#define PREFETCH_VECTOR_CAPACITY (1 << 15)
+
+/**
+ * Set of cache lines where prefetches were observed. This is a bitset of
+ * fixed capacity (PREFETCH_VECTOR_CAPACITY), such that it does not need
+ * heap allocations. Copies and all operations only touch the words that
+ * are in use.
+ */
+class PrefetchVector {
+private:
+	static size_t const WORD_BITS = 64;
+	static size_t const NO_WORDS = PREFETCH_VECTOR_CAPACITY / WORD_BITS;
+
+	size_t no_bits;
+	uint64_t words[NO_WORDS];
+
+	inline size_t no_used_words() const {
+		return (no_bits + WORD_BITS - 1) / WORD_BITS;
+	}
+
+public:
+	explicit PrefetchVector(size_t no_bits = 0)
+	: no_bits {no_bits}
+	{
+		assert(no_bits <= PREFETCH_VECTOR_CAPACITY);
+		memset(words, 0, no_used_words() * sizeof(uint64_t));
+	}
+
+	PrefetchVector(PrefetchVector const& other)
+	: no_bits {other.no_bits}
+	{
+		memcpy(words, other.words, no_used_words() * sizeof(uint64_t));
+	}
+
+	PrefetchVector& operator=(PrefetchVector const& other) {
+		no_bits = other.no_bits;
+		memcpy(words, other.words, no_used_words() * sizeof(uint64_t));
+		return *this;
+	}
+
+	inline size_t size() const {
+		return no_bits;
+	}
+
+	inline bool operator[](size_t idx) const {
+		assert(idx < no_bits);
+		return (words[idx / WORD_BITS] >> (idx % WORD_BITS)) & 1;
+	}
+
+	inline void set(size_t idx, bool value = true) {
+		assert(idx < no_bits);
+		if (value) {
+			words[idx / WORD_BITS] |= (1ULL << (idx % WORD_BITS));
+		} else {
+			words[idx / WORD_BITS] &= ~(1ULL << (idx % WORD_BITS));
+		}
+	}
+
+	size_t count() const;
+	size_t count(size_t begin, size_t end) const;
+	size_t find_first() const;
+	size_t find_next(size_t idx) const;
+
+	PrefetchVector operator^(PrefetchVector const& other) const;
+	PrefetchVector operator&(PrefetchVector const& other) const;
+	PrefetchVector andnot(PrefetchVector const& other) const;
+
+	Json to_json() const;
+};
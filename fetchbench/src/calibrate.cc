@@ -50,14 +50,16 @@ size_t access_measure(uint8_t* ptr1, uint8_t* ptr2, size_t repeat, size_t median
  * Calibrates the Flush+Reload threshold
  *
  * @param      mapping  The mapping to work in
+ * @param[in]  quick    Use 100x fewer repetitions (for re-calibrations)
  *
  * @return     The recommended Flush+Reload threshold
  */
-size_t calibrate_thresh(Mapping const& mapping) {
+size_t calibrate_thresh(Mapping const& mapping, bool quick) {
 	assert(mapping.size >= 2 * PAGE_SIZE);
+	size_t divisor = quick ? 100 : 1;
 
 	// find median
-	size_t repeat = 100000;
+	size_t repeat = 100000 / divisor;
 	size_t thresh;
 	flush_mapping(mapping);
 	size_t hit_median = access_measure(mapping.base_addr + 1024, mapping.base_addr + 1024, repeat, 0);
@@ -66,7 +68,7 @@ size_t calibrate_thresh(Mapping const& mapping) {
 	L::debug("Median: Hit(%zu) Miss(%zu)\n", hit_median, miss_median);
 	
 	// use median to remove outliers
-	repeat = 10000000;
+	repeat = 10000000 / divisor;
 	flush_mapping(mapping);
 	size_t hit = access_measure(mapping.base_addr + 1024, mapping.base_addr + 1024, repeat, hit_median);
 	flush_mapping(mapping);
@@ -97,12 +99,12 @@ static bool calibrate_sleep(Mapping const& mapping, size_t no_repetitions, size_
 	// compare results of stride prefetcher with and without sleep to decide its need.
 	for (int i = 0; i < 2; i++) {
 		StrideExperiment calib_noise { stride, step, 0, use_nanosleep, fr_thresh, noise_thresh };
-		vector<size_t> cache_histogram_pos = calib_noise.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
-		vector<bool> prefetch_vector_diff = calib_noise.evaluate_cache_histogram(cache_histogram_pos, no_repetitions);
+		CacheHistogram cache_histogram_pos = calib_noise.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+		PrefetchVector prefetch_vector_diff = calib_noise.evaluate_cache_histogram(cache_histogram_pos, no_repetitions);
 		random_activity(mapping);
 		flush_mapping(mapping);
 
-		prefetch_count_pos[i] = std::count(prefetch_vector_diff.begin(), prefetch_vector_diff.end(), true);
+		prefetch_count_pos[i] = prefetch_vector_diff.count();
 		use_nanosleep ^= true;
 	}
 	L::debug("\n prefetch count sleep(true): %zu, sleep(false): %zu\n", prefetch_count_pos[0], prefetch_count_pos[1]);
@@ -132,11 +134,11 @@ static size_t calibrate_noise_thresh(Mapping const& mapping, size_t no_repetitio
 	StrideExperiment calib_noise { stride, step, 0, use_nanosleep, fr_thresh, 0 };
 
 	// pass NULL as workload to probe all the CL to compute average noise
-	vector<size_t> cache_histogram_pos = calib_noise.collect_cache_histogram(mapping, no_repetitions, nullptr, nullptr);
+	CacheHistogram cache_histogram_pos = calib_noise.collect_cache_histogram(mapping, no_repetitions, nullptr, nullptr);
 	// proble all the cache lines to find max noise.
-	for (auto it = cache_histogram_pos.begin() + 1; it < cache_histogram_pos.end(); it++) {
-		if (thresh < *it) {
-			thresh = *it;
+	for (size_t idx = 1; idx < cache_histogram_pos.size(); idx++) {
+		if (thresh < cache_histogram_pos[idx]) {
+			thresh = cache_histogram_pos[idx];
 		}
 	}
 	L::debug("\nnoise: %zu %zu \n", thresh*2, (thresh*2) * 1000/(no_repetitions/cache_histogram_pos.size()));
@@ -157,7 +159,7 @@ void calibrate(size_t& fr_thresh, size_t& noise_thresh, int& use_nanosleep) {
 	
 	// Calibrate FR threshold
 	if (fr_thresh == 0) {
-		fr_thresh = calibrate_thresh(mapping);
+		fr_thresh = calibrate_thresh(mapping, false);
 		random_activity(mapping);
 		flush_mapping(mapping);
 	}
@@ -2,5 +2,8 @@
 #include <cinttypes>
 #include <unistd.h>
 
+#include "mapping.hh"
+
 size_t access_measure(uint8_t* ptr1, uint8_t* ptr2, size_t repeat, size_t median);
+size_t calibrate_thresh(Mapping const& mapping, bool quick);
 void calibrate(size_t& fr_thresh, size_t& noise_thresh, int& use_nanosleep);
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include <cstring>
+
+#include "code_lines.hh"
+
+#if defined(__i386__) || defined(__x86_64__)
+	// ret
+	static uint8_t const RET_CODE[] = { 0xc3 };
+	// nop
+	static uint8_t const NOP_CODE[] = { 0x90 };
+	// int3
+	static uint8_t const TRAP_CODE[] = { 0xcc };
+#elif defined(__aarch64__)
+	// ret
+	static uint32_t const RET_CODE[] = { 0xd65f03c0 };
+	// nop
+	static uint32_t const NOP_CODE[] = { 0xd503201f };
+	// brk #0
+	static uint32_t const TRAP_CODE[] = { 0xd4200000 };
+#endif
+
+/**
+ * Fills memory with copies of an instruction.
+ *
+ * @param      dst          The destination
+ * @param[in]  size         The size in bytes
+ * @param      instruction  The instruction
+ * @param[in]  length       The length of the instruction in bytes
+ */
+static void fill(uint8_t* dst, size_t size, void const* instruction, size_t length) {
+	for (size_t offset = 0; offset + length <= size; offset += length) {
+		memcpy(dst + offset, instruction, length);
+	}
+}
+
+/**
+ * Writes a relative jump (call = false) or call (call = true) from `src`
+ * to `dst`, followed by a return in case of a call.
+ *
+ * @param      src   The address of the branch
+ * @param      dst   The branch target
+ * @param[in]  call  Whether to write a call
+ */
+static void write_branch(uint8_t* src, uint8_t* dst, bool call) {
+	#if defined(__i386__) || defined(__x86_64__)
+		// jmp/call rel32 (relative to the next instruction)
+		int32_t rel = (int32_t)(dst - (src + 5));
+		src[0] = call ? 0xe8 : 0xe9;
+		memcpy(src + 1, &rel, sizeof(rel));
+		if (call) {
+			memcpy(src + 5, RET_CODE, sizeof(RET_CODE));
+		}
+	#elif defined(__aarch64__)
+		uint32_t* code = (uint32_t*) src;
+		if (call) {
+			// stp x29, x30, [sp, #-16]!; bl dst; ldp x29, x30, [sp], #16; ret
+			int32_t rel = (int32_t)((dst - (src + 4)) / 4);
+			code[0] = 0xa9bf7bfd;
+			code[1] = 0x94000000 | ((uint32_t)rel & 0x3ffffff);
+			code[2] = 0xa8c17bfd;
+			code[3] = RET_CODE[0];
+		} else {
+			// b dst
+			int32_t rel = (int32_t)((dst - src) / 4);
+			code[0] = 0x14000000 | ((uint32_t)rel & 0x3ffffff);
+		}
+	#endif
+}
+
+/**
+ * Allocates executable memory for code lines. All lines are
+ * CODE_LINE_RET lines initially.
+ *
+ * @param[in]  no_pages  Number of pages
+ *
+ * @return     The code lines.
+ */
+CodeLines allocate_code_lines(size_t no_pages) {
+	CodeLines lines { allocate_mapping(no_pages * PAGE_SIZE), no_pages * PAGE_SIZE / CACHE_LINE_SIZE };
+	write_code_lines(lines, vector<code_line_t>(lines.no_lines, code_line_t {CODE_LINE_RET, 0}));
+	return lines;
+}
+
+/**
+ * Generates the code of all lines. Everything after the instructions of a
+ * line (except for fall-through lines) is filled with trap instructions,
+ * such that a stray jump does not silently execute garbage.
+ *
+ * @param      lines   The code lines
+ * @param      layout  The content of each line
+ */
+void write_code_lines(CodeLines const& lines, vector<code_line_t> const& layout) {
+	assert(layout.size() == lines.no_lines);
+	make_mapping_writable(lines.code);
+	for (size_t idx = 0; idx < lines.no_lines; idx++) {
+		uint8_t* line = lines.code.base_addr + idx * CACHE_LINE_SIZE;
+		code_line_t const& content = layout[idx];
+		if (content.kind == CODE_LINE_FALLTHROUGH) {
+			fill(line, CACHE_LINE_SIZE, NOP_CODE, sizeof(NOP_CODE));
+			continue;
+		}
+		fill(line, CACHE_LINE_SIZE, TRAP_CODE, sizeof(TRAP_CODE));
+		if (content.kind == CODE_LINE_RET) {
+			memcpy(line, RET_CODE, sizeof(RET_CODE));
+		} else {
+			assert(content.target < lines.no_lines);
+			write_branch(line, lines.code.base_addr + content.target * CACHE_LINE_SIZE, content.kind == CODE_LINE_CALL);
+		}
+	}
+	make_mapping_executable(lines.code);
+}
+
+/**
+ * Releases code lines that were allocated by `allocate_code_lines()`.
+ *
+ * @param      lines  The code lines
+ */
+void release_code_lines(CodeLines const& lines) {
+	unmap_mapping(lines.code);
+}
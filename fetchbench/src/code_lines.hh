@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+
+#include "cacheutils.hh"
+#include "mapping.hh"
+
+using std::vector;
+
+/**
+ * Content of a generated code line (one cache line of code).
+ */
+typedef enum {
+	// returns immediately (used to probe whether the line is cached)
+	CODE_LINE_RET = 0,
+	// no-ops only, execution falls through into the next line
+	CODE_LINE_FALLTHROUGH,
+	// jumps to the beginning of the target line
+	CODE_LINE_JUMP,
+	// calls the beginning of the target line, then returns
+	CODE_LINE_CALL,
+} code_line_kind_t;
+
+typedef struct {
+	code_line_kind_t kind;
+	// target line index (CODE_LINE_JUMP and CODE_LINE_CALL only)
+	size_t target;
+} code_line_t;
+
+typedef void (*code_line_func_t)();
+
+/**
+ * Executable memory divided into cache-line-sized slots of generated code.
+ * Each line is entered at its beginning, so executing a line fetches it
+ * into the instruction cache. The content of all lines is set with
+ * `write_code_lines()`.
+ */
+typedef struct {
+	// executable memory holding the generated code
+	Mapping code;
+	// number of lines
+	size_t no_lines;
+} CodeLines;
+
+CodeLines allocate_code_lines(size_t no_pages);
+void write_code_lines(CodeLines const& lines, vector<code_line_t> const& layout);
+void release_code_lines(CodeLines const& lines);
+
+/**
+ * Returns the entry point of a code line.
+ *
+ * @param      lines  The code lines
+ * @param[in]  idx    The line index
+ *
+ * @return     Function pointer to the beginning of the line.
+ */
+__attribute__((always_inline)) static inline code_line_func_t code_line(CodeLines const& lines, size_t idx) {
+	return (code_line_func_t)(lines.code.base_addr + idx * CACHE_LINE_SIZE);
+}
+
+/**
+ * Flushes a code line from all caches, incl. the instruction caches.
+ *
+ * @param      p     Address within the line
+ */
+__attribute__((always_inline)) static inline void flush_code(void* p) {
+	#if defined(__aarch64__)
+		// DC CIVAC does not invalidate the instruction cache
+		asm volatile("DC CIVAC, %0" ::"r"(p));
+		asm volatile("DSB ISH");
+		asm volatile("IC IVAU, %0" ::"r"(p));
+		asm volatile("DSB ISH");
+		asm volatile("ISB");
+	#else
+		// CLFLUSH invalidates the line in all caches, incl. the L1I
+		flush(p);
+	#endif
+}
+
+/**
+ * Measures the time to execute a CODE_LINE_RET line, i.e., the time to
+ * fetch it (plus a constant call/return overhead).
+ *
+ * @param      lines  The code lines
+ * @param[in]  idx    The line index
+ *
+ * @return     The execution time (delta of two rdtsc()-timestamps).
+ */
+__attribute__((always_inline)) static inline size_t time_code_line(CodeLines const& lines, size_t idx) {
+	code_line_func_t func = code_line(lines, idx);
+	uint64_t start = rdtsc();
+	func();
+	uint64_t end = rdtsc();
+	return end - start;
+}
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include <limits>
+
+#include "frequency_guard.hh"
+#include "calibrate.hh"
+#include "cacheutils.hh"
+#include "logger.hh"
+#include "mapping.hh"
+
+// signals after which the original minimum frequency is restored
+static int const UNPIN_SIGNALS[] = {SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+frequency_guard_level_t FrequencyGuard::level = FREQUENCY_GUARD_OFF;
+
+FrequencyGuard::~FrequencyGuard() {
+	unpin();
+}
+
+/**
+ * Returns the single instance.
+ *
+ * @return     The frequency guard.
+ */
+FrequencyGuard& FrequencyGuard::get() {
+	static FrequencyGuard instance;
+	return instance;
+}
+
+static string cpufreq_path(int cpu, string const& file) {
+	return "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/" + file;
+}
+
+static string read_cpufreq_string(int cpu, string const& file) {
+	std::ifstream f {cpufreq_path(cpu, file)};
+	string value;
+	if ( ! (f >> value)) {
+		return "";
+	}
+	return value;
+}
+
+static size_t read_cpufreq_khz(int cpu, string const& file) {
+	std::ifstream f {cpufreq_path(cpu, file)};
+	size_t value = 0;
+	if ( ! (f >> value)) {
+		return 0;
+	}
+	return value;
+}
+
+static bool write_cpufreq_khz(int cpu, string const& file, size_t value) {
+	std::ofstream f {cpufreq_path(cpu, file)};
+	if ( ! f) {
+		return false;
+	}
+	f << value << std::flush;
+	return f.good();
+}
+
+static uint64_t monotonic_ms() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000ULL + t.tv_nsec / 1000000;
+}
+
+/**
+ * Measures the number of core cycles per tick of the timing source with a
+ * loop of dependent additions (one cycle per iteration).
+ *
+ * @return     Cycles per tick.
+ */
+static double measure_cycles_per_tick() {
+	uint64_t min_ticks = std::numeric_limits<uint64_t>::max();
+	for (size_t trial = 0; trial < FREQUENCY_REFERENCE_LOOP_TRIALS; trial++) {
+		uint64_t x = 0;
+		uint64_t begin = rdtsc();
+		for (size_t i = 0; i < FREQUENCY_REFERENCE_LOOP_ITERATIONS; i++) {
+			// prevent the compiler from collapsing the loop
+			asm volatile("" : "+r"(x));
+			x++;
+		}
+		uint64_t end = rdtsc();
+		min_ticks = std::min(min_ticks, end - begin);
+	}
+	return (double)FREQUENCY_REFERENCE_LOOP_ITERATIONS / std::max(min_ticks, (uint64_t)1);
+}
+
+/**
+ * Quickly calibrates the Flush+Reload threshold in a fresh mapping.
+ *
+ * @return     The threshold.
+ */
+static size_t quick_calibrate_fr_thresh() {
+	Mapping mapping = allocate_mapping(2 * PAGE_SIZE);
+	size_t fr_thresh = calibrate_thresh(mapping, true);
+	unmap_mapping(mapping);
+	return std::max(fr_thresh, (size_t)1);
+}
+
+/**
+ * Signal handler: restores the minimum frequency and passes the signal on
+ * to the previous handler.
+ *
+ * @param[in]  signal  The signal
+ */
+void FrequencyGuard::unpin_on_signal(int signal) {
+	FrequencyGuard& guard = get();
+	// only async-signal-safe functions: write the pre-formatted value to
+	// the file opened by pin()
+	if (guard.pinned) {
+		if (write(guard.min_freq_fd, guard.min_freq_value, strlen(guard.min_freq_value)) > 0) {
+			guard.pinned = false;
+		}
+	}
+	for (size_t i = 0; i < guard.previous_actions.size(); i++) {
+		if (UNPIN_SIGNALS[i] == signal) {
+			sigaction(signal, &guard.previous_actions[i], NULL);
+		}
+	}
+	raise(signal);
+}
+
+/**
+ * Sets the minimum frequency of the measurement core to its maximum
+ * frequency.
+ */
+void FrequencyGuard::pin() {
+	if (max_freq_khz == 0) {
+		L::warn("Frequency guard: cpufreq is not available, cannot pin the frequency\n");
+		return;
+	}
+	// opened before pinning, such that the signal handlers can restore
+	// the minimum frequency without allocating
+	min_freq_fd = open(cpufreq_path(cpu, "scaling_min_freq").c_str(), O_WRONLY);
+	if (min_freq_fd == -1 || ! write_cpufreq_khz(cpu, "scaling_min_freq", max_freq_khz)) {
+		L::warn("Frequency guard: could not set the minimum frequency of CPU %d (root required)\n", cpu);
+		if (min_freq_fd != -1) {
+			close(min_freq_fd);
+			min_freq_fd = -1;
+		}
+		return;
+	}
+	snprintf(min_freq_value, sizeof(min_freq_value), "%zu\n", min_freq_khz);
+	pinned = true;
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = unpin_on_signal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESETHAND;
+	previous_actions.clear();
+	for (int signal : UNPIN_SIGNALS) {
+		struct sigaction previous;
+		sigaction(signal, &action, &previous);
+		previous_actions.push_back(previous);
+	}
+	L::info("Frequency guard: pinned CPU %d to %zu kHz\n", cpu, max_freq_khz);
+}
+
+/**
+ * Restores the minimum frequency changed by pin().
+ */
+void FrequencyGuard::unpin() {
+	if ( ! pinned) {
+		return;
+	}
+	if ( ! write_cpufreq_khz(cpu, "scaling_min_freq", min_freq_khz)) {
+		L::warn("Frequency guard: could not restore the minimum frequency of CPU %d\n", cpu);
+	}
+	pinned = false;
+	close(min_freq_fd);
+	min_freq_fd = -1;
+	// reinstall the previous handlers, unless another handler was
+	// installed on top of ours in the meantime (e.g., by the
+	// MsrController), which passes the signal on to ours
+	for (size_t i = 0; i < previous_actions.size(); i++) {
+		struct sigaction current;
+		if (sigaction(UNPIN_SIGNALS[i], NULL, &current) == 0 && current.sa_handler == unpin_on_signal) {
+			sigaction(UNPIN_SIGNALS[i], &previous_actions[i], NULL);
+		}
+	}
+}
+
+/**
+ * Starts guarding the frequency of the measurement core: reads the
+ * cpufreq state, pins the frequency (if configured), and measures the
+ * baseline. Must be called after the timing source was initialized.
+ *
+ * @param[in]  cpu   The measurement CPU
+ */
+void FrequencyGuard::start(int cpu) {
+	if (level == FREQUENCY_GUARD_OFF) {
+		return;
+	}
+	this->cpu = cpu;
+	governor = read_cpufreq_string(cpu, "scaling_governor");
+	min_freq_khz = read_cpufreq_khz(cpu, "scaling_min_freq");
+	max_freq_khz = read_cpufreq_khz(cpu, "scaling_max_freq");
+	cur_freq_khz = read_cpufreq_khz(cpu, "scaling_cur_freq");
+	L::info("Frequency guard: CPU %d, governor \"%s\", %zu-%zu kHz (current: %zu kHz)\n", cpu, governor.c_str(), min_freq_khz, max_freq_khz, cur_freq_khz);
+	if (level >= FREQUENCY_GUARD_PIN) {
+		pin();
+	} else if (min_freq_khz != max_freq_khz && governor != "performance") {
+		L::warn("Frequency guard: the frequency of CPU %d is not fixed, consider -g 2\n", cpu);
+	}
+
+	baseline_cycles_per_tick = measure_cycles_per_tick();
+	last_cycles_per_tick = baseline_cycles_per_tick;
+	baseline_quick_fr_thresh = quick_calibrate_fr_thresh();
+	current_quick_fr_thresh = baseline_quick_fr_thresh;
+	last_check_ms = monotonic_ms();
+	L::info("Frequency guard: %.3f cycles per tick, quick Flush+Reload threshold: %zu\n", baseline_cycles_per_tick, baseline_quick_fr_thresh);
+}
+
+/**
+ * Measures the cycles-per-tick ratio (at most every
+ * FREQUENCY_CHECK_INTERVAL_MS) and re-calibrates the Flush+Reload
+ * threshold if it drifted.
+ */
+void FrequencyGuard::check() {
+	uint64_t now_ms = monotonic_ms();
+	if (now_ms - last_check_ms < FREQUENCY_CHECK_INTERVAL_MS) {
+		return;
+	}
+	no_checks++;
+	double cycles_per_tick = measure_cycles_per_tick();
+	double drift = cycles_per_tick / last_cycles_per_tick - 1;
+	if (std::abs(drift) > FREQUENCY_DRIFT_TOLERANCE) {
+		current_quick_fr_thresh = quick_calibrate_fr_thresh();
+		no_recalibrations++;
+		L::warn("Frequency guard: cycles per tick changed by %+.1f%% (%.3f -> %.3f), re-calibrated the Flush+Reload threshold (scale: %zu/%zu)\n",
+			drift * 100, last_cycles_per_tick, cycles_per_tick, current_quick_fr_thresh, baseline_quick_fr_thresh);
+		last_cycles_per_tick = cycles_per_tick;
+	}
+	// do not count the measurement towards the interval
+	last_check_ms = monotonic_ms();
+}
+
+/**
+ * Describes the state of the guard (for the results).
+ *
+ * @return     JSON structure.
+ */
+Json FrequencyGuard::to_json() const {
+	if (level == FREQUENCY_GUARD_OFF) {
+		return Json::object {
+			{"level", (int)level},
+		};
+	}
+	return Json::object {
+		{"level", (int)level},
+		{"cpu", cpu},
+		{"governor", governor},
+		{"min_freq_khz", (int)min_freq_khz},
+		{"max_freq_khz", (int)max_freq_khz},
+		{"cur_freq_khz_at_start", (int)cur_freq_khz},
+		{"pinned", pinned},
+		{"baseline_cycles_per_tick", baseline_cycles_per_tick},
+		{"last_cycles_per_tick", last_cycles_per_tick},
+		{"baseline_quick_fr_thresh", (int)baseline_quick_fr_thresh},
+		{"current_quick_fr_thresh", (int)current_quick_fr_thresh},
+		{"checks", (int)no_checks},
+		{"recalibrations", (int)no_recalibrations},
+	};
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <csignal>
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "json11.hpp"
+
+using json11::Json;
+using std::string;
+using std::vector;
+
+// Maximum relative change of the cycles-per-tick ratio before the
+// Flush+Reload threshold is re-calibrated
+#define FREQUENCY_DRIFT_TOLERANCE 0.05
+// Minimum time between two checks of the cycles-per-tick ratio
+#define FREQUENCY_CHECK_INTERVAL_MS 500
+// Length of the reference loop (1 cycle per iteration) and number of
+// measurements (the fastest one counts)
+#define FREQUENCY_REFERENCE_LOOP_ITERATIONS (1 << 20)
+#define FREQUENCY_REFERENCE_LOOP_TRIALS 5
+
+typedef enum {
+	FREQUENCY_GUARD_OFF = 0,
+	// check the cycles-per-tick ratio and re-calibrate on drift
+	FREQUENCY_GUARD_MONITOR = 1,
+	// additionally, pin the minimum frequency to the maximum frequency
+	FREQUENCY_GUARD_PIN = 2,
+} frequency_guard_level_t;
+
+/**
+ * Detects frequency changes of the measurement core during a run. Timing
+ * sources with a fixed rate (e.g., RDTSC, counter thread) count the same
+ * number of ticks per second, independent of the core frequency, so if
+ * the frequency drops, the hit and miss latencies grow, and the
+ * calibrated Flush+Reload threshold no longer separates them.
+ *
+ * The guard measures the number of core cycles per tick of the timing
+ * source with a reference loop of dependent additions (one cycle per
+ * iteration) at start() and then at most every FREQUENCY_CHECK_INTERVAL_MS
+ * between experiments (see fr_thresh()). If the ratio drifts by more than
+ * FREQUENCY_DRIFT_TOLERANCE, the Flush+Reload threshold is re-calibrated
+ * quickly, and the experiments use the threshold scaled by the ratio of the
+ * new and the initial quick calibration. With a cycle counter as timing
+ * source, the ratio is constant and nothing happens.
+ *
+ * With FREQUENCY_GUARD_PIN, the minimum frequency of the measurement core
+ * (cpufreq scaling_min_freq) is set to its maximum frequency for the run.
+ * The original value is restored at exit and from the handlers for
+ * SIGINT, SIGTERM and fatal signals (which then pass the signal on to the
+ * previously installed handlers).
+ *
+ * There is a single instance, see get().
+ */
+class FrequencyGuard {
+private:
+	static frequency_guard_level_t level;
+
+	int cpu = -1;
+	// cpufreq state at start() (empty/0 if not available)
+	string governor;
+	size_t min_freq_khz = 0;
+	size_t max_freq_khz = 0;
+	size_t cur_freq_khz = 0;
+	// pinned minimum frequency (restored at exit)
+	bool pinned = false;
+	// scaling_min_freq of the CPU and the value to restore, prepared by
+	// pin() for the signal handlers
+	int min_freq_fd = -1;
+	char min_freq_value[32] = {};
+	// signal actions installed before the unpin handlers (kept after
+	// unpin(), handlers installed later may still pass signals on to ours)
+	vector<struct sigaction> previous_actions;
+	// cycles per tick at start() and after the last re-calibration
+	double baseline_cycles_per_tick = 0;
+	double last_cycles_per_tick = 0;
+	// quick calibration of the Flush+Reload threshold at start() and after
+	// the last re-calibration
+	size_t baseline_quick_fr_thresh = 0;
+	size_t current_quick_fr_thresh = 0;
+	// CLOCK_MONOTONIC timestamp of the last check in ms
+	uint64_t last_check_ms = 0;
+	size_t no_checks = 0;
+	size_t no_recalibrations = 0;
+
+	FrequencyGuard() {}
+	~FrequencyGuard();
+
+	void pin();
+	void unpin();
+	static void unpin_on_signal(int signal);
+	void check();
+
+public:
+	FrequencyGuard(FrequencyGuard const&) = delete;
+	FrequencyGuard& operator=(FrequencyGuard const&) = delete;
+
+	static FrequencyGuard& get();
+
+	static inline void configure(frequency_guard_level_t level) {
+		FrequencyGuard::level = level;
+	}
+
+	void start(int cpu);
+
+	/**
+	 * Returns the Flush+Reload threshold to use for the next experiment.
+	 * Checks the frequency first (rate-limited).
+	 *
+	 * @param[in]  calibrated_fr_thresh  The threshold calibrated at the
+	 *                                   beginning of the run
+	 *
+	 * @return     The threshold, scaled if the frequency changed.
+	 */
+	inline size_t fr_thresh(size_t calibrated_fr_thresh) {
+		if (level == FREQUENCY_GUARD_OFF || baseline_quick_fr_thresh == 0) {
+			return calibrated_fr_thresh;
+		}
+		check();
+		return calibrated_fr_thresh * current_quick_fr_thresh / baseline_quick_fr_thresh;
+	}
+
+	/**
+	 * Returns the number of re-calibrations of the Flush+Reload threshold
+	 * so far, i.e., changes the value returned by fr_thresh().
+	 *
+	 * @return     The number of re-calibrations.
+	 */
+	inline size_t recalibrations() const {
+		return no_recalibrations;
+	}
+
+	Json to_json() const;
+};
@@ -0,0 +1,68 @@
+#include <cstring>
+
+#include "generated_maccess.hh"
+
+#if defined(__i386__) || defined(__x86_64__)
+	// movq (%rdi), %rax; ret
+	static uint8_t const MACCESS_CODE[] = { 0x48, 0x8b, 0x07, 0xc3 };
+	// int3
+	static uint8_t const TRAP_CODE[] = { 0xcc };
+	// x86 instructions can start at any byte
+	#define INSTRUCTION_ALIGNMENT 1
+#elif defined(__aarch64__)
+	// ldr x0, [x0]; ret
+	static uint32_t const MACCESS_CODE[] = { 0xf9400000, 0xd65f03c0 };
+	// brk #0
+	static uint32_t const TRAP_CODE[] = { 0xd4200000 };
+	// aarch64 instructions are 4 byte aligned
+	#define INSTRUCTION_ALIGNMENT 4
+#endif
+
+// Distance between two generated functions in bytes. It is chosen as an
+// odd multiple of the instruction alignment, such that the low-order PC
+// bits above the alignment are distinct for any 2^k consecutive
+// functions. This way, prefetchers that index their tables with a few
+// low-order PC bits do not see spurious collisions.
+#define MACCESS_FUNCTION_SPACING (INSTRUCTION_ALIGNMENT * 17)
+static_assert(sizeof(MACCESS_CODE) <= MACCESS_FUNCTION_SPACING, "generated function does not fit into its slot");
+
+/**
+ * Generates `no_functions` maccess functions at runtime, each with a
+ * single load instruction at a distinct PC. In contrast to the statically
+ * compiled functions in aligned_maccess.cc, the number of functions is
+ * only bounded by the available memory. The functions must be released
+ * with `release_maccess_functions()`.
+ *
+ * @param[in]  no_functions  Number of functions to generate
+ *
+ * @return     The generated functions.
+ */
+GeneratedMaccessFunctions generate_maccess_functions(size_t no_functions) {
+	size_t code_size = no_functions * MACCESS_FUNCTION_SPACING;
+	code_size = ((code_size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+	Mapping code = allocate_mapping(code_size);
+
+	// fill the whole mapping with trap instructions, such that a stray
+	// jump does not silently execute garbage
+	for (size_t offset = 0; offset + sizeof(TRAP_CODE) <= code.size; offset += sizeof(TRAP_CODE)) {
+		memcpy(code.base_addr + offset, TRAP_CODE, sizeof(TRAP_CODE));
+	}
+
+	vector<maccess_func_t> funcs;
+	for (size_t i = 0; i < no_functions; i++) {
+		uint8_t* func = code.base_addr + i * MACCESS_FUNCTION_SPACING;
+		memcpy(func, MACCESS_CODE, sizeof(MACCESS_CODE));
+		funcs.push_back((maccess_func_t) func);
+	}
+	make_mapping_executable(code);
+	return GeneratedMaccessFunctions { code, funcs };
+}
+
+/**
+ * Releases functions that were generated by `generate_maccess_functions()`.
+ *
+ * @param      functions  The generated functions
+ */
+void release_maccess_functions(GeneratedMaccessFunctions const& functions) {
+	unmap_mapping(functions.code);
+}
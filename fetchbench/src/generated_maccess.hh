@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+#include "aligned_maccess.hh"
+#include "mapping.hh"
+
+using std::vector;
+
+/**
+ * A set of maccess functions that were generated at runtime. Each function
+ * consists of a single load instruction followed by a return, i.e., each
+ * function loads from a distinct PC.
+ */
+typedef struct {
+	// executable memory holding the generated code
+	Mapping code;
+	// entry points of the generated functions
+	vector<maccess_func_t> funcs;
+} GeneratedMaccessFunctions;
+
+GeneratedMaccessFunctions generate_maccess_functions(size_t no_functions);
+void release_maccess_functions(GeneratedMaccessFunctions const& functions);
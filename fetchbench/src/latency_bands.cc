@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <fstream>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+#include "latency_bands.hh"
+#include "cache_histogram.hh"
+#include "cacheutils.hh"
+#include "logger.hh"
+#include "mapping.hh"
+
+using std::string;
+using std::vector;
+
+LatencyBands LatencyBands::instance;
+
+char const* cache_level_to_string(cache_level_t level) {
+	switch (level) {
+		case CACHE_LEVEL_L1: return "L1";
+		case CACHE_LEVEL_L2: return "L2";
+		case CACHE_LEVEL_LLC: return "LLC";
+		case CACHE_LEVEL_DRAM: return "DRAM";
+		default: return "unknown";
+	}
+}
+
+/**
+ * Reads the size of the data (or unified) cache of the given level of the
+ * current CPU from sysfs.
+ *
+ * @param[in]  level  The cache level
+ *
+ * @return     The size in bytes, 0 if unknown.
+ */
+static size_t read_data_cache_size(int level) {
+	string cpu_path = "/sys/devices/system/cpu/cpu" + std::to_string(sched_getcpu()) + "/cache/";
+	for (size_t index = 0; ; index++) {
+		string cache_path = cpu_path + "index" + std::to_string(index) + "/";
+		std::ifstream level_file {cache_path + "level"};
+		int cache_level;
+		if ( ! (level_file >> cache_level)) {
+			return 0;
+		}
+		string type;
+		std::ifstream {cache_path + "type"} >> type;
+		if (cache_level != level || type == "Instruction") {
+			continue;
+		}
+		// e.g., "48K" or "30M"
+		size_t size = 0;
+		char unit = 0;
+		std::ifstream {cache_path + "size"} >> size >> unit;
+		if (unit == 'K') {
+			size *= 1024;
+		} else if (unit == 'M') {
+			size *= 1024 * 1024;
+		}
+		return size;
+	}
+}
+
+/**
+ * Loads all lines of an eviction buffer, such that lines loaded before are
+ * evicted from every cache smaller than half the buffer.
+ *
+ * @param      eviction_buffer  The eviction buffer
+ */
+static void evict(Mapping const& eviction_buffer) {
+	for (size_t offset = 0; offset < eviction_buffer.size; offset += CACHE_LINE_SIZE) {
+		maccess(eviction_buffer.base_addr + offset);
+	}
+	mfence();
+}
+
+/**
+ * Measures the median load time of lines placed in the given level: the
+ * line is loaded (L1), then evicted from the L1 by loading a buffer twice
+ * the L1 size (L2), or from the L2 by loading a buffer twice the L2 size
+ * (LLC), or flushed (DRAM).
+ *
+ * @param      mapping          The mapping to place the lines in
+ * @param      eviction_buffer  The eviction buffer (unused for L1/DRAM)
+ * @param[in]  level            The level
+ *
+ * @return     The median load time.
+ */
+static size_t measure_level(Mapping const& mapping, Mapping const* eviction_buffer, cache_level_t level) {
+	vector<size_t> times;
+	times.reserve(LATENCY_BANDS_NO_MEASUREMENTS);
+	for (size_t i = 0; i < LATENCY_BANDS_NO_MEASUREMENTS; i++) {
+		uint8_t* ptr = mapping.base_addr + (i * CACHE_LINE_SIZE) % mapping.size;
+		if (level == CACHE_LEVEL_DRAM) {
+			flush(ptr);
+		} else {
+			maccess(ptr);
+		}
+		mfence();
+		if (eviction_buffer != nullptr) {
+			evict(*eviction_buffer);
+		}
+		times.push_back(flush_reload_t(ptr));
+	}
+	std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+	return times[times.size() / 2];
+}
+
+/**
+ * Calibrates the latency bands of the CPU the process runs on, using
+ * eviction-based placement of lines in each level (see measure_level()).
+ * Levels whose size is unknown are not measured (and get empty bands).
+ */
+void LatencyBands::calibrate() {
+	LatencyBands& bands = instance;
+	bands.l1_size = read_data_cache_size(1);
+	bands.l2_size = read_data_cache_size(2);
+	Mapping mapping = allocate_mapping(PAGE_SIZE);
+
+	bands.median[CACHE_LEVEL_L1] = measure_level(mapping, nullptr, CACHE_LEVEL_L1);
+	if (bands.l1_size != 0) {
+		Mapping eviction_buffer = allocate_mapping(2 * bands.l1_size);
+		bands.median[CACHE_LEVEL_L2] = measure_level(mapping, &eviction_buffer, CACHE_LEVEL_L2);
+		unmap_mapping(eviction_buffer);
+	}
+	if (bands.l2_size != 0) {
+		Mapping eviction_buffer = allocate_mapping(2 * bands.l2_size);
+		bands.median[CACHE_LEVEL_LLC] = measure_level(mapping, &eviction_buffer, CACHE_LEVEL_LLC);
+		unmap_mapping(eviction_buffer);
+	}
+	bands.median[CACHE_LEVEL_DRAM] = measure_level(mapping, nullptr, CACHE_LEVEL_DRAM);
+	unmap_mapping(mapping);
+
+	// the band of a level ends in the middle between its median and the
+	// next higher median of a later level
+	size_t lower_bound = 0;
+	for (size_t level = CACHE_LEVEL_L1; level < CACHE_LEVEL_DRAM; level++) {
+		bands.upper_bound[level] = lower_bound;
+		if (bands.median[level] == 0 || bands.median[level] < lower_bound) {
+			continue;
+		}
+		size_t next = level + 1;
+		while (next <= CACHE_LEVEL_DRAM && bands.median[next] <= bands.median[level]) {
+			next++;
+		}
+		if (next > CACHE_LEVEL_DRAM) {
+			continue;
+		}
+		bands.upper_bound[level] = std::max(lower_bound, (bands.median[level] + bands.median[next]) / 2);
+		lower_bound = bands.upper_bound[level];
+	}
+	bands.upper_bound[CACHE_LEVEL_DRAM] = SIZE_MAX;
+	bands.calibrated = true;
+	L::info("Latency bands: %s\n", bands.to_json().dump().c_str());
+}
+
+Json LatencyBands::to_json() const {
+	Json::object medians, upper_bounds;
+	for (size_t level = 0; level < NO_CACHE_LEVELS; level++) {
+		medians[cache_level_to_string((cache_level_t)level)] = (int)median[level];
+		if (level != CACHE_LEVEL_DRAM) {
+			upper_bounds[cache_level_to_string((cache_level_t)level)] = (int)upper_bound[level];
+		}
+	}
+	return Json::object {
+		{"calibrated", calibrated},
+		{"l1_size", (int)l1_size},
+		{"l2_size", (int)l2_size},
+		{"median", medians},
+		{"upper_bound", upper_bounds},
+	};
+}
+
+/**
+ * Returns the single instance.
+ *
+ * @return     The fill level summary.
+ */
+FillLevelSummary& FillLevelSummary::get() {
+	static FillLevelSummary instance;
+	return instance;
+}
+
+void FillLevelSummary::reset() {
+	no_traces = 0;
+	std::fill(std::begin(counts), std::end(counts), 0);
+}
+
+/**
+ * Adds the fill levels of the prefetched lines of a trace.
+ *
+ * @param      cache_histogram  The cache histogram
+ * @param      prefetch_vector  The prefetched lines
+ */
+void FillLevelSummary::add(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector) {
+	no_traces++;
+	for (size_t idx = prefetch_vector.find_first(); idx < prefetch_vector.size(); idx = prefetch_vector.find_next(idx)) {
+		counts[cache_histogram.fill_level(idx)]++;
+	}
+}
+
+/**
+ * Describes the fill levels of all prefetched lines added since the last
+ * reset().
+ *
+ * @return     JSON structure with the number of prefetched lines per
+ *             level and the latency bands used.
+ */
+Json FillLevelSummary::to_json() const {
+	Json::object prefetched_lines;
+	for (size_t level = 0; level <= NO_CACHE_LEVELS; level++) {
+		if (level != CACHE_LEVEL_DRAM) {
+			prefetched_lines[cache_level_to_string((cache_level_t)level)] = (int)counts[level];
+		}
+	}
+	return Json::object {
+		{"traces", (int)no_traces},
+		{"prefetched_lines", prefetched_lines},
+		{"latency_bands", LatencyBands::get().to_json()},
+	};
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cinttypes>
+
+#include "json11.hpp"
+
+using json11::Json;
+
+// Number of timed accesses per cache level during the calibration (the
+// median counts)
+#define LATENCY_BANDS_NO_MEASUREMENTS 501
+
+/**
+ * Level of the memory hierarchy an access was served from.
+ */
+typedef enum {
+	CACHE_LEVEL_L1 = 0,
+	CACHE_LEVEL_L2 = 1,
+	CACHE_LEVEL_LLC = 2,
+	CACHE_LEVEL_DRAM = 3,
+	NO_CACHE_LEVELS = 4,
+	// latency bands not calibrated
+	CACHE_LEVEL_UNKNOWN = NO_CACHE_LEVELS,
+} cache_level_t;
+
+char const* cache_level_to_string(cache_level_t level);
+
+/**
+ * Access latency bands of the memory hierarchy: a load that takes less
+ * than upper_bound[l] ticks (and at least upper_bound[l-1]) is attributed
+ * to level l. The bounds are the midpoints between the median latencies of
+ * adjacent levels. A level with a median not above the one of the level
+ * before cannot be told apart and gets an empty band.
+ */
+class LatencyBands {
+private:
+	bool calibrated = false;
+	// median latency per level
+	size_t median[NO_CACHE_LEVELS] = {};
+	// upper bound (exclusive) of the band per level
+	size_t upper_bound[NO_CACHE_LEVELS] = {};
+	// data cache sizes used for the eviction (0 if unknown)
+	size_t l1_size = 0;
+	size_t l2_size = 0;
+
+	static LatencyBands instance;
+
+public:
+	/**
+	 * Returns the bands calibrated by calibrate() (not calibrated before).
+	 *
+	 * @return     The latency bands.
+	 */
+	static inline LatencyBands const& get() {
+		return instance;
+	}
+
+	static void calibrate();
+
+	inline bool is_calibrated() const {
+		return calibrated;
+	}
+
+	/**
+	 * Returns the size of the L2 (data) cache of the calibrated CPU.
+	 *
+	 * @return     The size in bytes, 0 if unknown.
+	 */
+	inline size_t get_l2_size() const {
+		return l2_size;
+	}
+
+	/**
+	 * Attributes a load time to a level of the memory hierarchy.
+	 *
+	 * @param[in]  time  The load time (ticks)
+	 *
+	 * @return     The level, CACHE_LEVEL_UNKNOWN if not calibrated.
+	 */
+	inline cache_level_t classify(size_t time) const __attribute__((always_inline)) {
+		if ( ! calibrated) {
+			return CACHE_LEVEL_UNKNOWN;
+		}
+		for (size_t level = CACHE_LEVEL_L1; level < CACHE_LEVEL_DRAM; level++) {
+			if (time < upper_bound[level]) {
+				return (cache_level_t)level;
+			}
+		}
+		return CACHE_LEVEL_DRAM;
+	}
+
+	Json to_json() const;
+};
+
+class CacheHistogram;
+class PrefetchVector;
+
+/**
+ * Counts the fill levels of the prefetched lines of all experiment traces
+ * dumped during a characterization (see TestCaseBase::run()). There is a
+ * single instance, see get().
+ */
+class FillLevelSummary {
+private:
+	size_t no_traces = 0;
+	size_t counts[NO_CACHE_LEVELS + 1] = {};
+
+	FillLevelSummary() {}
+
+public:
+	static FillLevelSummary& get();
+
+	void reset();
+	void add(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector);
+	Json to_json() const;
+};
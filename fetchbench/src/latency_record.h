@@ -0,0 +1,54 @@
+#ifndef LATENCY_RECORD_H
+#define LATENCY_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+Accumulator for the timings of a latency experiment (pointer array and
+pointer chasing tests), shared by the C experiment code and LatencySamples.
+Each repetition yields one timing for the measured and one timing for the
+reference location. Instead of storing every timing, the timings of both
+streams are counted in fixed-size histograms, such that the memory needed
+does not depend on the number of repetitions.
+*/
+
+// Number of buckets of a latency histogram. Bucket t counts the timings
+// equal to t; the last bucket also counts all larger timings.
+#define LATENCY_HISTOGRAM_BUCKETS 2048
+
+typedef struct {
+    uint32_t counts[LATENCY_HISTOGRAM_BUCKETS];
+    uint64_t total;
+} latency_histogram_t;
+
+typedef struct {
+    latency_histogram_t measurements;
+    latency_histogram_t references;
+    // optional (for debugging): if not NULL, the raw timings are stored in
+    // these arrays as well, indexed by repetition
+    uint64_t* raw_measurements;
+    uint64_t* raw_references;
+} latency_record_t;
+
+// records the timing of one repetition
+static inline void latency_record_add(latency_record_t* record, size_t repetition, int is_reference, uint64_t timing){
+    latency_histogram_t* histogram = is_reference ? &record->references : &record->measurements;
+    histogram->counts[timing < LATENCY_HISTOGRAM_BUCKETS ? timing : LATENCY_HISTOGRAM_BUCKETS - 1]++;
+    histogram->total++;
+
+    uint64_t* raw = is_reference ? record->raw_references : record->raw_measurements;
+    if(raw != NULL){
+        raw[repetition] = timing;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_RECORD_H */
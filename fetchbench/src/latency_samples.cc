@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <string>
+
+#include "latency_samples.hh"
+
+/**
+ * Counts the timings below a threshold.
+ *
+ * @param      histogram  The histogram
+ * @param[in]  threshold  The threshold (exclusive)
+ *
+ * @return     Number of timings below the threshold.
+ */
+static size_t count_below(latency_histogram_t const& histogram, uint64_t threshold) {
+	size_t count = 0;
+	for (uint64_t t = 0; t < threshold && t < LATENCY_HISTOGRAM_BUCKETS; t++) {
+		count += histogram.counts[t];
+	}
+	return count;
+}
+
+/**
+ * Returns a percentile of the timings, i.e., the value at index
+ * (total * percentile / 100) if the timings were sorted.
+ *
+ * @param      histogram   The histogram
+ * @param[in]  percentile  The percentile (in [0, 100))
+ *
+ * @return     The percentile (0 for an empty histogram).
+ */
+static uint64_t percentile(latency_histogram_t const& histogram, size_t percentile) {
+	if (histogram.total == 0) {
+		return 0;
+	}
+	uint64_t idx = histogram.total * percentile / 100;
+	uint64_t cumulative = 0;
+	for (uint64_t t = 0; t < LATENCY_HISTOGRAM_BUCKETS; t++) {
+		cumulative += histogram.counts[t];
+		if (cumulative > idx) {
+			return t;
+		}
+	}
+	return LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * Returns selected percentiles of the timings.
+ *
+ * @param      histogram  The histogram
+ *
+ * @return     JSON object mapping each of LATENCY_SUMMARY_PERCENTILES to
+ *             its value.
+ */
+static Json quantiles_to_json(latency_histogram_t const& histogram) {
+	Json::object quantiles;
+	for (size_t p : LATENCY_SUMMARY_PERCENTILES) {
+		quantiles["p" + std::to_string(p)] = (int)percentile(histogram, p);
+	}
+	return quantiles;
+}
+
+/**
+ * Converts the non-empty buckets of a histogram to JSON.
+ *
+ * @param      histogram  The histogram
+ *
+ * @return     JSON array of [timing, count] pairs.
+ */
+static Json histogram_to_json(latency_histogram_t const& histogram) {
+	Json::array buckets_json;
+	for (uint64_t t = 0; t < LATENCY_HISTOGRAM_BUCKETS; t++) {
+		if (histogram.counts[t] != 0) {
+			buckets_json.push_back(Json::array {(int)t, (int)histogram.counts[t]});
+		}
+	}
+	return buckets_json;
+}
+
+/**
+ * Converts raw timings to JSON (sorted).
+ *
+ * @param      raw   The raw timings
+ *
+ * @return     JSON array with the sorted timings.
+ */
+static Json raw_to_json(vector<uint64_t> raw) {
+	std::sort(raw.begin(), raw.end());
+	Json::array raw_json;
+	for (uint64_t timing : raw) {
+		raw_json.push_back((int)timing);
+	}
+	return raw_json;
+}
+
+/**
+ * Returns the timing below which a sample is counted as a hit, i.e., the
+ * LATENCY_HIT_REFERENCE_PERCENTILE-th percentile of the references.
+ *
+ * @return     The threshold.
+ */
+uint64_t LatencySamples::hit_threshold() const {
+	return percentile(rec.references, LATENCY_HIT_REFERENCE_PERCENTILE);
+}
+
+size_t LatencySamples::count_measurement_hits() const {
+	return count_below(rec.measurements, hit_threshold());
+}
+
+size_t LatencySamples::count_reference_hits() const {
+	return count_below(rec.references, hit_threshold());
+}
+
+/**
+ * Computes how far the measurements are shifted towards faster timings
+ * compared to the references: the largest difference between the
+ * cumulative distributions of both streams (one-sided Kolmogorov-Smirnov
+ * statistic).
+ *
+ * @return     The separation in [0, 1] (0: measurements not faster than
+ *             the references, 1: all measurements faster than all
+ *             references).
+ */
+double LatencySamples::separation() const {
+	if (rec.measurements.total == 0 || rec.references.total == 0) {
+		return 0;
+	}
+	uint64_t cumulative_measurements = 0;
+	uint64_t cumulative_references = 0;
+	double max_difference = 0;
+	for (uint64_t t = 0; t < LATENCY_HISTOGRAM_BUCKETS; t++) {
+		cumulative_measurements += rec.measurements.counts[t];
+		cumulative_references += rec.references.counts[t];
+		double difference = (double)cumulative_measurements / rec.measurements.total
+			- (double)cumulative_references / rec.references.total;
+		max_difference = std::max(max_difference, difference);
+	}
+	return max_difference;
+}
+
+/**
+ * Decides whether the measured location was (significantly more often)
+ * cached than the reference location, see compare_proportions().
+ *
+ * @return     The verdict.
+ */
+verdict_t LatencySamples::verdict() const {
+	return compare_proportions(count_measurement_hits(), size(), count_reference_hits(), rec.references.total);
+}
+
+/**
+ * Summarizes the samples, incl. the verdict.
+ *
+ * @return     JSON structure describing the summary.
+ */
+Json LatencySamples::summary_to_json() const {
+	return Json::object {
+		{"median_measurement", (int)percentile(rec.measurements, 50)},
+		{"median_reference", (int)percentile(rec.references, 50)},
+		{"quantiles_measurement", quantiles_to_json(rec.measurements)},
+		{"quantiles_reference", quantiles_to_json(rec.references)},
+		{"hit_threshold", (int)hit_threshold()},
+		{"hits_measurement", (int)count_measurement_hits()},
+		{"hits_reference", (int)count_reference_hits()},
+		{"separation", separation()},
+		{"no_repetitions", (int)size()},
+		{"verdict", verdict_to_string(verdict())},
+	};
+}
+
+/**
+ * Converts the histograms (and the raw timings, if they were kept) to
+ * JSON (for plotting).
+ *
+ * @return     JSON structure with the histograms.
+ */
+Json LatencySamples::to_json() const {
+	Json::object json {
+		{"histogram_measurement", histogram_to_json(rec.measurements)},
+		{"histogram_reference", histogram_to_json(rec.references)},
+	};
+	if ( ! raw_measurements.empty()) {
+		json["measurements"] = raw_to_json(raw_measurements);
+		json["references"] = raw_to_json(raw_references);
+	}
+	return json;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cinttypes>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "latency_record.h"
+#include "search.hh"
+
+using json11::Json;
+using std::vector;
+
+// A measurement counts as a hit if it is faster than this percentile of
+// the reference timings (which are cache misses by construction).
+#define LATENCY_HIT_REFERENCE_PERCENTILE 5
+// Percentiles reported by LatencySamples::summary_to_json()
+#define LATENCY_SUMMARY_PERCENTILES {5, 25, 50, 75, 95}
+
+/**
+ * Timings of a latency experiment (e.g., the pointer array and pointer
+ * chasing tests), where each repetition yields one timing for the
+ * possibly prefetched location ("measurement") and one timing for a
+ * location that is never accessed before ("reference"). The experiment
+ * code accumulates the timings of both streams in histograms (see
+ * latency_record.h). Optionally, the raw timings are kept as well (for
+ * debugging).
+ */
+class LatencySamples {
+private:
+	latency_record_t rec {};
+	vector<uint64_t> raw_measurements;
+	vector<uint64_t> raw_references;
+
+public:
+	explicit LatencySamples(size_t no_repetitions, bool keep_raw = false) {
+		if (keep_raw) {
+			raw_measurements.resize(no_repetitions, 0);
+			raw_references.resize(no_repetitions, 0);
+		}
+	}
+
+	/**
+	 * Returns the accumulator to pass to the experiment code.
+	 *
+	 * @return     Pointer to the accumulator (valid until the object is
+	 *             modified or destroyed).
+	 */
+	inline latency_record_t* record() {
+		rec.raw_measurements = raw_measurements.empty() ? nullptr : raw_measurements.data();
+		rec.raw_references = raw_references.empty() ? nullptr : raw_references.data();
+		return &rec;
+	}
+
+	inline size_t size() const {
+		return rec.measurements.total;
+	}
+
+	uint64_t hit_threshold() const;
+	size_t count_measurement_hits() const;
+	size_t count_reference_hits() const;
+	double separation() const;
+	verdict_t verdict() const;
+
+	Json summary_to_json() const;
+	Json to_json() const;
+};
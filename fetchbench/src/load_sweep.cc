@@ -0,0 +1,211 @@
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <sstream>
+
+#include "load_sweep.hh"
+#include "logger.hh"
+#include "utils.hh"
+
+/**
+ * Parses the number of background load threads.
+ *
+ * @param      spec  "<streaming threads>,<random-access threads>", or a
+ *                   single number of streaming threads
+ *
+ * @return     The numbers of streaming and random-access threads. Exits on
+ *             invalid input.
+ */
+pair<size_t, size_t> parse_load_threads(string const& spec) {
+	char* end;
+	long no_streaming = strtol(spec.c_str(), &end, 10);
+	long no_random = 0;
+	if (*end == ',') {
+		char const* random_spec = end + 1;
+		no_random = strtol(random_spec, &end, 10);
+		if (end == random_spec) {
+			no_random = -1;
+		}
+	}
+	if (spec.empty() || *end != '\0' || no_streaming < 0 || no_random < 0 || no_streaming + no_random == 0) {
+		L::err("Invalid background load threads \"%s\" (expected \"<streaming>,<random>\")\n", spec.c_str());
+		exit(1);
+	}
+	return {no_streaming, no_random};
+}
+
+/**
+ * Parses the background load levels of a load sweep.
+ *
+ * @param      spec  Comma-separated list of target bandwidths in MB/s,
+ *                   where 0 means no background load and "max" means
+ *                   unthrottled load
+ *
+ * @return     The levels (BACKGROUND_LOAD_UNTHROTTLED for "max"). Exits on
+ *             invalid input.
+ */
+vector<double> parse_load_levels(string const& spec) {
+	vector<double> levels;
+	std::istringstream stream {spec};
+	string item;
+	while (std::getline(stream, item, ',')) {
+		if (item == "max") {
+			levels.push_back(BACKGROUND_LOAD_UNTHROTTLED);
+			continue;
+		}
+		char* end;
+		double level = strtod(item.c_str(), &end);
+		if (item.empty() || *end != '\0' || level < 0) {
+			L::err("Invalid background load level \"%s\" (must be a bandwidth in MB/s or \"max\")\n", item.c_str());
+			exit(1);
+		}
+		levels.push_back(level);
+	}
+	return levels;
+}
+
+static string level_to_string(double level) {
+	if (level == BACKGROUND_LOAD_UNTHROTTLED) {
+		return "max";
+	}
+	return std::to_string((size_t)level);
+}
+
+/**
+ * Returns the working directory of a load level. Each level runs in its
+ * own directory, such that the traces of the levels do not overwrite each
+ * other.
+ */
+static string level_directory(string const& testcase_id, size_t idx, double level) {
+	return LOAD_SWEEP_DIRECTORY_PREFIX + testcase_id + "-" + std::to_string(idx) + "-" + level_to_string(level);
+}
+
+/**
+ * Runs the testcase under one background load level in the working
+ * directory of the level.
+ *
+ * @return     JSON structure with the achieved load and the results.
+ */
+static Json run_level(TestCaseBase& testcase, BackgroundLoad& load, size_t idx, double level, bool only_identification) {
+	string directory = level_directory(testcase.id(), idx, level);
+	if (mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST) {
+		L::err("load sweep: mkdir error (%s): %s\n", directory.c_str(), strerror(errno));
+		exit(1);
+	}
+	if (chdir(directory.c_str()) == -1) {
+		L::err("load sweep: chdir error (%s): %s\n", directory.c_str(), strerror(errno));
+		exit(1);
+	}
+
+	L::info("load sweep: running \"%s\" with background load %s MB/s\n", testcase.id().c_str(), level_to_string(level).c_str());
+	Json load_json = Json::object {
+		{"target_mbps", 0},
+		{"throttled", false},
+		{"achieved_mbps", 0},
+		{"threads", Json::array {}},
+	};
+	if (level != 0) {
+		load.start(level);
+	}
+	Json result = testcase.run(only_identification);
+	if (level != 0) {
+		load_json = load.stop();
+	}
+	json_dump_to_file(result, "results-" + testcase.id() + ".json");
+
+	if (chdir("..") == -1) {
+		L::err("load sweep: chdir error (..): %s\n", strerror(errno));
+		exit(1);
+	}
+	return Json::object {
+		{"level", level_to_string(level)},
+		{"directory", directory},
+		{"load", load_json},
+		{"results", result},
+	};
+}
+
+/**
+ * Load sweep mode: runs a testcase once per background load level (see
+ * BackgroundLoad) and reports how the prefetch metrics (degree, distance,
+ * coverage, see PrefetchMetrics) change as the bandwidth of the
+ * background load rises. The metrics of the identification and (if it
+ * ran) the characterization are tabulated per level, ordered by the
+ * achieved bandwidth, together with the change from the lowest to the
+ * highest load.
+ *
+ * @param      testcase             The testcase
+ * @param      load                 The background load threads
+ * @param[in]  levels               The target bandwidths in MB/s (0: no
+ *                                  load, BACKGROUND_LOAD_UNTHROTTLED:
+ *                                  unthrottled)
+ * @param[in]  only_identification  Whether to run only the
+ *                                  identification tests
+ *
+ * @return     JSON structure with the results per level and the changes
+ *             of the prefetch metrics.
+ */
+Json run_load_sweep(TestCaseBase& testcase, BackgroundLoad& load, vector<double> const& levels, bool only_identification) {
+	vector<Json> level_results;
+	for (size_t idx = 0; idx < levels.size(); idx++) {
+		level_results.push_back(run_level(testcase, load, idx, levels[idx], only_identification));
+	}
+
+	// order the levels by the achieved bandwidth
+	vector<size_t> order(levels.size());
+	for (size_t idx = 0; idx < order.size(); idx++) {
+		order[idx] = idx;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return level_results[a]["load"]["achieved_mbps"].number_value() < level_results[b]["load"]["achieved_mbps"].number_value();
+	});
+
+	// prefetch metrics per level, printed as a table (one column per level)
+	char const* const phases[] = {"identification", "characteristics"};
+	char const* const metrics[] = {"mean_degree", "mean_distance", "max_distance", "coverage", "timeliness"};
+	L::info("load sweep: prefetch metrics of \"%s\" per level (columns: achieved MB/s", testcase.id().c_str());
+	for (size_t idx : order) {
+		L::info(" %.0f", level_results[idx]["load"]["achieved_mbps"].number_value());
+	}
+	L::info(")\n");
+	Json::object changes_json;
+	for (char const* phase : phases) {
+		for (char const* metric : metrics) {
+			string name = string {phase} + "." + metric;
+			string row;
+			vector<double> values;
+			for (size_t idx : order) {
+				Json const& phase_metrics = level_results[idx]["results"][phase]["prefetch_metrics"];
+				if ( ! phase_metrics.is_object() || phase_metrics["traces"].int_value() == 0) {
+					row += " -";
+					continue;
+				}
+				double value = phase_metrics[metric].number_value();
+				values.push_back(value);
+				char buffer[32];
+				snprintf(buffer, sizeof(buffer), " %.2f", value);
+				row += buffer;
+			}
+			if (values.size() < 2) {
+				continue;
+			}
+			L::info("  %-40s%s\n", name.c_str(), row.c_str());
+			changes_json[name] = Json::object {
+				{"lowest_load", values.front()},
+				{"highest_load", values.back()},
+				{"relative_change", (values.front() != 0) ? (values.back() - values.front()) / values.front() : 0.0},
+			};
+		}
+	}
+
+	Json::array levels_json;
+	for (size_t idx : order) {
+		levels_json.push_back(level_results[idx]);
+	}
+	return Json::object {
+		{"testcase", testcase.id()},
+		{"load_threads", (int)load.no_threads()},
+		{"levels", levels_json},
+		{"metric_changes", changes_json},
+	};
+}
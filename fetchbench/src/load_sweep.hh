@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "testcase.hh"
+#include "background_load.hh"
+
+using json11::Json;
+using std::pair;
+using std::string;
+using std::vector;
+
+// Prefix of the working directory of each load level
+#define LOAD_SWEEP_DIRECTORY_PREFIX "load-"
+
+pair<size_t, size_t> parse_load_threads(string const& spec);
+vector<double> parse_load_levels(string const& spec);
+Json run_load_sweep(TestCaseBase& testcase, BackgroundLoad& load, vector<double> const& levels, bool only_identification);
@@ -11,18 +11,46 @@
 #include "logger.hh"
 #include "calibrate.hh"
 #include "cacheutils.hh"
+#include "result_cache.hh"
+#include "msr_controller.hh"
+#include "matrix.hh"
+#include "topology.hh"
+#include "noise_monitor.hh"
+#include "quiet_mode.hh"
+#include "frequency_guard.hh"
+#include "latency_bands.hh"
+#include "access_kind.hh"
+#include "background_load.hh"
+#include "load_sweep.hh"
+#include "numa_compare.hh"
 
 using json11::Json;
 using std::string;
 using std::unique_ptr;
 using std::make_unique;
+using std::pair;
+
+/**
+ * Adds the CPU placement to the results of a testcase.
+ *
+ * @param      results    The results
+ * @param      placement  The placement
+ *
+ * @return     The results incl. the placement.
+ */
+static Json with_placement(Json const& results, Json const& placement) {
+	Json::object items = results.object_items();
+	items["placement"] = placement;
+	return items;
+}
 
 int main(int argc, char** argv) {
 	// === parse command line options ===
-	// (-c) CPU core to move the process to
-	int opt_target_cpu = 0;
-	// (-e) CPU core to move the counter thread to
-	int opt_ctr_cpu = 1;
+	// (-c) CPU core to move the process to (-1: select automatically)
+	int opt_target_cpu = -1;
+	// (-e) CPU core to move the counter thread to (-1: select
+	// automatically)
+	int opt_ctr_cpu = -1;
 	// (-f) Flush+Reload Threshold
 	size_t opt_fr_thresh = 0;
 	// (-t) Which testcase to run
@@ -33,9 +61,39 @@ int main(int argc, char** argv) {
 	int opt_use_nanosleep = -1;
 	// (-i) Flag to only run identification tests
 	int opt_only_identification = 0;
+	// (-x) Flag to use the incremental step sweep in the stride overview
+	int opt_incremental_overview = 0;
+	// (-a) Maximum age of cached baseline results in minutes (0 = disabled)
+	size_t opt_result_cache_max_age_min = RESULT_CACHE_DEFAULT_MAX_AGE_MIN;
+	// (-r) Flag to keep and dump the raw timings of latency experiments
+	int opt_raw_samples = 0;
+	// (-m) Prefetcher configurations to run the testcase with (matrix mode)
+	string opt_matrix_masks = "";
+	// (-p) CPU cores to spread the configurations across (matrix mode)
+	string opt_matrix_cpus = "";
+	// (-d) Flag to discard repetitions disturbed by noise (interrupts,
+	// preemption, page faults)
+	int opt_discard_noisy = 0;
+	// (-q) Quiet mode level (see quiet_mode_level_t)
+	int opt_quiet_mode = QUIET_MODE_OFF;
+	// (-g) Frequency guard level (see frequency_guard_level_t)
+	int opt_frequency_guard = FREQUENCY_GUARD_OFF;
+	// (-k) Access kinds to run the identification tests with
+	string opt_access_kinds = "load";
+	// (-b) Background load threads (load sweep mode): "<streaming>,<random>"
+	string opt_load_threads = "";
+	// (-w) Background load levels in MB/s (load sweep mode)
+	string opt_load_levels = "0,max";
+	// (-o) Interfering patterns of the pollution testcase
+	string opt_pollution_patterns = "all";
+	// (-l) NUMA node to bind all mappings to (-1: the kernel decides)
+	int opt_numa_node = MAPPING_NO_NUMA_NODE;
+	// (-u) NUMA nodes to compare (NUMA comparison mode): "<local>,<remote>"
+	// or "auto"
+	string opt_numa_compare = "";
 
 	int opt;
-	while ((opt = getopt(argc, argv, "c:e:f:t:n:s:i:")) != -1) {
+	while ((opt = getopt(argc, argv, "c:e:f:t:n:s:i:x:a:r:m:p:d:q:g:k:b:w:o:l:u:")) != -1) {
 		switch (opt) {
 			case 'c':
 				opt_target_cpu = atoi(optarg);
@@ -70,50 +128,277 @@ int main(int argc, char** argv) {
 					exit(EXIT_FAILURE);	
 				}
 				break;
+			case 'x':
+				opt_incremental_overview = atoi(optarg);
+				if ( ! (opt_incremental_overview == 0 || opt_incremental_overview == 1)) {
+					fprintf(stderr, "Invalid incremental overview flag (-x) (must be either 0 or 1).\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'a': {
+				int max_age_min = atoi(optarg);
+				if (max_age_min < 0) {
+					fprintf(stderr, "Invalid max. age of cached results (-a) (must be >= 0).\n");
+					exit(EXIT_FAILURE);
+				}
+				opt_result_cache_max_age_min = max_age_min;
+				break;
+			}
+			case 'r':
+				opt_raw_samples = atoi(optarg);
+				if ( ! (opt_raw_samples == 0 || opt_raw_samples == 1)) {
+					fprintf(stderr, "Invalid raw samples flag (-r) (must be either 0 or 1).\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'm':
+				opt_matrix_masks = string {optarg};
+				break;
+			case 'p':
+				opt_matrix_cpus = string {optarg};
+				break;
+			case 'd':
+				opt_discard_noisy = atoi(optarg);
+				if ( ! (opt_discard_noisy == 0 || opt_discard_noisy == 1)) {
+					fprintf(stderr, "Invalid discard flag (-d) (must be either 0 or 1).\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'q':
+				opt_quiet_mode = atoi(optarg);
+				if ( ! (opt_quiet_mode >= QUIET_MODE_OFF && opt_quiet_mode <= QUIET_MODE_SYSTEM)) {
+					fprintf(stderr, "Invalid quiet mode level (-q) (must be 0, 1 or 2).\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'g':
+				opt_frequency_guard = atoi(optarg);
+				if ( ! (opt_frequency_guard >= FREQUENCY_GUARD_OFF && opt_frequency_guard <= FREQUENCY_GUARD_PIN)) {
+					fprintf(stderr, "Invalid frequency guard level (-g) (must be 0, 1 or 2).\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'k':
+				opt_access_kinds = string {optarg};
+				break;
+			case 'b':
+				opt_load_threads = string {optarg};
+				break;
+			case 'w':
+				opt_load_levels = string {optarg};
+				break;
+			case 'o':
+				opt_pollution_patterns = string {optarg};
+				break;
+			case 'l':
+				opt_numa_node = atoi(optarg);
+				if (opt_numa_node < 0) {
+					fprintf(stderr, "Invalid NUMA node (-l) (must be >= 0).\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'u':
+				opt_numa_compare = string {optarg};
+				break;
 			default: // unknown option
 				fprintf(stderr,
 					"Usage: %s\n"
-					"  [-c <CPU core to run the tests on>]\n"
-					"  [-e <CPU core to use for a counter thread (if enabled)>]\n"
+					"  [-c <CPU core to run the tests on (default: selected automatically)>]\n"
+					"  [-e <CPU core to use for a counter thread (if enabled, default: selected automatically)>]\n"
 					"  [-f <Flush+Reload threshold>]\n"
 					"  [-n <Noise threshold (float in [0, 1000])>]\n"
 					"  [-s <use_nanosleep flag (0 or 1)>]\n"
 					"  [-i <only_identification flag (0 or 1)>]\n"
-					"  [-t <testcase>]\n",
+					"  [-x <incremental_overview flag (0 or 1): only probe lines that can newly become prefetched in the stride overview>]\n"
+					"  [-a <max. age of cached baseline results in minutes (0 disables caching)>]\n"
+					"  [-r <raw_samples flag (0 or 1): dump raw timings of latency experiments>]\n"
+					"  [-d <discard_noisy flag (0 or 1): discard repetitions disturbed by interrupts, preemption or page faults>]\n"
+					"  [-q <quiet mode (0: off, 1: SCHED_FIFO, mlockall, no THP, 2: additionally move IRQs and other threads away)>]\n"
+					"  [-g <frequency guard (0: off, 1: re-calibrate if the frequency changes, 2: additionally pin the minimum frequency to the maximum)>]\n"
+					"  [-k <access kinds for the identification tests (\"all\" or comma-separated, e.g., \"load,store,prefetch_t0\")>]\n"
+					"  [-t <testcase>]\n"
+					"  [-o <interfering patterns of the pollution testcase (\"all\" or comma-separated: stream, stride, region)>]\n"
+					"  [-m <prefetcher masks for matrix mode (\"all\" or comma-separated, bit i enables prefetcher i)>]\n"
+					"  [-p <CPU cores for matrix mode (e.g., \"0,2,4\"), defaults to -c>]\n"
+					"  [-b <background load threads for load sweep mode (\"<streaming>,<random>\")>]\n"
+					"  [-w <background load levels in MB/s for load sweep mode (comma-separated, 0: no load, \"max\": unthrottled, default: \"0,max\")>]\n"
+					"  [-l <NUMA node to bind the memory of the tests to (default: the kernel decides)>]\n"
+					"  [-u <NUMA nodes for NUMA comparison mode (\"<local>,<remote>\" or \"auto\")>]\n",
 					argv[0]
 				);
 				exit(EXIT_FAILURE);
 		}
 	}
 
-	// Pin process to first CPU core
+	// Select the CPU cores based on the topology (unless specified). This
+	// has to happen before pinning, as only the CPUs the process may run
+	// on are considered.
+	Topology topology = Topology::discover();
+	bool auto_target_cpu = (opt_target_cpu == -1);
+	bool auto_ctr_cpu = (opt_ctr_cpu == -1);
+	if (auto_target_cpu) {
+		opt_target_cpu = topology.select_measurement_cpu();
+	}
+	if (auto_ctr_cpu) {
+		opt_ctr_cpu = topology.select_counter_cpu(opt_target_cpu);
+	}
+	Json placement = Json::object {
+		{"measurement", topology.cpu_to_json(opt_target_cpu)},
+		{"measurement_selected_automatically", auto_target_cpu},
+		{"counter_thread", topology.cpu_to_json(opt_ctr_cpu)},
+		{"counter_thread_selected_automatically", auto_ctr_cpu},
+	};
+	L::info("CPU placement: %s\n", placement.dump().c_str());
+
+	// Pin process to the measurement CPU core
 	L::info("Pinning process to CPU %d\n", opt_target_cpu);
 	pin_process_to_cpu(0, opt_target_cpu);
 
 	// Initialize counter thread (if enabled and necessary on the platform)
 	clock_init(opt_ctr_cpu);
 
+	// Guard the frequency (if enabled). This has to happen before the
+	// calibration, such that it runs at the pinned frequency already.
+	FrequencyGuard::configure((frequency_guard_level_t)opt_frequency_guard);
+	FrequencyGuard::get().start(opt_target_cpu);
+
 	// Calibrate Flush+Reload threshold, noise threshold and sleep requirement (or use provided value)
 	calibrate(opt_fr_thresh, opt_noise_thresh, opt_use_nanosleep);
 	bool use_nanosleep = (opt_use_nanosleep != 0);
 	L::info("Using Flush+Reload threshold: %zu, noise threshold: %zu, use_nanosleep: %d\n", opt_fr_thresh, opt_noise_thresh, use_nanosleep);
 
+	// Calibrate the latency bands of the cache levels (to attribute
+	// prefetches to the level they fill)
+	LatencyBands::calibrate();
+
+	// Discard repetitions disturbed by noise (or not)
+	NoiseMonitor::set_enabled(opt_discard_noisy != 0);
+	L::info("Discarding noisy repetitions: %d\n", opt_discard_noisy);
+
+	// Quiet mode for the testcases. In matrix mode, the workers would move
+	// the IRQs and threads concurrently and could not restore them
+	// reliably.
+	if (opt_quiet_mode == QUIET_MODE_SYSTEM && opt_matrix_masks != "") {
+		L::warn("Quiet mode 2 is not supported in matrix mode, using quiet mode 1\n");
+		opt_quiet_mode = QUIET_MODE_PROCESS;
+	}
+	QuietMode::configure((quiet_mode_level_t)opt_quiet_mode, opt_ctr_cpu);
+
+	// Access kinds (loads, stores, software prefetches, ...) to run the
+	// identification tests of the stride, stream and SMS testcases with
+	AccessKinds::configure(parse_access_kinds(opt_access_kinds));
+
+	// Bind the memory of the tests to a NUMA node (if requested)
+	if (opt_numa_node != MAPPING_NO_NUMA_NODE) {
+		if (opt_numa_compare != "") {
+			L::err("NUMA node binding (-l) and NUMA comparison mode (-u) cannot be combined\n");
+			exit(EXIT_FAILURE);
+		}
+		L::info("Binding memory to NUMA node %d\n", opt_numa_node);
+		set_mapping_numa_node(opt_numa_node);
+	}
+
 	// List of all testcases
 	vector<unique_ptr<TestCaseBase>> testcases;
 	testcases.push_back(make_unique<TestCaseAdjacent>(opt_fr_thresh, opt_noise_thresh, use_nanosleep));
-	testcases.push_back(make_unique<TestCaseStride>  (opt_fr_thresh, opt_noise_thresh, use_nanosleep));
+	testcases.push_back(make_unique<TestCaseStride>  (opt_fr_thresh, opt_noise_thresh, use_nanosleep, opt_result_cache_max_age_min, opt_incremental_overview != 0));
 	testcases.push_back(make_unique<TestCaseStream>  (opt_fr_thresh, opt_noise_thresh, use_nanosleep));
 	testcases.push_back(make_unique<TestCaseSMS>     (opt_fr_thresh, opt_noise_thresh, use_nanosleep));
 	testcases.push_back(make_unique<TestCaseDCReplay>(opt_fr_thresh, opt_noise_thresh, use_nanosleep));
-	testcases.push_back(make_unique<TestCasePointerArray>(opt_target_cpu, opt_ctr_cpu));
-	testcases.push_back(make_unique<TestCasePointerChase>(opt_target_cpu, opt_ctr_cpu));
+	testcases.push_back(make_unique<TestCasePointerArray>(opt_raw_samples));
+	testcases.push_back(make_unique<TestCasePointerChase>());
+	testcases.push_back(make_unique<TestCaseICache>(use_nanosleep));
+	testcases.push_back(make_unique<TestCasePage>    (opt_fr_thresh, opt_noise_thresh, use_nanosleep));
+	testcases.push_back(make_unique<TestCaseCorrelation>(opt_fr_thresh, opt_noise_thresh, use_nanosleep));
+	testcases.push_back(make_unique<TestCaseSharing>(opt_fr_thresh, opt_noise_thresh, use_nanosleep, topology, opt_ctr_cpu));
+	testcases.push_back(make_unique<TestCasePollution>(opt_fr_thresh, opt_noise_thresh, use_nanosleep, parse_pollution_patterns(opt_pollution_patterns)));
+
+	// matrix mode: run the selected testcase with each prefetcher
+	// configuration
+	if (opt_matrix_masks != "") {
+		#ifdef INTEL_DONT_DISABLE_OTHER_PREFETCHERS
+			L::err("Matrix mode requires MSR accesses (built with INTEL_DONT_DISABLE_OTHER_PREFETCHERS)\n");
+			exit(EXIT_FAILURE);
+		#endif
+		MsrController& msr_controller = MsrController::get();
+		if ( ! msr_controller.supported()) {
+			L::err("Matrix mode is not supported on this CPU (no prefetcher control MSR)\n");
+			exit(EXIT_FAILURE);
+		}
+		vector<uint64_t> masks = parse_prefetcher_masks(opt_matrix_masks, msr_controller.no_prefetchers());
+		vector<int> cpus = (opt_matrix_cpus != "") ? parse_cpu_list(opt_matrix_cpus) : vector<int> {opt_target_cpu};
+		for (unique_ptr<TestCaseBase> const& testcase : testcases) {
+			if (opt_testcase == testcase->id()) {
+				Json j = with_placement(run_matrix(*testcase, masks, cpus, opt_ctr_cpu, opt_only_identification), placement);
+				json_dump_to_file(j, "results-" + testcase->id() + "-matrix.json");
+				clock_teardown();
+				return EXIT_SUCCESS;
+			}
+		}
+		L::err("Matrix mode requires a testcase (-t), got: \"%s\"\n", opt_testcase.c_str());
+		clock_teardown();
+		exit(EXIT_FAILURE);
+	}
+
+	// load sweep mode: run the selected testcase under each background load
+	// level
+	if (opt_load_threads != "") {
+		if (opt_matrix_masks != "") {
+			L::err("Load sweep mode (-b) and matrix mode (-m) cannot be combined\n");
+			exit(EXIT_FAILURE);
+		}
+		if (opt_numa_compare != "") {
+			L::err("Load sweep mode (-b) and NUMA comparison mode (-u) cannot be combined\n");
+			exit(EXIT_FAILURE);
+		}
+		pair<size_t, size_t> load_threads = parse_load_threads(opt_load_threads);
+		vector<double> load_levels = parse_load_levels(opt_load_levels);
+		vector<int> load_cpus = topology.select_load_cpus(opt_target_cpu, opt_ctr_cpu);
+		if (load_cpus.empty()) {
+			L::warn("No CPU for the background load besides the measurement CPU, the load threads share it\n");
+			load_cpus.push_back(opt_target_cpu);
+		}
+		for (unique_ptr<TestCaseBase> const& testcase : testcases) {
+			if (opt_testcase == testcase->id()) {
+				BackgroundLoad load {load_threads.first, load_threads.second, load_cpus};
+				Json j = with_placement(run_load_sweep(*testcase, load, load_levels, opt_only_identification), placement);
+				json_dump_to_file(j, "results-" + testcase->id() + "-load.json");
+				clock_teardown();
+				return EXIT_SUCCESS;
+			}
+		}
+		L::err("Load sweep mode requires a testcase (-t), got: \"%s\"\n", opt_testcase.c_str());
+		clock_teardown();
+		exit(EXIT_FAILURE);
+	}
+
+	// NUMA comparison mode: run the selected testcase with local and with
+	// remote memory
+	if (opt_numa_compare != "") {
+		if (opt_matrix_masks != "") {
+			L::err("NUMA comparison mode (-u) and matrix mode (-m) cannot be combined\n");
+			exit(EXIT_FAILURE);
+		}
+		pair<int, int> numa_nodes = parse_numa_nodes(opt_numa_compare, topology, opt_target_cpu);
+		for (unique_ptr<TestCaseBase> const& testcase : testcases) {
+			if (opt_testcase == testcase->id()) {
+				Json j = with_placement(run_numa_comparison(*testcase, numa_nodes.first, numa_nodes.second, opt_only_identification), placement);
+				json_dump_to_file(j, "results-" + testcase->id() + "-numa.json");
+				clock_teardown();
+				return EXIT_SUCCESS;
+			}
+		}
+		L::err("NUMA comparison mode requires a testcase (-t), got: \"%s\"\n", opt_testcase.c_str());
+		clock_teardown();
+		exit(EXIT_FAILURE);
+	}
 
 	// if no testcase is specified, run all testcases
 	if (opt_testcase == "") {
 		L::info("Running all test cases\n");
 		for (unique_ptr<TestCaseBase> const& testcase : testcases) {
 			L::info("Running test case: \"%s\"\n", testcase->id().c_str());
-			Json j = testcase->run(opt_only_identification);
+			Json j = with_placement(testcase->run(opt_only_identification), placement);
 			L::info("%s\n", json_pretty_print(j.dump()).c_str());
 			json_dump_to_file(j, "results-" + testcase->id() + ".json");
 		}
@@ -122,7 +407,7 @@ int main(int argc, char** argv) {
 		for (unique_ptr<TestCaseBase> const& testcase : testcases) {
 			if (opt_testcase == testcase->id()) {
 				L::info("Running test case: \"%s\"\n", opt_testcase.c_str());
-				Json j = testcase->run(opt_only_identification);
+				Json j = with_placement(testcase->run(opt_only_identification), placement);
 				L::info("%s\n", json_pretty_print(j.dump()).c_str());
 				json_dump_to_file(j, "results-" + testcase->id() + ".json");
 				found = true;
@@ -1,27 +1,330 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#include <linux/mempolicy.h>
 
 #include "mapping.hh"
 #include "logger.hh"
 #include "cacheutils.hh"
 
+// NUMA node new mappings are bound to (MAPPING_NO_NUMA_NODE: the kernel's
+// choice), see set_mapping_numa_node()
+static int mapping_numa_node = MAPPING_NO_NUMA_NODE;
+
+/**
+ * Builds a node mask (for mbind and set_mempolicy) that contains a single
+ * NUMA node.
+ *
+ * @param      nodemask  The node mask (MAPPING_MAX_NUMA_NODES bits)
+ * @param[in]  node      The node
+ */
+static void single_node_mask(unsigned long* nodemask, int node) {
+	size_t const bits = 8 * sizeof(unsigned long);
+	std::fill(nodemask, nodemask + MAPPING_MAX_NUMA_NODES / bits, 0UL);
+	nodemask[node / bits] = 1UL << (node % bits);
+}
+
+/**
+ * Selects the NUMA node that all mappings allocated from now on are bound
+ * to (mbind), e.g., to compare prefetching from local and remote memory.
+ * The memory policy of the calling thread is set as well (set_mempolicy),
+ * such that memory the tests allocate elsewhere (e.g., the buffers of the
+ * pointer tests) is placed on the node too. Exits if the node cannot be
+ * used.
+ *
+ * @param[in]  node  The node, MAPPING_NO_NUMA_NODE to let the kernel
+ *                   decide again
+ */
+void set_mapping_numa_node(int node) {
+	long result;
+	if (node == MAPPING_NO_NUMA_NODE) {
+		result = syscall(SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+	} else {
+		if (node < 0 || node >= MAPPING_MAX_NUMA_NODES) {
+			L::err("Invalid NUMA node %d\n", node);
+			exit(1);
+		}
+		unsigned long nodemask[MAPPING_MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+		single_node_mask(nodemask, node);
+		result = syscall(SYS_set_mempolicy, MPOL_BIND, nodemask, MAPPING_MAX_NUMA_NODES);
+	}
+	if (result != 0) {
+		L::err("set_mempolicy failed (NUMA node %d): %s\n", node, strerror(errno));
+		exit(1);
+	}
+	mapping_numa_node = node;
+}
+
+/**
+ * Returns the NUMA node new mappings are bound to.
+ *
+ * @return     The node, MAPPING_NO_NUMA_NODE if the kernel decides.
+ */
+int get_mapping_numa_node() {
+	return mapping_numa_node;
+}
+
+/**
+ * Determines the NUMA node a page is placed on.
+ *
+ * @param      addr  An address in the page (must be backed by memory)
+ *
+ * @return     The node, -1 if unknown.
+ */
+int numa_node_of(uint8_t* addr) {
+	int node = -1;
+	if (syscall(SYS_get_mempolicy, &node, NULL, 0, addr, MPOL_F_NODE | MPOL_F_ADDR) != 0) {
+		return -1;
+	}
+	return node;
+}
+
+/**
+ * Binds a memory range to the NUMA node selected with
+ * set_mapping_numa_node(), if any. Must be called before the range is
+ * backed by memory.
+ *
+ * @param      addr  The beginning of the range (page aligned)
+ * @param[in]  size  The size of the range
+ */
+static void bind_mapping(uint8_t* addr, size_t size) {
+	if (mapping_numa_node == MAPPING_NO_NUMA_NODE) {
+		return;
+	}
+	unsigned long nodemask[MAPPING_MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+	single_node_mask(nodemask, mapping_numa_node);
+	if (syscall(SYS_mbind, addr, size, MPOL_BIND, nodemask, MAPPING_MAX_NUMA_NODES, 0) != 0) {
+		L::err("mbind failed (NUMA node %d): %s\n", mapping_numa_node, strerror(errno));
+		exit(1);
+	}
+}
+
 /**
- * Allocates a mapping using mmap. The mapping will be page aligned.
+ * Touches every page of a mapping (write), such that it is backed by
+ * memory.
+ *
+ * @param      mapping  The mapping
+ */
+static void populate_mapping(Mapping const& mapping) {
+	for (size_t offset = 0; offset < mapping.size; offset += PAGE_SIZE) {
+		mapping.base_addr[offset] = 0;
+	}
+}
+
+/**
+ * Allocates a mapping using mmap. The mapping will be page aligned and
+ * bound to the NUMA node selected with set_mapping_numa_node(), if any.
  *
  * @param[in]  mem_size  Size of the mapping.
  *
  * @return     Mapping.
  */
 Mapping allocate_mapping(size_t mem_size) {
+	// a bound mapping is populated after binding it
+	bool bound = (mapping_numa_node != MAPPING_NO_NUMA_NODE);
 	uint8_t* m = (uint8_t*) mmap(
 		NULL, mem_size, PROT_READ | PROT_WRITE,
-		MAP_POPULATE | MAP_PRIVATE | MAP_ANONYMOUS,
+		(bound ? 0 : MAP_POPULATE) | MAP_PRIVATE | MAP_ANONYMOUS,
 		-1, 0
 	);
 	if (m == MAP_FAILED) {
 		L::err("mmap failed");
 		exit(1);
 	}
-	return Mapping {m, mem_size};
+	Mapping mapping {m, mem_size};
+	if (bound) {
+		bind_mapping(m, mem_size);
+		populate_mapping(mapping);
+	}
+	return mapping;
+}
+
+/**
+ * Allocates a mapping that is backed by regular pages only, i.e., the
+ * kernel does not back it by transparent huge pages. The mapping will be
+ * page aligned.
+ *
+ * @param[in]  mem_size  Size of the mapping.
+ *
+ * @return     Mapping.
+ */
+Mapping allocate_mapping_small_pages(size_t mem_size) {
+	uint8_t* m = (uint8_t*) mmap(
+		NULL, mem_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS,
+		-1, 0
+	);
+	if (m == MAP_FAILED) {
+		L::err("mmap failed");
+		exit(1);
+	}
+	if (madvise(m, mem_size, MADV_NOHUGEPAGE) != 0) {
+		L::debug("madvise(MADV_NOHUGEPAGE) failed\n");
+	}
+	bind_mapping(m, mem_size);
+	Mapping mapping {m, mem_size};
+	populate_mapping(mapping);
+	return mapping;
+}
+
+/**
+ * Allocates a mapping that is aligned to and backed by huge pages, if
+ * possible. We try reserved huge pages (MAP_HUGETLB) first, and fall back
+ * to transparent huge pages (MADV_HUGEPAGE). The latter is only a hint,
+ * use mapping_huge_page_bytes() to check how much of the mapping is
+ * actually backed by huge pages. If transparent huge pages are disabled
+ * for the process (quiet mode, see QuietMode), they are enabled while the
+ * mapping is populated, such that only this mapping gets huge pages.
+ *
+ * @param[in]  mem_size  Size of the mapping (multiple of HUGE_PAGE_SIZE).
+ *
+ * @return     Mapping.
+ */
+Mapping allocate_mapping_huge_pages(size_t mem_size) {
+	assert(mem_size % HUGE_PAGE_SIZE == 0);
+	#ifdef MAP_HUGETLB
+		bool bound = (mapping_numa_node != MAPPING_NO_NUMA_NODE);
+		uint8_t* m = (uint8_t*) mmap(
+			NULL, mem_size, PROT_READ | PROT_WRITE,
+			(bound ? 0 : MAP_POPULATE) | MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+			-1, 0
+		);
+		if (m != MAP_FAILED) {
+			Mapping mapping {m, mem_size};
+			if (bound) {
+				bind_mapping(m, mem_size);
+				populate_mapping(mapping);
+			}
+			return mapping;
+		}
+		L::debug("mmap(MAP_HUGETLB) failed, trying transparent huge pages\n");
+	#endif
+
+	// over-allocate by one huge page to align the mapping, then unmap the
+	// unaligned head and tail
+	size_t reserved_size = mem_size + HUGE_PAGE_SIZE;
+	uint8_t* reserved = (uint8_t*) mmap(
+		NULL, reserved_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS,
+		-1, 0
+	);
+	if (reserved == MAP_FAILED) {
+		L::err("mmap failed");
+		exit(1);
+	}
+	uint8_t* aligned = (uint8_t*)(((uintptr_t)reserved + HUGE_PAGE_SIZE - 1) & ~((uintptr_t)HUGE_PAGE_SIZE - 1));
+	if (aligned > reserved) {
+		munmap(reserved, aligned - reserved);
+	}
+	if (aligned + mem_size < reserved + reserved_size) {
+		munmap(aligned + mem_size, reserved + reserved_size - (aligned + mem_size));
+	}
+	bool thp_disabled = (prctl(PR_GET_THP_DISABLE, 0, 0, 0, 0) == 1);
+	if (thp_disabled && prctl(PR_SET_THP_DISABLE, 0, 0, 0, 0) != 0) {
+		L::debug("prctl(PR_SET_THP_DISABLE) failed\n");
+	}
+	if (madvise(aligned, mem_size, MADV_HUGEPAGE) != 0) {
+		L::debug("madvise(MADV_HUGEPAGE) failed\n");
+	}
+	bind_mapping(aligned, mem_size);
+	Mapping mapping {aligned, mem_size};
+	populate_mapping(mapping);
+	if (thp_disabled) {
+		prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0);
+	}
+	return mapping;
+}
+
+/**
+ * Determines how many bytes of a mapping are backed by huge pages
+ * (transparent or reserved), according to /proc/self/smaps. If the kernel
+ * merged the mapping with adjacent ones, the huge pages of the whole
+ * memory area are counted (at most the size of the mapping).
+ *
+ * @param      mapping  The mapping
+ *
+ * @return     Number of bytes backed by huge pages, 0 if unknown.
+ */
+size_t mapping_huge_page_bytes(Mapping const& mapping) {
+	std::ifstream file {"/proc/self/smaps"};
+	std::string line;
+	bool in_area = false;
+	size_t huge_kib = 0;
+	while (std::getline(file, line)) {
+		uintptr_t begin, end;
+		if (sscanf(line.c_str(), "%" SCNxPTR "-%" SCNxPTR " ", &begin, &end) == 2 && line.find(':') > line.find(' ')) {
+			// header of the next memory area
+			if (in_area) {
+				break;
+			}
+			in_area = ((uintptr_t)mapping.base_addr >= begin && (uintptr_t)mapping.base_addr < end);
+			continue;
+		}
+		if ( ! in_area) {
+			continue;
+		}
+		std::istringstream fields {line};
+		std::string key;
+		size_t kib = 0;
+		fields >> key >> kib;
+		if (key == "AnonHugePages:" || key == "Private_Hugetlb:" || key == "Shared_Hugetlb:") {
+			huge_kib += kib;
+		}
+	}
+	return std::min(huge_kib * 1024, mapping.size);
+}
+
+/**
+ * Invalidates the address translations of a memory range in the TLBs
+ * (incl. the paging-structure caches), without changing its content or
+ * evicting it from the data caches. To this end, the range is made
+ * read-only and writable again, which makes the kernel invalidate the
+ * translations. The range must be page aligned (huge page aligned for
+ * huge pages).
+ *
+ * @param      addr  The beginning of the range
+ * @param[in]  size  The size of the range
+ */
+void invalidate_translation(uint8_t* addr, size_t size) {
+	if (mprotect(addr, size, PROT_READ) != 0 || mprotect(addr, size, PROT_READ | PROT_WRITE) != 0) {
+		L::err("mprotect failed");
+		exit(1);
+	}
+}
+
+/**
+ * Makes a mapping that holds generated code writable (and not
+ * executable), such that the code can be (re-)written.
+ *
+ * @param      mapping  The mapping
+ */
+void make_mapping_writable(Mapping const& mapping) {
+	if (mprotect(mapping.base_addr, mapping.size, PROT_READ | PROT_WRITE) != 0) {
+		L::err("mprotect failed\n");
+		exit(1);
+	}
+}
+
+/**
+ * Makes a mapping executable (and read-only) after code was written into
+ * it. The instruction caches are synchronized with the written code
+ * first.
+ *
+ * @param      mapping  The mapping
+ */
+void make_mapping_executable(Mapping const& mapping) {
+	__builtin___clear_cache((char*) mapping.base_addr, (char*) mapping.base_addr + mapping.size);
+	if (mprotect(mapping.base_addr, mapping.size, PROT_READ | PROT_EXEC) != 0) {
+		L::err("mprotect failed\n");
+		exit(1);
+	}
 }
 
 /**
@@ -2,12 +2,28 @@
 #include <cinttypes>
 #include <unistd.h>
 
+// size of a huge page (x86-64, and AArch64 with 4 KiB granule)
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+// mappings are not bound to a NUMA node (the kernel decides)
+#define MAPPING_NO_NUMA_NODE (-1)
+// number of NUMA nodes covered by a node mask
+#define MAPPING_MAX_NUMA_NODES 1024
+
 typedef struct {
 	uint8_t* base_addr;
 	size_t size;
 } Mapping;
 
+void set_mapping_numa_node(int node);
+int get_mapping_numa_node();
+int numa_node_of(uint8_t* addr);
 Mapping allocate_mapping(size_t mem_size);
+Mapping allocate_mapping_small_pages(size_t mem_size);
+Mapping allocate_mapping_huge_pages(size_t mem_size);
+size_t mapping_huge_page_bytes(Mapping const& mapping);
+void invalidate_translation(uint8_t* addr, size_t size);
+void make_mapping_writable(Mapping const& mapping);
+void make_mapping_executable(Mapping const& mapping);
 void unmap_mapping(Mapping const& mapping);
 void flush_mapping(Mapping const& mapping);
 
@@ -0,0 +1,386 @@
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+#include "matrix.hh"
+#include "cacheutils.hh"
+#include "logger.hh"
+#include "msr_controller.hh"
+#include "utils.hh"
+
+using std::map;
+using std::pair;
+
+/**
+ * Parses the prefetcher configurations to run in matrix mode.
+ *
+ * @param      spec            "all" for all combinations, or a
+ *                             comma-separated list of masks (decimal or
+ *                             hexadecimal with 0x prefix), where bit i
+ *                             enables prefetcher i (see
+ *                             MsrController::prefetcher_name())
+ * @param[in]  no_prefetchers  Number of controllable prefetchers
+ *
+ * @return     The masks (without duplicates). Exits on invalid input.
+ */
+vector<uint64_t> parse_prefetcher_masks(string const& spec, size_t no_prefetchers) {
+	uint64_t no_masks = 1ULL << no_prefetchers;
+	vector<uint64_t> masks;
+	if (spec == "all") {
+		for (uint64_t mask = 0; mask < no_masks; mask++) {
+			masks.push_back(mask);
+		}
+		return masks;
+	}
+	std::istringstream stream {spec};
+	string item;
+	while (std::getline(stream, item, ',')) {
+		char* end;
+		uint64_t mask = strtoull(item.c_str(), &end, 0);
+		if (item.empty() || *end != '\0' || mask >= no_masks) {
+			L::err("Invalid prefetcher mask \"%s\" (must be in [0, %lu))\n", item.c_str(), no_masks);
+			exit(1);
+		}
+		if (std::find(masks.begin(), masks.end(), mask) == masks.end()) {
+			masks.push_back(mask);
+		}
+	}
+	return masks;
+}
+
+/**
+ * Returns a readable description of a prefetcher configuration.
+ *
+ * @param[in]  mask  The mask (bit i enables prefetcher i)
+ *
+ * @return     Names of the enabled prefetchers, joined by "+" ("none" if
+ *             all are disabled).
+ */
+string prefetcher_mask_to_string(uint64_t mask) {
+	MsrController& msr_controller = MsrController::get();
+	string result;
+	for (size_t idx = 0; idx < msr_controller.no_prefetchers(); idx++) {
+		if (mask & (1ULL << idx)) {
+			result += (result.empty() ? "" : "+") + string {msr_controller.prefetcher_name(idx)};
+		}
+	}
+	return result.empty() ? "none" : result;
+}
+
+/**
+ * Returns the working directory of a configuration. Each configuration
+ * runs in its own directory, such that the traces and plots of
+ * concurrently running configurations do not collide.
+ */
+static string matrix_directory(string const& testcase_id, uint64_t mask) {
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "-0x%lx", mask);
+	return MATRIX_DIRECTORY_PREFIX + testcase_id + buffer;
+}
+
+/**
+ * Runs the testcase with one prefetcher configuration. Called in a
+ * worker process; the results are written to the working directory of
+ * the configuration.
+ */
+static void run_configuration(TestCaseBase& testcase, uint64_t mask, int cpu, int ctr_cpu, bool only_identification) {
+	string directory = matrix_directory(testcase.id(), mask);
+	if (mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST) {
+		L::err("matrix: mkdir error (%s): %s\n", directory.c_str(), strerror(errno));
+		exit(1);
+	}
+	if (chdir(directory.c_str()) == -1) {
+		L::err("matrix: chdir error (%s): %s\n", directory.c_str(), strerror(errno));
+		exit(1);
+	}
+	pin_process_to_cpu(0, cpu);
+	clock_init(ctr_cpu);
+	MsrController::get().force_prefetchers(USE_CURRENT_CPU, mask);
+
+	L::info("matrix: running \"%s\" on CPU %d with prefetchers %s\n", testcase.id().c_str(), cpu, prefetcher_mask_to_string(mask).c_str());
+	Json j = testcase.run(only_identification);
+	clock_teardown();
+	json_dump_to_file(j, "results-" + testcase.id() + ".json");
+}
+
+/**
+ * Collects all boolean values of a result (e.g., "identified"), keyed by
+ * their path in the JSON structure.
+ */
+static void collect_features(Json const& json, string const& path, map<string, bool>& features) {
+	if (json.is_bool()) {
+		features[path] = json.bool_value();
+	} else if (json.is_object()) {
+		for (pair<string const, Json> const& item : json.object_items()) {
+			collect_features(item.second, path.empty() ? item.first : path + "." + item.first, features);
+		}
+	} else if (json.is_array()) {
+		Json::array const& items = json.array_items();
+		for (size_t idx = 0; idx < items.size(); idx++) {
+			collect_features(items[idx], path + "[" + std::to_string(idx) + "]", features);
+		}
+	}
+}
+
+/**
+ * Attributes a feature (an observed behavior) to the prefetchers, based
+ * on its value in each tested configuration:
+ * - minimal enabling sets: the smallest configurations (w.r.t. set
+ *   inclusion) in which the feature is observed. A set with more than one
+ *   prefetcher means that they are only effective together; several sets
+ *   mean that each of them suffices.
+ * - monotone: whether the feature is observed in exactly the tested
+ *   configurations that contain one of the minimal sets. If not, some
+ *   prefetcher suppresses the feature (see the effects).
+ * - effects: for each prefetcher, over all pairs of tested configurations
+ *   that differ only in this prefetcher, how often enabling it makes the
+ *   feature appear or disappear.
+ * - interactions: for each pair of prefetchers, over all tested squares of
+ *   configurations (neither, either, both), how often the effect of one
+ *   prefetcher depends on the other.
+ *
+ * @param      values          The feature value per configuration mask
+ * @param[in]  no_prefetchers  Number of controllable prefetchers
+ *
+ * @return     JSON structure describing the attribution.
+ */
+static Json attribute_feature(map<uint64_t, bool> const& values, size_t no_prefetchers) {
+	MsrController& msr_controller = MsrController::get();
+
+	vector<uint64_t> minimal_sets;
+	for (pair<uint64_t const, bool> const& value : values) {
+		if ( ! value.second) {
+			continue;
+		}
+		bool minimal = true;
+		for (pair<uint64_t const, bool> const& other : values) {
+			if (other.second && other.first != value.first && (other.first & value.first) == other.first) {
+				minimal = false;
+				break;
+			}
+		}
+		if (minimal) {
+			minimal_sets.push_back(value.first);
+		}
+	}
+	bool monotone = true;
+	for (pair<uint64_t const, bool> const& value : values) {
+		bool contains_minimal_set = std::any_of(minimal_sets.begin(), minimal_sets.end(), [&](uint64_t set) {
+			return (set & value.first) == set;
+		});
+		monotone &= (contains_minimal_set == value.second);
+	}
+	Json::array minimal_sets_json;
+	for (uint64_t set : minimal_sets) {
+		minimal_sets_json.push_back(prefetcher_mask_to_string(set));
+	}
+
+	Json::object effects_json;
+	for (size_t p = 0; p < no_prefetchers; p++) {
+		uint64_t bit = 1ULL << p;
+		size_t no_pairs = 0, no_enables = 0, no_inhibits = 0;
+		for (pair<uint64_t const, bool> const& value : values) {
+			map<uint64_t, bool>::const_iterator with = values.find(value.first | bit);
+			if ((value.first & bit) || with == values.end()) {
+				continue;
+			}
+			no_pairs++;
+			no_enables += ( ! value.second && with->second) ? 1 : 0;
+			no_inhibits += (value.second && ! with->second) ? 1 : 0;
+		}
+		effects_json[msr_controller.prefetcher_name(p)] = Json::object {
+			{"pairs", (int)no_pairs},
+			{"enables", (int)no_enables},
+			{"inhibits", (int)no_inhibits},
+		};
+	}
+
+	Json::array interactions_json;
+	for (size_t p = 0; p < no_prefetchers; p++) {
+		for (size_t q = p + 1; q < no_prefetchers; q++) {
+			uint64_t bit_p = 1ULL << p;
+			uint64_t bit_q = 1ULL << q;
+			size_t no_squares = 0, no_interacting = 0;
+			for (pair<uint64_t const, bool> const& value : values) {
+				uint64_t mask = value.first;
+				if ((mask & (bit_p | bit_q)) || ! values.count(mask | bit_p) || ! values.count(mask | bit_q) || ! values.count(mask | bit_p | bit_q)) {
+					continue;
+				}
+				no_squares++;
+				int effect_p_without_q = (int)values.at(mask | bit_p) - (int)values.at(mask);
+				int effect_p_with_q = (int)values.at(mask | bit_p | bit_q) - (int)values.at(mask | bit_q);
+				no_interacting += (effect_p_without_q != effect_p_with_q) ? 1 : 0;
+			}
+			if (no_interacting > 0) {
+				interactions_json.push_back(Json::object {
+					{"prefetchers", Json::array {msr_controller.prefetcher_name(p), msr_controller.prefetcher_name(q)}},
+					{"squares", (int)no_squares},
+					{"interacting", (int)no_interacting},
+				});
+			}
+		}
+	}
+
+	return Json::object {
+		{"minimal_enabling_sets", minimal_sets_json},
+		{"monotone", monotone},
+		{"effects", effects_json},
+		{"interactions", interactions_json},
+	};
+}
+
+/**
+ * Matrix mode: runs a testcase once per prefetcher configuration and
+ * attributes the observed behavior to the prefetchers. Each configuration
+ * runs in a forked worker process that is pinned to one of the given
+ * CPUs and forces the configuration on its core via MsrController (the
+ * configurations requested by the testcase itself are ignored). Workers
+ * on different cores run concurrently, so the CPUs should belong to
+ * different physical cores.
+ *
+ * @param      testcase             The testcase
+ * @param      masks                The prefetcher configurations (bit i
+ *                                  enables prefetcher i)
+ * @param[in]  cpus                 The CPUs to spread the configurations
+ *                                  across
+ * @param[in]  ctr_cpu              The CPU for the counter thread (if
+ *                                  enabled)
+ * @param[in]  only_identification  Whether to run only the
+ *                                  identification tests
+ *
+ * @return     JSON structure with the results per configuration and the
+ *             attribution of each feature that differs between the
+ *             configurations.
+ */
+Json run_matrix(TestCaseBase& testcase, vector<uint64_t> const& masks, vector<int> cpus, int ctr_cpu, bool only_identification) {
+	MsrController& msr_controller = MsrController::get();
+	size_t no_prefetchers = msr_controller.no_prefetchers();
+
+	#ifdef COUNTER_THREAD
+		if (cpus.size() > 1) {
+			L::warn("matrix: the counter thread supports only one worker, using CPU %d only\n", cpus[0]);
+			cpus.resize(1);
+		}
+	#endif
+	for (size_t i = 0; i < cpus.size(); i++) {
+		for (size_t j = i + 1; j < cpus.size(); j++) {
+			vector<int> const& siblings = msr_controller.core_siblings(cpus[i]);
+			if (std::find(siblings.begin(), siblings.end(), cpus[j]) != siblings.end()) {
+				L::err("matrix: CPUs %d and %d share a core (and its prefetchers)\n", cpus[i], cpus[j]);
+				exit(1);
+			}
+		}
+	}
+
+	// each worker starts its own counter thread (threads do not survive
+	// fork())
+	clock_teardown();
+	fflush(stdout);
+
+	map<pid_t, pair<uint64_t, int>> running;
+	vector<int> idle_cpus {cpus.rbegin(), cpus.rend()};
+	map<uint64_t, Json> results;
+	size_t next = 0;
+	while (next < masks.size() || ! running.empty()) {
+		while (next < masks.size() && ! idle_cpus.empty()) {
+			int cpu = idle_cpus.back();
+			idle_cpus.pop_back();
+			uint64_t mask = masks[next++];
+			pid_t pid = fork();
+			if (pid == -1) {
+				L::err("matrix: fork error: %s\n", strerror(errno));
+				exit(1);
+			} else if (pid == 0) {
+				run_configuration(testcase, mask, cpu, ctr_cpu, only_identification);
+				exit(EXIT_SUCCESS);
+			}
+			running[pid] = {mask, cpu};
+		}
+		int status;
+		pid_t pid = wait(&status);
+		if (pid == -1) {
+			L::err("matrix: wait error: %s\n", strerror(errno));
+			exit(1);
+		}
+		uint64_t mask = running.at(pid).first;
+		idle_cpus.push_back(running.at(pid).second);
+		running.erase(pid);
+
+		bool success = WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+		Json result = json_load_from_file(matrix_directory(testcase.id(), mask) + "/results-" + testcase.id() + ".json");
+		if ( ! success || result.is_null()) {
+			L::warn("matrix: configuration %s failed\n", prefetcher_mask_to_string(mask).c_str());
+			result = Json {};
+		}
+		results[mask] = result;
+	}
+
+	clock_init(ctr_cpu);
+
+	// features (boolean results) per configuration
+	map<string, map<uint64_t, bool>> features;
+	Json::array configurations_json;
+	for (uint64_t mask : masks) {
+		Json const& result = results[mask];
+		map<string, bool> configuration_features;
+		collect_features(result["identification"], "identification", configuration_features);
+		collect_features(result["characteristics"], "characteristics", configuration_features);
+		for (pair<string const, bool> const& feature : configuration_features) {
+			features[feature.first][mask] = feature.second;
+		}
+		configurations_json.push_back(Json::object {
+			{"mask", (int)mask},
+			{"prefetchers", prefetcher_mask_to_string(mask)},
+			{"success", ! result.is_null()},
+			{"directory", matrix_directory(testcase.id(), mask)},
+			{"results", result},
+		});
+	}
+
+	// attribute the features that differ between the configurations and
+	// print them as a table (one column per configuration)
+	Json::object attribution_json;
+	Json::object constant_features_json;
+	L::info("matrix: features of \"%s\" per configuration (columns: masks", testcase.id().c_str());
+	for (uint64_t mask : masks) {
+		L::info(" 0x%lx", mask);
+	}
+	L::info(")\n");
+	for (pair<string const, map<uint64_t, bool>> const& feature : features) {
+		bool constant = std::all_of(feature.second.begin(), feature.second.end(), [&](pair<uint64_t const, bool> const& value) {
+			return value.second == feature.second.begin()->second;
+		});
+		if (constant) {
+			constant_features_json[feature.first] = feature.second.begin()->second;
+			continue;
+		}
+		Json attribution = attribute_feature(feature.second, no_prefetchers);
+		attribution_json[feature.first] = attribution;
+
+		string row;
+		for (uint64_t mask : masks) {
+			map<uint64_t, bool>::const_iterator value = feature.second.find(mask);
+			row += (value == feature.second.end()) ? " -" : (value->second ? " 1" : " 0");
+		}
+		string sets;
+		for (Json const& set : attribution["minimal_enabling_sets"].array_items()) {
+			sets += (sets.empty() ? "" : " | ") + set.string_value();
+		}
+		L::info("  %-50s%s  <- %s%s\n", feature.first.c_str(), row.c_str(), sets.empty() ? "-" : sets.c_str(), attribution["monotone"].bool_value() ? "" : " (not monotone)");
+	}
+
+	Json::array prefetchers_json;
+	for (size_t idx = 0; idx < no_prefetchers; idx++) {
+		prefetchers_json.push_back(msr_controller.prefetcher_name(idx));
+	}
+	return Json::object {
+		{"testcase", testcase.id()},
+		{"prefetchers", prefetchers_json},
+		{"configurations", configurations_json},
+		{"attribution", attribution_json},
+		{"constant_features", constant_features_json},
+	};
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "testcase.hh"
+
+using json11::Json;
+using std::string;
+using std::vector;
+
+// Prefix of the working directory of each configuration in matrix mode
+#define MATRIX_DIRECTORY_PREFIX "matrix-"
+
+vector<uint64_t> parse_prefetcher_masks(string const& spec, size_t no_prefetchers);
+vector<int> parse_cpu_list(string const& spec);
+string prefetcher_mask_to_string(uint64_t mask);
+Json run_matrix(TestCaseBase& testcase, vector<uint64_t> const& masks, vector<int> cpus, int ctr_cpu, bool only_identification);
@@ -0,0 +1,236 @@
+#include <csignal>
+#include <fstream>
+
+#include "msr_controller.hh"
+#include "logger.hh"
+
+// signals after which the original register values are restored
+static int const RESTORE_SIGNALS[] = {SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+// controllable prefetchers (in the order of the "enabled" mask bits)
+static vector<prefetcher_control_t> const INTEL_PREFETCHER_CONTROLS {
+	{"L2_HW", INTEL_L2_HW_PREFETCHER},
+	{"L2_ADJACENT_CL", INTEL_L2_ADJACENT_CL_PREFETCHER},
+	{"DCU", INTEL_DCU_PREFETCHER},
+	{"DCU_IP", INTEL_DCU_IP_PREFETCHER},
+};
+static vector<prefetcher_control_t> const AMD_PREFETCHER_CONTROLS {
+	{"L1_STREAM", AMD_L1_STREAM_PREFETCHER},
+	{"L1_STRIDE", AMD_L1_STRIDE_PREFETCHER},
+	{"L1_REGION", AMD_L1_REGION_PREFETCHER},
+	{"L2_STREAM", AMD_L2_STREAM_PREFETCHER},
+	{"L2_UP_DOWN", AMD_L2_UP_DOWN_PREFETCHER},
+};
+
+MsrController::MsrController() {
+	architecture_t arch = get_arch();
+	if (arch == ARCH_INTEL) {
+		msr_reg = INTEL_MSR_MISC_FEATURE_CONTROL;
+		controls = INTEL_PREFETCHER_CONTROLS;
+	} else if (arch == ARCH_AMD) {
+		msr_reg = AMD_MSR_PREFETCH_CONTROL;
+		controls = AMD_PREFETCHER_CONTROLS;
+	}
+	for (cpu_state_t& state : cpus) {
+		state.fd = -1;
+		state.original_value = 0;
+		state.current_value = 0;
+	}
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = restore_on_signal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESETHAND;
+	for (int signal : RESTORE_SIGNALS) {
+		struct sigaction previous;
+		sigaction(signal, &action, &previous);
+		previous_actions.push_back(previous);
+	}
+}
+
+MsrController::~MsrController() {
+	restore();
+	for (cpu_state_t& state : cpus) {
+		if (state.fd != -1) {
+			close(state.fd);
+			state.fd = -1;
+		}
+	}
+}
+
+/**
+ * Returns the single instance. It is created on first use, which also
+ * installs the signal handlers.
+ *
+ * @return     The MSR controller.
+ */
+MsrController& MsrController::get() {
+	static MsrController instance;
+	return instance;
+}
+
+/**
+ * Signal handler: restores the original register values and passes the
+ * signal on to the previous handler.
+ *
+ * @param[in]  signal  The signal
+ */
+void MsrController::restore_on_signal(int signal) {
+	MsrController& controller = get();
+	controller.restore();
+	for (size_t i = 0; i < controller.previous_actions.size(); i++) {
+		if (RESTORE_SIGNALS[i] == signal) {
+			sigaction(signal, &controller.previous_actions[i], NULL);
+		}
+	}
+	raise(signal);
+}
+
+/**
+ * Opens the MSR file of a CPU (if not opened yet) and saves the original
+ * register value.
+ *
+ * @param[in]  cpu   The processor ID
+ *
+ * @return     The state of the CPU.
+ */
+MsrController::cpu_state_t& MsrController::open_cpu(int cpu) {
+	if (cpu < 0 || cpu >= CPU_SETSIZE) {
+		L::err("MsrController: invalid CPU %d\n", cpu);
+		exit(1);
+	}
+	cpu_state_t& state = cpus[cpu];
+	if (state.fd != -1) {
+		return state;
+	}
+	int fd = open(msr_file_path(cpu).c_str(), O_RDWR);
+	if (fd == -1) {
+		L::err("MsrController: open error (CPU %d): %s\n", cpu, strerror(errno));
+		exit(1);
+	}
+	uint64_t value;
+	if (pread(fd, &value, sizeof(value), msr_reg) != sizeof(value)) {
+		L::err("MsrController: pread error (CPU %d): %s\n", cpu, strerror(errno));
+		exit(1);
+	}
+	state.original_value = value;
+	state.current_value = value;
+	// set the fd last: restore() only touches CPUs with a saved value
+	state.fd = fd;
+	return state;
+}
+
+/**
+ * Returns the logical CPUs that share a core with the given CPU
+ * (including the CPU itself), according to sysfs. Falls back to the CPU
+ * itself if the topology is not available.
+ *
+ * @param[in]  cpu   The processor ID
+ *
+ * @return     The processor IDs.
+ */
+vector<int> const& MsrController::core_siblings(int cpu) {
+	map<int, vector<int>>::const_iterator it = siblings.find(cpu);
+	if (it != siblings.end()) {
+		return it->second;
+	}
+	vector<int> result;
+	std::ifstream file {"/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list"};
+	string list;
+	if (file && std::getline(file, list)) {
+		result = parse_cpu_list(list);
+	}
+	if (result.empty()) {
+		result.push_back(cpu);
+	}
+	return siblings[cpu] = result;
+}
+
+/**
+ * Enables exactly the given prefetchers (and disables all others) on a
+ * CPU and all logical CPUs sharing its core. Other bits of the register
+ * are left unchanged. Nothing is written if the configuration is already
+ * active.
+ *
+ * @param[in]  cpu                  The processor ID (USE_CURRENT_CPU for
+ *                                  the CPU the process runs on)
+ * @param[in]  enabled_prefetchers  Bit i enables prefetcher i
+ */
+void MsrController::write_prefetchers(int cpu, uint64_t enabled_prefetchers) {
+	if ( ! supported()) {
+		L::err("MsrController: prefetcher control is not supported on this CPU\n");
+		exit(1);
+	}
+	if (cpu == USE_CURRENT_CPU) {
+		cpu = sched_getcpu();
+	}
+	uint64_t all_bits = 0;
+	uint64_t disable_bits = 0;
+	for (size_t idx = 0; idx < controls.size(); idx++) {
+		all_bits |= controls[idx].disable_bit;
+		if ( ! (enabled_prefetchers & (1ULL << idx))) {
+			disable_bits |= controls[idx].disable_bit;
+		}
+	}
+	for (int sibling : core_siblings(cpu)) {
+		cpu_state_t& state = open_cpu(sibling);
+		uint64_t value = (state.current_value & ~all_bits) | disable_bits;
+		if (value == state.current_value) {
+			continue;
+		}
+		L::debug("MsrController: writing 0x%lx into 0x%x on CPU %d\n", value, msr_reg, sibling);
+		if (pwrite(state.fd, &value, sizeof(value), msr_reg) != sizeof(value)) {
+			L::err("MsrController: pwrite error (CPU %d): %s\n", sibling, strerror(errno));
+			exit(1);
+		}
+		uint64_t written_value;
+		if (pread(state.fd, &written_value, sizeof(written_value), msr_reg) != sizeof(written_value) || written_value != value) {
+			L::err("MsrController: verifying the write failed (CPU %d)\n", sibling);
+			exit(1);
+		}
+		state.current_value = value;
+	}
+}
+
+/**
+ * Applies a prefetcher configuration requested by a testcase, unless a
+ * configuration is forced.
+ *
+ * @param[in]  cpu                  The processor ID (USE_CURRENT_CPU for
+ *                                  the CPU the process runs on)
+ * @param[in]  enabled_prefetchers  Bit i enables prefetcher i
+ */
+void MsrController::set_prefetchers(int cpu, uint64_t enabled_prefetchers) {
+	write_prefetchers(cpu, forced ? forced_prefetchers : enabled_prefetchers);
+}
+
+/**
+ * Applies a prefetcher configuration and keeps it for the rest of the
+ * process, i.e., later calls to set_prefetchers() apply this
+ * configuration instead of the requested one.
+ *
+ * @param[in]  cpu                  The processor ID (USE_CURRENT_CPU for
+ *                                  the CPU the process runs on)
+ * @param[in]  enabled_prefetchers  Bit i enables prefetcher i
+ */
+void MsrController::force_prefetchers(int cpu, uint64_t enabled_prefetchers) {
+	forced = true;
+	forced_prefetchers = enabled_prefetchers;
+	write_prefetchers(cpu, enabled_prefetchers);
+}
+
+/**
+ * Writes the original register values back to all CPUs that were
+ * modified. Only uses async-signal-safe functions, as it is also called
+ * from signal handlers.
+ */
+void MsrController::restore() {
+	for (cpu_state_t& state : cpus) {
+		if (state.fd == -1 || state.current_value == state.original_value) {
+			continue;
+		}
+		if (pwrite(state.fd, &state.original_value, sizeof(state.original_value), msr_reg) == sizeof(state.original_value)) {
+			state.current_value = state.original_value;
+		}
+	}
+}
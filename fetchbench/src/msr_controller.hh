@@ -0,0 +1,122 @@
+#pragma once
+
+#include <csignal>
+#include <cinttypes>
+#include <sched.h>
+#include <map>
+#include <vector>
+
+#include "utils.hh"
+
+using std::map;
+using std::vector;
+
+// Bit mask of all prefetchers controlled via MSR_MISC_FEATURE_CONTROL
+#define INTEL_ALL_PREFETCHERS (INTEL_L2_HW_PREFETCHER | INTEL_L2_ADJACENT_CL_PREFETCHER | INTEL_DCU_PREFETCHER | INTEL_DCU_IP_PREFETCHER)
+
+/**
+ * A prefetcher that can be disabled by setting a bit in the prefetcher
+ * control MSR.
+ */
+typedef struct {
+	char const* name;
+	uint64_t disable_bit;
+} prefetcher_control_t;
+
+/**
+ * Controls the prefetchers via the prefetcher control MSR of the CPU
+ * (MSR_MISC_FEATURE_CONTROL on Intel, PrefetchControl on AMD). The
+ * controllable prefetchers of the architecture are numbered (see
+ * prefetcher_name()); bit i of an "enabled" mask enables prefetcher i. On
+ * Intel, these masks are the same as the intel_prefetcher_t bits.
+ *
+ * The MSR files of the CPUs are opened once and kept open, and the
+ * register value is cached, such that switching the prefetcher
+ * configuration costs at most one write (plus one verifying read) per
+ * logical CPU. As the prefetchers are shared by the hyperthreads of a
+ * core, the configuration is always applied to all logical CPUs of the
+ * core.
+ *
+ * A configuration can be forced (see force_prefetchers()), such that the
+ * configurations requested by the testcases are ignored (matrix mode).
+ *
+ * The original register values are saved when a CPU is touched for the
+ * first time and written back by restore(), which is called at exit and
+ * from the handlers for SIGINT, SIGTERM and fatal signals (e.g.,
+ * SIGSEGV), such that the machine is not left with disabled prefetchers.
+ * The handlers then pass the signal on to the previously installed
+ * handlers (e.g., of the FrequencyGuard).
+ *
+ * There is a single instance, see get().
+ */
+class MsrController {
+private:
+	typedef struct {
+		// file descriptor of /dev/cpu/<cpu>/msr (-1 if not opened yet)
+		int fd;
+		// register value before the first write
+		uint64_t original_value;
+		// last value written (or read)
+		uint64_t current_value;
+	} cpu_state_t;
+
+	// prefetcher control register and controllable prefetchers of the
+	// architecture (empty if not supported)
+	uint32_t msr_reg = 0;
+	vector<prefetcher_control_t> controls;
+	// forced "enabled" mask (see force_prefetchers())
+	bool forced = false;
+	uint64_t forced_prefetchers = 0;
+	// indexed by CPU ID; fixed size, such that the signal handler never
+	// sees a reallocation
+	cpu_state_t cpus[CPU_SETSIZE];
+	// logical CPUs sharing a core, per CPU ID (see core_siblings())
+	map<int, vector<int>> siblings;
+	// signal actions installed before the restore handlers (not changed
+	// after the constructor, such that the handlers can read them)
+	vector<struct sigaction> previous_actions;
+
+	MsrController();
+	~MsrController();
+
+	cpu_state_t& open_cpu(int cpu);
+	void write_prefetchers(int cpu, uint64_t enabled_prefetchers);
+	static void restore_on_signal(int signal);
+
+public:
+	MsrController(MsrController const&) = delete;
+	MsrController& operator=(MsrController const&) = delete;
+
+	static MsrController& get();
+
+	inline bool supported() const {
+		return ! controls.empty();
+	}
+
+	inline size_t no_prefetchers() const {
+		return controls.size();
+	}
+
+	inline char const* prefetcher_name(size_t idx) const {
+		return controls.at(idx).name;
+	}
+
+	vector<int> const& core_siblings(int cpu);
+	void set_prefetchers(int cpu, uint64_t enabled_prefetchers);
+	void force_prefetchers(int cpu, uint64_t enabled_prefetchers);
+	void restore();
+};
+
+/**
+ * Enables exactly the given prefetchers (and disables all others) on
+ * Intel CPUs.
+ *
+ * @param[in]  cpu                  The processor ID (USE_CURRENT_CPU for
+ *                                  the CPU the process runs on)
+ * @param[in]  enabled_prefetchers  Bit mask of intel_prefetcher_t values
+ */
+static inline void set_intel_prefetchers(int cpu, uint64_t enabled_prefetchers) {
+	#ifndef INTEL_DONT_DISABLE_OTHER_PREFETCHERS
+		MsrController::get().set_prefetchers(cpu, enabled_prefetchers);
+	#endif
+}
@@ -0,0 +1,159 @@
+#include <ctime>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+
+#include "noise_monitor.hh"
+#include "logger.hh"
+
+bool NoiseMonitor::enabled = false;
+
+Json NoiseStats::to_json() const {
+	return Json::object {
+		{"calibration_windows", (int)no_calibration_windows},
+		{"windows", (int)no_windows},
+		{"tainted", (int)no_tainted},
+		{"timer_jumps", (int)no_timer_jumps},
+		{"context_switches", (int)no_context_switches},
+		{"page_faults", (int)no_page_faults},
+		{"migrations", (int)no_migrations},
+		{"discard_rate", discard_rate()},
+	};
+}
+
+/**
+ * Opens a software perf_event counter for the calling thread.
+ *
+ * @param[in]  config         The event (PERF_COUNT_SW_*)
+ * @param[in]  group_fd       The group leader (-1 for a new group)
+ * @param[in]  exclude_kernel Count in user mode only
+ *
+ * @return     The file descriptor, -1 on failure.
+ */
+static int open_software_counter(uint64_t config, int group_fd, bool exclude_kernel) {
+	struct perf_event_attr attr {};
+	attr.type = PERF_TYPE_SOFTWARE;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.read_format = PERF_FORMAT_GROUP;
+	attr.exclude_kernel = exclude_kernel;
+	attr.exclude_hv = 1;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+/**
+ * Sets up the perf_event counters. Counting kernel events is required to
+ * see migrations, but may not be permitted (perf_event_paranoid), so we
+ * fall back to user mode only.
+ */
+NoiseMonitor::NoiseMonitor() {
+	for (bool exclude_kernel : {false, true}) {
+		perf_fd = open_software_counter(PERF_COUNT_SW_PAGE_FAULTS, -1, exclude_kernel);
+		if (perf_fd == -1) {
+			continue;
+		}
+		if (open_software_counter(PERF_COUNT_SW_CPU_MIGRATIONS, perf_fd, exclude_kernel) == -1) {
+			close(perf_fd);
+			perf_fd = -1;
+			continue;
+		}
+		ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		break;
+	}
+	if (perf_fd == -1) {
+		L::debug("NoiseMonitor: perf_event_open() failed, using getrusage() for page faults\n");
+	}
+}
+
+NoiseMonitor::~NoiseMonitor() {
+	// the group members are closed with the process
+	if (perf_fd != -1) {
+		close(perf_fd);
+	}
+}
+
+/**
+ * Returns the single instance of the noise monitor. The counters are
+ * opened for the calling thread on first use.
+ *
+ * @return     The noise monitor.
+ */
+NoiseMonitor& NoiseMonitor::get() {
+	static NoiseMonitor instance;
+	return instance;
+}
+
+/**
+ * Reads the noise counters of the calling thread. Involuntary context
+ * switches always come from getrusage(), because the perf_event counter
+ * would also count the voluntary ones (e.g., nanosleep() in the
+ * experiments).
+ *
+ * @param[out] context_switches  Involuntary context switches
+ * @param[out] page_faults       Page faults (minor and major)
+ * @param[out] migrations        CPU migrations (0 without perf_event)
+ */
+void NoiseMonitor::read_counters(uint64_t& context_switches, uint64_t& page_faults, uint64_t& migrations) const {
+	struct rusage usage;
+	getrusage(RUSAGE_THREAD, &usage);
+	context_switches = usage.ru_nivcsw;
+
+	struct {
+		uint64_t nr;
+		uint64_t values[2];
+	} group;
+	if (perf_fd != -1 && read(perf_fd, &group, sizeof(group)) == sizeof(group)) {
+		page_faults = group.values[0];
+		migrations = group.values[1];
+	} else {
+		page_faults = usage.ru_minflt + usage.ru_majflt;
+		migrations = 0;
+	}
+}
+
+static inline uint64_t monotonic_ns() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000 * 1000 * 1000ULL + t.tv_nsec;
+}
+
+void NoiseMonitor::begin_window_slow() {
+	read_counters(window_begin_context_switches, window_begin_page_faults, window_begin_migrations);
+	window_begin_time = monotonic_ns();
+}
+
+bool NoiseMonitor::end_window_slow(NoiseStats& stats) {
+	uint64_t duration = monotonic_ns() - window_begin_time;
+	uint64_t context_switches, page_faults, migrations;
+	read_counters(context_switches, page_faults, migrations);
+
+	// timer jumps: the bound is calibrated on the shortest of the first
+	// windows of this collection, whose samples are discarded
+	no_collection_windows++;
+	if (no_collection_windows <= NOISE_CALIBRATION_WINDOWS) {
+		if (min_calibration_duration == 0 || duration < min_calibration_duration) {
+			min_calibration_duration = duration;
+		}
+		stats.no_calibration_windows++;
+		return false;
+	}
+	bool timer_jump = (duration > NOISE_TIMER_JUMP_FACTOR * min_calibration_duration);
+	bool context_switch = (context_switches != window_begin_context_switches);
+	bool page_fault = (page_faults != window_begin_page_faults);
+	bool migration = (migrations != window_begin_migrations);
+
+	stats.no_windows++;
+	stats.no_timer_jumps += timer_jump;
+	stats.no_context_switches += context_switch;
+	stats.no_page_faults += page_fault;
+	stats.no_migrations += migration;
+	if (timer_jump || context_switch || page_fault || migration) {
+		stats.no_tainted++;
+		return false;
+	}
+	return true;
+}
+
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cinttypes>
+
+#include "json11.hpp"
+
+using json11::Json;
+
+// Number of windows at the beginning of each collection that calibrate the
+// timer jump bound (warm-up, their samples are discarded)
+#define NOISE_CALIBRATION_WINDOWS 16
+// A window is tainted if it takes longer than this factor times the
+// shortest calibration window of the collection
+#define NOISE_TIMER_JUMP_FACTOR 4
+
+/**
+ * Counts how many repetitions of an experiment were tainted by noise (and
+ * thus discarded), and why. A window can have several reasons. The
+ * calibration windows (also discarded) are counted separately.
+ */
+class NoiseStats {
+public:
+	size_t no_calibration_windows = 0;
+	size_t no_windows = 0;
+	size_t no_tainted = 0;
+	size_t no_timer_jumps = 0;
+	size_t no_context_switches = 0;
+	size_t no_page_faults = 0;
+	size_t no_migrations = 0;
+
+	inline double discard_rate() const {
+		return (no_windows == 0) ? 0 : (double)no_tainted / no_windows;
+	}
+
+	Json to_json() const;
+};
+
+/**
+ * Optional per-repetition noise detection. A "window" spans one
+ * repetition of an experiment (flushing, workload, and probing). It is
+ * tainted if, during the window,
+ * - the thread was preempted (involuntary context switch, getrusage()),
+ * - a page fault occurred or the thread was migrated (perf_event software
+ *   counters, or getrusage() if perf_event_open() is not permitted), or
+ * - the window took more than NOISE_TIMER_JUMP_FACTOR times as long as
+ *   the shortest of the first NOISE_CALIBRATION_WINDOWS windows of the
+ *   current collection (e.g., because of an interrupt). These windows
+ *   only calibrate the bound and are discarded, such that all recorded
+ *   windows are checked against the same bound, independent of their
+ *   order.
+ * The counters are read outside of the window (before flushing and after
+ * probing), so the system calls do not disturb the measurement.
+ *
+ * The monitor is disabled by default (see set_enabled()); then windows
+ * are neither counted nor tainted. There is a single instance, see get().
+ */
+class NoiseMonitor {
+private:
+	static bool enabled;
+
+	// perf_event group (page faults, CPU migrations); -1 if not available
+	int perf_fd = -1;
+	// counter values at the beginning of the window
+	uint64_t window_begin_time = 0;
+	uint64_t window_begin_context_switches = 0;
+	uint64_t window_begin_page_faults = 0;
+	uint64_t window_begin_migrations = 0;
+	// calibration of the timer jump bound (per collection)
+	size_t no_collection_windows = 0;
+	uint64_t min_calibration_duration = 0;
+
+	NoiseMonitor();
+	~NoiseMonitor();
+
+	void read_counters(uint64_t& context_switches, uint64_t& page_faults, uint64_t& migrations) const;
+	void begin_window_slow();
+	bool end_window_slow(NoiseStats& stats);
+
+public:
+	NoiseMonitor(NoiseMonitor const&) = delete;
+	NoiseMonitor& operator=(NoiseMonitor const&) = delete;
+
+	static NoiseMonitor& get();
+
+	static inline void set_enabled(bool enable) {
+		enabled = enable;
+	}
+
+	static inline bool is_enabled() {
+		return enabled;
+	}
+
+	/**
+	 * Starts a new collection, i.e., the timer jump bound is calibrated
+	 * again (the workload may take a different time than before).
+	 */
+	inline void begin_collection() {
+		no_collection_windows = 0;
+		min_calibration_duration = 0;
+	}
+
+	inline void begin_window() {
+		if (enabled) {
+			begin_window_slow();
+		}
+	}
+
+	/**
+	 * Ends a window.
+	 *
+	 * @param      stats  The statistics to update
+	 *
+	 * @return     true if the window is clean, false if it is tainted (and
+	 *             the sample should be discarded).
+	 */
+	inline bool end_window(NoiseStats& stats) {
+		if ( ! enabled) {
+			return true;
+		}
+		return end_window_slow(stats);
+	}
+};
@@ -0,0 +1,167 @@
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+
+#include "numa_compare.hh"
+#include "mapping.hh"
+#include "cacheutils.hh"
+#include "logger.hh"
+#include "utils.hh"
+
+/**
+ * Parses the NUMA nodes of a local-versus-remote comparison.
+ *
+ * @param      spec             "<local node>,<remote node>", or "auto" to
+ *                              use the node of the measurement CPU and
+ *                              another node with memory
+ * @param      topology         The topology
+ * @param[in]  measurement_cpu  The measurement CPU
+ *
+ * @return     The local and the remote node. Exits on invalid input or if
+ *             there is no remote node.
+ */
+pair<int, int> parse_numa_nodes(string const& spec, Topology const& topology, int measurement_cpu) {
+	if (spec == "auto") {
+		int local_node = topology.numa_node_of_cpu(measurement_cpu);
+		int remote_node = topology.select_remote_numa_node(measurement_cpu);
+		if (local_node == -1 || remote_node == -1) {
+			L::err("NUMA comparison: no remote NUMA node with memory for CPU %d (local node: %d)\n", measurement_cpu, local_node);
+			exit(1);
+		}
+		return {local_node, remote_node};
+	}
+	char* end;
+	long local_node = strtol(spec.c_str(), &end, 10);
+	long remote_node = -1;
+	if (*end == ',') {
+		char const* remote_spec = end + 1;
+		remote_node = strtol(remote_spec, &end, 10);
+		if (end == remote_spec) {
+			remote_node = -1;
+		}
+	}
+	if (spec.empty() || *end != '\0' || local_node < 0 || remote_node < 0) {
+		L::err("Invalid NUMA nodes \"%s\" (expected \"<local>,<remote>\" or \"auto\")\n", spec.c_str());
+		exit(1);
+	}
+	if (local_node == remote_node) {
+		L::warn("NUMA comparison: local and remote node are the same (%ld)\n", local_node);
+	}
+	return {(int)local_node, (int)remote_node};
+}
+
+/**
+ * Determines the NUMA node the mappings are actually placed on, by
+ * allocating a mapping of a single page.
+ *
+ * @return     The node, -1 if unknown.
+ */
+static int probe_placement() {
+	Mapping mapping = allocate_mapping(PAGE_SIZE);
+	int node = numa_node_of(mapping.base_addr);
+	unmap_mapping(mapping);
+	return node;
+}
+
+/**
+ * Runs the testcase with all mappings bound to a NUMA node, in the working
+ * directory of the placement (such that the traces of the placements do
+ * not overwrite each other).
+ *
+ * @return     JSON structure with the node and the results.
+ */
+static Json run_placement(TestCaseBase& testcase, string const& placement, int node, bool only_identification) {
+	string directory = NUMA_COMPARE_DIRECTORY_PREFIX + testcase.id() + "-" + placement;
+	if (mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST) {
+		L::err("NUMA comparison: mkdir error (%s): %s\n", directory.c_str(), strerror(errno));
+		exit(1);
+	}
+	if (chdir(directory.c_str()) == -1) {
+		L::err("NUMA comparison: chdir error (%s): %s\n", directory.c_str(), strerror(errno));
+		exit(1);
+	}
+
+	L::info("NUMA comparison: running \"%s\" with %s memory (node %d)\n", testcase.id().c_str(), placement.c_str(), node);
+	set_mapping_numa_node(node);
+	int placed_node = probe_placement();
+	if (placed_node != node) {
+		L::warn("NUMA comparison: mappings are placed on node %d instead of node %d\n", placed_node, node);
+	}
+	Json result = testcase.run(only_identification);
+	set_mapping_numa_node(MAPPING_NO_NUMA_NODE);
+	json_dump_to_file(result, "results-" + testcase.id() + ".json");
+
+	if (chdir("..") == -1) {
+		L::err("NUMA comparison: chdir error (..): %s\n", strerror(errno));
+		exit(1);
+	}
+	return Json::object {
+		{"node", node},
+		{"placed_node", placed_node},
+		{"directory", directory},
+		{"results", result},
+	};
+}
+
+/**
+ * NUMA comparison mode: runs a testcase once with all mappings bound to
+ * the local NUMA node (of the measurement CPU) and once bound to a remote
+ * node, and reports whether the prefetchers are identified with both and
+ * how their prefetch metrics (coverage, distance, timeliness, see
+ * PrefetchMetrics) differ for remote memory, e.g., because a prefetcher
+ * prefetches farther ahead to hide the higher latency, or its prefetches
+ * arrive too late.
+ *
+ * @param      testcase             The testcase
+ * @param[in]  local_node           The local node
+ * @param[in]  remote_node          The remote node
+ * @param[in]  only_identification  Whether to run only the
+ *                                  identification tests
+ *
+ * @return     JSON structure with the results per placement and the
+ *             differences of the prefetch metrics.
+ */
+Json run_numa_comparison(TestCaseBase& testcase, int local_node, int remote_node, bool only_identification) {
+	Json local = run_placement(testcase, "local", local_node, only_identification);
+	Json remote = run_placement(testcase, "remote", remote_node, only_identification);
+
+	bool local_identified = local["results"]["identification"]["identified"].bool_value();
+	bool remote_identified = remote["results"]["identification"]["identified"].bool_value();
+	L::info("NUMA comparison: \"%s\" identified with local memory: %d, remote memory: %d\n", testcase.id().c_str(), local_identified, remote_identified);
+
+	// prefetch metrics per placement, printed as a table
+	char const* const phases[] = {"identification", "characteristics"};
+	char const* const metrics[] = {"mean_degree", "mean_distance", "max_distance", "coverage", "timeliness"};
+	L::info("NUMA comparison: prefetch metrics of \"%s\" (columns: local node %d, remote node %d)\n", testcase.id().c_str(), local_node, remote_node);
+	Json::object differences_json;
+	for (char const* phase : phases) {
+		Json const& local_metrics = local["results"][phase]["prefetch_metrics"];
+		Json const& remote_metrics = remote["results"][phase]["prefetch_metrics"];
+		if ( ! local_metrics.is_object() || ! remote_metrics.is_object() || local_metrics["traces"].int_value() == 0 || remote_metrics["traces"].int_value() == 0) {
+			continue;
+		}
+		for (char const* metric : metrics) {
+			string name = string {phase} + "." + metric;
+			double local_value = local_metrics[metric].number_value();
+			double remote_value = remote_metrics[metric].number_value();
+			L::info("  %-40s %.2f %.2f\n", name.c_str(), local_value, remote_value);
+			differences_json[name] = Json::object {
+				{"local", local_value},
+				{"remote", remote_value},
+				{"difference", remote_value - local_value},
+				{"relative_difference", (local_value != 0) ? (remote_value - local_value) / local_value : 0.0},
+			};
+		}
+	}
+
+	return Json::object {
+		{"testcase", testcase.id()},
+		{"local", local},
+		{"remote", remote},
+		{"identified", Json::object {
+			{"local", local_identified},
+			{"remote", remote_identified},
+		}},
+		{"metric_differences", differences_json},
+	};
+}
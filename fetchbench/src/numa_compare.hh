@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+#include "json11.hpp"
+
+#include "testcase.hh"
+#include "topology.hh"
+
+using json11::Json;
+using std::pair;
+using std::string;
+
+// Prefix of the working directory of each placement
+#define NUMA_COMPARE_DIRECTORY_PREFIX "numa-"
+
+pair<int, int> parse_numa_nodes(string const& spec, Topology const& topology, int measurement_cpu);
+Json run_numa_comparison(TestCaseBase& testcase, int local_node, int remote_node, bool only_identification);
@@ -2,66 +2,52 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
-#include <pthread.h>
-#include <unistd.h>
 #include <sys/mman.h>
 
-#include <time.h>
-
-
-#ifdef COUNTER_THREAD
-    #include <pthread.h>
-    volatile uint64_t timestamp;
-    static void* counter_thread_thread(void* arg){
-        for(;;){
-            timestamp ++;
-        }
-    }
-#endif /* COUNTER_THREAD */
+#include "parr.h"
 
 /* Used by assembly */
-uint64_t iters;
-uint64_t blind_key;
-uint64_t head;
-uint64_t increment;
-uint64_t blind_measure;
-uint64_t blind_ref;
-uint64_t time_measure;
+uint64_t parr_iters;
+uint64_t parr_blind_key;
+uint64_t parr_head;
+uint64_t parr_increment;
+uint64_t parr_blind_measure;
+uint64_t parr_time_measure;
 
 /*
 implemented in assembly.
 Psudocode:
-void pchase(){
+void parr_pchase(){
     for(size_t i = 0; i <= iters; i++){
         uint64_t ptr = *(uint64_t*)(head + i * increment) ^ blind_key;
         *(uint64_t*)ptr;
     }
-    time_measure = measure_time(*(uint64_t*)(blind_measure ^ blind_key));
+    parr_time_measure = measure_time(*(uint64_t*)(blind_measure ^ blind_key));
     time_ref     = measure_time(*(uint64_t*)(blind_ref     ^ blind_key));
 }
 */
-void pchase();
+void parr_pchase();
 
 /*
 implemmented in assembly.
 Pseudocode:
-void test_pc(){
+void parr_test_pc(){
     // UNROLL loop
     for(size_t i = 0; i <= iters; i++){
         uint64_t ptr = *(uint64_t*)(head + i) ^ blind_key;
         *(uint64_t*)ptr;
     }
-    time_measure = measure_time(*(uint64_t*)(blind_measure ^ blind_key));
+    parr_time_measure = measure_time(*(uint64_t*)(blind_measure ^ blind_key));
     time_ref     = measure_time(*(uint64_t*)(blind_ref     ^ blind_key));
 }
 */
-void test_pc();
+void parr_test_pc();
 
 /*
 implemented in assembly
 basically test_pc only that instructions are on different pages and are on different page offsets
 */
-void test_pc_align();
+void parr_test_pc_align();
 
 #define BLIND_MEASURE_KEY 0x4242424242424242ull
 
@@ -71,39 +57,94 @@ static uint64_t rand64() {
     return rand_seed = (164603309694725029ull * rand_seed) % 14738995463583502973ull;
 }
 
-static void setup_pointers(
-    uint64_t* parr_base, 
-    uint64_t parr_entries_count, 
-    uint64_t parr_entry_size, 
-    uint64_t tarr_base, 
+// placement of the pointers of one repetition. A single layout is allocated
+// per experiment and re-shuffled in place for every repetition.
+typedef struct {
+    // permutation of the target array indices (partially re-shuffled for each repetition)
+    uint64_t* perm;
+    uint64_t tarr_entries_count;
+    uint64_t tarr_base;
+    uint64_t tarr_entry_size;
+    uint64_t parr_entries_count;
+    // target address (not blinded) of each pointer array entry
+    uint64_t* targets;
+    // target address (not blinded) for the reference measurement
+    uint64_t ref_target;
+    // backing memory for perm and targets
+    void* memory;
+    uint64_t memory_size;
+} layout_t;
+
+// draw a new placement with a partial Fisher-Yates shuffle of the permutation.
+// The permutation stays a permutation, so it never has to be reset.
+static void layout_shuffle(layout_t* layout){
+    uint64_t n = layout->tarr_entries_count;
+    // +1 because we need a ref pointer that is not in the array
+    for(uint64_t i = 0; i < layout->parr_entries_count + 1; i++){
+        uint64_t j = i + rand64() % (n - i);
+        uint64_t idx = layout->perm[j];
+        layout->perm[j] = layout->perm[i];
+        layout->perm[i] = idx;
+        
+        uint64_t target = layout->tarr_base + idx * layout->tarr_entry_size * sizeof(uint64_t);
+        if(i == 0){
+            layout->ref_target = target;
+        } else {
+            layout->targets[i - 1] = target;
+        }
+    }
+}
+
+static void layout_init(
+    layout_t* layout,
+    uint64_t parr_entries_count,
+    uint64_t tarr_base,
     uint64_t tarr_entries_count,
-    uint64_t tarr_entry_size,
-    uint64_t blind_key,
-    uint64_t ref_ptr_offset
+    uint64_t tarr_entry_size
 ){
-    // +1 because we need a ref pointer that is not in the array
-    if(tarr_entries_count + 1 < parr_entries_count){
+    if(parr_entries_count + 1 > tarr_entries_count){
         fprintf(stderr, "pointer array is too big for target array (%zu vs. %zu)\n", parr_entries_count, tarr_entries_count);
         exit(1);
     }
     
-    // entries in target array that are already used
-    uint8_t* used = calloc(tarr_entries_count, sizeof(uint8_t));
+    layout->tarr_entries_count = tarr_entries_count;
+    layout->tarr_base = tarr_base;
+    layout->tarr_entry_size = tarr_entry_size;
+    layout->parr_entries_count = parr_entries_count;
     
-    uint64_t idx = rand64() % tarr_entries_count;
-    used[idx] = 1;
-    blind_measure = (tarr_base + idx * tarr_entry_size * sizeof(uint64_t) + ref_ptr_offset) ^ BLIND_MEASURE_KEY;
+    // a single allocation per experiment, nothing is allocated per repetition
+    layout->memory_size = sizeof(uint64_t) * (tarr_entries_count + parr_entries_count);
+    layout->memory = mmap(NULL, layout->memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(layout->memory == MAP_FAILED){
+        perror("mmap");
+        exit(1);
+    }
+    layout->perm = (uint64_t*)layout->memory;
+    for(uint64_t i = 0; i < tarr_entries_count; i++){
+        layout->perm[i] = i;
+    }
+    layout->targets = layout->perm + tarr_entries_count;
+}
+
+static void layout_destroy(layout_t* layout){
+    munmap(layout->memory, layout->memory_size);
+}
+
+// write the pointers of a layout to the pointer array. Only the pointer
+// slots are written, so the space in between stays zero (as mapped).
+static void setup_pointers(
+    uint64_t* parr_base, 
+    uint64_t parr_entries_count, 
+    uint64_t parr_entry_size, 
+    layout_t const* layout,
+    uint64_t blind_key,
+    uint64_t ref_ptr_offset
+){
+    parr_blind_measure = (layout->ref_target + ref_ptr_offset) ^ BLIND_MEASURE_KEY;
     
     for(uint64_t i = 0; i < parr_entries_count; i++){
-        do {
-            idx = rand64() % tarr_entries_count;
-        } while(used[idx]);
-        
-        parr_base[i * parr_entry_size] = (tarr_base + idx * tarr_entry_size * sizeof(uint64_t)) ^ blind_key;
-        used[idx] = 1;
-    }    
-    
-    free(used);
+        parr_base[i * parr_entry_size] = layout->targets[i] ^ blind_key;
+    }
 }
 
 #if defined(__x86_64__)
@@ -116,49 +157,150 @@ static void setup_pointers(
 #ifdef FLUSHING
   #warning Using Flushing
   #if defined(__x86_64__)
-  uint64_t thrash_cache(void* memory, uint64_t size) {
-      for(uint64_t offset = 0; offset < size; offset += 64){
-          asm volatile("clflush (%0)" :: "r" ((uint64_t)memory + offset));
-      }
-  }
-
+    #define flush_line(x) asm volatile("clflush (%0)" :: "r" (x))
+    #define flush_fence() asm volatile("mfence")
   #else /* probably arm */
-  
-  uint64_t thrash_cache(void* memory, uint64_t size) {
+    #define flush_line(x) asm volatile("DC CIVAC, %0" :: "r" (x))
+    #define flush_fence() asm volatile("DSB ISH")
+  #endif /* architecture */
+
+  static void parr_thrash_cache(void* memory, uint64_t size) {
       for(uint64_t offset = 0; offset < size; offset += 64){
-          asm volatile("DC CIVAC, %0" :: "r" ((uint64_t)memory + offset));
+          flush_line((uint64_t)memory + offset);
       }
   }
-  
-#endif /* architecture */
 #elif defined (EVICTION)
   #warning Using Eviction
-  uint64_t cache_thrash_array[1024*1024*128];
-  uint64_t thrash_cache(void* memory, uint64_t size){
-      uint64_t result = 0;
+  // size of the eviction array, must be (much) larger than the last-level
+  // cache
+  #ifndef EVICTION_SIZE
+    #define EVICTION_SIZE ((uint64_t)1024 * 1024 * 1024)
+  #endif /* EVICTION_SIZE */
+  static uint64_t cache_thrash_array[EVICTION_SIZE / sizeof(uint64_t)];
+  static void parr_thrash_cache(void* memory, uint64_t size){
       for(uint64_t i = 8; i < sizeof(cache_thrash_array) / 8 - 8; i += 8){
           maccess(&cache_thrash_array[i - 8]);
           maccess(&cache_thrash_array[i]);
           maccess(&cache_thrash_array[i + 8]);
         //cache_thrash_array[i] = 5;
       } 
-      return result;
   }
 #else
   #error No cache control defined, use FLUSHING, or EVICTION
 #endif /* cache control */
 
-void access_pages(uint64_t* arr, uint64_t size){
-     for(uint64_t i = 0; i <= size; i += 4096){
+static void parr_access_pages(uint64_t* arr, uint64_t size){
+     for(uint64_t i = 0; i < size; i += 4096){
          void* target = (void*)&arr[i / sizeof(uint64_t)];
          maccess(target);
      }
 }
 
-static void run_pc_experiment(
+// Radius (in bytes) around each target that is flushed after a repetition
+// with bounded thrashing. It covers the measurement offsets (up to +-512
+// bytes) and lines that adjacent/next-line prefetchers may have fetched.
+// Must stay below 4096, as the target array has a page of slack on both
+// ends.
+#define FLUSH_RADIUS 1024
+
+// flush only the lines a repetition could have touched instead of the whole arrays
+static int bounded_thrash = 1;
+
+void parr_set_bounded_thrash(int enabled){
+    bounded_thrash = enabled;
+}
+
+static int use_bounded_thrash(){
+#ifdef FLUSHING
+    return bounded_thrash;
+#else
+    // lines can not be evicted selectively
+    return 0;
+#endif /* FLUSHING */
+}
+
+// 128-byte line pair that is touched to fill the TLB entry of a target's
+// page: half a page away from the target, such that neither the pair nor
+// lines an adjacent-line prefetcher fetches along with it can be measured
+static uint64_t tlb_warm_pair(uint64_t target){
+    return (target ^ 2048ull) & ~127ull;
+}
+
+// cache state at the start of an experiment: nothing of both arrays is cached
+static void init_caches(uint64_t* parr, uint64_t parr_size, uint64_t* tarr, uint64_t tarr_size){
+    if(use_bounded_thrash()){
+        parr_thrash_cache(parr, parr_size);
+        parr_thrash_cache(tarr, tarr_size);
+    }
+}
+
+// cache state right before the measurement: nothing of both arrays is cached,
+// and the TLB holds the pages of all targets
+static void prepare_caches(
+    uint64_t* parr,
+    uint64_t parr_size,
+    uint64_t parr_entries_count,
+    uint64_t parr_entry_size,
+    uint64_t* tarr,
+    uint64_t tarr_size,
+    layout_t const* layout
+){
+    if(!use_bounded_thrash()){
+        parr_thrash_cache(parr, parr_size);
+        parr_thrash_cache(tarr, tarr_size);
+        parr_access_pages(tarr, tarr_size);
+        return;
+    }
+#ifdef FLUSHING
+    // touch the pages of all targets to fill the TLB, then flush the
+    // touched line pairs again (the TLB entries stay)
+    maccess(tlb_warm_pair(layout->ref_target));
+    for(uint64_t i = 0; i < layout->parr_entries_count; i++){
+        maccess(tlb_warm_pair(layout->targets[i]));
+    }
+    flush_line(tlb_warm_pair(layout->ref_target));
+    flush_line(tlb_warm_pair(layout->ref_target) + 64);
+    for(uint64_t i = 0; i < layout->parr_entries_count; i++){
+        flush_line(tlb_warm_pair(layout->targets[i]));
+        flush_line(tlb_warm_pair(layout->targets[i]) + 64);
+    }
+    // the pointer slots were just written by setup_pointers. The rest of
+    // the target array was flushed after it was touched the last time.
+    uint64_t last_line = (uint64_t)-1;
+    for(uint64_t i = 0; i < parr_entries_count; i++){
+        uint64_t line = (uint64_t)&parr[i * parr_entry_size] & ~63ull;
+        if(line != last_line){
+            flush_line(line);
+            last_line = line;
+        }
+    }
+    // the flushes are right before the measurement, make sure they completed
+    flush_fence();
+#endif /* FLUSHING */
+}
+
+static void flush_around(uint64_t target){
+#ifdef FLUSHING
+    for(uint64_t line = (target & ~63ull) - FLUSH_RADIUS; line <= (target & ~63ull) + FLUSH_RADIUS; line += 64){
+        flush_line(line);
+    }
+#endif /* FLUSHING */
+}
+
+// flush everything the last repetition could have touched in the target array
+static void cleanup_caches(layout_t const* layout){
+    if(!use_bounded_thrash()){
+        return;
+    }
+    flush_around(layout->ref_target);
+    for(uint64_t i = 0; i < layout->parr_entries_count; i++){
+        flush_around(layout->targets[i]);
+    }
+}
+
+void parr_run_pc_experiment(
     uint64_t repeat,
-    uint64_t* measure_out, // array to write timings for measured pointer to
-    uint64_t* ref_out, // array to write timings for ref pointer to
+    latency_record_t* record, // accumulator for the timings
     uint64_t _blind_key
 ) {
    uint64_t _parr_size = sizeof(uint64_t*) * 1 * 512 + 4096;
@@ -173,38 +315,36 @@ static void run_pc_experiment(
        tarr[i] = rand64();
    }
    
-   blind_key = _blind_key;
+   parr_blind_key = _blind_key;
+   
+   parr_increment = 1 * 8;
+   parr_head = (uint64_t) &parr[0];
    
-   increment = 1 * 8;
-   head = (uint64_t) &parr[0];
+   layout_t layout;
+   layout_init(&layout, 512, (uint64_t)tarr + 4096 * 4, 600, 16);
+   init_caches(parr, _parr_size, tarr, _tarr_size);
    
    for(size_t r = 0; r < 2 * repeat; r++){
-       memset(parr, 0, _parr_size);
-       setup_pointers(parr, 512, 1, (uint64_t)tarr + 4096 * 4, 600, 16, blind_key, 0);
+       layout_shuffle(&layout);
+       setup_pointers(parr, 512, 1, &layout, parr_blind_key, 0);
        if(r % 2){
-           blind_measure = (parr[16] + 0) ^ blind_key ^ BLIND_MEASURE_KEY; 
+           parr_blind_measure = (parr[16] + 0) ^ parr_blind_key ^ BLIND_MEASURE_KEY; 
        }
-       thrash_cache(parr, _parr_size);
-       thrash_cache(tarr, _tarr_size);
+       prepare_caches(parr, _parr_size, 512, 1, tarr, _tarr_size, &layout);
+       parr_test_pc();
        
-       access_pages(tarr, _tarr_size);
-       test_pc();
-       
-       if(r % 2){
-           measure_out[r / 2] = time_measure;
-       } else {
-           ref_out[r / 2] = time_measure;
-       }
+       latency_record_add(record, r / 2, !(r % 2), parr_time_measure);
+       cleanup_caches(&layout);
    }
    
+   layout_destroy(&layout);
    munmap(parr, _parr_size);
    munmap(tarr, _tarr_size);
 }
 
-static void run_pc_align_experiment(
+void parr_run_pc_align_experiment(
     uint64_t repeat,
-    uint64_t* measure_out, // array to write timings for measured pointer to
-    uint64_t* ref_out, // array to write timings for ref pointer to
+    latency_record_t* record, // accumulator for the timings
     uint64_t _blind_key
 ) {
    uint64_t _parr_size = sizeof(uint64_t*) * 1 * 512 + 4096;
@@ -219,34 +359,34 @@ static void run_pc_align_experiment(
        tarr[i] = rand64();
    }
    
-   blind_key = _blind_key;
+   parr_blind_key = _blind_key;
+   
+   parr_increment = 1 * 8;
+   parr_head = (uint64_t) &parr[0];
    
-   increment = 1 * 8;
-   head = (uint64_t) &parr[0];
+   layout_t layout;
+   layout_init(&layout, 512, (uint64_t)tarr + 4096 * 4, 600, 16);
+   init_caches(parr, _parr_size, tarr, _tarr_size);
    
    for(size_t r = 0; r < 2 * repeat; r++){
-       memset(parr, 0, _parr_size);
-       setup_pointers(parr, 512, 1, (uint64_t)tarr + 4096 * 4, 600, 16, blind_key, 0);
+       layout_shuffle(&layout);
+       setup_pointers(parr, 512, 1, &layout, parr_blind_key, 0);
        if(r % 2){
-           blind_measure = (parr[16] + 0) ^ blind_key ^ BLIND_MEASURE_KEY;
+           parr_blind_measure = (parr[16] + 0) ^ parr_blind_key ^ BLIND_MEASURE_KEY;
        }
-       thrash_cache(parr, _parr_size); 
-       thrash_cache(tarr, _tarr_size);
-       access_pages(tarr, _tarr_size);
-       test_pc_align();
+       prepare_caches(parr, _parr_size, 512, 1, tarr, _tarr_size, &layout);
+       parr_test_pc_align();
        
-       if(r % 2){
-           measure_out[r / 2] = time_measure;
-       } else {
-           ref_out[r / 2] = time_measure;
-       }
+       latency_record_add(record, r / 2, !(r % 2), parr_time_measure);
+       cleanup_caches(&layout);
    }
    
+   layout_destroy(&layout);
    munmap(parr, _parr_size);
    munmap(tarr, _tarr_size);
 }
 
-static void run_experiment(
+void parr_run_experiment(
    size_t parr_entries_count,  // amount of entries in pointer array [ in parr_entry_size ]
    size_t parr_entry_size, // amount of space in between pointers (independent of space between accesses) [ in pointers ]
    size_t tarr_entries_count, // amount of integers in accessed array [ in tarr_entry_size ]
@@ -255,8 +395,7 @@ static void run_experiment(
    size_t _iters, // amount of loop iterations
    size_t repeat, // how often to repeat the experiment
    size_t measure_index, // index to measure 
-   uint64_t* measure_out, // array to write timings for measured pointer to
-   uint64_t* ref_out, // array to write timings for ref pointer to
+   latency_record_t* record, // accumulator for the timings
    uint64_t _blind_key, // xor key to use to encrypt pointers
    uint64_t ptr_offset, // offset from start of (maybe) cached entry to measure
    uint64_t iter_start_idx // start index for iteration
@@ -274,320 +413,39 @@ static void run_experiment(
        tarr[i] = rand64();
    }
    
-   blind_key = _blind_key;
-   iters = _iters;
-   increment = iter_increment * 8;
-   head = (uint64_t) &parr[iter_start_idx];
+   parr_blind_key = _blind_key;
+   parr_iters = _iters;
+   parr_increment = iter_increment * 8;
+   parr_head = (uint64_t) &parr[iter_start_idx];
+   
+   layout_t layout;
+   layout_init(&layout, parr_entries_count, (uint64_t)tarr + 4096 * 4, tarr_entries_count, tarr_entry_size);
+   init_caches(parr, _parr_size, tarr, _tarr_size);
    
    for(size_t r = 0; r < 2 * repeat; r++){
-       memset(parr, 0, sizeof(uint64_t*) * parr_entry_size * parr_entries_count);
-       setup_pointers(parr, parr_entries_count, parr_entry_size, (uint64_t)tarr + 4096 * 4, tarr_entries_count, tarr_entry_size, blind_key, ptr_offset);
+       layout_shuffle(&layout);
+       setup_pointers(parr, parr_entries_count, parr_entry_size, &layout, parr_blind_key, ptr_offset);
        if(r % 2){
-           blind_measure = (parr[measure_index * parr_entry_size] + ptr_offset) ^ blind_key ^ BLIND_MEASURE_KEY;
+           parr_blind_measure = (parr[measure_index * parr_entry_size] + ptr_offset) ^ parr_blind_key ^ BLIND_MEASURE_KEY;
        }
-       thrash_cache(parr, _parr_size);
-       thrash_cache(tarr, _tarr_size);
-       access_pages(tarr, _tarr_size);
-       
+       prepare_caches(parr, _parr_size, parr_entries_count, parr_entry_size, tarr, _tarr_size, &layout);
+       parr_pchase();
        
-       pchase();
-       
-       if(r % 2){
-           measure_out[r / 2] = time_measure;
-       } else {
-           ref_out[r / 2]     = time_measure;
-       }
+       latency_record_add(record, r / 2, !(r % 2), parr_time_measure);
+       cleanup_caches(&layout);
    }
    
+   layout_destroy(&layout);
    munmap(parr, _parr_size);
    munmap(tarr, _tarr_size);
 }
 
-int uint64_t_compare(const void* _a, const void* _b){
-    uint64_t a = *(const uint64_t*)_a;
-    uint64_t b = *(const uint64_t*)_b;
-    if(a < b)
-        return -1;
-    if(b < a)
-        return 1;
-    return 0;
-}
-
-int main(int argc, char** argv){
-    #ifdef COUNTER_THREAD
-        pthread_t thread;
-        pthread_create(&thread, NULL, counter_thread_thread, NULL);
-        usleep(10000);
-    #endif /* COUNTER_THREAD */
-    
-    // seed random
-    rand_seed = time(NULL);
-    
-    printf("; seed: %zu\n", rand_seed);
+void parr_seed(uint64_t seed){
+    rand_seed = seed;
     
     #ifdef EVICTION
     for(size_t i = 0; i < sizeof(cache_thrash_array) / sizeof(uint64_t); i++){
         cache_thrash_array[i] = rand64();
     }
     #endif /* EVICTION */
-    
-    // #define ITERS 200    
-    uint64_t ITERS = (uint64_t)atol(argv[1]);
-    
-    
-    uint64_t* measure_out = malloc(ITERS * sizeof(uint64_t));
-    uint64_t* ref_out     = malloc(ITERS * sizeof(uint64_t));
-    
-    // test for existence of the prefetcher
-    printf("#[Experiment][existence]: start\n");
-    run_experiment(
-        512,         // 512 entries in pointer array
-        1,           // no space between pointers
-        60000,         // 600 entries in target array
-        16,          // 128 byte entries
-        1,           // go to direct next pointer when iterating
-        120,         // amount of training pointers
-        ITERS,       // amount of iterations
-        120,         // access pointer directly after (possibly) prefetched entry
-        measure_out, // output for measurement timings
-        ref_out,     // output for reference timings
-        0,           // no blinding here
-        0,           // measure directly at (possibly) prefetched entry
-        0            // start training with index 0
-    );
-    qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    for(size_t i = 0; i < ITERS; i++){
-        printf("%zu %zu\n", measure_out[i], ref_out[i]);
-    }
-    printf("#[Experiment][existence]: end\n");
-    
-    // test for existence of the prefetcher (use blinding, should rule out false positives)
-    printf("#[Experiment][existence-ref]: start\n");
-    run_experiment(
-        512,         // 512 entries in pointer array
-        1,           // no space between pointers
-        60000,         // 600 entries in target array
-        16,          // 128 byte entries
-        1,           // go to direct next pointer when iterating
-        120,         // amount of training pointers
-        ITERS,       // amount of iterations
-        120,         // access pointer directly after (possibly) prefetched entry
-        measure_out, // output for measurement timings
-        ref_out,     // output for reference timings
-        0x42434445,  // do blinding here
-        0,           // measure directly at (possibly) prefetched entry
-        0            // start training with index 0
-    );
-    qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    for(size_t i = 0; i < ITERS; i++){
-        printf("%zu %zu\n", measure_out[i], ref_out[i]);
-    }
-    printf("#[Experiment][existence-ref]: end\n");
-    
-    // test whether the prefetcher detects backwards iteration
-    printf("#[Experiment][backwards]: start\n");
-    run_experiment(
-        512,         // 512 entries in pointer array
-        1,           // no space between pointers
-        60000,         // 600 entries in target array
-        16,          // 128 byte entries
-        (uint64_t)-1,// go to direct previous pointer when iterating
-        120,         // amount of training pointers
-        ITERS,       // amount of iterations
-        0,           // access pointer directly after (possibly) prefetched entry
-        measure_out, // output for measurement timings
-        ref_out,     // output for reference timings
-        0,           // no blinding here
-        0,           // measure directly at (possibly) prefetched entry
-        121          // start training with index 121
-    );
-    qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    for(size_t i = 0; i < ITERS; i++){
-        printf("%zu %zu\n", measure_out[i], ref_out[i]);
-    }
-    printf("#[Experiment][backwards]: end\n");
-    
-    // test whether the prefetcher detects backwards iteration
-    printf("#[Experiment][backwards-ref]: start\n");
-    run_experiment(
-        512,         // 512 entries in pointer array
-        1,           // no space between pointers
-        60000,         // 600 entries in target array
-        16,          // 128 byte entries
-        (uint64_t)-1,// go to direct previous pointer when iterating
-        120,         // amount of training pointers
-        ITERS,       // amount of iterations
-        0,           // access pointer directly after (possibly) prefetched entry
-        measure_out, // output for measurement timings
-        ref_out,     // output for reference timings
-        0xcafebabe,  // use blinding here
-        0,           // measure directly at (possibly) prefetched entry
-        121          // start training with index 121
-    );
-    qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    for(size_t i = 0; i < ITERS; i++){
-        printf("%zu %zu\n", measure_out[i], ref_out[i]);
-    }
-    printf("#[Experiment][backwards-ref]: end\n");
-    
-    
-    // test whether prefetching depends on pc
-    printf("#[Experiment][pc-dependence]: start\n");
-    run_pc_experiment(
-        ITERS, measure_out, ref_out, 0
-    );
-    qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    for(size_t i = 0; i < ITERS; i++){
-        printf("%zu %zu\n", measure_out[i], ref_out[i]);
-    }
-    printf("#[Experiment][pc-dependence]: end\n");
-    
-    // reference test for whether prefetching depends on pc
-    printf("#[Experiment][pc-dependence-ref]: start\n");
-    run_pc_experiment(
-        ITERS, measure_out, ref_out, 0x42434445
-    );
-    qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    for(size_t i = 0; i < ITERS; i++){
-        printf("%zu %zu\n", measure_out[i], ref_out[i]);
-    }
-    printf("#[Experiment][pc-dependence-ref]: end\n");
-    
-    // test whether prefetching depends on pc (on different pages at different offsets)
-    printf("#[Experiment][pc-dependence-align]: start\n");
-    run_pc_align_experiment(
-        ITERS, measure_out, ref_out, 0
-    );
-    qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    for(size_t i = 0; i < ITERS; i++){
-        printf("%zu %zu\n", measure_out[i], ref_out[i]);
-    }
-    printf("#[Experiment][pc-dependence-align]: end\n");
-    
-    // reference test for whether prefetching depends on pc
-    printf("#[Experiment][pc-dependence-align-ref]: start\n");
-    run_pc_align_experiment(
-        ITERS, measure_out, ref_out, 0x42434445
-    );
-    qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-    for(size_t i = 0; i < ITERS; i++){
-        printf("%zu %zu\n", measure_out[i], ref_out[i]);
-    }
-    printf("#[Experiment][pc-dependence-align-ref]: end\n");
-    
-    // test different amounts of training pointers
-    printf("#[Experiment][training-pointers]: start\n");
-    for(uint64_t o = 1; o <= 16; o++){
-        run_experiment(
-            512,         // 512 entries in pointer array
-            8,           // no space between pointers
-            60000,         // 600 entries in target array
-            16,          // 128 byte entries
-            8,           // go to direct next pointer when iterating
-            o,           // amount of training pointers
-            ITERS,       // amount of iterations
-            o,           // access pointer directly after (possibly) prefetched entry
-            measure_out, // output for measurement timings
-            ref_out,     // output for reference timings
-            0,           // no blinding here
-            0,           // measure directly at (possibly) prefetched entry
-            0            // start training with index 0
-        );
-        qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-        qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-        for(size_t i = 0; i < ITERS; i++){
-            printf("%zu %zu %zu\n", o, measure_out[i], ref_out[i]);
-        }
-    }
-    printf("#[Experiment][training-pointers]: end\n");
-    
-    // test different measurement offsets from (possibly) prefetched pointer
-    printf("#[Experiment][target-offset]: start\n");
-    for(uint64_t o = 0; o <= 1024; o += 8){
-        run_experiment(
-            512,         // 512 entries in pointer array
-            1,           // no space between pointers
-            60000,         // 600 entries in target array
-            16,          // 128 byte entries
-            1,           // go to direct next pointer when iterating
-            120,         // amount of training pointers
-            ITERS,       // amount of iterations
-            120,         // access pointer directly after (possibly) prefetched entry
-            measure_out, // output for measurement timings
-            ref_out,     // output for reference timings
-            0,           // no blinding here
-            o-512,       // measure at currently tested offset (offset is in bytes)
-            0            // start training with index 0
-        );
-        qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-        qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-        for(size_t i = 0; i < ITERS; i++){
-            printf("%zd %zu %zu\n", (int64_t)(o-512), measure_out[i], ref_out[i]);
-        }
-    }
-    printf("#[Experiment][target-offset]: end\n");
-    
-    // test different offsets from last training pointer to measure
-    printf("#[Experiment][pointer-array-offset]: start\n");
-    for(uint64_t o = 0; o <= 256; o++){
-        run_experiment(
-            512,         // 512 entries in pointer array
-            1,           // no space between pointers
-            60000,         // 600 entries in target array
-            16,          // 128 byte entries
-            1,           // go to direct next pointer when iterating
-            120,         // amount of training pointers
-            ITERS,       // amount of iterations
-            120 + o,     // measure pointer at current offset from training pointer (0 is actually 1 :-) )
-            measure_out, // output for measurement timings
-            ref_out,     // output for reference timings
-            0,           // no blinding here
-            0,           // measure directly at (possibly) prefetched entry
-            0            // start training with index 0
-        );
-        qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-        qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-        for(size_t i = 0; i < ITERS; i++){
-            printf("%zu %zu %zu\n", o, measure_out[i], ref_out[i]);
-        }
-    }
-    printf("#[Experiment][pointer-array-offset]: end\n");
-    
-    // test different offsets between pointers
-    printf("#[Experiment][pointer-array-space]: start\n");
-    for(uint64_t o = 1; o <= 128; o++){
-        run_experiment(
-            512,         // 512 entries in pointer array
-            o,           // current space between pointers (in multiples of 8 bytes)
-            60000,         // 600 entries in target array
-            16,          // 128 byte entries
-            o,           // iterate with current offset (in multiples of 8 bytes)
-            120,         // amount of training pointers
-            ITERS,       // amount of iterations
-            120,         // access pointer directly after (possibly) prefetched entry
-            measure_out, // output for measurement timings
-            ref_out,     // output for reference timings
-            0,           // no blinding here
-            0,           // measure directly at (possibly) prefetched entry
-            0            // start training with index 0
-        );
-        qsort(measure_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-        qsort(ref_out, ITERS, sizeof(uint64_t), uint64_t_compare);
-        for(size_t i = 0; i < ITERS; i++){
-            printf("%zu %zu %zu\n", o, measure_out[i], ref_out[i]);
-        }
-    }
-    printf("#[Experiment][pointer-array-space]: end\n");
-    
-    free(measure_out);
-    free(ref_out);
-    exit(0);
 }
@@ -0,0 +1,55 @@
+#ifndef PARR_H
+#define PARR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../latency_record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+Pointer array (array of pointers) prefetcher test.
+The functions below run one experiment each and add `repeat` timings for
+the measured pointer and `repeat` timings for a reference pointer (that is
+never accessed before) to `record` (see latency_record.h), which must be
+zeroed before the first experiment. The timings are taken
+with the timing source the library is compiled for (COUNTER_THREAD reads the
+counter of the global counter thread, see counter_thread.hh).
+*/
+
+// seed the pseudo random number generator used to place the pointers
+void parr_seed(uint64_t seed);
+
+// flush only the lines a repetition could have touched (default) instead of
+// both arrays. Only supported with FLUSHING.
+void parr_set_bounded_thrash(int enabled);
+
+void parr_run_experiment(
+    size_t parr_entries_count, // amount of entries in pointer array [ in parr_entry_size ]
+    size_t parr_entry_size, // amount of space in between pointers (independent of space between accesses) [ in pointers ]
+    size_t tarr_entries_count, // amount of integers in accessed array [ in tarr_entry_size ]
+    size_t tarr_entry_size, // size of a single entry in target array [in uint64_ts ]
+    size_t iter_increment, // amount of space between accesses [ in pointers ]
+    size_t iters, // amount of loop iterations
+    size_t repeat, // how often to repeat the experiment
+    size_t measure_index, // index to measure
+    latency_record_t* record, // accumulator for the timings
+    uint64_t blind_key, // xor key to use to encrypt pointers
+    uint64_t ptr_offset, // offset from start of (maybe) cached entry to measure
+    uint64_t iter_start_idx // start index for iteration
+);
+
+// training loop unrolled, i.e., each pointer is accessed by a different instruction
+void parr_run_pc_experiment(uint64_t repeat, latency_record_t* record, uint64_t blind_key);
+
+// like parr_run_pc_experiment, but the instructions are on different pages and at different page offsets
+void parr_run_pc_align_experiment(uint64_t repeat, latency_record_t* record, uint64_t blind_key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PARR_H */
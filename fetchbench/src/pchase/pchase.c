@@ -1,152 +1,207 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <stdint.h>
-#include <pthread.h>
-#include <unistd.h>
-#include <sys/mman.h>
-
-#include <time.h>
-
-
-#ifdef COUNTER_THREAD
-    #include <pthread.h>
-    volatile uint64_t timestamp;
-    static void* counter_thread_thread(void* arg){
-        for(;;){
-            timestamp ++;
-        }
-    }
-#endif /* COUNTER_THREAD */
-
-
-#define BLIND_MEASURE_KEY 0x4242424242424242ull
-#define CACHE_LINE_SIZE 64
-#define PAGE_SIZE (4096 * 4)
-#define THRASH_ALLOC ((uint64_t)1024 * 1024 * 1024)
-#define ENTRIES_COUNT (20 * PAGE_SIZE / sizeof(struct entry))
-
-#if defined(__x86_64__)
-    #define maccess(x) asm volatile("mov (%0), %%rax" :: "r" (x) : "rax")
-#else /* probably arm */
-    #define maccess(x) asm volatile("ldr x0, [%0]\n" :: "r" (x) : "x1")
-#endif /* architecture */
-
-// linked list entry
-struct entry {
-    struct entry* next;
-    char selected[2*CACHE_LINE_SIZE - sizeof(struct entry*)];
-};
-
-// memory containing the linked list (all on one page)
-struct entry* entry_array;
-
-uint64_t m_measure;
-// amount of entries
-uint64_t entries;
-// blind pointers so prefetcher cannot detect them
-uint64_t xor_key;
-// blinded pointer to head
-uint64_t head_blinded;
-// pointer to measure (blinded)
-uint64_t pref_blinded;
-
-static struct entry* select_entry(){
-    struct entry* result;
-    do {
-        result = &entry_array[rand() % ENTRIES_COUNT];
-    } while(result->selected[0]);
-    result->selected[0] = 1;
-    return result;
-}
-
-static void thrash_cache(void* memory, uint64_t size){
-    for(uint64_t i = 0; i < size; i += CACHE_LINE_SIZE){
-        #if defined(__x86_64__)
-            asm volatile("clflush (%0)" :: "r" ((uint64_t)memory + i));
-        #else /* probably Arm */
-            asm volatile("DC CIVAC, %0" :: "r" ((uint64_t)memory + i));
-        #endif /* __x86_64__ */
-    }
-}
-
-// function to initialize linked list with random order
-static void init(int is_ref){
-	memset(entry_array, 0, sizeof(struct entry) * ENTRIES_COUNT); 
-	
-	struct entry* ref = select_entry();
-	struct entry* head = select_entry();
-	struct entry* last = head;
-	
-	for(uint64_t i = 0; i < entries; i++) {
-	    struct entry* cur = select_entry();
-	    last->next = cur;
-	    last = cur;
-	}
-	
-	xor_key = (uint64_t)BLIND_MEASURE_KEY;
-	head_blinded = (uint64_t)(void*)head ^ xor_key;
-    pref_blinded = (uint64_t)(void*)(is_ref ? ref : last) ^ xor_key;
-}
-
-// actual pointer chase function (implemented in assembly)
-void pchase();
-
-int uint64_t_compare(const void* _a, const void* _b){
-    uint64_t a = *(const uint64_t*)_a;
-    uint64_t b = *(const uint64_t*)_b;
-    if(a < b)
-        return -1;
-    if(b < a)
-        return 1;
-    return 0;
-}
-
-void access_pages(uint64_t* arr, uint64_t size){
-     for(uint64_t i = 0; i <= size; i += 4096){
-         void* target = (void*)&arr[i / sizeof(uint64_t)];
-         maccess(target);
-     }
-}
-
-int main(int argc, char** argv){
-    #ifdef COUNTER_THREAD
-        pthread_t thread;
-        pthread_create(&thread, NULL, counter_thread_thread, NULL);
-        usleep(10000);
-    #endif /* COUNTER_THREAD */
-
-    srand(time(NULL));
-
-    entry_array = malloc(sizeof(struct entry) * ENTRIES_COUNT);
-    memset(entry_array, 'A', sizeof(struct entry) * ENTRIES_COUNT);
-
-
-    uint64_t max = ENTRIES_COUNT / 10;
-    
-    uint64_t MEASUREMENTS = atoll(argv[1]);
-
-    uint64_t* out_ref = malloc(sizeof(uint64_t) * MEASUREMENTS);
-    uint64_t* out_mes = malloc(sizeof(uint64_t) * MEASUREMENTS);
-
-    for(entries = 0; entries < max; entries ++){
-
-        for(uint64_t i = 0; i < MEASUREMENTS * 2; i++){
-            init(i % 2);
-            thrash_cache(entry_array, sizeof(struct entry) * ENTRIES_COUNT);
-            access_pages(entry_array, sizeof(struct entry) * ENTRIES_COUNT);
-            pchase();
-            (i % 2 ? out_ref : out_mes)[i >> 1] = m_measure;
-        }
-
-
-        qsort(out_mes, MEASUREMENTS, sizeof(uint64_t), uint64_t_compare);
-        qsort(out_ref, MEASUREMENTS, sizeof(uint64_t), uint64_t_compare);
-
-        for(uint64_t i = 0; i < MEASUREMENTS; i ++){
-            printf("%zu: %zu %zu\n", entries, out_mes[i], out_ref[i]);
-        }
-    }
-    
-    return 0;
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "pchase.h"
+
+
+#define BLIND_MEASURE_KEY 0x4242424242424242ull
+#define CACHE_LINE_SIZE 64
+#define PAGE_SIZE (4096 * 4)
+#define THRASH_ALLOC ((uint64_t)1024 * 1024 * 1024)
+#define ENTRIES_COUNT (20 * PAGE_SIZE / sizeof(struct entry))
+
+#if defined(__x86_64__)
+    #define maccess(x) asm volatile("mov (%0), %%rax" :: "r" (x) : "rax")
+#else /* probably arm */
+    #define maccess(x) asm volatile("ldr x0, [%0]\n" :: "r" (x) : "x1")
+#endif /* architecture */
+
+// linked list entry
+struct entry {
+    struct entry* next;
+    char selected[2*CACHE_LINE_SIZE - sizeof(struct entry*)];
+};
+
+// memory containing the linked list (all on one page)
+static struct entry* entry_array;
+
+/* Used by assembly */
+uint64_t pchase_m_measure;
+// amount of entries
+uint64_t pchase_entries;
+// blind pointers so prefetcher cannot detect them
+uint64_t pchase_xor_key;
+// blinded pointer to head
+uint64_t pchase_head_blinded;
+// pointer to measure (blinded)
+uint64_t pchase_pref_blinded;
+
+static uint64_t rand_seed;
+
+static uint64_t rand64() {
+    return rand_seed = (164603309694725029ull * rand_seed) % 14738995463583502973ull;
+}
+
+// permutation of the entry indices (partially re-shuffled for each list)
+static uint64_t perm[ENTRIES_COUNT];
+// entries used by the current list: reference, head, and the list elements
+static struct entry* chosen[ENTRIES_COUNT / 10 + 2];
+static uint64_t chosen_count;
+
+// select the entries with a partial Fisher-Yates shuffle of the permutation
+static void select_entries(uint64_t count){
+    for(uint64_t i = 0; i < count; i++){
+        uint64_t j = i + rand64() % (ENTRIES_COUNT - i);
+        uint64_t idx = perm[j];
+        perm[j] = perm[i];
+        perm[i] = idx;
+        chosen[i] = &entry_array[idx];
+        chosen[i]->selected[0] = 1;
+    }
+    chosen_count = count;
+}
+
+#if defined(__x86_64__)
+    #define flush_line(x) asm volatile("clflush (%0)" :: "r" (x))
+    #define flush_fence() asm volatile("mfence")
+#else /* probably Arm */
+    #define flush_line(x) asm volatile("DC CIVAC, %0" :: "r" (x))
+    #define flush_fence() asm volatile("DSB ISH")
+#endif /* __x86_64__ */
+
+static void thrash_cache(void* memory, uint64_t size){
+    for(uint64_t i = 0; i < size; i += CACHE_LINE_SIZE){
+        flush_line((uint64_t)memory + i);
+    }
+}
+
+// function to initialize linked list with random order
+static void init(int is_ref){
+    // +2 for the reference and the head
+    select_entries(pchase_entries + 2);
+	struct entry* ref = chosen[0];
+	struct entry* head = chosen[1];
+	struct entry* last = head;
+	
+	for(uint64_t i = 0; i < pchase_entries; i++) {
+	    struct entry* cur = chosen[i + 2];
+	    last->next = cur;
+	    last = cur;
+	}
+	
+	pchase_xor_key = (uint64_t)BLIND_MEASURE_KEY;
+	pchase_head_blinded = (uint64_t)(void*)head ^ pchase_xor_key;
+    pchase_pref_blinded = (uint64_t)(void*)(is_ref ? ref : last) ^ pchase_xor_key;
+}
+
+// actual pointer chase function (implemented in assembly)
+void pchase_chase();
+
+static void access_pages(uint64_t* arr, uint64_t size){
+     for(uint64_t i = 0; i < size; i += 4096){
+         void* target = (void*)&arr[i / sizeof(uint64_t)];
+         maccess(target);
+     }
+}
+
+// Radius (in bytes) around each selected entry that is flushed after a
+// repetition with bounded thrashing. It covers lines that
+// adjacent/next-line prefetchers may have fetched.
+#define FLUSH_RADIUS 1024
+
+// flush only the lines a repetition could have touched instead of the whole array
+static int bounded_thrash = 1;
+
+void pchase_set_bounded_thrash(int enabled){
+    bounded_thrash = enabled;
+}
+
+// 128-byte line pair (entry) that is touched to fill the TLB entry of an
+// entry's page: half a page away from the entry, such that neither the pair
+// nor lines an adjacent-line prefetcher fetches along with it can be measured
+static uint64_t tlb_warm_pair(struct entry* entry){
+    return ((uint64_t)entry ^ 2048ull) & ~127ull;
+}
+
+// cache state right before the measurement: nothing of the array is cached,
+// and the TLB holds the pages of all selected entries
+static void prepare_caches(){
+    uint64_t array_size = sizeof(struct entry) * ENTRIES_COUNT;
+    if(!bounded_thrash){
+        thrash_cache(entry_array, array_size);
+        access_pages((uint64_t*)entry_array, array_size);
+        return;
+    }
+    // touch the pages of all selected entries to fill the TLB
+    for(uint64_t i = 0; i < chosen_count; i++){
+        maccess(tlb_warm_pair(chosen[i]));
+    }
+    // the selected entries were just written by init, the line pairs in
+    // their pages were just touched (the TLB entries stay). All other
+    // entries were flushed after they were touched the last time.
+    for(uint64_t i = 0; i < chosen_count; i++){
+        thrash_cache((void*)tlb_warm_pair(chosen[i]), 2 * CACHE_LINE_SIZE);
+        thrash_cache(chosen[i], sizeof(struct entry));
+    }
+    // the flushes are right before the measurement, make sure they completed
+    flush_fence();
+}
+
+// reset the selected entries and flush everything the last repetition could have touched
+static void cleanup_caches(){
+    uint64_t array_begin = (uint64_t)entry_array;
+    uint64_t array_end = array_begin + sizeof(struct entry) * ENTRIES_COUNT;
+    for(uint64_t i = 0; i < chosen_count; i++){
+        chosen[i]->next = NULL;
+        chosen[i]->selected[0] = 0;
+    }
+    if(!bounded_thrash){
+        return;
+    }
+    for(uint64_t i = 0; i < chosen_count; i++){
+        uint64_t entry = (uint64_t)chosen[i];
+        uint64_t begin = (entry - array_begin > FLUSH_RADIUS) ? entry - FLUSH_RADIUS : array_begin;
+        uint64_t end = (array_end - entry > FLUSH_RADIUS + sizeof(struct entry)) ? entry + sizeof(struct entry) + FLUSH_RADIUS : array_end;
+        thrash_cache((void*)begin, end - begin);
+    }
+}
+
+void pchase_seed(uint64_t seed){
+    rand_seed = seed;
+}
+
+uint64_t pchase_max_entries(void){
+    return ENTRIES_COUNT / 10;
+}
+
+void pchase_run_experiment(uint64_t entries, uint64_t repeat, latency_record_t* record){
+    if(entries > pchase_max_entries()){
+        fprintf(stderr, "linked list is too long (%zu vs. %zu)\n", (size_t)entries, (size_t)pchase_max_entries());
+        exit(1);
+    }
+    
+    // page aligned and zeroed, such that only selected entries have content
+    entry_array = mmap(NULL, sizeof(struct entry) * ENTRIES_COUNT, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(entry_array == MAP_FAILED){
+        perror("mmap");
+        exit(1);
+    }
+    for(uint64_t i = 0; i < ENTRIES_COUNT; i++){
+        perm[i] = i;
+    }
+    thrash_cache(entry_array, sizeof(struct entry) * ENTRIES_COUNT);
+
+    pchase_entries = entries;
+    for(uint64_t i = 0; i < repeat * 2; i++){
+        init(i % 2);
+        prepare_caches();
+        pchase_chase();
+        latency_record_add(record, i >> 1, i % 2, pchase_m_measure);
+        cleanup_caches();
+    }
+
+    munmap(entry_array, sizeof(struct entry) * ENTRIES_COUNT);
+    entry_array = NULL;
+}
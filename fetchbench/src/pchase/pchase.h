@@ -0,0 +1,39 @@
+#ifndef PCHASE_H
+#define PCHASE_H
+
+#include <stdint.h>
+
+#include "../latency_record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+Pointer chasing prefetcher test.
+A linked list with `entries` elements (in random order) is traversed, then
+the access time of the element the last list element points to is measured.
+Each experiment adds `repeat` timings for this element and `repeat` timings
+for a reference element (that is not part of the list) to `record` (see
+latency_record.h), which must be zeroed before. The timings are taken with the timing source the library is
+compiled for (COUNTER_THREAD reads the counter of the global counter thread,
+see counter_thread.hh).
+*/
+
+// seed the pseudo random number generator used to build the linked list
+void pchase_seed(uint64_t seed);
+
+// flush only the lines a repetition could have touched (default) instead of
+// the whole entry array
+void pchase_set_bounded_thrash(int enabled);
+
+// maximum length of the linked list
+uint64_t pchase_max_entries(void);
+
+void pchase_run_experiment(uint64_t entries, uint64_t repeat, latency_record_t* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PCHASE_H */
@@ -0,0 +1,76 @@
+#include <algorithm>
+
+#include "prefetch_metrics.hh"
+#include "cache_histogram.hh"
+
+/**
+ * Returns the single instance.
+ *
+ * @return     The prefetch metrics.
+ */
+PrefetchMetrics& PrefetchMetrics::get() {
+	static PrefetchMetrics instance;
+	return instance;
+}
+
+void PrefetchMetrics::reset() {
+	no_traces = 0;
+	no_traces_with_prefetches = 0;
+	no_prefetched_lines = 0;
+	no_potential_lines = 0;
+	sum_distance = 0;
+	max_distance = 0;
+	no_prefetched_hits = 0;
+	no_prefetched_probes = 0;
+}
+
+/**
+ * Adds the prefetches of a trace.
+ *
+ * @param      cache_histogram   The cache histogram of the trace
+ * @param      prefetch_vector   The prefetched lines
+ * @param      potential_vector  The lines that could have been prefetched
+ *                               (not accessed by the experiment)
+ * @param[in]  last_access_cl    The cache line of the last access of the
+ *                               experiment (the distance is measured
+ *                               from there)
+ */
+void PrefetchMetrics::add(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector, PrefetchVector const& potential_vector, size_t last_access_cl) {
+	no_traces++;
+	no_potential_lines += potential_vector.count();
+	size_t degree = 0;
+	size_t distance = 0;
+	for (size_t idx = prefetch_vector.find_first(); idx < prefetch_vector.size(); idx = prefetch_vector.find_next(idx)) {
+		degree++;
+		distance = std::max(distance, (idx > last_access_cl) ? idx - last_access_cl : last_access_cl - idx);
+		no_prefetched_hits += cache_histogram.hit_count(idx);
+		no_prefetched_probes += cache_histogram.probe_count(idx);
+	}
+	if (degree > 0) {
+		no_traces_with_prefetches++;
+		no_prefetched_lines += degree;
+		sum_distance += distance;
+		max_distance = std::max(max_distance, distance);
+	}
+}
+
+/**
+ * Describes the prefetches of all traces added since the last reset().
+ *
+ * @return     JSON structure with the mean degree (over all traces), the
+ *             mean and maximum distance (over the traces with prefetches),
+ *             the coverage and the timeliness.
+ */
+Json PrefetchMetrics::to_json() const {
+	return Json::object {
+		{"traces", (int)no_traces},
+		{"traces_with_prefetches", (int)no_traces_with_prefetches},
+		{"prefetched_lines", (int)no_prefetched_lines},
+		{"potential_lines", (int)no_potential_lines},
+		{"mean_degree", (no_traces > 0) ? (double)no_prefetched_lines / no_traces : 0.0},
+		{"mean_distance", (no_traces_with_prefetches > 0) ? (double)sum_distance / no_traces_with_prefetches : 0.0},
+		{"max_distance", (int)max_distance},
+		{"coverage", (no_potential_lines > 0) ? (double)no_prefetched_lines / no_potential_lines : 0.0},
+		{"timeliness", (no_prefetched_probes > 0) ? (double)no_prefetched_hits / no_prefetched_probes : 0.0},
+	};
+}
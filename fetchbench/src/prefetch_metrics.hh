@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cinttypes>
+
+#include "json11.hpp"
+
+using json11::Json;
+
+class PrefetchVector;
+class CacheHistogram;
+
+/**
+ * Summarizes how aggressively the prefetchers acted in all experiment
+ * traces dumped during a phase of a testcase (identification or
+ * characterization, see TestCaseBase::run()):
+ * - degree: number of prefetched lines per trace,
+ * - distance: distance of the farthest prefetched line from the last
+ *   access of the trace (in cache lines),
+ * - coverage: fraction of the lines that could have been prefetched
+ *   (potential prefetch locations) that were prefetched,
+ * - timeliness: fraction of the probes of prefetched lines that hit, i.e.,
+ *   found the prefetch completed in time.
+ * Comparing them between runs, e.g., under different background loads
+ * (see run_load_sweep()) or memory on different NUMA nodes (see
+ * run_numa_comparison()), shows whether the prefetchers throttle or fall
+ * behind. There is a single instance, see get().
+ */
+class PrefetchMetrics {
+private:
+	size_t no_traces = 0;
+	size_t no_traces_with_prefetches = 0;
+	size_t no_prefetched_lines = 0;
+	size_t no_potential_lines = 0;
+	size_t sum_distance = 0;
+	size_t max_distance = 0;
+	size_t no_prefetched_hits = 0;
+	size_t no_prefetched_probes = 0;
+
+	PrefetchMetrics() {}
+
+public:
+	static PrefetchMetrics& get();
+
+	void reset();
+	void add(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector, PrefetchVector const& potential_vector, size_t last_access_cl);
+	Json to_json() const;
+};
@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+#include "quiet_mode.hh"
+#include "logger.hh"
+#include "utils.hh"
+
+// signals after which the settings are restored
+static int const LEAVE_SIGNALS[] = {SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+quiet_mode_level_t QuietMode::level = QUIET_MODE_OFF;
+int QuietMode::ctr_cpu = -1;
+
+QuietMode::~QuietMode() {
+	leave();
+}
+
+/**
+ * Returns the single instance.
+ *
+ * @return     The quiet mode.
+ */
+QuietMode& QuietMode::get() {
+	static QuietMode instance;
+	return instance;
+}
+
+/**
+ * Reads the first line of a (procfs) file.
+ *
+ * @param      path  The path
+ *
+ * @return     The line ("" if the file cannot be read).
+ */
+static string read_line(string const& path) {
+	std::ifstream file {path};
+	string line;
+	if ( ! (file && std::getline(file, line))) {
+		return "";
+	}
+	return line;
+}
+
+/**
+ * Writes a value to a (procfs) file.
+ *
+ * @param      path   The path
+ * @param      value  The value
+ *
+ * @return     true on success.
+ */
+static bool write_line(string const& path, string const& value) {
+	std::ofstream file {path};
+	if ( ! file) {
+		return false;
+	}
+	file << value << std::flush;
+	return file.good();
+}
+
+/**
+ * Lists the numeric entries of a directory (e.g., IRQs, PIDs).
+ *
+ * @param      path  The directory
+ *
+ * @return     The numbers.
+ */
+static vector<long> list_numeric_entries(string const& path) {
+	vector<long> entries;
+	DIR* dir = opendir(path.c_str());
+	if (dir == NULL) {
+		return entries;
+	}
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL) {
+		char* end;
+		long value = strtol(entry->d_name, &end, 10);
+		if (end != entry->d_name && *end == '\0') {
+			entries.push_back(value);
+		}
+	}
+	closedir(dir);
+	return entries;
+}
+
+/**
+ * Removes the measurement CPU from the affinity of all IRQs that may also
+ * be handled by other CPUs.
+ *
+ * @param[in]  cpu   The measurement CPU
+ *
+ * @return     JSON structure with the number of moved IRQs and the number
+ *             of IRQs that could not be moved (e.g., per-CPU or managed
+ *             IRQs, or no permission).
+ */
+Json QuietMode::move_irqs(int cpu) {
+	size_t no_failed = 0;
+	for (long irq : list_numeric_entries("/proc/irq")) {
+		string path = "/proc/irq/" + std::to_string(irq) + "/smp_affinity_list";
+		string original = read_line(path);
+		vector<int> cpus = parse_cpu_list(original);
+		if (std::find(cpus.begin(), cpus.end(), cpu) == cpus.end()) {
+			continue;
+		}
+		string others;
+		for (int other : cpus) {
+			if (other != cpu) {
+				others += (others.empty() ? "" : ",") + std::to_string(other);
+			}
+		}
+		if (others.empty() || ! write_line(path, others)) {
+			no_failed++;
+			continue;
+		}
+		moved_irqs.push_back({path, original});
+	}
+	return Json::object {
+		{"moved", (int)moved_irqs.size()},
+		{"not_moved", (int)no_failed},
+	};
+}
+
+/**
+ * Removes the measurement CPU from the affinity of all threads of other
+ * processes that may also run on other CPUs.
+ *
+ * @param[in]  cpu   The measurement CPU
+ *
+ * @return     JSON structure with the number of moved threads and the
+ *             number of threads that could not be moved (e.g., kernel
+ *             threads, or no permission).
+ */
+Json QuietMode::move_threads(int cpu) {
+	size_t no_failed = 0;
+	pid_t own_pid = getpid();
+	for (long pid : list_numeric_entries("/proc")) {
+		if (pid == own_pid) {
+			continue;
+		}
+		for (long tid : list_numeric_entries("/proc/" + std::to_string(pid) + "/task")) {
+			cpu_set_t original;
+			if (sched_getaffinity(tid, sizeof(original), &original) != 0 || ! CPU_ISSET(cpu, &original)) {
+				continue;
+			}
+			cpu_set_t others = original;
+			CPU_CLR(cpu, &others);
+			if (CPU_COUNT(&others) == 0 || sched_setaffinity(tid, sizeof(others), &others) != 0) {
+				no_failed++;
+				continue;
+			}
+			moved_threads.push_back({(pid_t)tid, original});
+		}
+	}
+	return Json::object {
+		{"moved", (int)moved_threads.size()},
+		{"not_moved", (int)no_failed},
+	};
+}
+
+/**
+ * Restores all settings changed by enter(). Only uses async-signal-safe
+ * functions (the paths and values of the IRQ affinities were prepared by
+ * enter()), as it is also called from signal handlers.
+ *
+ * @return     The number of IRQs whose affinity could not be restored.
+ */
+size_t QuietMode::restore_settings() {
+	size_t no_failed = 0;
+	for (irq_affinity_t const& irq : moved_irqs) {
+		int fd = open(irq.path.c_str(), O_WRONLY);
+		if (fd == -1 || write(fd, irq.original.c_str(), irq.original.size()) != (ssize_t)irq.original.size()) {
+			no_failed++;
+		}
+		if (fd != -1) {
+			close(fd);
+		}
+	}
+	// threads may have exited in the meantime
+	for (thread_affinity_t const& thread : moved_threads) {
+		sched_setaffinity(thread.tid, sizeof(thread.original), &thread.original);
+	}
+	if (thp_changed) {
+		prctl(PR_SET_THP_DISABLE, original_thp_disable, 0, 0, 0);
+		thp_changed = false;
+	}
+	if (memory_locked) {
+		munlockall();
+		memory_locked = false;
+	}
+	if (sched_changed) {
+		sched_setscheduler(0, original_policy, &original_param);
+		sched_changed = false;
+	}
+	return no_failed;
+}
+
+/**
+ * Signal handler: restores the settings and passes the signal on to the
+ * previous handler.
+ *
+ * @param[in]  signal  The signal
+ */
+void QuietMode::leave_on_signal(int signal) {
+	QuietMode& quiet_mode = get();
+	if (quiet_mode.active) {
+		quiet_mode.active = false;
+		quiet_mode.restore_settings();
+	}
+	for (size_t i = 0; i < quiet_mode.previous_actions.size(); i++) {
+		if (LEAVE_SIGNALS[i] == signal) {
+			sigaction(signal, &quiet_mode.previous_actions[i], NULL);
+		}
+	}
+	raise(signal);
+}
+
+/**
+ * Installs the signal handlers (once, they stay installed: handlers
+ * installed later, e.g., by the MsrController, pass signals on to them,
+ * and they only restore the settings while active).
+ */
+void QuietMode::install_signal_handlers() {
+	if ( ! previous_actions.empty()) {
+		return;
+	}
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = leave_on_signal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESETHAND;
+	for (int signal : LEAVE_SIGNALS) {
+		struct sigaction previous;
+		sigaction(signal, &action, &previous);
+		previous_actions.push_back(previous);
+	}
+}
+
+/**
+ * Applies the configured settings to the calling (measurement) thread and
+ * the CPU it runs on.
+ *
+ * @return     JSON structure describing which settings were applied.
+ */
+Json QuietMode::enter() {
+	if (level == QUIET_MODE_OFF || active) {
+		return Json::object {
+			{"level", (int)level},
+		};
+	}
+	active = true;
+	install_signal_handlers();
+	int cpu = sched_getcpu();
+	Json::object result {
+		{"level", (int)level},
+		{"cpu", cpu},
+	};
+
+	// real-time scheduling
+	bool shares_cpu_with_counter_thread = false;
+	#if defined(COUNTER_THREAD)
+		shares_cpu_with_counter_thread = (ctr_cpu == cpu);
+	#endif
+	if (shares_cpu_with_counter_thread) {
+		L::warn("Quiet mode: not using SCHED_FIFO, the counter thread runs on the same CPU\n");
+	} else {
+		original_policy = sched_getscheduler(0);
+		sched_getparam(0, &original_param);
+		struct sched_param param {};
+		param.sched_priority = QUIET_MODE_FIFO_PRIORITY;
+		sched_changed = (sched_setscheduler(0, SCHED_FIFO, &param) == 0);
+		if ( ! sched_changed) {
+			L::warn("Quiet mode: sched_setscheduler(SCHED_FIFO) failed: %s\n", strerror(errno));
+		}
+	}
+	result["sched_fifo"] = sched_changed;
+	result["sched_priority"] = sched_changed ? QUIET_MODE_FIFO_PRIORITY : 0;
+
+	// memory locking. Future mappings are locked when they are populated
+	// (MCL_ONFAULT), not at mmap() time, which would populate them before
+	// they are bound to a NUMA node or advised to use huge pages.
+	#ifdef MCL_ONFAULT
+		memory_locked = (mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == 0);
+	#else
+		memory_locked = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+	#endif
+	if ( ! memory_locked) {
+		L::warn("Quiet mode: mlockall() failed: %s\n", strerror(errno));
+	}
+	result["mlockall"] = memory_locked;
+
+	// transparent huge pages
+	original_thp_disable = prctl(PR_GET_THP_DISABLE, 0, 0, 0, 0);
+	thp_changed = (original_thp_disable == 0 && prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0) == 0);
+	result["thp_disabled"] = thp_changed || original_thp_disable == 1;
+
+	if (level >= QUIET_MODE_SYSTEM) {
+		result["irqs"] = move_irqs(cpu);
+		result["threads"] = move_threads(cpu);
+	}
+
+	L::info("Quiet mode: %s\n", Json(result).dump().c_str());
+	return result;
+}
+
+/**
+ * Restores all settings changed by enter().
+ */
+void QuietMode::leave() {
+	if ( ! active) {
+		return;
+	}
+	active = false;
+	size_t no_failed = restore_settings();
+	if (no_failed > 0) {
+		L::warn("Quiet mode: could not restore the affinity of %zu IRQs\n", no_failed);
+	}
+	moved_irqs.clear();
+	moved_threads.clear();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <csignal>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+#include "json11.hpp"
+
+using json11::Json;
+using std::string;
+using std::vector;
+
+// Real-time priority of the measurement thread in quiet mode. Below the
+// threaded interrupt handlers (50), such that the kernel keeps working.
+#define QUIET_MODE_FIFO_PRIORITY 49
+
+typedef enum {
+	// normal scheduling
+	QUIET_MODE_OFF = 0,
+	// SCHED_FIFO, mlockall(), no transparent huge pages
+	QUIET_MODE_PROCESS = 1,
+	// additionally, move IRQs and threads of other processes away from
+	// the measurement CPU
+	QUIET_MODE_SYSTEM = 2,
+} quiet_mode_level_t;
+
+/**
+ * Reduces the interference with the measurement thread while a testcase
+ * runs (see TestCaseBase::run()). Every setting is applied only where
+ * permitted (most require root or CAP_SYS_NICE/CAP_IPC_LOCK) and is
+ * reported by enter(), such that results from hosts with and without
+ * quiet mode can be told apart:
+ * - The measurement thread is scheduled with SCHED_FIFO (skipped if the
+ *   counter thread runs on the same CPU, it would starve).
+ * - All pages of the process are locked (mlockall()).
+ * - Transparent huge pages are disabled for the process (no compaction
+ *   or khugepaged collapses of the mappings), except for the mappings
+ *   that ask for huge pages (see allocate_mapping_huge_pages()).
+ * - QUIET_MODE_SYSTEM: the affinities of the IRQs and of the threads of
+ *   other processes are changed to exclude the measurement CPU, if they
+ *   include other CPUs.
+ * leave() restores everything. The handlers for SIGINT, SIGTERM and fatal
+ * signals restore the settings as well (with async-signal-safe functions
+ * only, see restore_settings()) and then pass the signal on to the
+ * previously installed handlers (e.g., of the MsrController).
+ *
+ * There is a single instance, see get().
+ */
+class QuietMode {
+private:
+	typedef struct {
+		string path;
+		string original;
+	} irq_affinity_t;
+
+	typedef struct {
+		pid_t tid;
+		cpu_set_t original;
+	} thread_affinity_t;
+
+	static quiet_mode_level_t level;
+	static int ctr_cpu;
+
+	bool active = false;
+	// saved state (valid while active)
+	bool sched_changed = false;
+	int original_policy = SCHED_OTHER;
+	struct sched_param original_param {};
+	bool memory_locked = false;
+	bool thp_changed = false;
+	int original_thp_disable = 0;
+	vector<irq_affinity_t> moved_irqs;
+	vector<thread_affinity_t> moved_threads;
+	// signal actions installed before the handlers (see
+	// install_signal_handlers())
+	vector<struct sigaction> previous_actions;
+
+	QuietMode() {}
+	~QuietMode();
+
+	Json move_irqs(int cpu);
+	Json move_threads(int cpu);
+	size_t restore_settings();
+	void install_signal_handlers();
+	static void leave_on_signal(int signal);
+
+public:
+	QuietMode(QuietMode const&) = delete;
+	QuietMode& operator=(QuietMode const&) = delete;
+
+	static QuietMode& get();
+
+	/**
+	 * Configures the quiet mode of all following testcases.
+	 *
+	 * @param[in]  level    The level
+	 * @param[in]  ctr_cpu  The CPU of the counter thread (if any)
+	 */
+	static inline void configure(quiet_mode_level_t level, int ctr_cpu) {
+		QuietMode::level = level;
+		QuietMode::ctr_cpu = ctr_cpu;
+	}
+
+	Json enter();
+	void leave();
+};
@@ -0,0 +1,37 @@
+#include <sstream>
+
+#include "result_cache.hh"
+
+/**
+ * Builds the key for an entry of the result cache. Two measurements with
+ * the same key are considered interchangeable.
+ *
+ * @param      experiment_key   Description of the experiment class and its
+ *                              parameters, incl. the calibration values
+ *                              (see e.g. StrideExperiment::cache_key())
+ * @param      workload_id      Name of the workload function
+ * @param      mappings         The mappings passed to the workload. Only
+ *                              their sizes and relative positions are part
+ *                              of the key, not their absolute addresses.
+ *                              The NUMA node they are bound to (see
+ *                              set_mapping_numa_node()) is part of it.
+ * @param[in]  no_repetitions   Number of repetitions
+ * @param      additional_info  Description of the additional information
+ *                              passed to the workload (if any)
+ *
+ * @return     The key.
+ */
+string result_cache_key(string const& experiment_key, string const& workload_id, vector<Mapping> const& mappings, size_t no_repetitions, string const& additional_info) {
+	std::ostringstream key;
+	key << experiment_key << ";workload=" << workload_id << ";layout=";
+	for (Mapping const& mapping : mappings) {
+		ssize_t relative_offset = mapping.base_addr - mappings[0].base_addr;
+		key << mapping.size << "@" << relative_offset << ",";
+	}
+	key << ";numa_node=" << get_mapping_numa_node();
+	key << ";no_repetitions=" << no_repetitions;
+	if (additional_info != "") {
+		key << ";additional_info=" << additional_info;
+	}
+	return key.str();
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cmath>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "logger.hh"
+#include "mapping.hh"
+#include "frequency_guard.hh"
+#include "utils.hh"
+
+using json11::Json;
+using std::map;
+using std::string;
+using std::vector;
+
+// Default maximum age of a cached result in minutes
+#define RESULT_CACHE_DEFAULT_MAX_AGE_MIN 10
+// Maximum relative change of the CPU frequency between the measurement of
+// a cached result and its use
+#define RESULT_CACHE_MAX_FREQUENCY_DRIFT 0.05
+
+string result_cache_key(string const& experiment_key, string const& workload_id, vector<Mapping> const& mappings, size_t no_repetitions, string const& additional_info = "");
+
+/**
+ * Cache for measurement results (e.g., cache histograms) that are shared
+ * between sub-tests. Results are addressed by a key that describes the
+ * experiment, its calibration values, the workload, the layout and NUMA
+ * node of the mappings and the number of repetitions, see
+ * result_cache_key(). The key does not cover the conditions of a run,
+ * e.g., the prefetcher configuration (MSRs) or the background load, so
+ * the testcases discard their cached results at the beginning of each run
+ * (see TestCaseBase::invalidate_cached_results()).
+ *
+ * Within a run, a cached result is only used while it is fresh: it must
+ * not be older than the maximum age, the Flush+Reload threshold must not
+ * have been re-calibrated since (see FrequencyGuard), and the current CPU
+ * frequency must not differ by more than RESULT_CACHE_MAX_FREQUENCY_DRIFT
+ * from the frequency at the time of the measurement. Otherwise, the
+ * result is measured again.
+ *
+ * @tparam     T     Type of the cached results
+ */
+template <typename T>
+class ResultCache {
+private:
+	typedef struct {
+		T result;
+		time_t timestamp;
+		size_t cpu_frequency_khz;
+		// FrequencyGuard re-calibrations before the measurement
+		size_t fr_recalibrations;
+	} entry_t;
+
+	// maximum age of a cached result in seconds (0 disables the cache)
+	time_t const max_age_sec;
+	map<string, entry_t> entries;
+	// statistics
+	size_t no_hits = 0;
+	size_t no_misses = 0;
+	size_t no_stale = 0;
+
+	bool is_fresh(entry_t const& entry, size_t cpu_frequency_khz) const {
+		if (time(NULL) - entry.timestamp > max_age_sec) {
+			L::debug("result cache: entry expired\n");
+			return false;
+		}
+		if (entry.fr_recalibrations != FrequencyGuard::get().recalibrations()) {
+			L::debug("result cache: Flush+Reload threshold re-calibrated\n");
+			return false;
+		}
+		// the frequency is only compared if it is available
+		if (entry.cpu_frequency_khz != 0 && cpu_frequency_khz != 0) {
+			double drift = std::abs((double)cpu_frequency_khz - (double)entry.cpu_frequency_khz) / entry.cpu_frequency_khz;
+			if (drift > RESULT_CACHE_MAX_FREQUENCY_DRIFT) {
+				L::debug("result cache: CPU frequency changed from %zu kHz to %zu kHz\n", entry.cpu_frequency_khz, cpu_frequency_khz);
+				return false;
+			}
+		}
+		return true;
+	}
+
+public:
+	ResultCache(size_t max_age_min)
+	: max_age_sec {(time_t)(max_age_min * 60)}
+	{}
+
+	/**
+	 * Returns the cached result for `key` if it is fresh. Otherwise, the
+	 * result is measured with `measure` and stored in the cache.
+	 *
+	 * @param      key      The key (see result_cache_key())
+	 * @param      measure  Function that performs the measurement
+	 *
+	 * @return     The (cached or new) result.
+	 */
+	T fetch(string const& key, std::function<T()> const& measure) {
+		size_t cpu_frequency_khz = read_cpu_frequency_khz(USE_CURRENT_CPU);
+		if (max_age_sec > 0) {
+			typename map<string, entry_t>::const_iterator it = entries.find(key);
+			if (it != entries.end()) {
+				if (is_fresh(it->second, cpu_frequency_khz)) {
+					L::debug("result cache: hit for %s\n", key.c_str());
+					no_hits++;
+					return it->second.result;
+				}
+				no_stale++;
+			} else {
+				no_misses++;
+			}
+		}
+
+		T result = measure();
+		if (max_age_sec > 0) {
+			entries[key] = entry_t { result, time(NULL), cpu_frequency_khz, FrequencyGuard::get().recalibrations() };
+		}
+		return result;
+	}
+
+	/**
+	 * Removes all entries from the cache, e.g., after the conditions of
+	 * the measurements changed (see TestCaseBase::run()).
+	 */
+	void invalidate() {
+		entries.clear();
+	}
+
+	/**
+	 * Returns statistics about the cache usage.
+	 *
+	 * @return     JSON structure describing the statistics.
+	 */
+	Json stats() const {
+		return Json::object {
+			{"enabled", (max_age_sec > 0)},
+			{"max_age_min", (int)(max_age_sec / 60)},
+			{"hits", (int)no_hits},
+			{"misses", (int)no_misses},
+			{"stale", (int)no_stale},
+		};
+	}
+};
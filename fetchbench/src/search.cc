@@ -0,0 +1,227 @@
+#include <cassert>
+#include <cmath>
+#include <string>
+#include <utility>
+
+#include "search.hh"
+#include "logger.hh"
+
+using std::pair;
+
+// z-scores above Z_YES are considered a significant difference, z-scores
+// below Z_NO are considered no difference. Anything in between is
+// inconclusive and should be measured again.
+#define Z_YES 3.0
+#define Z_NO 1.5
+
+/**
+ * Swaps VERDICT_YES and VERDICT_NO. Inconclusive verdicts stay
+ * inconclusive.
+ *
+ * @param[in]  verdict  The verdict
+ *
+ * @return     The negated verdict.
+ */
+verdict_t negate_verdict(verdict_t verdict) {
+	if (verdict == VERDICT_YES) {
+		return VERDICT_NO;
+	} else if (verdict == VERDICT_NO) {
+		return VERDICT_YES;
+	}
+	return VERDICT_INCONCLUSIVE;
+}
+
+/**
+ * Returns a printable name of a verdict.
+ *
+ * @param[in]  verdict  The verdict
+ *
+ * @return     "yes", "no", or "inconclusive".
+ */
+char const* verdict_to_string(verdict_t verdict) {
+	return (verdict == VERDICT_YES) ? "yes" : (verdict == VERDICT_NO) ? "no" : "inconclusive";
+}
+
+/**
+ * Decides whether the proportion of hits among the signal trials
+ * significantly exceeds the proportion of hits among the reference trials,
+ * using a two-proportion z-test.
+ *
+ * @param[in]  signal_hits       Number of hits among the signal trials
+ * @param[in]  signal_trials     Number of signal trials
+ * @param[in]  reference_hits    Number of hits among the reference trials
+ * @param[in]  reference_trials  Number of reference trials
+ *
+ * @return     VERDICT_YES if the signal is significantly higher,
+ *             VERDICT_NO if there is no meaningful difference,
+ *             VERDICT_INCONCLUSIVE otherwise.
+ */
+verdict_t compare_proportions(size_t signal_hits, size_t signal_trials, size_t reference_hits, size_t reference_trials) {
+	if (signal_trials == 0 || reference_trials == 0) {
+		return VERDICT_INCONCLUSIVE;
+	}
+
+	double n_signal = signal_trials;
+	double n_reference = reference_trials;
+	double p_signal = signal_hits / n_signal;
+	double p_reference = reference_hits / n_reference;
+	double p_pooled = (signal_hits + reference_hits) / (n_signal + n_reference);
+	double stderr_pooled = std::sqrt(p_pooled * (1 - p_pooled) * (1 / n_signal + 1 / n_reference));
+
+	double z;
+	if (stderr_pooled == 0) {
+		z = (p_signal > p_reference) ? INFINITY : 0;
+	} else {
+		z = (p_signal - p_reference) / stderr_pooled;
+	}
+	L::debug("hit rate signal: %.3f, reference: %.3f, z = %.2f\n", p_signal, p_reference, z);
+
+	if (z >= Z_YES) {
+		return VERDICT_YES;
+	} else if (z < Z_NO) {
+		return VERDICT_NO;
+	}
+	return VERDICT_INCONCLUSIVE;
+}
+
+/**
+ * Decides whether the hit rate at the signal locations significantly
+ * exceeds the hit rate at the reference locations of a cache histogram.
+ * The line with the maximum hit rate among the signal locations is
+ * compared to the pooled hit rate of all reference locations using a
+ * two-proportion z-test on the raw hit and probe counts.
+ *
+ * @param      cache_histogram    The cache histogram
+ * @param      signal_indices     Cache lines where we look for prefetches
+ * @param      reference_indices  Cache lines where we expect misses
+ *
+ * @return     VERDICT_YES if the signal is significantly higher,
+ *             VERDICT_NO if there is no meaningful difference,
+ *             VERDICT_INCONCLUSIVE otherwise.
+ */
+verdict_t compare_hit_rates(CacheHistogram const& cache_histogram, vector<size_t> const& signal_indices, vector<size_t> const& reference_indices) {
+	assert(signal_indices.size() > 0);
+	assert(reference_indices.size() > 0);
+
+	// signal line with the highest hit rate
+	size_t signal_idx = signal_indices[0];
+	for (size_t idx : signal_indices) {
+		assert(idx < cache_histogram.size());
+		if (cache_histogram[idx] > cache_histogram[signal_idx]) {
+			signal_idx = idx;
+		}
+	}
+	size_t reference_hits = 0;
+	size_t reference_probes = 0;
+	for (size_t idx : reference_indices) {
+		assert(idx < cache_histogram.size());
+		reference_hits += cache_histogram.hit_count(idx);
+		reference_probes += cache_histogram.probe_count(idx);
+	}
+	return compare_proportions(cache_histogram.hit_count(signal_idx), cache_histogram.probe_count(signal_idx), reference_hits, reference_probes);
+}
+
+/**
+ * Searches the boundary of a monotone predicate, i.e., a predicate that
+ * holds for all values in [lower, boundary] and does not hold for all
+ * values in (boundary, upper]. The search first brackets the boundary by
+ * probing lower, lower+1, lower+3, lower+7, ... and then bisects the
+ * bracket. Inconclusive probes are repeated up to `max_attempts` times
+ * and treated as "does not hold" afterwards. Finally, the values on both
+ * sides of the boundary are measured again to confirm the result.
+ *
+ * @param[in]  lower         The lower end of the search range
+ * @param[in]  upper         The upper end of the search range
+ * @param      probe         Function to measure the predicate
+ * @param[in]  max_attempts  Maximum number of attempts per probe point
+ *
+ * @return     The search result.
+ */
+BoundarySearchResult find_boundary(size_t lower, size_t upper, probe_func_t const& probe, size_t max_attempts) {
+	assert(lower <= upper);
+	assert(max_attempts >= 1);
+
+	BoundarySearchResult result {};
+	map<size_t, bool> decided;
+
+	auto measure = [&](size_t value) -> bool {
+		verdict_t verdict = VERDICT_INCONCLUSIVE;
+		for (size_t attempt = 0; attempt < max_attempts && verdict == VERDICT_INCONCLUSIVE; attempt++) {
+			verdict = probe(value, attempt);
+			result.no_probes++;
+		}
+		result.verdicts[value] = verdict;
+		decided[value] = (verdict == VERDICT_YES);
+		L::debug("search: value %zu -> %s\n", value, verdict_to_string(verdict));
+		return decided[value];
+	};
+	auto holds = [&](size_t value) -> bool {
+		map<size_t, bool>::const_iterator it = decided.find(value);
+		if (it != decided.end()) {
+			return it->second;
+		}
+		return measure(value);
+	};
+
+	result.holds_at_lower = holds(lower);
+	if ( ! result.holds_at_lower) {
+		result.last_true = lower;
+		result.confirmed = ! measure(lower);
+		return result;
+	}
+
+	// bracket: [good, bad) with holds(good) && !holds(bad)
+	size_t good = lower;
+	size_t bad = upper + 1;
+	for (size_t distance = 1; good < upper; distance *= 2) {
+		size_t value = std::min(lower + 2 * distance - 1, upper);
+		if (holds(value)) {
+			good = value;
+		} else {
+			bad = value;
+			break;
+		}
+	}
+
+	// bisect
+	while (bad <= upper && bad - good > 1) {
+		size_t middle = good + (bad - good) / 2;
+		if (holds(middle)) {
+			good = middle;
+		} else {
+			bad = middle;
+		}
+	}
+	result.last_true = good;
+	result.holds_across_range = (bad > upper);
+
+	// confirm both sides with fresh measurements
+	result.confirmed = measure(good);
+	if (bad <= upper) {
+		result.confirmed = ! measure(bad) && result.confirmed;
+	}
+	return result;
+}
+
+/**
+ * Converts the result of a boundary search to JSON.
+ *
+ * @param      result  The search result
+ *
+ * @return     JSON structure describing the search.
+ */
+Json boundary_search_to_json(BoundarySearchResult const& result) {
+	Json::object verdicts_json;
+	for (pair<size_t const, verdict_t> const& verdict_pair : result.verdicts) {
+		verdict_t const& verdict = verdict_pair.second;
+		verdicts_json[std::to_string(verdict_pair.first)] = verdict_to_string(verdict);
+	}
+	return Json::object {
+		{"holds_at_lower", result.holds_at_lower},
+		{"holds_across_range", result.holds_across_range},
+		{"last_true", (int)result.last_true},
+		{"confirmed", result.confirmed},
+		{"no_probes", (int)result.no_probes},
+		{"verdicts", verdicts_json},
+	};
+}
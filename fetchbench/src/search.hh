@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "cache_histogram.hh"
+
+using json11::Json;
+using std::map;
+using std::vector;
+
+// Outcome of a single probe point of a search.
+typedef enum { VERDICT_NO = 0, VERDICT_YES = 1, VERDICT_INCONCLUSIVE = 2 } verdict_t;
+
+verdict_t negate_verdict(verdict_t verdict);
+char const* verdict_to_string(verdict_t verdict);
+verdict_t compare_proportions(size_t signal_hits, size_t signal_trials, size_t reference_hits, size_t reference_trials);
+verdict_t compare_hit_rates(CacheHistogram const& cache_histogram, vector<size_t> const& signal_indices, vector<size_t> const& reference_indices);
+
+/**
+ * Result of find_boundary().
+ */
+typedef struct {
+	// does the predicate hold at the lower end of the search range?
+	bool holds_at_lower;
+	// does the predicate hold up to (and including) the upper end?
+	bool holds_across_range;
+	// largest value for which the predicate holds (only meaningful if
+	// holds_at_lower is true)
+	size_t last_true;
+	// were the verdicts on both sides of the boundary reproduced by fresh
+	// measurements?
+	bool confirmed;
+	// number of probe() invocations, including repetitions and
+	// confirmations
+	size_t no_probes;
+	// latest verdict per probed value
+	map<size_t, verdict_t> verdicts;
+} BoundarySearchResult;
+
+// A probe measures the predicate at `value`. `attempt` starts at 0 and is
+// incremented each time the previous attempt was inconclusive, such that
+// the probe can increase its number of repetitions.
+typedef std::function<verdict_t(size_t value, size_t attempt)> probe_func_t;
+
+BoundarySearchResult find_boundary(size_t lower, size_t upper, probe_func_t const& probe, size_t max_attempts = 3);
+Json boundary_search_to_json(BoundarySearchResult const& result);
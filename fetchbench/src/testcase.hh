@@ -3,14 +3,109 @@
 #include <string>
 #include <ctime>
 #include <fstream>
+#include <functional>
+#include <vector>
 
 #include "json11.hpp"
 #include "logger.hh"
+#include "quiet_mode.hh"
+#include "frequency_guard.hh"
+#include "latency_bands.hh"
+#include "prefetch_metrics.hh"
+#include "access_kind.hh"
+#include "mapping.hh"
 
 using json11::Json;
 
 class TestCaseBase {
 protected:
+	// kind of the accesses the workloads of the current test perform (see
+	// identify_per_access_kind())
+	access_kind_t access_kind = ACCESS_KIND_LOAD;
+
+	/**
+	 * Returns a suffix for file names of the current access kind, such
+	 * that the traces of different kinds do not overwrite each other.
+	 *
+	 * @return     "" for loads, "-<kind>" otherwise.
+	 */
+	std::string access_kind_suffix() const {
+		if (access_kind == ACCESS_KIND_LOAD) {
+			return "";
+		}
+		return std::string {"-"} + access_kind_to_string(access_kind);
+	}
+
+	/**
+	 * Runs an identification test once per access kind selected with
+	 * AccessKinds (loads only by default, which returns the result of the
+	 * test unchanged). Otherwise, the prefetcher counts as identified if
+	 * any kind identified it, and the boolean results of the tests are
+	 * tabulated per kind. Kinds the CPU does not support are skipped.
+	 *
+	 * @param[in]  identify_kind  The identification test, runs with the
+	 *                            kind set in access_kind
+	 *
+	 * @return     JSON structure with the results per kind and the table.
+	 */
+	Json identify_per_access_kind(std::function<Json()> identify_kind) {
+		std::vector<access_kind_t> const& kinds = AccessKinds::get();
+		if (kinds.size() == 1 && kinds[0] == ACCESS_KIND_LOAD) {
+			access_kind = ACCESS_KIND_LOAD;
+			return identify_kind();
+		}
+
+		bool identified = false;
+		Json::object results;
+		Json::array table;
+		for (access_kind_t kind : kinds) {
+			char const* name = access_kind_to_string(kind);
+			if ( ! access_kind_supported(kind)) {
+				L::warn("Access kind %s is not supported on this CPU, skipping\n", name);
+				results[name] = Json::object {
+					{"status", "unsupported"},
+				};
+				continue;
+			}
+			L::info("Access kind: %s\n", name);
+			access_kind = kind;
+			Json result = identify_kind();
+			results[name] = result;
+			identified = identified || result["identified"].bool_value();
+
+			// one row per kind: the boolean results of all tests
+			Json::object row {
+				{"access_kind", name},
+				{"identified", result["identified"].bool_value()},
+			};
+			for (auto const& test : result.object_items()) {
+				for (auto const& item : test.second.object_items()) {
+					if (item.second.is_bool()) {
+						row[test.first + "." + item.first] = item.second;
+					}
+				}
+			}
+			table.push_back(row);
+		}
+		access_kind = ACCESS_KIND_LOAD;
+
+		L::info("Identification per access kind:\n");
+		for (Json const& row : table) {
+			std::string flags;
+			for (auto const& item : row.object_items()) {
+				if (item.second.is_bool() && item.first != "identified") {
+					flags += " " + item.first + "=" + (item.second.bool_value() ? "1" : "0");
+				}
+			}
+			L::info("  %-14s identified=%d%s\n", row["access_kind"].string_value().c_str(), row["identified"].bool_value(), flags.c_str());
+		}
+		return Json::object {
+			{"identified", identified},
+			{"access_kinds", results},
+			{"access_kind_table", table},
+		};
+	}
+
 	/**
 	 * Code to run BEFORE the actual test, e.g., setting some MSRs to
 	 * disable/enable certain hardware features.
@@ -51,6 +146,17 @@ protected:
 	}
 
 public:
+	/**
+	 * Discards measurement results the testcase keeps between runs (e.g.,
+	 * baseline cache histograms, see ResultCache), such that they are
+	 * measured again. Called at the beginning of each run(), as the
+	 * conditions of the measurements may differ from the previous run,
+	 * e.g., the prefetcher configuration (matrix mode) or the background
+	 * load (load sweep mode).
+	 */
+	virtual void invalidate_cached_results() {
+	}
+
 	/**
 	 * Returns a short identifier string for the testcase
 	 *
@@ -77,19 +183,49 @@ public:
 			L::info("Running only identification tests.\n");
 		}
 
-		// Run pre-test and identification test in any case
+		// Results kept from a previous run were measured under other
+		// conditions
+		invalidate_cached_results();
+
+		// Run pre-test and identification test in any case. The quiet mode
+		// (if enabled) is only active during the actual tests, its
+		// settings are reported as part of the pre-test results.
 		Json results_pre_test = pre_test();
+		QuietMode& quiet_mode = QuietMode::get();
+		Json::object results_pre_test_items = results_pre_test.object_items();
+		results_pre_test_items["quiet_mode"] = quiet_mode.enter();
+		results_pre_test_items["numa_node"] = get_mapping_numa_node();
+		results_pre_test = results_pre_test_items;
+		// degree, distance, coverage and timeliness of the prefetches in
+		// all traces of the identification and of the characterization
+		// (if any)
+		PrefetchMetrics::get().reset();
 		Json results_identification = identify();
+		Json::object results_identification_items = results_identification.object_items();
+		results_identification_items["prefetch_metrics"] = PrefetchMetrics::get().to_json();
+		results_identification = results_identification_items;
 
 		// Run characterization only if (a) the identification test was
 		// successful and (b) characterization tests were not disabled
 		Json results_characterization = {"skipped"};
 		if ( ! only_identification && results_identification["identified"].bool_value() == true) {
+			// fill levels of the prefetches in all traces of the
+			// characterization (if any)
+			FillLevelSummary::get().reset();
+			PrefetchMetrics::get().reset();
 			results_characterization = characterize();
+			Json::object results_characterization_items = results_characterization.object_items();
+			results_characterization_items["fill_levels"] = FillLevelSummary::get().to_json();
+			results_characterization_items["prefetch_metrics"] = PrefetchMetrics::get().to_json();
+			results_characterization = results_characterization_items;
 		}
 		
 		// Run post-test in any case
+		quiet_mode.leave();
 		Json results_post_test = post_test();
+		Json::object results_post_test_items = results_post_test.object_items();
+		results_post_test_items["frequency_guard"] = FrequencyGuard::get().to_json();
+		results_post_test = results_post_test_items;
 		
 		// take timestamp after the testcase finished
 		time_t time_end = time(NULL);
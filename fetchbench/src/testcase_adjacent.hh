@@ -8,6 +8,7 @@
 #include "testcase.hh"
 #include "cacheutils.hh"
 #include "mapping.hh"
+#include "msr_controller.hh"
 #include "logger.hh"
 
 using std::string;
@@ -138,10 +139,7 @@ protected:
 			// as well. If only one of both is enabled, there is no
 			// adjacent cache line prefetching. That's why we enable both
 			// for this test.
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, false);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_L2_HW_PREFETCHER | INTEL_L2_ADJACENT_CL_PREFETCHER);
 		} else if (arch == ARCH_ARM) {
 		}
 		return Json::object {
@@ -151,10 +149,7 @@ protected:
 
 	virtual Json post_test() override {
 		if (get_arch() == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, true);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
 		}
 		return Json::object {};
 	}
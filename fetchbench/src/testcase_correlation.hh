@@ -0,0 +1,282 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "testcase.hh"
+#include "cacheutils.hh"
+#include "logger.hh"
+#include "utils.hh"
+#include "mapping.hh"
+#include "msr_controller.hh"
+#include "search.hh"
+
+#include "testcase_correlation_correxperiment.hh"
+
+using json11::Json;
+using std::pair;
+using std::string;
+using std::vector;
+
+// Number of pages of the mapping the sequences are placed in
+#define CORRELATION_NO_PAGES 4096
+// Shortest and longest sequence of the history length search
+#define CORRELATION_MIN_LENGTH 16
+#define CORRELATION_MAX_LENGTH 4096
+// Length of each sequence and maximum number of sequences of the table
+// capacity search
+#define CORRELATION_CAPACITY_LENGTH 8
+#define CORRELATION_MAX_SEQUENCES 512
+
+/**
+ * Test case for temporal (correlation) prefetchers, e.g., Markov or
+ * ISB-style prefetchers, which record sequences of miss addresses and
+ * replay them when the beginning of a sequence misses again.
+ *
+ * Unlike TestCaseDCReplay (fixed sequence, deltas), the sequences are
+ * random lines in random pages, accessed from a single PC, so neither
+ * deltas nor spatial footprints nor PCs predict the next address, only
+ * the recorded order does (see CorrelationExperiment). The tests search
+ * for the longest sequence that is still replayed from its beginning
+ * (history length) and the number of short sequences whose oldest one is
+ * still replayed (table capacity), and vary the locality of the
+ * sequences (elements per page) and the length of the replayed prefix.
+ */
+class TestCaseCorrelation : public TestCaseBase {
+private:
+	size_t const fr_thresh;
+	size_t const noise_thresh;
+	bool const use_nanosleep;
+
+public:
+	TestCaseCorrelation(size_t fr_thresh, size_t noise_thresh, bool use_nanosleep)
+	: fr_thresh {fr_thresh}
+	, noise_thresh {noise_thresh}
+	, use_nanosleep {use_nanosleep}
+	{}
+
+	virtual string id() override {
+		return "correlation";
+	}
+
+private:
+	/**
+	 * Runs a correlation experiment and dumps it to a trace file.
+	 *
+	 * @param      mapping         The mapping
+	 * @param      sequences       The sequences (the first one is replayed)
+	 * @param[in]  prefix_length   The number of elements to replay
+	 * @param[in]  no_repetitions  Number of repetitions
+	 * @param      filepath        The trace file path
+	 *
+	 * @return     The verdict whether the continuation was prefetched, and
+	 *             the number of prefetched elements.
+	 */
+	pair<verdict_t, size_t> run_experiment(Mapping const& mapping, vector<vector<size_t>> const& sequences, size_t prefix_length, size_t no_repetitions, string const& filepath) {
+		CorrelationExperiment experiment { sequences, 0, prefix_length, use_nanosleep, fr_thresh, noise_thresh };
+		CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping, no_repetitions);
+		experiment.dump(cache_histogram, filepath);
+		verdict_t verdict = experiment.evaluate_replay(cache_histogram);
+		size_t depth = (verdict == VERDICT_YES) ? experiment.evaluate_depth(cache_histogram) : 0;
+		L::debug("sequences: %zu, length: %zu, prefix: %zu -> %s (depth %zu)\n", sequences.size(), sequences[0].size(), prefix_length, verdict_to_string(verdict), depth);
+		return {verdict, depth};
+	}
+
+	// ========== TESTS ==============
+
+	/**
+	 * Trains a single sequence, replays its prefix and checks whether the
+	 * continuation is prefetched.
+	 *
+	 * @param      mapping         The mapping
+	 * @param[in]  length          The sequence length
+	 * @param[in]  lines_per_page  The elements per page (locality)
+	 * @param[in]  prefix_length   The number of elements to replay
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_replay(Mapping const& mapping, size_t length, size_t lines_per_page, size_t prefix_length, size_t no_repetitions) {
+		L::info("Test: %s (length %zu, %zu per page, prefix %zu)\n", __FUNCTION__, length, lines_per_page, prefix_length);
+		vector<vector<size_t>> sequences = CorrelationExperiment::generate_sequences(1, length, lines_per_page, CORRELATION_NO_PAGES);
+		pair<verdict_t, size_t> result = run_experiment(mapping, sequences, prefix_length, no_repetitions,
+			"trace-correlation-test_replay-length_" + zero_pad(length, 4) + "-locality_" + zero_pad(lines_per_page, 2) + "-prefix_" + zero_pad(prefix_length, 2) + ".json");
+		return Json::object {
+			{"status", "completed"},
+			{"length", (int)length},
+			{"lines_per_page", (int)lines_per_page},
+			{"prefix_length", (int)prefix_length},
+			{"verdict", verdict_to_string(result.first)},
+			{"replay", result.first == VERDICT_YES},
+			{"depth", (int)result.second},
+		};
+	}
+
+	/**
+	 * Searches the longest sequence that is still replayed when its first
+	 * elements miss again. Lengths are CORRELATION_MIN_LENGTH << exponent;
+	 * longer histories overwrite the beginning of the sequence in a
+	 * prefetcher with a limited history, so the predicate is monotone.
+	 *
+	 * @param      mapping         The mapping
+	 * @param[in]  no_repetitions  Number of repetitions (per probed line)
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_history_length(Mapping const& mapping, size_t no_repetitions) {
+		L::info("Test: %s\n", __FUNCTION__);
+		size_t const prefix_length = 4;
+		size_t const max_exponent = __builtin_ctzl(CORRELATION_MAX_LENGTH / CORRELATION_MIN_LENGTH);
+		probe_func_t replays = [&](size_t exponent, size_t attempt) -> verdict_t {
+			size_t length = CORRELATION_MIN_LENGTH << exponent;
+			vector<vector<size_t>> sequences = CorrelationExperiment::generate_sequences(1, length, 1, CORRELATION_NO_PAGES);
+			return run_experiment(mapping, sequences, prefix_length, no_repetitions * (attempt + 1),
+				"trace-correlation-test_history_length-length_" + zero_pad(length, 4) + "-attempt_" + std::to_string(attempt) + ".json").first;
+		};
+		BoundarySearchResult search = find_boundary(0, max_exponent, replays);
+		size_t history_length = search.holds_at_lower ? (CORRELATION_MIN_LENGTH << search.last_true) : 0;
+		L::info("History length: %zu%s\n", history_length, search.holds_across_range ? " (or more)" : "");
+		return Json::object {
+			{"status", "completed"},
+			{"history_length", (int)history_length},
+			{"history_length_at_least", search.holds_across_range},
+			{"search", boundary_search_to_json(search)},
+		};
+	}
+
+	/**
+	 * Searches the number of sequences of length CORRELATION_CAPACITY_LENGTH
+	 * that can be trained such that the first (oldest) one is still
+	 * replayed.
+	 *
+	 * @param      mapping         The mapping
+	 * @param[in]  no_repetitions  Number of repetitions (per probed line)
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_table_capacity(Mapping const& mapping, size_t no_repetitions) {
+		L::info("Test: %s\n", __FUNCTION__);
+		size_t const prefix_length = 2;
+		probe_func_t replays = [&](size_t no_sequences, size_t attempt) -> verdict_t {
+			vector<vector<size_t>> sequences = CorrelationExperiment::generate_sequences(no_sequences, CORRELATION_CAPACITY_LENGTH, 1, CORRELATION_NO_PAGES);
+			return run_experiment(mapping, sequences, prefix_length, no_repetitions * (attempt + 1),
+				"trace-correlation-test_table_capacity-sequences_" + zero_pad(no_sequences, 3) + "-attempt_" + std::to_string(attempt) + ".json").first;
+		};
+		BoundarySearchResult search = find_boundary(1, CORRELATION_MAX_SEQUENCES, replays);
+		size_t capacity = search.holds_at_lower ? search.last_true : 0;
+		L::info("Table capacity: %zu sequences%s\n", capacity, search.holds_across_range ? " (or more)" : "");
+		return Json::object {
+			{"status", "completed"},
+			{"capacity", (int)capacity},
+			{"capacity_at_least", search.holds_across_range},
+			{"sequence_length", CORRELATION_CAPACITY_LENGTH},
+			{"search", boundary_search_to_json(search)},
+		};
+	}
+
+	/**
+	 * Checks whether replay depends on the locality of the sequence, i.e.,
+	 * on how many of its elements share a page.
+	 *
+	 * @param      mapping         The mapping
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_locality(Mapping const& mapping, size_t no_repetitions) {
+		L::info("Test: %s\n", __FUNCTION__);
+		Json::object results;
+		Json::object replays;
+		for (size_t lines_per_page : {1, 4, 16}) {
+			Json result = test_replay(mapping, 64, lines_per_page, 4, no_repetitions);
+			results[std::to_string(lines_per_page)] = result;
+			replays[std::to_string(lines_per_page)] = result["replay"];
+		}
+		return Json::object {
+			{"status", "completed"},
+			{"replay_per_lines_per_page", replays},
+			{"results", results},
+		};
+	}
+
+	/**
+	 * Checks how many elements of a sequence have to miss again before it
+	 * is replayed.
+	 *
+	 * @param      mapping         The mapping
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_prefix_length(Mapping const& mapping, size_t no_repetitions) {
+		L::info("Test: %s\n", __FUNCTION__);
+		Json::object results;
+		Json::object depths;
+		size_t min_prefix_length = 0;
+		for (size_t prefix_length : {1, 2, 4, 8}) {
+			Json result = test_replay(mapping, 32, 1, prefix_length, no_repetitions);
+			results[std::to_string(prefix_length)] = result;
+			depths[std::to_string(prefix_length)] = result["depth"];
+			if (min_prefix_length == 0 && result["replay"].bool_value()) {
+				min_prefix_length = prefix_length;
+			}
+		}
+		return Json::object {
+			{"status", "completed"},
+			{"min_prefix_length", (int)min_prefix_length},
+			{"depth_per_prefix_length", depths},
+			{"results", results},
+		};
+	}
+
+protected:
+	virtual Json pre_test() override {
+		architecture_t arch = get_arch();
+		if (arch == ARCH_INTEL) {
+			// disable the known prefetchers, they must not fetch the
+			// continuation by chance
+			set_intel_prefetchers(USE_CURRENT_CPU, 0);
+		} else if (arch == ARCH_ARM) {
+		}
+		return Json::object {
+			{"architecture", arch},
+		};
+	}
+
+	virtual Json post_test() override {
+		if (get_arch() == ARCH_INTEL) {
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
+		}
+		return Json::object {};
+	}
+
+	virtual Json identify() override {
+		size_t no_repetitions = 4000;
+		Mapping mapping = allocate_mapping(CORRELATION_NO_PAGES * PAGE_SIZE);
+		flush_mapping(mapping);
+		Json test_results = test_replay(mapping, 32, 1, 4, no_repetitions);
+		unmap_mapping(mapping);
+
+		return Json::object {
+			{ "identified", test_results["replay"].bool_value() },
+			{ "test_replay", test_results },
+		};
+	}
+
+	virtual Json characterize() override {
+		size_t no_repetitions = 2000;
+		Mapping mapping = allocate_mapping(CORRELATION_NO_PAGES * PAGE_SIZE);
+		flush_mapping(mapping);
+		Json results = Json::object {
+			{ "test_history_length", test_history_length(mapping, no_repetitions) },
+			{ "test_table_capacity", test_table_capacity(mapping, no_repetitions) },
+			{ "test_locality", test_locality(mapping, no_repetitions) },
+			{ "test_prefix_length", test_prefix_length(mapping, no_repetitions) },
+		};
+		unmap_mapping(mapping);
+		return results;
+	}
+};
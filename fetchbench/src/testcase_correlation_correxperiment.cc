@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <numeric>
+
+#include "testcase_correlation_correxperiment.hh"
+#include "logger.hh"
+
+using json11::Json;
+using std::vector;
+
+CorrelationExperiment::CorrelationExperiment(vector<vector<size_t>> sequences, size_t trigger_sequence, size_t prefix_length, bool use_nanosleep, size_t fr_thresh, size_t noise_thresh)
+: sequences {sequences}
+, trigger_sequence {trigger_sequence}
+, prefix_length {prefix_length}
+, use_nanosleep {use_nanosleep}
+, fr_thresh {fr_thresh}
+, noise_thresh {noise_thresh}
+, t_req { .tv_sec = 0, .tv_nsec = 1000 /* 1µs */ }
+{
+	assert(trigger_sequence < sequences.size());
+	vector<size_t> const& trigger = sequences[trigger_sequence];
+	assert(prefix_length >= 1 && prefix_length < trigger.size());
+
+	// signal: the continuation of the prefix
+	for (size_t idx = prefix_length; idx < trigger.size() && idx < prefix_length + CORRELATION_PROBE_DEPTH; idx++) {
+		slot_offsets.push_back(trigger[idx]);
+	}
+	no_signal_slots = slot_offsets.size();
+	// reference: half a page away from each signal line (generate_sequences()
+	// never places sequence elements there)
+	for (size_t slot = 0; slot < no_signal_slots; slot++) {
+		slot_offsets.push_back(slot_offsets[slot] ^ (PAGE_SIZE / 2));
+	}
+}
+
+/**
+ * Generates sequences of random, distinct cache lines. Each sequence uses
+ * its own pages, `lines_per_page` lines per page (the locality of the
+ * sequence), at random line offsets in the first half of the page. The
+ * elements are shuffled, i.e., consecutive elements are usually in
+ * different pages and there is no constant delta between them.
+ *
+ * @param[in]  no_sequences    Number of sequences
+ * @param[in]  length          Length of each sequence
+ * @param[in]  lines_per_page  Number of elements per page (1 to a quarter
+ *                             of the lines of a page)
+ * @param[in]  no_pages        Number of pages of the mapping
+ *
+ * @return     The sequences (offsets from the beginning of the mapping in
+ *             bytes).
+ */
+vector<vector<size_t>> CorrelationExperiment::generate_sequences(size_t no_sequences, size_t length, size_t lines_per_page, size_t no_pages) {
+	size_t const lines_per_half_page = PAGE_SIZE / CACHE_LINE_SIZE / 2;
+	assert(lines_per_page >= 1 && 2 * lines_per_page <= lines_per_half_page);
+	size_t pages_per_sequence = (length + lines_per_page - 1) / lines_per_page;
+	assert(no_sequences * pages_per_sequence <= no_pages);
+
+	vector<size_t> pages(no_pages);
+	std::iota(pages.begin(), pages.end(), 0);
+	std::shuffle(pages.begin(), pages.end(), *get_rng());
+
+	// even line offsets only, such that no two elements are adjacent lines
+	vector<size_t> line_offsets;
+	for (size_t line = 0; line < lines_per_half_page; line += 2) {
+		line_offsets.push_back(line * CACHE_LINE_SIZE);
+	}
+
+	vector<vector<size_t>> sequences;
+	size_t next_page = 0;
+	for (size_t sequence_idx = 0; sequence_idx < no_sequences; sequence_idx++) {
+		vector<size_t> sequence;
+		while (sequence.size() < length) {
+			size_t page = pages[next_page++];
+			std::shuffle(line_offsets.begin(), line_offsets.end(), *get_rng());
+			for (size_t i = 0; i < lines_per_page && sequence.size() < length; i++) {
+				sequence.push_back(page * PAGE_SIZE + line_offsets[i]);
+			}
+		}
+		std::shuffle(sequence.begin(), sequence.end(), *get_rng());
+		sequences.push_back(sequence);
+	}
+	return sequences;
+}
+
+vector<size_t> CorrelationExperiment::signal_slots() const {
+	vector<size_t> slots(no_signal_slots);
+	std::iota(slots.begin(), slots.end(), 0);
+	return slots;
+}
+
+vector<size_t> CorrelationExperiment::reference_slots() const {
+	vector<size_t> slots(slot_offsets.size() - no_signal_slots);
+	std::iota(slots.begin(), slots.end(), no_signal_slots);
+	return slots;
+}
+
+/**
+ * Accesses the elements [begin, end) of a sequence, all from the same PC.
+ *
+ * @param      mapping   The mapping
+ * @param      sequence  The sequence
+ * @param[in]  begin     The first element
+ * @param[in]  end       The element after the last one
+ */
+__attribute__((noinline)) static void access_sequence(Mapping const& mapping, vector<size_t> const& sequence, size_t begin, size_t end) {
+	for (size_t idx = begin; idx < end; idx++) {
+		maccess(mapping.base_addr + sequence[idx]);
+		// serialize the misses, such that the prefetcher observes them in
+		// sequence order
+		mfence();
+	}
+}
+
+/**
+ * Collects a cache histogram over the slots. In each repetition, all
+ * sequences are trained CORRELATION_NO_TRAININGS times in order (the
+ * trigger sequence first), with all lines flushed after each training,
+ * such that every access is a miss. Then, all lines incl. the slots are
+ * flushed again (the training may have prefetched the reference slots),
+ * the prefix of the trigger sequence is replayed, and a single slot is
+ * probed.
+ *
+ * @param      mapping         The mapping
+ * @param[in]  no_repetitions  Number of repetitions
+ *
+ * @return     Cache histogram (absolute counters per slot)
+ */
+CacheHistogram CorrelationExperiment::collect_cache_histogram(Mapping const& mapping, size_t no_repetitions) {
+	for (vector<size_t> const& sequence : sequences) {
+		for (size_t offset : sequence) {
+			assert(offset < mapping.size);
+		}
+	}
+
+	CacheHistogram cache_histogram (slot_offsets.size());
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
+	for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+		noise_monitor.begin_window();
+
+		// train the sequences
+		for (size_t training = 0; training < CORRELATION_NO_TRAININGS; training++) {
+			for (vector<size_t> const& sequence : sequences) {
+				for (size_t offset : sequence) {
+					flush(mapping.base_addr + offset);
+				}
+			}
+			for (size_t offset : slot_offsets) {
+				flush(mapping.base_addr + offset);
+			}
+			mfence();
+			for (vector<size_t> const& sequence : sequences) {
+				access_sequence(mapping, sequence, 0, sequence.size());
+			}
+		}
+
+		// flush (incl. the slots, which the training may have prefetched),
+		// then replay the prefix of the trigger sequence
+		for (vector<size_t> const& sequence : sequences) {
+			for (size_t offset : sequence) {
+				flush(mapping.base_addr + offset);
+			}
+		}
+		for (size_t offset : slot_offsets) {
+			flush(mapping.base_addr + offset);
+		}
+		mfence();
+		access_sequence(mapping, sequences[trigger_sequence], 0, prefix_length);
+		mfence();
+
+		// sleep a while to give the prefetcher some time to work
+		if (use_nanosleep) {
+			nanosleep(&t_req, &t_rem);
+		}
+
+		// probe a single slot, keep the result only if the repetition was
+		// not disturbed
+		size_t slot = repetition % slot_offsets.size();
+		probe_result_t result = probe_single(mapping.base_addr + slot_offsets[slot]);
+		if (noise_monitor.end_window(noise_stats)) {
+			cache_histogram.record(slot, result);
+		}
+	}
+	return cache_histogram;
+}
+
+/**
+ * Decides whether a signal slot has a significantly higher hit rate than
+ * the reference slots (pooled). In addition to the z-test of
+ * compare_proportions(), which flags even tiny differences after many
+ * repetitions, the hit rate has to exceed the reference hit rate by
+ * CORRELATION_MIN_HIT_RATE_INCREASE.
+ *
+ * @param      cache_histogram  The cache histogram
+ * @param[in]  slot             The signal slot
+ *
+ * @return     The verdict.
+ */
+verdict_t CorrelationExperiment::compare_slot(CacheHistogram const& cache_histogram, size_t slot) const {
+	size_t reference_hits = 0;
+	size_t reference_probes = 0;
+	for (size_t reference_slot : reference_slots()) {
+		reference_hits += cache_histogram.hit_count(reference_slot);
+		reference_probes += cache_histogram.probe_count(reference_slot);
+	}
+	size_t signal_hits = cache_histogram.hit_count(slot);
+	size_t signal_probes = cache_histogram.probe_count(slot);
+	verdict_t verdict = compare_proportions(signal_hits, signal_probes, reference_hits, reference_probes);
+	if (verdict == VERDICT_YES && signal_probes > 0 && reference_probes > 0) {
+		double increase = (double)signal_hits / signal_probes - (double)reference_hits / reference_probes;
+		if (increase < CORRELATION_MIN_HIT_RATE_INCREASE) {
+			return VERDICT_NO;
+		}
+	}
+	return verdict;
+}
+
+/**
+ * Decides whether the continuation of the prefix was prefetched, i.e.,
+ * whether any signal slot has a higher hit rate than the reference slots
+ * (see compare_slot()).
+ *
+ * @param      cache_histogram  The cache histogram
+ *
+ * @return     VERDICT_YES if any slot is prefetched, VERDICT_INCONCLUSIVE
+ *             if none is but some are inconclusive, VERDICT_NO otherwise.
+ */
+verdict_t CorrelationExperiment::evaluate_replay(CacheHistogram const& cache_histogram) const {
+	verdict_t verdict = VERDICT_NO;
+	for (size_t slot : signal_slots()) {
+		verdict_t slot_verdict = compare_slot(cache_histogram, slot);
+		if (slot_verdict == VERDICT_YES) {
+			return VERDICT_YES;
+		} else if (slot_verdict == VERDICT_INCONCLUSIVE) {
+			verdict = VERDICT_INCONCLUSIVE;
+		}
+	}
+	return verdict;
+}
+
+/**
+ * Counts the consecutive elements of the continuation (starting right
+ * after the prefix) that were prefetched, i.e., how far ahead the
+ * prefetcher replays the sequence (up to CORRELATION_PROBE_DEPTH).
+ *
+ * @param      cache_histogram  The cache histogram
+ *
+ * @return     The number of elements.
+ */
+size_t CorrelationExperiment::evaluate_depth(CacheHistogram const& cache_histogram) const {
+	size_t depth = 0;
+	while (depth < no_signal_slots && compare_slot(cache_histogram, depth) == VERDICT_YES) {
+		depth++;
+	}
+	return depth;
+}
+
+/**
+ * Dumps the experiment and the cache histogram to a JSON file. The
+ * sequences are summarized by their number and length, the slots are
+ * listed with their offsets.
+ *
+ * @param      cache_histogram  The cache histogram
+ * @param      filepath         The file path to the JSON file
+ */
+void CorrelationExperiment::dump(CacheHistogram const& cache_histogram, string const& filepath) const {
+	Json::array slot_offsets_json;
+	for (size_t offset : slot_offsets) {
+		slot_offsets_json.push_back((int)offset);
+	}
+	Json::array trigger_json;
+	for (size_t offset : sequences[trigger_sequence]) {
+		trigger_json.push_back((int)offset);
+	}
+
+	Json j = Json::object {
+		{ "no_sequences", (int)sequences.size() },
+		{ "sequence_length", (int)sequences[trigger_sequence].size() },
+		{ "trigger_sequence", (int)trigger_sequence },
+		{ "trigger_sequence_offsets", trigger_json },
+		{ "prefix_length", (int)prefix_length },
+		{ "no_trainings", CORRELATION_NO_TRAININGS },
+		{ "slot_offsets", slot_offsets_json },
+		{ "no_signal_slots", (int)no_signal_slots },
+		{ "use_nanosleep", use_nanosleep },
+		{ "fr_thresh", (int)fr_thresh },
+		{ "noise_thresh", (int)noise_thresh },
+		{ "cache_histogram", cache_histogram.normalized_to_json() },
+		{ "cache_histogram_hits", cache_histogram.hits_to_json() },
+		{ "cache_histogram_probes", cache_histogram.probes_to_json() },
+		{ "cache_histogram_levels", cache_histogram.levels_to_json() },
+		{ "probe_fr_thresh", (int)probe_fr_thresh },
+		{ "noise", noise_stats.to_json() },
+		{ "numa_node", get_mapping_numa_node() },
+	};
+	json_dump_to_file(j, filepath);
+}
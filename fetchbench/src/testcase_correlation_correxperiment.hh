@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cinttypes>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "json11.hpp"
+
+#include "utils.hh"
+#include "cacheutils.hh"
+#include "mapping.hh"
+#include "cache_histogram.hh"
+#include "noise_monitor.hh"
+#include "frequency_guard.hh"
+#include "search.hh"
+
+using json11::Json;
+using std::string;
+using std::vector;
+
+// Number of times the sequences are trained per repetition
+#define CORRELATION_NO_TRAININGS 3
+// Number of elements after the replayed prefix that are probed
+#define CORRELATION_PROBE_DEPTH 4
+// Minimum increase of the hit rate of a signal slot over the reference
+// slots to count it as prefetched
+#define CORRELATION_MIN_HIT_RATE_INCREASE 0.1
+
+/**
+ * Experiment for temporal (correlation) prefetchers. One or more
+ * sequences of cache lines at random addresses are trained, each
+ * access from the same PC, such that the only thing the sequences have
+ * in common is the order of their (miss) addresses. Afterwards, a prefix
+ * of one of the sequences (the trigger sequence) is replayed, and a line
+ * of its continuation is probed. A temporal prefetcher that recorded the
+ * sequence prefetches the continuation.
+ *
+ * The probed lines ("slots") are the CORRELATION_PROBE_DEPTH elements of
+ * the trigger sequence after the prefix (signal), and one line per
+ * signal element in the middle of the same page that is never accessed
+ * (reference). The cache histogram of the experiment is indexed by slot.
+ */
+class CorrelationExperiment {
+public:
+	// trained sequences, offsets from the beginning of the mapping in bytes
+	vector<vector<size_t>> const sequences;
+	// index of the sequence whose prefix is replayed
+	size_t const trigger_sequence;
+	// number of elements of the trigger sequence to replay
+	size_t const prefix_length;
+	// wait before probing or not
+	bool const use_nanosleep;
+	// Flush+Reload threshold
+	size_t const fr_thresh;
+	// Flush+Reload noise threshold
+	size_t const noise_thresh;
+	// structs for nanosleep
+	struct timespec const t_req;
+	struct timespec t_rem;
+	// repetitions discarded because of noise (see NoiseMonitor)
+	NoiseStats noise_stats;
+	// Flush+Reload threshold used by the last collection (fr_thresh,
+	// scaled if the frequency changed, see FrequencyGuard)
+	size_t probe_fr_thresh = 0;
+
+private:
+	// offsets of the probed lines, signal slots first
+	vector<size_t> slot_offsets;
+	size_t no_signal_slots = 0;
+
+public:
+	CorrelationExperiment(vector<vector<size_t>> sequences, size_t trigger_sequence, size_t prefix_length, bool use_nanosleep, size_t fr_thresh, size_t noise_thresh);
+
+	static vector<vector<size_t>> generate_sequences(size_t no_sequences, size_t length, size_t lines_per_page, size_t no_pages);
+
+	vector<size_t> signal_slots() const;
+	vector<size_t> reference_slots() const;
+
+private:
+	inline probe_result_t probe_single(uint8_t* ptr) const __attribute__((always_inline)) {
+		size_t time = flush_reload_t(ptr);
+		return { time < probe_fr_thresh, LatencyBands::get().classify(time) };
+	}
+
+public:
+	CacheHistogram collect_cache_histogram(Mapping const& mapping, size_t no_repetitions);
+
+	verdict_t compare_slot(CacheHistogram const& cache_histogram, size_t slot) const;
+	verdict_t evaluate_replay(CacheHistogram const& cache_histogram) const;
+	size_t evaluate_depth(CacheHistogram const& cache_histogram) const;
+
+	void dump(CacheHistogram const& cache_histogram, string const& filepath) const;
+};
@@ -15,6 +15,7 @@
 #include "logger.hh"
 #include "utils.hh"
 #include "mapping.hh"
+#include "msr_controller.hh"
 
 #include "testcase_dcreplay_dcexperiment.hh"
 
@@ -44,10 +45,7 @@ protected:
 	virtual Json pre_test() override {
 		architecture_t arch = get_arch();
 		if (arch == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, false);
+			set_intel_prefetchers(USE_CURRENT_CPU, 0);
 		} else if (arch == ARCH_ARM) {
 		}
 		return Json::object {
@@ -57,10 +55,7 @@ protected:
 
 	virtual Json post_test() override {
 		if (get_arch() == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, true);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
 		}
 		return Json::object {};
 	}
@@ -91,15 +86,15 @@ protected:
 		DCReplayExperiment experiment { training_offsets, trigger_offsets, use_nanosleep, fr_thresh, noise_thresh };
 
 		// run experiments
-		vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_dcreplay_same_pc_different_memory, nullptr);
-		vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+		CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_dcreplay_same_pc_different_memory, nullptr);
+		PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
 
 		// Dump cache histogram
 		string dump_filename = "trace-dcreplay_base.json";
 		experiment.dump(cache_histogram, prefetch_vector, dump_filename);
 
 		// Count prefetches
-		size_t prefetch_count = std::count(prefetch_vector.begin(), prefetch_vector.end(), true);
+		size_t prefetch_count = prefetch_vector.count();
 		printf("loaded:%zu prefetched: %zu\n", trigger_offsets.size(), prefetch_count);
 		unmap_mapping(mapping);
 
@@ -13,6 +13,10 @@
 #include "utils.hh"
 #include "aligned_maccess.hh"
 #include "mapping.hh"
+#include "cache_histogram.hh"
+#include "prefetch_metrics.hh"
+#include "noise_monitor.hh"
+#include "frequency_guard.hh"
 
 using json11::Json;
 using std::vector;
@@ -34,6 +38,11 @@ public:
 	// structs for nanosleep
 	struct timespec const t_req;
 	struct timespec t_rem;
+	// repetitions discarded because of noise (see NoiseMonitor)
+	NoiseStats noise_stats;
+	// Flush+Reload threshold used by the last collection (fr_thresh,
+	// scaled if the frequency changed, see FrequencyGuard)
+	size_t probe_fr_thresh = 0;
 
 private:
 	// relative distances of later training loads to the first training load
@@ -47,19 +56,18 @@ public:
 	bool cl_potential_prefetch(size_t cl_idx) const;
 
 private:
-	inline void probe_single(vector<size_t>& cache_histogram, size_t idx, uint8_t* ptr) const __attribute__((always_inline)) {
-		assert(idx < cache_histogram.size());
+	inline probe_result_t probe_single(uint8_t* ptr) const __attribute__((always_inline)) {
 		size_t time = flush_reload_t(ptr);
-		cache_histogram[idx] += (time < fr_thresh) ? 1 : 0;
+		return { time < probe_fr_thresh, LatencyBands::get().classify(time) };
 	}
 
 public:
-	vector<size_t> collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(DCReplayExperiment const&, Mapping const&, void*), void* additional_info);
-	vector<size_t> collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(DCReplayExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info);
-	vector<bool> evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const;
-	vector<bool> evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions) const;
-	void dump(vector<size_t> const& cache_histogram, vector<bool> prefetch_vector, string const& filepath) const;
-	static pair<DCReplayExperiment, vector<size_t>> restore(string const& filepath);
+	CacheHistogram collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(DCReplayExperiment const&, Mapping const&, void*), void* additional_info);
+	CacheHistogram collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(DCReplayExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info);
+	PrefetchVector evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const;
+	PrefetchVector evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions) const;
+	void dump(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector, string const& filepath) const;
+	static pair<DCReplayExperiment, CacheHistogram> restore(string const& filepath);
 };
 
 // ===== WORKLOADS =====
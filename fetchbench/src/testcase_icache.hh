@@ -0,0 +1,494 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "testcase.hh"
+#include "cacheutils.hh"
+#include "code_lines.hh"
+#include "logger.hh"
+#include "utils.hh"
+#include "msr_controller.hh"
+
+using json11::Json;
+using std::string;
+using std::vector;
+
+// Minimum increase of the hit rate of a line (compared to the baseline
+// without executing any code) to count it as prefetched
+#define ICACHE_PREFETCH_THRESHOLD 0.5
+// Number of code pages to generate
+#define ICACHE_NO_PAGES 4
+// Time to wait before flushing the lines (in rdtsc() ticks)
+#define ICACHE_SETTLE_TICKS 2000
+// Number of timed executions to calibrate the code fetch threshold
+#define ICACHE_CALIBRATION_ROUNDS 1001
+
+/**
+ * Test case for instruction (code) prefetchers.
+ *
+ * The testcase generates code pages at runtime (see CodeLines), in which
+ * every cache line holds either a return instruction, no-ops that fall
+ * through into the next line, or a jump/call to another line. In each
+ * repetition, it flushes the involved lines, executes a sequence of lines
+ * (e.g., two lines falling through, or a line jumping to a distant line),
+ * and then times the execution of a single line that was not part of the
+ * sequence. If executing that line is fast, it was prefetched. The hit
+ * rate of each probed line is compared to a baseline run without
+ * executing the sequence.
+ *
+ * The tests cover the next-line distance (how many lines after the last
+ * executed line are prefetched, depending on the length of the sequence),
+ * fall-through versus branch-target prefetching (lines after a taken jump
+ * or call versus lines after its target), and whether prefetches cross
+ * page boundaries.
+ */
+class TestCaseICache : public TestCaseBase {
+private:
+	bool const use_nanosleep;
+	// structs for nanosleep
+	struct timespec const t_req;
+	struct timespec t_rem;
+	// threshold between cached and uncached code fetches (see
+	// calibrate_code_thresh())
+	size_t code_thresh = 0;
+	// number of lines per page
+	size_t const lines_per_page = PAGE_SIZE / CACHE_LINE_SIZE;
+
+public:
+	TestCaseICache(bool use_nanosleep)
+	: use_nanosleep {use_nanosleep}
+	, t_req { .tv_sec = 0, .tv_nsec = 1000 /* 1µs */ }
+	{}
+
+	virtual string id() override {
+		return "icache";
+	}
+
+private:
+	/**
+	 * Returns a layout in which `length` consecutive lines starting at
+	 * `first` are executed by falling through from one into the next.
+	 *
+	 * @param[in]  no_lines  The total number of lines
+	 * @param[in]  first     The first line
+	 * @param[in]  length    The number of lines to execute
+	 *
+	 * @return     The layout.
+	 */
+	vector<code_line_t> layout_sequential(size_t no_lines, size_t first, size_t length) const {
+		assert(length >= 1 && first + length <= no_lines);
+		vector<code_line_t> layout(no_lines, code_line_t {CODE_LINE_RET, 0});
+		for (size_t idx = first; idx < first + length - 1; idx++) {
+			layout[idx] = code_line_t {CODE_LINE_FALLTHROUGH, 0};
+		}
+		return layout;
+	}
+
+	/**
+	 * Returns a layout in which line `source` jumps to (or calls) line
+	 * `target`, which returns.
+	 *
+	 * @param[in]  no_lines  The total number of lines
+	 * @param[in]  source    The line with the branch
+	 * @param[in]  target    The branch target
+	 * @param[in]  call      Whether to call the target instead of jumping
+	 *
+	 * @return     The layout.
+	 */
+	vector<code_line_t> layout_branch(size_t no_lines, size_t source, size_t target, bool call) const {
+		vector<code_line_t> layout(no_lines, code_line_t {CODE_LINE_RET, 0});
+		layout[source] = code_line_t {call ? CODE_LINE_CALL : CODE_LINE_JUMP, target};
+		return layout;
+	}
+
+	/**
+	 * Calibrates the threshold between cached and uncached code fetches:
+	 * the median execution time of a line right after it was flushed
+	 * (miss) and right after it was executed (hit). The threshold is in
+	 * the middle.
+	 *
+	 * @param      lines  The code lines (all CODE_LINE_RET)
+	 *
+	 * @return     JSON structure with the medians and the threshold.
+	 */
+	Json calibrate_code_thresh(CodeLines const& lines) {
+		size_t idx = lines_per_page + lines_per_page / 2;
+		vector<size_t> hit_times, miss_times;
+		for (size_t i = 0; i < ICACHE_CALIBRATION_ROUNDS; i++) {
+			flush_code((void*)code_line(lines, idx));
+			mfence();
+			miss_times.push_back(time_code_line(lines, idx));
+			hit_times.push_back(time_code_line(lines, idx));
+		}
+		std::nth_element(hit_times.begin(), hit_times.begin() + hit_times.size() / 2, hit_times.end());
+		std::nth_element(miss_times.begin(), miss_times.begin() + miss_times.size() / 2, miss_times.end());
+		size_t hit_median = hit_times[hit_times.size() / 2];
+		size_t miss_median = miss_times[miss_times.size() / 2];
+		code_thresh = (hit_median + miss_median) / 2;
+		L::info("Code fetch threshold: %zu (hit: %zu, miss: %zu)\n", code_thresh, hit_median, miss_median);
+		if (miss_median <= hit_median) {
+			L::warn("Cached and uncached code fetches cannot be told apart\n");
+		}
+		return Json::object {
+			{"hit_median", (int)hit_median},
+			{"miss_median", (int)miss_median},
+			{"code_thresh", (int)code_thresh},
+		};
+	}
+
+	/**
+	 * Measures the hit rate of each probed line after executing the code
+	 * starting at line `entry`. Each repetition flushes the involved lines,
+	 * executes the entry line (unless `execute` is false, for the
+	 * baseline), and probes a single line, such that the probes do not
+	 * trigger prefetches of the lines probed later.
+	 *
+	 * @param      lines           The code lines
+	 * @param[in]  entry           The line to execute
+	 * @param[in]  execute         Whether to execute the entry line
+	 * @param      flush_lines     The lines to flush (executed and probed)
+	 * @param      probe_lines     The lines to probe
+	 * @param[in]  no_repetitions  Number of repetitions per probed line
+	 *
+	 * @return     Hit rate per probed line.
+	 */
+	vector<double> measure_hit_rates(CodeLines const& lines, size_t entry, bool execute, vector<size_t> const& flush_lines, vector<size_t> const& probe_lines, size_t no_repetitions) {
+		vector<size_t> hits(probe_lines.size(), 0);
+		vector<size_t> order(probe_lines.size());
+		for (size_t i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+		for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+			// Probe in random order: the probe is an indirect call, and if
+			// its target were predictable, the front-end would fetch the
+			// probed line before the timer starts.
+			std::shuffle(order.begin(), order.end(), *get_rng());
+			for (size_t i : order) {
+				// let prefetches triggered by the previous probe complete,
+				// such that they do not refill the lines after the flush
+				uint64_t settle_begin = rdtsc();
+				while (rdtsc() - settle_begin < ICACHE_SETTLE_TICKS);
+
+				for (size_t idx : flush_lines) {
+					flush_code((void*)code_line(lines, idx));
+				}
+				mfence();
+				if (execute) {
+					code_line(lines, entry)();
+				}
+				mfence();
+
+				// sleep a while to give the prefetcher some time to work
+				if (use_nanosleep) {
+					nanosleep(&t_req, &t_rem);
+				}
+
+				if (time_code_line(lines, probe_lines[i]) < code_thresh) {
+					hits[i]++;
+				}
+			}
+		}
+		vector<double> hit_rates;
+		for (size_t hit_count : hits) {
+			hit_rates.push_back((double)hit_count / no_repetitions);
+		}
+		return hit_rates;
+	}
+
+	/**
+	 * Executes a code layout and determines which of the probed lines are
+	 * prefetched. The results are dumped to a trace file.
+	 *
+	 * @param      lines           The code lines
+	 * @param      layout          The layout
+	 * @param[in]  entry           The line to execute
+	 * @param      probe_lines     The lines to probe
+	 * @param[in]  no_repetitions  Number of repetitions per probed line
+	 * @param      filepath        The trace file path
+	 *
+	 * @return     Whether each probed line was prefetched.
+	 */
+	vector<bool> run_layout(CodeLines const& lines, vector<code_line_t> const& layout, size_t entry, vector<size_t> const& probe_lines, size_t no_repetitions, string const& filepath) {
+		write_code_lines(lines, layout);
+
+		// executed lines: the entry, the lines falling through and the
+		// lines after them, the branches and their targets
+		vector<size_t> flush_lines = probe_lines;
+		flush_lines.push_back(entry);
+		for (size_t idx = 0; idx < layout.size(); idx++) {
+			if (layout[idx].kind == CODE_LINE_FALLTHROUGH) {
+				flush_lines.push_back(idx);
+				flush_lines.push_back(idx + 1);
+			} else if (layout[idx].kind != CODE_LINE_RET) {
+				flush_lines.push_back(idx);
+				flush_lines.push_back(layout[idx].target);
+			}
+		}
+		std::sort(flush_lines.begin(), flush_lines.end());
+		flush_lines.erase(std::unique(flush_lines.begin(), flush_lines.end()), flush_lines.end());
+
+		vector<double> baseline = measure_hit_rates(lines, entry, false, flush_lines, probe_lines, no_repetitions);
+		vector<double> hit_rates = measure_hit_rates(lines, entry, true, flush_lines, probe_lines, no_repetitions);
+
+		vector<bool> prefetched;
+		Json::array probes;
+		for (size_t i = 0; i < probe_lines.size(); i++) {
+			prefetched.push_back(hit_rates[i] - baseline[i] >= ICACHE_PREFETCH_THRESHOLD);
+			L::debug("line %3zd (%+3zd): %.3f (baseline: %.3f)%s\n", probe_lines[i], (ssize_t)probe_lines[i] - (ssize_t)entry, hit_rates[i], baseline[i], prefetched.back() ? " prefetched" : "");
+			probes.push_back(Json::object {
+				{"line", (int)probe_lines[i]},
+				{"hit_rate", hit_rates[i]},
+				{"baseline", baseline[i]},
+				{"prefetched", (bool)prefetched.back()},
+			});
+		}
+		Json::array layout_json;
+		for (size_t idx = 0; idx < layout.size(); idx++) {
+			if (layout[idx].kind != CODE_LINE_RET) {
+				layout_json.push_back(Json::object {
+					{"line", (int)idx},
+					{"kind", (int)layout[idx].kind},
+					{"target", (int)layout[idx].target},
+				});
+			}
+		}
+		json_dump_to_file(Json::object {
+			{"entry", (int)entry},
+			{"layout", layout_json},
+			{"probes", probes},
+			{"code_thresh", (int)code_thresh},
+			{"lines_per_page", (int)lines_per_page},
+			{"cache_line_size", CACHE_LINE_SIZE},
+		}, filepath);
+		return prefetched;
+	}
+
+	/**
+	 * Counts the consecutive prefetched lines at the beginning of a probe
+	 * result.
+	 *
+	 * @param      prefetched  Whether each probed line was prefetched
+	 * @param[in]  begin       The first index to consider
+	 * @param[in]  end         The index after the last one to consider
+	 *
+	 * @return     The number of consecutive prefetched lines.
+	 */
+	static size_t consecutive_prefetches(vector<bool> const& prefetched, size_t begin, size_t end) {
+		size_t count = 0;
+		while (begin + count < end && prefetched[begin + count]) {
+			count++;
+		}
+		return count;
+	}
+
+	static Json::array to_json_array(vector<bool> const& values, size_t begin, size_t end) {
+		Json::array array;
+		for (size_t i = begin; i < end; i++) {
+			array.push_back((bool)values[i]);
+		}
+		return array;
+	}
+
+	// ========== TESTS ==============
+
+	/**
+	 * Executes `length` consecutive lines (falling through) in the middle
+	 * of a page and probes the 8 lines after and the 4 lines before them.
+	 *
+	 * @param      lines           The code lines
+	 * @param[in]  length          The number of lines to execute
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_next_line(CodeLines const& lines, size_t length, size_t no_repetitions) {
+		L::info("Test: %s (%zu lines)\n", __FUNCTION__, length);
+		size_t first = lines_per_page + 16;
+		size_t last = first + length - 1;
+		vector<size_t> probe_lines;
+		for (size_t distance = 1; distance <= 8; distance++) {
+			probe_lines.push_back(last + distance);
+		}
+		for (size_t distance = 1; distance <= 4; distance++) {
+			probe_lines.push_back(first - distance);
+		}
+		vector<bool> prefetched = run_layout(lines, layout_sequential(lines.no_lines, first, length), first, probe_lines, no_repetitions,
+			"trace-icache-test_next_line-length_" + zero_pad(length, 2) + ".json");
+
+		size_t distance = consecutive_prefetches(prefetched, 0, 8);
+		size_t backward_distance = consecutive_prefetches(prefetched, 8, 12);
+		L::info("Next-line distance: %zu (backward: %zu)\n", distance, backward_distance);
+		return Json::object {
+			{"status", "completed"},
+			{"executed_lines", (int)length},
+			{"forward", to_json_array(prefetched, 0, 8)},
+			{"backward", to_json_array(prefetched, 8, 12)},
+			{"prefetches_forward", distance > 0},
+			{"prefetches_backward", backward_distance > 0},
+			{"distance", (int)distance},
+			{"backward_distance", (int)backward_distance},
+		};
+	}
+
+	/**
+	 * Executes a line that jumps to (or calls) a line 32 lines ahead and
+	 * probes the 4 lines after the branch (fall-through path, not
+	 * executed), the 4 lines after the branch target, and the 2 lines
+	 * before the branch target.
+	 *
+	 * @param      lines           The code lines
+	 * @param[in]  call            Whether to call the target
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_branch_target(CodeLines const& lines, bool call, size_t no_repetitions) {
+		L::info("Test: %s (%s)\n", __FUNCTION__, call ? "call" : "jump");
+		size_t source = lines_per_page + 8;
+		size_t target = source + 32;
+		vector<size_t> probe_lines;
+		for (size_t distance = 1; distance <= 4; distance++) {
+			probe_lines.push_back(source + distance);
+		}
+		for (size_t distance = 1; distance <= 4; distance++) {
+			probe_lines.push_back(target + distance);
+		}
+		probe_lines.push_back(target - 1);
+		probe_lines.push_back(target - 2);
+		vector<bool> prefetched = run_layout(lines, layout_branch(lines.no_lines, source, target, call), source, probe_lines, no_repetitions,
+			string {"trace-icache-test_branch_target-"} + (call ? "call" : "jump") + ".json");
+
+		size_t fallthrough_distance = consecutive_prefetches(prefetched, 0, 4);
+		size_t target_distance = consecutive_prefetches(prefetched, 4, 8);
+		L::info("Fall-through distance: %zu, branch target distance: %zu\n", fallthrough_distance, target_distance);
+		return Json::object {
+			{"status", "completed"},
+			{"branch", call ? "call" : "jump"},
+			{"fallthrough", to_json_array(prefetched, 0, 4)},
+			{"target_next", to_json_array(prefetched, 4, 8)},
+			{"target_previous", to_json_array(prefetched, 8, 10)},
+			{"fallthrough_prefetched", fallthrough_distance > 0},
+			{"target_next_prefetched", target_distance > 0},
+			{"fallthrough_distance", (int)fallthrough_distance},
+			{"target_distance", (int)target_distance},
+		};
+	}
+
+	/**
+	 * Checks whether the next-line distance depends on the number of
+	 * consecutively executed lines.
+	 *
+	 * @param      lines           The code lines
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_next_line_distance(CodeLines const& lines, size_t no_repetitions) {
+		L::info("Test: %s\n", __FUNCTION__);
+		Json::object results;
+		Json::object distances;
+		for (size_t length : {1, 2, 4, 8}) {
+			Json result = test_next_line(lines, length, no_repetitions);
+			results[std::to_string(length)] = result;
+			distances[std::to_string(length)] = result["distance"];
+		}
+		return Json::object {
+			{"status", "completed"},
+			{"distance_per_executed_lines", distances},
+			{"results", results},
+		};
+	}
+
+	/**
+	 * Checks whether instruction prefetches cross page boundaries: once
+	 * for two lines falling through at the end of a page, once for a jump
+	 * to the last line of a page. The first 4 lines of the next page are
+	 * probed.
+	 *
+	 * @param      lines           The code lines
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_page_crossing(CodeLines const& lines, size_t no_repetitions) {
+		L::info("Test: %s\n", __FUNCTION__);
+		// sequential: the last two lines of page 1
+		size_t next_page = 2 * lines_per_page;
+		vector<size_t> probe_lines;
+		for (size_t i = 0; i < 4; i++) {
+			probe_lines.push_back(next_page + i);
+		}
+		vector<bool> prefetched_sequential = run_layout(lines, layout_sequential(lines.no_lines, next_page - 2, 2), next_page - 2, probe_lines, no_repetitions,
+			"trace-icache-test_page_crossing-sequential.json");
+
+		// branch: from page 1 to the last line of page 2
+		size_t target = 3 * lines_per_page - 1;
+		for (size_t& line : probe_lines) {
+			line += lines_per_page;
+		}
+		vector<bool> prefetched_branch = run_layout(lines, layout_branch(lines.no_lines, lines_per_page + 8, target, false), lines_per_page + 8, probe_lines, no_repetitions,
+			"trace-icache-test_page_crossing-branch.json");
+
+		size_t sequential_distance = consecutive_prefetches(prefetched_sequential, 0, 4);
+		size_t branch_distance = consecutive_prefetches(prefetched_branch, 0, 4);
+		L::info("Lines prefetched across the page boundary: %zu (sequential), %zu (branch target)\n", sequential_distance, branch_distance);
+		return Json::object {
+			{"status", "completed"},
+			{"sequential", to_json_array(prefetched_sequential, 0, 4)},
+			{"branch_target", to_json_array(prefetched_branch, 0, 4)},
+			{"sequential_crosses_page", sequential_distance > 0},
+			{"branch_target_crosses_page", branch_distance > 0},
+		};
+	}
+
+protected:
+	virtual Json pre_test() override {
+		architecture_t arch = get_arch();
+		return Json::object {
+			{"architecture", arch},
+		};
+	}
+
+	virtual Json identify() override {
+		size_t no_repetitions = 2000;
+		CodeLines lines = allocate_code_lines(ICACHE_NO_PAGES);
+		Json calibration = calibrate_code_thresh(lines);
+
+		Json results_next_line = test_next_line(lines, 2, no_repetitions);
+		Json results_branch = test_branch_target(lines, false, no_repetitions);
+		release_code_lines(lines);
+
+		bool identified = (
+			results_next_line["prefetches_forward"].bool_value()
+			|| results_next_line["prefetches_backward"].bool_value()
+			|| results_branch["fallthrough_prefetched"].bool_value()
+			|| results_branch["target_next_prefetched"].bool_value()
+		);
+		return Json::object {
+			{ "identified", identified },
+			{ "calibration", calibration },
+			{ "test_next_line", results_next_line },
+			{ "test_branch_target_jump", results_branch },
+		};
+	}
+
+	virtual Json characterize() override {
+		size_t no_repetitions = 2000;
+		CodeLines lines = allocate_code_lines(ICACHE_NO_PAGES);
+		calibrate_code_thresh(lines);
+
+		Json results = Json::object {
+			{ "test_next_line_distance", test_next_line_distance(lines, no_repetitions) },
+			{ "test_branch_target_call", test_branch_target(lines, true, no_repetitions) },
+			{ "test_page_crossing", test_page_crossing(lines, no_repetitions) },
+		};
+		release_code_lines(lines);
+		return results;
+	}
+};
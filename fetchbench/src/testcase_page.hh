@@ -0,0 +1,545 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "testcase.hh"
+#include "cacheutils.hh"
+#include "mapping.hh"
+#include "logger.hh"
+#include "utils.hh"
+#include "noise_monitor.hh"
+#include "frequency_guard.hh"
+#include "access_kind.hh"
+
+using json11::Json;
+using std::pair;
+using std::string;
+using std::vector;
+
+// Minimum increase of the hit rate of a line (compared to the baseline
+// without training) to count it as prefetched
+#define PAGE_PREFETCH_THRESHOLD 0.5
+// Number of training accesses
+#define PAGE_TRAIN_ACCESSES 8
+// Number of lines probed ahead of the last training access
+#define PAGE_NO_PROBES 8
+// Stride of the stride pattern in cache lines
+#define PAGE_STRIDE_LINES 4
+// Minimum fraction of the page walk latency that the training has to save
+// to count the translation of the next page as warmed
+#define PAGE_TLB_WARM_THRESHOLD 0.5
+// Minimum page walk latency (in rdtsc() ticks) to evaluate TLB warmth
+#define PAGE_MIN_WALK_TICKS 5
+// Quantile of the latencies to compare for TLB warmth
+#define PAGE_TLB_QUANTILE 0.1
+
+/**
+ * Training pattern of the page testcase.
+ */
+typedef struct {
+	char const* name;
+	// stride in bytes
+	size_t stride;
+} page_pattern_t;
+
+/**
+ * Test case for prefetching across page boundaries.
+ *
+ * Trains a stream (stride of one cache line) or a stride pattern (stride of
+ * PAGE_STRIDE_LINES lines) that ends just before a page boundary, and
+ * checks the next page separately for
+ *  - **cache state:** whether the lines the pattern would access next
+ *    are cached afterwards (Flush+Reload, compared to a baseline without
+ *    training). This is measured with the translation of the next page
+ *    invalidated before the training (TLB cold) and present (TLB warm).
+ *    The same pattern ending in the middle of the page serves as control.
+ *  - **TLB warmth:** whether the training makes the translation of the
+ *    next page available, i.e., a prefetcher (or a TLB prefetcher)
+ *    performed the page walk. We time a cached line of the next page after
+ *    invalidating its translation, and compare it to the latency with a
+ *    cold and a warm translation without training.
+ *
+ * Both are tested at a 4 KiB boundary (in the middle of a 2 MiB region)
+ * and at a 2 MiB boundary, on a mapping backed by regular pages and on a
+ * mapping backed by huge pages (if available). On the latter, the 4 KiB
+ * boundary is not a translation boundary, so a prefetcher that stops at
+ * 4 KiB boundaries only for lack of a translation crosses it there.
+ */
+class TestCasePage : public TestCaseBase {
+private:
+	size_t const fr_thresh;
+	size_t const noise_thresh;
+	bool const use_nanosleep;
+	// structs for nanosleep
+	struct timespec const t_req;
+	struct timespec t_rem;
+	// repetitions discarded because of noise (see NoiseMonitor)
+	NoiseStats noise_stats;
+
+	// mapping size: boundaries at HUGE_PAGE_SIZE / 2 (4 KiB) and
+	// HUGE_PAGE_SIZE (2 MiB), and an unrelated last huge page
+	static constexpr size_t MAPPING_SIZE = 3 * HUGE_PAGE_SIZE;
+
+public:
+	TestCasePage(size_t fr_thresh, size_t noise_thresh, bool use_nanosleep)
+	: fr_thresh {fr_thresh}
+	, noise_thresh {noise_thresh}
+	, use_nanosleep {use_nanosleep}
+	, t_req { .tv_sec = 0, .tv_nsec = 1000 /* 1µs */ }
+	{}
+
+	virtual string id() override {
+		return "page";
+	}
+
+private:
+	/**
+	 * Performs `no_accesses` accesses (of the current access kind) with
+	 * the given stride, all from the same PC.
+	 *
+	 * @param      begin        The first address to access
+	 * @param[in]  stride       The stride in bytes
+	 * @param[in]  no_accesses  The number of accesses
+	 */
+	__attribute__((noinline)) void train(uint8_t* begin, size_t stride, size_t no_accesses) {
+		for (uint8_t* ptr = begin; ptr < begin + stride * no_accesses; ptr += stride) {
+			maccess_kind(access_kind, ptr);
+		}
+	}
+
+	/**
+	 * Returns the range that shares the translation of the page at the
+	 * given offset, i.e., the page or the huge page.
+	 *
+	 * @param      mapping  The mapping
+	 * @param[in]  offset   The offset
+	 * @param[in]  huge     Whether the mapping is backed by huge pages
+	 *
+	 * @return     Beginning and size of the range.
+	 */
+	static pair<uint8_t*, size_t> translation_range(Mapping const& mapping, size_t offset, bool huge) {
+		size_t size = huge ? HUGE_PAGE_SIZE : PAGE_SIZE;
+		return {mapping.base_addr + offset / size * size, size};
+	}
+
+	/**
+	 * Measures the hit rate of each probed line after training the pattern.
+	 * Each repetition flushes the training and probed lines, prepares the
+	 * translation of the probed page (invalidated or warmed), trains the
+	 * pattern (unless `execute` is false, for the baseline), and probes a
+	 * single line. The lines are probed in random order.
+	 *
+	 * @param      mapping         The mapping
+	 * @param[in]  huge            Whether the mapping is backed by huge pages
+	 * @param[in]  train_offset    The offset of the first training access
+	 * @param[in]  stride          The stride in bytes
+	 * @param      probe_offsets   The offsets of the probed lines (all in
+	 *                             the same page)
+	 * @param[in]  tlb_cold        Whether to invalidate the translation of
+	 *                             the probed page before the training
+	 * @param[in]  execute         Whether to train the pattern
+	 * @param[in]  no_repetitions  Number of repetitions per probed line
+	 *
+	 * @return     Hit rate per probed line.
+	 */
+	vector<double> measure_hit_rates(Mapping const& mapping, bool huge, size_t train_offset, size_t stride, vector<size_t> const& probe_offsets, bool tlb_cold, bool execute, size_t no_repetitions) {
+		pair<uint8_t*, size_t> probe_translation = translation_range(mapping, probe_offsets[0], huge);
+		// a line at the end of the probed page that is not probed, to warm
+		// the translation (not needed if the training is in the same page)
+		uint8_t* warm_ptr = mapping.base_addr + (probe_offsets[0] / PAGE_SIZE + 1) * PAGE_SIZE - CACHE_LINE_SIZE;
+		bool warm = ! tlb_cold && (probe_offsets[0] / PAGE_SIZE != train_offset / PAGE_SIZE);
+
+		vector<size_t> hits(probe_offsets.size(), 0);
+		vector<size_t> probes(probe_offsets.size(), 0);
+		vector<size_t> order(probe_offsets.size());
+		for (size_t i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+		size_t probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+		NoiseMonitor& noise_monitor = NoiseMonitor::get();
+		noise_monitor.begin_collection();
+		for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+			std::shuffle(order.begin(), order.end(), *get_rng());
+			for (size_t i : order) {
+				// flush lines
+				for (size_t step = 0; step < PAGE_TRAIN_ACCESSES; step++) {
+					flush(mapping.base_addr + train_offset + step * stride);
+				}
+				for (size_t offset : probe_offsets) {
+					flush(mapping.base_addr + offset);
+				}
+				mfence();
+
+				// prepare the translation (the system call happens outside
+				// of the window, it does not count as noise)
+				if (tlb_cold) {
+					invalidate_translation(probe_translation.first, probe_translation.second);
+				} else if (warm) {
+					maccess(warm_ptr);
+					mfence();
+					flush(warm_ptr);
+				}
+				mfence();
+				noise_monitor.begin_window();
+
+				// induce pattern
+				if (execute) {
+					train(mapping.base_addr + train_offset, stride, PAGE_TRAIN_ACCESSES);
+				}
+				mfence();
+
+				// sleep a while to give the prefetcher some time to work
+				if (use_nanosleep) {
+					nanosleep(&t_req, &t_rem);
+				}
+
+				size_t time = flush_reload_t(mapping.base_addr + probe_offsets[i]);
+				if (noise_monitor.end_window(noise_stats)) {
+					probes[i]++;
+					if (time < probe_fr_thresh && time > noise_thresh) {
+						hits[i]++;
+					}
+				}
+			}
+		}
+		vector<double> hit_rates;
+		for (size_t i = 0; i < hits.size(); i++) {
+			hit_rates.push_back(probes[i] > 0 ? (double)hits[i] / probes[i] : 0.0);
+		}
+		return hit_rates;
+	}
+
+	/**
+	 * Determines which lines the pattern would access next are prefetched
+	 * after training it.
+	 *
+	 * @param      mapping         The mapping
+	 * @param[in]  huge            Whether the mapping is backed by huge pages
+	 * @param[in]  end_offset      The offset after the last training access
+	 *                             (the first probed line)
+	 * @param[in]  stride          The stride in bytes
+	 * @param[in]  tlb_cold        Whether to invalidate the translation of
+	 *                             the probed page
+	 * @param[in]  no_repetitions  Number of repetitions per probed line
+	 *
+	 * @return     JSON structure with the hit rates, the baseline, and the
+	 *             number of consecutive prefetched lines.
+	 */
+	Json test_probes(Mapping const& mapping, bool huge, size_t end_offset, size_t stride, bool tlb_cold, size_t no_repetitions) {
+		size_t train_offset = end_offset - PAGE_TRAIN_ACCESSES * stride;
+		vector<size_t> probe_offsets;
+		for (size_t step = 0; step < PAGE_NO_PROBES; step++) {
+			probe_offsets.push_back(end_offset + step * stride);
+		}
+		vector<double> baseline = measure_hit_rates(mapping, huge, train_offset, stride, probe_offsets, tlb_cold, false, no_repetitions);
+		vector<double> hit_rates = measure_hit_rates(mapping, huge, train_offset, stride, probe_offsets, tlb_cold, true, no_repetitions);
+
+		Json::array hit_rates_json, baseline_json, prefetched_json;
+		size_t distance = 0;
+		bool consecutive = true;
+		for (size_t i = 0; i < probe_offsets.size(); i++) {
+			bool prefetched = (hit_rates[i] - baseline[i] >= PAGE_PREFETCH_THRESHOLD);
+			consecutive = consecutive && prefetched;
+			if (consecutive) {
+				distance++;
+			}
+			L::debug("offset %7zu: %.3f (baseline: %.3f)%s\n", probe_offsets[i], hit_rates[i], baseline[i], prefetched ? " prefetched" : "");
+			hit_rates_json.push_back(hit_rates[i]);
+			baseline_json.push_back(baseline[i]);
+			prefetched_json.push_back(prefetched);
+		}
+		return Json::object {
+			{"first_probe_offset", (int)end_offset},
+			{"hit_rates", hit_rates_json},
+			{"baseline", baseline_json},
+			{"prefetched", prefetched_json},
+			{"distance", (int)distance},
+		};
+	}
+
+	/**
+	 * Returns the PAGE_TLB_QUANTILE quantile of a vector of timings.
+	 */
+	static size_t low_quantile(vector<size_t> values) {
+		if (values.empty()) {
+			return 0;
+		}
+		size_t idx = (size_t)(values.size() * PAGE_TLB_QUANTILE);
+		std::nth_element(values.begin(), values.begin() + idx, values.end());
+		return values[idx];
+	}
+
+	/**
+	 * Measures whether training the pattern warms the translation of the
+	 * next page. In each repetition, a line in the middle of the next page
+	 * is loaded, then one translation is invalidated, a single line at the
+	 * beginning of the training page is loaded, and the line in the next
+	 * page is timed again. Three modes alternate:
+	 *  - cold: the translation of the next page is invalidated,
+	 *  - warm: the translation of an unrelated page is invalidated (same
+	 *    system call, same disturbance of the caches),
+	 *  - trained: like cold, then the pattern is trained.
+	 * The single load warms the paging-structure caches for the training
+	 * page in all modes, such that the trained mode does not benefit from
+	 * a shorter walk alone. The timed line is not always still cached after
+	 * the system call, so we compare a low quantile (PAGE_TLB_QUANTILE) of
+	 * the latencies, i.e., the cases in which it was. The difference of the
+	 * cold and warm latencies is the page walk latency, and the fraction of
+	 * it that the training saves is the TLB warmth.
+	 *
+	 * @param      mapping         The mapping
+	 * @param[in]  huge            Whether the mapping is backed by huge pages
+	 * @param[in]  boundary        The offset of the page boundary
+	 * @param[in]  stride          The stride in bytes
+	 * @param[in]  no_repetitions  Number of repetitions per mode
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_tlb_warmth(Mapping const& mapping, bool huge, size_t boundary, size_t stride, size_t no_repetitions) {
+		uint8_t* target = mapping.base_addr + boundary + PAGE_SIZE / 2;
+		pair<uint8_t*, size_t> next_translation = translation_range(mapping, boundary, huge);
+		pair<uint8_t*, size_t> unrelated_translation = translation_range(mapping, mapping.size - PAGE_SIZE, huge);
+		uint8_t* train_begin = mapping.base_addr + boundary - PAGE_TRAIN_ACCESSES * stride;
+		uint8_t* page_begin = mapping.base_addr + boundary - PAGE_SIZE;
+
+		// 0: cold, 1: warm, 2: trained
+		vector<vector<size_t>> times(3);
+		NoiseMonitor& noise_monitor = NoiseMonitor::get();
+		noise_monitor.begin_collection();
+		for (size_t repetition = 0; repetition < 3 * no_repetitions; repetition++) {
+			size_t mode = repetition % 3;
+			for (size_t step = 0; step < PAGE_TRAIN_ACCESSES; step++) {
+				flush(train_begin + step * stride);
+			}
+			flush(page_begin);
+			maccess(target);
+			mfence();
+			pair<uint8_t*, size_t> const& invalidated = (mode == 1) ? unrelated_translation : next_translation;
+			invalidate_translation(invalidated.first, invalidated.second);
+			mfence();
+			noise_monitor.begin_window();
+
+			maccess(page_begin);
+			mfence();
+			if (mode == 2) {
+				train(train_begin, stride, PAGE_TRAIN_ACCESSES);
+			}
+			mfence();
+
+			// sleep a while to give the prefetcher some time to work
+			if (use_nanosleep) {
+				nanosleep(&t_req, &t_rem);
+			}
+
+			size_t time = flush_reload_t(target);
+			if (noise_monitor.end_window(noise_stats)) {
+				times[mode].push_back(time);
+			}
+		}
+
+		ssize_t cold = low_quantile(times[0]);
+		ssize_t warm = low_quantile(times[1]);
+		ssize_t trained = low_quantile(times[2]);
+		ssize_t walk = cold - warm;
+		bool measurable = (walk >= PAGE_MIN_WALK_TICKS);
+		double warmth = measurable ? (double)(cold - trained) / walk : 0.0;
+		bool tlb_warmed = measurable && warmth >= PAGE_TLB_WARM_THRESHOLD;
+		L::debug("TLB: cold %zd, warm %zd, trained %zd (warmth: %.2f)\n", cold, warm, trained, warmth);
+		return Json::object {
+			{"cold", (int)cold},
+			{"warm", (int)warm},
+			{"trained", (int)trained},
+			{"walk_latency", (int)walk},
+			{"walk_latency_measurable", measurable},
+			{"warmth", warmth},
+			{"tlb_warmed", tlb_warmed},
+		};
+	}
+
+	// ========== TESTS ==============
+
+	/**
+	 * Trains a pattern ending just before a page boundary and measures the
+	 * cache state (TLB cold and, unless `quick`, TLB warm) and the TLB
+	 * warmth of the next page, and the cache state in the middle of the page
+	 * (control). The results are dumped to a trace file.
+	 *
+	 * @param      mapping         The mapping
+	 * @param[in]  huge            Whether the mapping is backed by huge pages
+	 * @param[in]  boundary        The offset of the page boundary
+	 * @param      pattern         The pattern
+	 * @param[in]  quick           Whether to skip the TLB-warm cache state
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_boundary(Mapping const& mapping, bool huge, size_t boundary, page_pattern_t const& pattern, bool quick, size_t no_repetitions) {
+		char const* mapping_name = huge ? "huge" : "regular";
+		char const* boundary_name = (boundary % HUGE_PAGE_SIZE == 0) ? "2MiB" : "4KiB";
+		L::info("Test: %s (%s pages, %s boundary, %s%s)\n", __FUNCTION__, mapping_name, boundary_name, pattern.name, access_kind_suffix().c_str());
+		// the control pattern ends PAGE_NO_PROBES strides earlier, its
+		// probes are in the same page as the training
+		assert((PAGE_TRAIN_ACCESSES + PAGE_NO_PROBES) * pattern.stride <= PAGE_SIZE);
+		bool same_translation = huge && (boundary % HUGE_PAGE_SIZE != 0);
+		noise_stats = NoiseStats {};
+
+		Json in_page = test_probes(mapping, huge, boundary - PAGE_NO_PROBES * pattern.stride, pattern.stride, false, no_repetitions);
+		Json next_page_tlb_cold = test_probes(mapping, huge, boundary, pattern.stride, true, no_repetitions);
+		Json next_page_tlb_warm = quick ? Json {} : test_probes(mapping, huge, boundary, pattern.stride, false, no_repetitions);
+		Json tlb = test_tlb_warmth(mapping, huge, boundary, pattern.stride, 10 * no_repetitions);
+
+		bool prefetches_in_page = (in_page["distance"].int_value() > 0);
+		bool crosses_tlb_cold = (next_page_tlb_cold["distance"].int_value() > 0);
+		bool crosses_tlb_warm = ! quick && (next_page_tlb_warm["distance"].int_value() > 0);
+		bool tlb_warmed = ! same_translation && tlb["tlb_warmed"].bool_value();
+		L::info("Prefetches in page: %d, across the boundary: %d (TLB cold), %d (TLB warm), next translation warmed: %d\n",
+			prefetches_in_page, crosses_tlb_cold, crosses_tlb_warm, tlb_warmed);
+
+		Json::object result {
+			{"status", "completed"},
+			{"mapping", mapping_name},
+			{"boundary", boundary_name},
+			{"pattern", pattern.name},
+			{"stride", (int)pattern.stride},
+			{"same_translation", same_translation},
+			{"in_page", in_page},
+			{"next_page_tlb_cold", next_page_tlb_cold},
+			{"next_page_tlb_warm", next_page_tlb_warm},
+			{"tlb", tlb},
+			{"prefetches_in_page", prefetches_in_page},
+			{"crosses_tlb_cold", crosses_tlb_cold},
+			{"crosses_tlb_warm", crosses_tlb_warm},
+			{"tlb_warmed", tlb_warmed},
+		};
+		Json::object trace = result;
+		trace["cache_line_size"] = CACHE_LINE_SIZE;
+		trace["fr_thresh"] = (int)fr_thresh;
+		trace["noise_thresh"] = (int)noise_thresh;
+		trace["noise"] = noise_stats.to_json();
+		trace["numa_node"] = get_mapping_numa_node();
+		trace["access_kind"] = access_kind_to_string(access_kind);
+		json_dump_to_file(trace, string {"trace-page-"} + mapping_name + "-" + boundary_name + "-" + pattern.name + access_kind_suffix() + ".json");
+		return result;
+	}
+
+	/**
+	 * Allocates the mapping backed by huge pages. Returns false (and
+	 * releases the mapping) if it is not fully backed by huge pages.
+	 */
+	bool allocate_huge(Mapping& mapping, size_t& huge_page_bytes) {
+		mapping = allocate_mapping_huge_pages(MAPPING_SIZE);
+		huge_page_bytes = mapping_huge_page_bytes(mapping);
+		if (huge_page_bytes < MAPPING_SIZE) {
+			L::warn("Only %zu of %zu bytes are backed by huge pages, skipping the huge page tests\n", huge_page_bytes, MAPPING_SIZE);
+			unmap_mapping(mapping);
+			return false;
+		}
+		return true;
+	}
+
+protected:
+	virtual Json pre_test() override {
+		architecture_t arch = get_arch();
+		return Json::object {
+			{"architecture", arch},
+		};
+	}
+
+	virtual Json identify() override {
+		return identify_per_access_kind([this]() -> Json {
+			size_t no_repetitions = 300;
+			Mapping mapping = allocate_mapping_small_pages(MAPPING_SIZE);
+			Json result = test_boundary(mapping, false, HUGE_PAGE_SIZE / 2, page_pattern_t {"stream", CACHE_LINE_SIZE}, true, no_repetitions);
+			unmap_mapping(mapping);
+
+			bool identified = (
+				result["crosses_tlb_cold"].bool_value()
+				|| result["tlb_warmed"].bool_value()
+			);
+			return Json::object {
+				{ "identified", identified },
+				{ "test_boundary", result },
+			};
+		});
+	}
+
+	virtual Json characterize() override {
+		size_t no_repetitions = 500;
+		vector<page_pattern_t> patterns {
+			{"stream", CACHE_LINE_SIZE},
+			{"stride", PAGE_STRIDE_LINES * CACHE_LINE_SIZE},
+		};
+		Json::object results;
+		Json::array table;
+		size_t huge_page_bytes = 0;
+		for (bool huge : {false, true}) {
+			Mapping mapping;
+			if (huge) {
+				if ( ! allocate_huge(mapping, huge_page_bytes)) {
+					results["huge"] = Json::object {
+						{"status", "unavailable"},
+						{"huge_page_bytes", (int)huge_page_bytes},
+					};
+					continue;
+				}
+			} else {
+				mapping = allocate_mapping_small_pages(MAPPING_SIZE);
+			}
+
+			Json::object mapping_results;
+			for (size_t boundary : {(size_t)HUGE_PAGE_SIZE / 2, (size_t)HUGE_PAGE_SIZE}) {
+				for (page_pattern_t const& pattern : patterns) {
+					Json result = test_boundary(mapping, huge, boundary, pattern, false, no_repetitions);
+					mapping_results[result["boundary"].string_value() + "-" + pattern.name] = result;
+					table.push_back(Json::object {
+						{"mapping", result["mapping"]},
+						{"boundary", result["boundary"]},
+						{"pattern", result["pattern"]},
+						{"prefetches_in_page", result["prefetches_in_page"]},
+						{"crosses_tlb_cold", result["crosses_tlb_cold"]},
+						{"crosses_tlb_warm", result["crosses_tlb_warm"]},
+						{"tlb_warmed", result["tlb_warmed"]},
+					});
+				}
+			}
+			results[huge ? "huge" : "regular"] = mapping_results;
+			unmap_mapping(mapping);
+		}
+
+		// do huge pages let the prefetchers cross 4 KiB boundaries that
+		// they do not cross on regular pages?
+		bool hugepages_extend_reach = false;
+		Json const& regular_results = results["regular"];
+		Json const& huge_results = results["huge"];
+		if (huge_results["status"].is_null()) {
+			for (page_pattern_t const& pattern : patterns) {
+				string key = string {"4KiB-"} + pattern.name;
+				hugepages_extend_reach = hugepages_extend_reach || (
+					huge_results[key]["crosses_tlb_cold"].bool_value()
+					&& ! regular_results[key]["crosses_tlb_cold"].bool_value()
+				);
+			}
+		}
+
+		L::info("Page boundary crossing (in page / TLB cold / TLB warm / TLB warmed):\n");
+		for (Json const& row : table) {
+			L::info("  %-7s %-4s %-6s  %d / %d / %d / %d\n",
+				row["mapping"].string_value().c_str(), row["boundary"].string_value().c_str(), row["pattern"].string_value().c_str(),
+				row["prefetches_in_page"].bool_value(), row["crosses_tlb_cold"].bool_value(),
+				row["crosses_tlb_warm"].bool_value(), row["tlb_warmed"].bool_value());
+		}
+		L::info("Huge pages extend the prefetch reach: %d\n", hugepages_extend_reach);
+		return Json::object {
+			{"results", results},
+			{"table", table},
+			{"hugepages_extend_reach", hugepages_extend_reach},
+		};
+	}
+};
@@ -2,94 +2,217 @@
 
 #include <cstdio>
 #include <cstring>
+#include <functional>
 #include <string>
 #include <limits>
 
 #include "testcase.hh"
 #include "cacheutils.hh"
+#include "latency_samples.hh"
 #include "mapping.hh"
+#include "msr_controller.hh"
 #include "logger.hh"
+#include "search.hh"
+#include "parr/parr.h"
 
 using std::string;
 
+// Number of repetitions of each pointer array experiment
+#define PARR_NO_REPETITIONS 5000
+
+// Blinding key for the reference experiments. Blinded pointers can not be
+// recognized by the prefetcher, which rules out false positives.
+#define PARR_BLIND_KEY 0x42434445
+
 class TestCasePointerArray : public TestCaseBase {
 private:
-	int const cpu_bin;
-	int const cpu_ctrthread;
+	// keep the raw timings of the experiments and include them in the
+	// dumps (for debugging, see LatencySamples)
+	bool keep_raw_samples;
+
 public:
-	TestCasePointerArray(int cpu_bin, int cpu_ctrthread)
-	: cpu_bin {cpu_bin}
-	, cpu_ctrthread {cpu_ctrthread}
+	TestCasePointerArray(bool keep_raw_samples)
+	: keep_raw_samples {keep_raw_samples}
 	{}
 
 	virtual string id() override {
 		return "parr";
 	}
-	
+
 protected:
 	virtual Json pre_test() override {
-		// stop global counter thread (if enabled). The external binary will
-		// start its own.
-		clock_teardown();
 		// make sure all prefetchers are enabled
 		architecture_t arch = get_arch();
 		if (arch == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, true);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
 		}
+		parr_seed(random_uint32(1, std::numeric_limits<uint32_t>::max()));
 		return Json::object {};
 	}
 
 	virtual Json post_test() override {
-		// restart global counter thread (if enabled)
-		clock_init(cpu_ctrthread);
 		if (get_arch() == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, true);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
 		}
 		return Json::object {};
 	}
-	
-	virtual Json identify() override {
-		size_t no_repetitions = 5000;
-
-		L::info("Calling external binary...\n");
-		fflush(stdout);
-		pid_t pid = fork();
-		switch(pid) {
-			case -1:
-				perror("fork() failed.");
-				exit(EXIT_FAILURE);
-			case 0: { // child
-				#ifdef COUNTER_THREAD
-					pin_process_to_cpu(0, cpu_bin, cpu_ctrthread);
-				#else
-					pin_process_to_cpu(0, cpu_bin);
-				#endif
-				std::string no_repetitions_str = std::to_string(no_repetitions);
-				vector<char const *> argv {"sh", "runner_parr.sh", no_repetitions_str.c_str(), NULL};
-				execvp(const_cast<char* const>(argv.data()[0]), const_cast<char* const*>(argv.data()));
-				break;
-			}
-			default: // parent
-				L::info("Waiting for external binary to finish...\n");
-				waitpid(pid, NULL, 0);
-				break;
+
+	/**
+	 * Runs one pointer array experiment (see parr_run_experiment() for
+	 * the parameters). The pointer array has 512 entries and the target
+	 * array 60000 entries of 128 bytes.
+	 *
+	 * @return     The samples.
+	 */
+	LatencySamples run_experiment(size_t parr_entry_size, size_t iter_increment, size_t iters, size_t measure_index, uint64_t blind_key, uint64_t ptr_offset, uint64_t iter_start_idx) {
+		LatencySamples samples (PARR_NO_REPETITIONS, keep_raw_samples);
+		parr_run_experiment(
+			512, parr_entry_size, 60000, 16, iter_increment, iters, PARR_NO_REPETITIONS,
+			measure_index, samples.record(), blind_key, ptr_offset, iter_start_idx
+		);
+		return samples;
+	}
+
+	/**
+	 * Runs an experiment for each parameter value and summarizes the
+	 * results.
+	 *
+	 * @param      params      The parameter values
+	 * @param      experiment  Function that runs the experiment for a
+	 *                         parameter value
+	 *
+	 * @return     JSON structure with the parameter values and one
+	 *             summary per value (see LatencySamples::summary_to_json()).
+	 */
+	Json sweep(vector<int64_t> const& params, std::function<LatencySamples(int64_t)> const& experiment) {
+		Json::array params_json;
+		Json::array summaries_json;
+		for (int64_t param : params) {
+			LatencySamples samples = experiment(param);
+			params_json.push_back((int)param);
+			summaries_json.push_back(samples.summary_to_json());
 		}
-		L::info("External binary finished.\n");
+		return Json::object {
+			{"params", params_json},
+			{"summaries", summaries_json},
+		};
+	}
+
+	/**
+	 * Dumps the histograms of the experiments and the summaries of the
+	 * sweeps to a JSON file (for plotting).
+	 *
+	 * @param      experiments  Map of experiment name to samples
+	 * @param      sweeps       Map of sweep name to sweep results (see
+	 *                          sweep())
+	 * @param      filename     The filename
+	 */
+	void dump(map<string, LatencySamples> const& experiments, Json::object const& sweeps, string const& filename) {
+		Json::object experiments_json;
+		for (pair<string const, LatencySamples> const& experiment : experiments) {
+			experiments_json[experiment.first] = experiment.second.to_json();
+		}
+		json_dump_to_file(Json::object {
+			{"experiments", experiments_json},
+			{"sweeps", sweeps},
+		}, filename);
+	}
+
+	virtual Json identify() override {
+		// test for existence of the prefetcher: train with the first 120
+		// pointers, measure the target of the next one
+		LatencySamples existence = run_experiment(1, 1, 120, 120, 0, 0, 0);
+		// same with blinding, should rule out false positives
+		LatencySamples existence_ref = run_experiment(1, 1, 120, 120, PARR_BLIND_KEY, 0, 0);
+
+		verdict_t verdict = existence.verdict();
+		verdict_t verdict_ref = existence_ref.verdict();
+		L::debug("parr existence: %s, reference: %s\n", verdict_to_string(verdict), verdict_to_string(verdict_ref));
+		bool identified = (verdict == VERDICT_YES && verdict_ref == VERDICT_NO);
 
-		plot_parr("parr", "parr.log");
+		string dump_filename = "trace-parr_identify.json";
+		dump({{"existence", existence}, {"existence-ref", existence_ref}}, {}, dump_filename);
+		plot_parr(string{__FUNCTION__}, {dump_filename});
 
-		// TODO: Separate identification and characterization properly
-		// TODO: Automatically determine whether identification was successful or not
-		return {};
+		return Json::object {
+			{"identified", identified},
+			{"existence", existence.summary_to_json()},
+			{"existence-ref", existence_ref.summary_to_json()},
+		};
 	}
-	
+
 	virtual Json characterize() override {
-		return {};
+		map<string, LatencySamples> experiments;
+		// test whether the prefetcher detects backwards iteration
+		experiments.emplace("backwards", run_experiment(1, (size_t)-1, 120, 0, 0, 0, 121));
+		experiments.emplace("backwards-ref", run_experiment(1, (size_t)-1, 120, 0, 0xcafebabe, 0, 121));
+
+		// test whether prefetching depends on pc (training loop unrolled)
+		LatencySamples pc_dependence (PARR_NO_REPETITIONS, keep_raw_samples);
+		parr_run_pc_experiment(PARR_NO_REPETITIONS, pc_dependence.record(), 0);
+		LatencySamples pc_dependence_ref (PARR_NO_REPETITIONS, keep_raw_samples);
+		parr_run_pc_experiment(PARR_NO_REPETITIONS, pc_dependence_ref.record(), PARR_BLIND_KEY);
+		// same, but instructions on different pages at different offsets
+		LatencySamples pc_dependence_align (PARR_NO_REPETITIONS, keep_raw_samples);
+		parr_run_pc_align_experiment(PARR_NO_REPETITIONS, pc_dependence_align.record(), 0);
+		LatencySamples pc_dependence_align_ref (PARR_NO_REPETITIONS, keep_raw_samples);
+		parr_run_pc_align_experiment(PARR_NO_REPETITIONS, pc_dependence_align_ref.record(), PARR_BLIND_KEY);
+		experiments.emplace("pc-dependence", pc_dependence);
+		experiments.emplace("pc-dependence-ref", pc_dependence_ref);
+		experiments.emplace("pc-dependence-align", pc_dependence_align);
+		experiments.emplace("pc-dependence-align-ref", pc_dependence_align_ref);
+
+		Json::object results;
+		for (pair<string const, LatencySamples> const& experiment : experiments) {
+			results[experiment.first] = experiment.second.summary_to_json();
+		}
+		Json::object sweeps;
+
+		// test different amounts of training pointers
+		vector<int64_t> training_pointers;
+		for (int64_t o = 1; o <= 16; o++) {
+			training_pointers.push_back(o);
+		}
+		sweeps["training-pointers"] = sweep(training_pointers, [&](int64_t o) {
+			return run_experiment(8, 8, o, o, 0, 0, 0);
+		});
+
+		// test different measurement offsets (in bytes) from the
+		// (possibly) prefetched pointer
+		vector<int64_t> target_offsets;
+		for (int64_t o = -512; o <= 512; o += 8) {
+			target_offsets.push_back(o);
+		}
+		sweeps["target-offset"] = sweep(target_offsets, [&](int64_t o) {
+			return run_experiment(1, 1, 120, 120, 0, (uint64_t)o, 0);
+		});
+
+		// test different offsets from the last training pointer to the
+		// measured pointer
+		vector<int64_t> pointer_array_offsets;
+		for (int64_t o = 0; o <= 256; o++) {
+			pointer_array_offsets.push_back(o);
+		}
+		sweeps["pointer-array-offset"] = sweep(pointer_array_offsets, [&](int64_t o) {
+			return run_experiment(1, 1, 120, 120 + o, 0, 0, 0);
+		});
+
+		// test different space between pointers (in multiples of 8 bytes)
+		vector<int64_t> pointer_array_spaces;
+		for (int64_t o = 1; o <= 128; o++) {
+			pointer_array_spaces.push_back(o);
+		}
+		sweeps["pointer-array-space"] = sweep(pointer_array_spaces, [&](int64_t o) {
+			return run_experiment(o, o, 120, 120, 0, 0, 0);
+		});
+
+		string dump_filename = "trace-parr_characterize.json";
+		dump(experiments, sweeps, dump_filename);
+		plot_parr(string{__FUNCTION__}, {dump_filename});
+
+		for (pair<string const, Json> const& sweep_result : sweeps) {
+			results[sweep_result.first] = sweep_result.second;
+		}
+		return results;
 	}
-};
\ No newline at end of file
+};
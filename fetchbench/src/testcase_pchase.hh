@@ -7,89 +7,120 @@
 
 #include "testcase.hh"
 #include "cacheutils.hh"
+#include "latency_samples.hh"
 #include "mapping.hh"
+#include "msr_controller.hh"
 #include "logger.hh"
+#include "search.hh"
+#include "pchase/pchase.h"
 
 using std::string;
 
+// Number of repetitions per linked list length (per attempt during the
+// search in identify())
+#define PCHASE_NO_REPETITIONS 5000
+
 class TestCasePointerChase : public TestCaseBase {
 private:
-	int const cpu_bin;
-	int const cpu_ctrthread;
+	// shortest linked list after which the next element was prefetched
+	// (set by identify())
+	size_t min_chain_length = 0;
+	// summaries of the lengths probed by the search in identify() (latest
+	// attempt per length)
+	map<size_t, Json> probe_summaries;
+
 public:
-	TestCasePointerChase(int cpu_bin, int cpu_ctrthread)
-	: cpu_bin {cpu_bin}
-	, cpu_ctrthread {cpu_ctrthread}
-	{}
+	TestCasePointerChase() {}
 
 	virtual string id() override {
 		return "pchase";
 	}
-	
+
 protected:
 	virtual Json pre_test() override {
-		// stop global counter thread (if enabled). The external binary will
-		// start its own.
-		clock_teardown();
 		// make sure all prefetchers are enabled
 		architecture_t arch = get_arch();
 		if (arch == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, true);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
 		}
+		pchase_seed(random_uint32(1, std::numeric_limits<uint32_t>::max()));
 		return Json::object {};
 	}
 
 	virtual Json post_test() override {
-		// restart global counter thread (if enabled)
-		clock_init(cpu_ctrthread);
 		if (get_arch() == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, true);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
 		}
 		return Json::object {};
 	}
-	
+
+	/**
+	 * Runs the pointer chasing experiment for one linked list length.
+	 *
+	 * @param[in]  entries         The length of the linked list
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     The samples.
+	 */
+	LatencySamples run_experiment(size_t entries, size_t no_repetitions) {
+		LatencySamples samples (no_repetitions);
+		pchase_run_experiment(entries, no_repetitions, samples.record());
+		return samples;
+	}
+
 	virtual Json identify() override {
-		size_t no_repetitions = 5000;
-
-		L::info("Calling external binary...\n");
-		fflush(stdout);
-		pid_t pid = fork();
-		switch(pid) {
-			case -1:
-				perror("fork() failed.");
-				exit(EXIT_FAILURE);
-			case 0: { // child
-				#ifdef COUNTER_THREAD
-					pin_process_to_cpu(0, cpu_bin, cpu_ctrthread);
-				#else
-					pin_process_to_cpu(0, cpu_bin);
-				#endif
-				std::string no_repetitions_str = std::to_string(no_repetitions);
-				vector<char const *> argv {"sh", "runner_pchase.sh", no_repetitions_str.c_str(), NULL};
-				execvp(const_cast<char* const>(argv.data()[0]), const_cast<char* const*>(argv.data()));
-				break;
-			}
-			default: // parent
-				L::info("Waiting for external binary to finish...\n");
-				waitpid(pid, NULL, 0);
-				break;
+		// Once the element after the end of the traversal gets prefetched
+		// for some length, it also gets prefetched for longer lists. So
+		// instead of measuring every length, we search the last length
+		// without a prefetch with find_boundary().
+		probe_summaries.clear();
+		probe_func_t no_prefetch = [&](size_t entries, size_t attempt) -> verdict_t {
+			LatencySamples samples = run_experiment(entries, PCHASE_NO_REPETITIONS * (attempt + 1));
+			verdict_t verdict = samples.verdict();
+			L::debug("pchase length %zu: %s\n", entries, verdict_to_string(verdict));
+			probe_summaries[entries] = samples.summary_to_json();
+			return negate_verdict(verdict);
+		};
+		BoundarySearchResult search = find_boundary(0, pchase_max_entries() - 1, no_prefetch);
+		Json::object summaries_json;
+		for (pair<size_t const, Json> const& probe_summary : probe_summaries) {
+			summaries_json[std::to_string(probe_summary.first)] = probe_summary.second;
 		}
-		L::info("External binary finished.\n");
 
-		plot_pchase("pchase", "pchase.log");
+		bool identified = ! search.holds_across_range;
+		if (identified) {
+			min_chain_length = search.holds_at_lower ? search.last_true + 1 : 0;
+		}
 
-		// TODO: Separate identification and characterization properly
-		// TODO: Automatically determine whether identification was successful or not
-		return {};
+		return Json::object {
+			{"identified", identified},
+			{"min_chain_length", (int)min_chain_length},
+			{"search", boundary_search_to_json(search)},
+			{"summaries", summaries_json},
+		};
 	}
-	
+
 	virtual Json characterize() override {
-		return {};
+		// profile of the lengths probed by the search (for plotting),
+		// instead of measuring all lengths again
+		Json::array lengths_json;
+		Json::array summaries_json;
+		for (pair<size_t const, Json> const& probe_summary : probe_summaries) {
+			lengths_json.push_back((int)probe_summary.first);
+			summaries_json.push_back(probe_summary.second);
+		}
+
+		Json sweep_json = Json::object {
+			{"params", lengths_json},
+			{"summaries", summaries_json},
+		};
+		string dump_filename = "trace-pchase_characterize.json";
+		json_dump_to_file(Json::object {{"sweeps", Json::object {{"chain-length", sweep_json}}}}, dump_filename);
+		plot_pchase(string{__FUNCTION__}, {dump_filename});
+
+		return Json::object {
+			{"min_chain_length", (int)min_chain_length},
+			{"chain-length", sweep_json},
+		};
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "testcase.hh"
+#include "cacheutils.hh"
+#include "logger.hh"
+#include "utils.hh"
+#include "mapping.hh"
+#include "msr_controller.hh"
+#include "latency_bands.hh"
+#include "search.hh"
+
+#include "testcase_pollution_pollutionexperiment.hh"
+
+using json11::Json;
+using std::string;
+using std::vector;
+
+/**
+ * Test case for the harm done by prefetchers: useless prefetches that
+ * evict useful lines. A working set of half the L2 cache is kept resident
+ * while an interfering pattern (stream, stride, region) runs; the
+ * working set lines evicted with the pattern in order are compared with
+ * the ones evicted with the same lines in random order, which the
+ * prefetchers cannot predict (see PollutionExperiment). The pollution
+ * cost of a pattern is the number of extra evicted working set lines per
+ * access of the pattern.
+ *
+ * Pattern-independent prefetches (e.g., adjacent line prefetches on every
+ * miss) happen in both orders and do not count.
+ */
+class TestCasePollution : public TestCaseBase {
+private:
+	size_t const fr_thresh;
+	size_t const noise_thresh;
+	bool const use_nanosleep;
+	vector<pollution_pattern_t> const patterns;
+
+public:
+	TestCasePollution(size_t fr_thresh, size_t noise_thresh, bool use_nanosleep, vector<pollution_pattern_t> patterns)
+	: fr_thresh {fr_thresh}
+	, noise_thresh {noise_thresh}
+	, use_nanosleep {use_nanosleep}
+	, patterns {patterns}
+	{}
+
+	virtual string id() override {
+		return "pollution";
+	}
+
+private:
+	/**
+	 * Returns the number of lines of the working set: half of the L2
+	 * cache, or POLLUTION_DEFAULT_WORKING_SET_SIZE if its size is unknown.
+	 */
+	static size_t working_set_lines() {
+		size_t l2_size = LatencyBands::get().get_l2_size();
+		return ((l2_size != 0) ? l2_size / 2 : POLLUTION_DEFAULT_WORKING_SET_SIZE) / CACHE_LINE_SIZE;
+	}
+
+	// ========== TESTS ==============
+
+	/**
+	 * Measures the pollution caused by an interfering pattern.
+	 *
+	 * @param      working_set       The working set mapping
+	 * @param[in]  pattern           The pattern
+	 * @param[in]  pattern_accesses  The number of accesses of the pattern
+	 * @param[in]  no_repetitions    Number of repetitions (half of them
+	 *                               with the control)
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_pollution(Mapping const& working_set, pollution_pattern_t pattern, size_t pattern_accesses, size_t no_repetitions) {
+		char const* name = pollution_pattern_to_string(pattern);
+		L::info("Test: %s (%s, %zu accesses)\n", __FUNCTION__, name, pattern_accesses);
+		PollutionExperiment experiment { pattern, working_set.size / CACHE_LINE_SIZE, pattern_accesses, use_nanosleep, fr_thresh, noise_thresh };
+		Mapping pattern_mapping = allocate_mapping(experiment.pattern_mapping_size());
+		CacheHistogram cache_histogram = experiment.collect_cache_histogram(working_set, pattern_mapping, no_repetitions);
+		unmap_mapping(pattern_mapping);
+		experiment.dump(cache_histogram, "trace-pollution-" + string {name} + "-accesses_" + zero_pad(pattern_accesses, 5) + ".json");
+
+		verdict_t verdict = experiment.evaluate(cache_histogram);
+		double cost = experiment.pollution_cost(cache_histogram);
+		L::debug("%s: evicted %.4f (ordered) vs. %.4f (control) -> %s, cost %.4f\n", name,
+			experiment.eviction_rate(cache_histogram, PollutionExperiment::SLOT_ORDERED),
+			experiment.eviction_rate(cache_histogram, PollutionExperiment::SLOT_CONTROL),
+			verdict_to_string(verdict), cost);
+		return Json::object {
+			{"status", "completed"},
+			{"pattern_accesses", (int)pattern_accesses},
+			{"eviction_rate_ordered", experiment.eviction_rate(cache_histogram, PollutionExperiment::SLOT_ORDERED)},
+			{"eviction_rate_control", experiment.eviction_rate(cache_histogram, PollutionExperiment::SLOT_CONTROL)},
+			{"verdict", verdict_to_string(verdict)},
+			{"polluting", verdict == VERDICT_YES},
+			{"pollution_cost", cost},
+		};
+	}
+
+	/**
+	 * Measures the pollution of a pattern for an increasing number of
+	 * accesses (1/16 to 1 times the working set).
+	 *
+	 * @param      working_set     The working set mapping
+	 * @param[in]  pattern         The pattern
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_pattern_length(Mapping const& working_set, pollution_pattern_t pattern, size_t no_repetitions) {
+		L::info("Test: %s (%s)\n", __FUNCTION__, pollution_pattern_to_string(pattern));
+		size_t no_lines = working_set.size / CACHE_LINE_SIZE;
+		Json::object results;
+		Json::object costs;
+		for (size_t divisor : {16, 8, 4, 2, 1}) {
+			Json result = test_pollution(working_set, pattern, no_lines / divisor, no_repetitions);
+			results[std::to_string(no_lines / divisor)] = result;
+			costs[std::to_string(no_lines / divisor)] = result["pollution_cost"];
+		}
+		return Json::object {
+			{"status", "completed"},
+			{"pollution_cost_per_accesses", costs},
+			{"results", results},
+		};
+	}
+
+protected:
+	virtual Json pre_test() override {
+		architecture_t arch = get_arch();
+		if (arch == ARCH_INTEL) {
+			// measure the harm of all prefetchers (use matrix mode to
+			// attribute it)
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
+		} else if (arch == ARCH_ARM) {
+		}
+		return Json::object {
+			{"architecture", arch},
+			{"working_set_lines", (int)working_set_lines()},
+		};
+	}
+
+	virtual Json post_test() override {
+		return Json::object {};
+	}
+
+	virtual Json identify() override {
+		size_t no_repetitions = 200;
+		Mapping working_set = allocate_mapping(working_set_lines() * CACHE_LINE_SIZE);
+		Json::object results;
+		Json::object costs;
+		bool identified = false;
+		for (pollution_pattern_t pattern : patterns) {
+			Json result = test_pollution(working_set, pattern, working_set_lines() / 2, no_repetitions);
+			results[pollution_pattern_to_string(pattern)] = result;
+			costs[pollution_pattern_to_string(pattern)] = result["pollution_cost"];
+			identified |= result["polluting"].bool_value();
+		}
+		unmap_mapping(working_set);
+
+		return Json::object {
+			{ "identified", identified },
+			{ "pollution_cost", costs },
+			{ "test_pollution", results },
+		};
+	}
+
+	virtual Json characterize() override {
+		size_t no_repetitions = 200;
+		Mapping working_set = allocate_mapping(working_set_lines() * CACHE_LINE_SIZE);
+		Json::object results;
+		for (pollution_pattern_t pattern : patterns) {
+			results[pollution_pattern_to_string(pattern)] = test_pattern_length(working_set, pattern, no_repetitions);
+		}
+		unmap_mapping(working_set);
+
+		return Json::object {
+			{ "test_pattern_length", results },
+		};
+	}
+};
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+
+#include "testcase_pollution_pollutionexperiment.hh"
+#include "logger.hh"
+
+using json11::Json;
+using std::vector;
+
+char const* pollution_pattern_to_string(pollution_pattern_t pattern) {
+	switch (pattern) {
+		case POLLUTION_STREAM: return "stream";
+		case POLLUTION_STRIDE: return "stride";
+		case POLLUTION_REGION: return "region";
+		default: return "unknown";
+	}
+}
+
+/**
+ * Parses the interfering patterns of the pollution testcase.
+ *
+ * @param      spec  "all", or a comma-separated list of pattern names
+ *                   (see pollution_pattern_to_string())
+ *
+ * @return     The patterns (without duplicates). Exits on invalid input.
+ */
+vector<pollution_pattern_t> parse_pollution_patterns(string const& spec) {
+	vector<pollution_pattern_t> patterns;
+	if (spec == "all") {
+		for (size_t pattern = 0; pattern < NO_POLLUTION_PATTERNS; pattern++) {
+			patterns.push_back((pollution_pattern_t)pattern);
+		}
+		return patterns;
+	}
+	std::istringstream stream {spec};
+	string item;
+	while (std::getline(stream, item, ',')) {
+		bool found = false;
+		for (size_t pattern = 0; pattern < NO_POLLUTION_PATTERNS; pattern++) {
+			if (item == pollution_pattern_to_string((pollution_pattern_t)pattern)) {
+				if (std::find(patterns.begin(), patterns.end(), (pollution_pattern_t)pattern) == patterns.end()) {
+					patterns.push_back((pollution_pattern_t)pattern);
+				}
+				found = true;
+			}
+		}
+		if ( ! found) {
+			L::err("Invalid pollution pattern \"%s\" (must be stream, stride or region)\n", item.c_str());
+			exit(1);
+		}
+	}
+	return patterns;
+}
+
+PollutionExperiment::PollutionExperiment(pollution_pattern_t pattern, size_t working_set_lines, size_t pattern_accesses, bool use_nanosleep, size_t fr_thresh, size_t noise_thresh)
+: pattern {pattern}
+, working_set_lines {working_set_lines}
+, pattern_accesses {pattern_accesses}
+, use_nanosleep {use_nanosleep}
+, fr_thresh {fr_thresh}
+, noise_thresh {noise_thresh}
+, t_req { .tv_sec = 0, .tv_nsec = 1000 /* 1µs */ }
+{
+	size_t const lines_per_page = PAGE_SIZE / CACHE_LINE_SIZE;
+	vector<size_t> region_lines(lines_per_page);
+	std::iota(region_lines.begin(), region_lines.end(), 0);
+	std::shuffle(region_lines.begin(), region_lines.end(), *get_rng());
+	region_lines.resize(POLLUTION_REGION_LINES);
+	std::sort(region_lines.begin(), region_lines.end());
+
+	for (size_t idx = 0; idx < pattern_accesses; idx++) {
+		size_t line = 0;
+		switch (pattern) {
+			case POLLUTION_STREAM:
+				line = idx;
+				break;
+			case POLLUTION_STRIDE:
+				line = idx * POLLUTION_STRIDE_LINES;
+				break;
+			default:
+				line = (idx / POLLUTION_REGION_LINES) * lines_per_page + region_lines[idx % POLLUTION_REGION_LINES];
+				break;
+		}
+		ordered_offsets.push_back(line * CACHE_LINE_SIZE);
+	}
+	control_offsets = ordered_offsets;
+	std::shuffle(control_offsets.begin(), control_offsets.end(), *get_rng());
+	// the lines between and after the accessed ones (may be prefetched)
+	// are part of the mapping, rounded up to pages
+	pattern_size = (ordered_offsets.back() / PAGE_SIZE + 2) * PAGE_SIZE;
+
+	for (size_t line = 0; line < working_set_lines; line++) {
+		working_set_offsets.push_back(line * CACHE_LINE_SIZE);
+	}
+	std::shuffle(working_set_offsets.begin(), working_set_offsets.end(), *get_rng());
+}
+
+/**
+ * Collects a cache histogram of the working set probes. In each
+ * repetition, the pattern lines (incl. the ones in between) are flushed,
+ * the working set is loaded (twice), the pattern runs (in order in even
+ * repetitions, in random order in odd ones), and all working set lines
+ * are probed. The probes of a repetition are kept only if the pattern and
+ * the probes were not disturbed.
+ *
+ * @param      working_set      The working set mapping (at least
+ *                              working_set_lines lines)
+ * @param      pattern_mapping  The pattern mapping (at least
+ *                              pattern_mapping_size())
+ * @param[in]  no_repetitions   Number of repetitions
+ *
+ * @return     Cache histogram (slots SLOT_ORDERED and SLOT_CONTROL, hit:
+ *             not evicted)
+ */
+CacheHistogram PollutionExperiment::collect_cache_histogram(Mapping const& working_set, Mapping const& pattern_mapping, size_t no_repetitions) {
+	assert(working_set.size >= working_set_lines * CACHE_LINE_SIZE);
+	assert(pattern_mapping.size >= pattern_size);
+
+	CacheHistogram cache_histogram (2);
+	vector<probe_result_t> results (working_set_lines);
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
+	for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+		size_t slot = (repetition % 2 == 0) ? SLOT_ORDERED : SLOT_CONTROL;
+		vector<size_t> const& pattern_offsets = (slot == SLOT_ORDERED) ? ordered_offsets : control_offsets;
+
+		for (size_t offset = 0; offset < pattern_size; offset += CACHE_LINE_SIZE) {
+			flush(pattern_mapping.base_addr + offset);
+		}
+		mfence();
+
+		for (size_t round = 0; round < 2; round++) {
+			for (size_t offset : working_set_offsets) {
+				maccess(working_set.base_addr + offset);
+			}
+		}
+		mfence();
+
+		noise_monitor.begin_window();
+
+		for (size_t offset : pattern_offsets) {
+			maccess(pattern_mapping.base_addr + offset);
+		}
+		mfence();
+
+		// sleep a while to give the prefetcher some time to work
+		if (use_nanosleep) {
+			nanosleep(&t_req, &t_rem);
+		}
+
+		for (size_t idx = 0; idx < working_set_lines; idx++) {
+			results[idx] = probe_single(working_set.base_addr + working_set_offsets[idx]);
+		}
+		if (noise_monitor.end_window(noise_stats)) {
+			for (probe_result_t const& result : results) {
+				cache_histogram.record(slot, result);
+			}
+		}
+	}
+	return cache_histogram;
+}
+
+/**
+ * Returns the fraction of evicted working set lines.
+ *
+ * @param      cache_histogram  The cache histogram
+ * @param[in]  slot             SLOT_ORDERED or SLOT_CONTROL
+ *
+ * @return     The fraction (0 if there are no probes).
+ */
+double PollutionExperiment::eviction_rate(CacheHistogram const& cache_histogram, size_t slot) const {
+	size_t probes = cache_histogram.probe_count(slot);
+	return (probes > 0) ? (double)(probes - cache_histogram.hit_count(slot)) / probes : 0;
+}
+
+/**
+ * Decides whether the ordered pattern evicts significantly more working
+ * set lines than the control, i.e., whether its prefetches pollute the
+ * cache. In addition to the z-test of compare_proportions(), the
+ * eviction rate has to exceed the one of the control by
+ * POLLUTION_MIN_EVICTION_INCREASE.
+ *
+ * @param      cache_histogram  The cache histogram
+ *
+ * @return     The verdict.
+ */
+verdict_t PollutionExperiment::evaluate(CacheHistogram const& cache_histogram) const {
+	size_t ordered_probes = cache_histogram.probe_count(SLOT_ORDERED);
+	size_t control_probes = cache_histogram.probe_count(SLOT_CONTROL);
+	verdict_t verdict = compare_proportions(
+		ordered_probes - cache_histogram.hit_count(SLOT_ORDERED), ordered_probes,
+		control_probes - cache_histogram.hit_count(SLOT_CONTROL), control_probes
+	);
+	if (verdict == VERDICT_YES && eviction_rate(cache_histogram, SLOT_ORDERED) - eviction_rate(cache_histogram, SLOT_CONTROL) < POLLUTION_MIN_EVICTION_INCREASE) {
+		return VERDICT_NO;
+	}
+	return verdict;
+}
+
+/**
+ * Returns the pollution cost of the pattern: the working set lines the
+ * ordered pattern evicts in addition to the control, per access of the
+ * pattern (negative if the control evicts more).
+ *
+ * @param      cache_histogram  The cache histogram
+ *
+ * @return     The cost.
+ */
+double PollutionExperiment::pollution_cost(CacheHistogram const& cache_histogram) const {
+	double extra_evictions = (eviction_rate(cache_histogram, SLOT_ORDERED) - eviction_rate(cache_histogram, SLOT_CONTROL)) * working_set_lines;
+	return extra_evictions / pattern_accesses;
+}
+
+/**
+ * Dumps the experiment and the cache histogram to a JSON file.
+ *
+ * @param      cache_histogram  The cache histogram
+ * @param      filepath         The file path to the JSON file
+ */
+void PollutionExperiment::dump(CacheHistogram const& cache_histogram, string const& filepath) const {
+	Json j = Json::object {
+		{ "pattern", pollution_pattern_to_string(pattern) },
+		{ "working_set_lines", (int)working_set_lines },
+		{ "pattern_accesses", (int)pattern_accesses },
+		{ "pattern_size", (int)pattern_size },
+		{ "use_nanosleep", use_nanosleep },
+		{ "fr_thresh", (int)fr_thresh },
+		{ "noise_thresh", (int)noise_thresh },
+		{ "eviction_rate_ordered", eviction_rate(cache_histogram, SLOT_ORDERED) },
+		{ "eviction_rate_control", eviction_rate(cache_histogram, SLOT_CONTROL) },
+		{ "cache_histogram_hits", cache_histogram.hits_to_json() },
+		{ "cache_histogram_probes", cache_histogram.probes_to_json() },
+		{ "cache_histogram_levels", cache_histogram.levels_to_json() },
+		{ "probe_fr_thresh", (int)probe_fr_thresh },
+		{ "noise", noise_stats.to_json() },
+		{ "numa_node", get_mapping_numa_node() },
+	};
+	json_dump_to_file(j, filepath);
+}
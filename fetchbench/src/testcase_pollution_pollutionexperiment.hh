@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cinttypes>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "json11.hpp"
+
+#include "utils.hh"
+#include "cacheutils.hh"
+#include "mapping.hh"
+#include "cache_histogram.hh"
+#include "noise_monitor.hh"
+#include "frequency_guard.hh"
+#include "search.hh"
+
+using json11::Json;
+using std::string;
+using std::vector;
+
+// Stride of the stride pattern in cache lines
+#define POLLUTION_STRIDE_LINES 4
+// Lines per page accessed by the region pattern
+#define POLLUTION_REGION_LINES 8
+// Working set size if the L2 size is unknown
+#define POLLUTION_DEFAULT_WORKING_SET_SIZE (128 * 1024)
+// Minimum increase of the fraction of evicted working set lines (over the
+// control) to count a pattern as polluting
+#define POLLUTION_MIN_EVICTION_INCREASE 0.01
+
+typedef enum {
+	// consecutive lines
+	POLLUTION_STREAM = 0,
+	// every POLLUTION_STRIDE_LINES-th line
+	POLLUTION_STRIDE = 1,
+	// the same POLLUTION_REGION_LINES lines of each page
+	POLLUTION_REGION = 2,
+	NO_POLLUTION_PATTERNS = 3,
+} pollution_pattern_t;
+
+char const* pollution_pattern_to_string(pollution_pattern_t pattern);
+vector<pollution_pattern_t> parse_pollution_patterns(string const& spec);
+
+/**
+ * Experiment for cache pollution by prefetches. A working set that fits
+ * into the L2 cache is loaded, then an interfering pattern accesses
+ * other lines, then every working set line is probed (in random order)
+ * to count the lines that were evicted from the L2 (served from the LLC or
+ * DRAM, or missing the caches if the latency bands are not calibrated).
+ *
+ * Each repetition runs the pattern either in order (the prefetchers can
+ * detect it) or in a random order of the same lines (control: same
+ * demand fills, but no pattern to prefetch), alternately. Extra evictions
+ * in order are caused by the prefetches of the pattern.
+ *
+ * The cache histogram of the experiment has two slots: the working set
+ * probes after the ordered pattern (0) and after the control (1); a probe
+ * counts as a hit if the line was not evicted.
+ */
+class PollutionExperiment {
+public:
+	pollution_pattern_t const pattern;
+	// number of lines of the working set
+	size_t const working_set_lines;
+	// number of accesses of the pattern
+	size_t const pattern_accesses;
+	// wait before probing or not
+	bool const use_nanosleep;
+	// Flush+Reload threshold
+	size_t const fr_thresh;
+	// Flush+Reload noise threshold
+	size_t const noise_thresh;
+	// structs for nanosleep
+	struct timespec const t_req;
+	struct timespec t_rem;
+	// repetitions discarded because of noise (see NoiseMonitor)
+	NoiseStats noise_stats;
+	// Flush+Reload threshold used by the last collection (fr_thresh,
+	// scaled if the frequency changed, see FrequencyGuard)
+	size_t probe_fr_thresh = 0;
+
+	static size_t const SLOT_ORDERED = 0;
+	static size_t const SLOT_CONTROL = 1;
+
+private:
+	// offsets of the pattern in order and shuffled (same lines)
+	vector<size_t> ordered_offsets;
+	vector<size_t> control_offsets;
+	// offsets of the working set lines (shuffled)
+	vector<size_t> working_set_offsets;
+	size_t pattern_size;
+
+public:
+	PollutionExperiment(pollution_pattern_t pattern, size_t working_set_lines, size_t pattern_accesses, bool use_nanosleep, size_t fr_thresh, size_t noise_thresh);
+
+	inline size_t pattern_mapping_size() const {
+		return pattern_size;
+	}
+
+private:
+	inline probe_result_t probe_single(uint8_t* ptr) const __attribute__((always_inline)) {
+		size_t time = flush_reload_t(ptr);
+		cache_level_t level = LatencyBands::get().classify(time);
+		bool evicted = (level == CACHE_LEVEL_UNKNOWN) ? (time >= probe_fr_thresh) : (level > CACHE_LEVEL_L2);
+		return { ! evicted, level };
+	}
+
+public:
+	CacheHistogram collect_cache_histogram(Mapping const& working_set, Mapping const& pattern_mapping, size_t no_repetitions);
+
+	double eviction_rate(CacheHistogram const& cache_histogram, size_t slot) const;
+	verdict_t evaluate(CacheHistogram const& cache_histogram) const;
+	double pollution_cost(CacheHistogram const& cache_histogram) const;
+
+	void dump(CacheHistogram const& cache_histogram, string const& filepath) const;
+};
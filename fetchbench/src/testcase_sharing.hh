@@ -0,0 +1,271 @@
+#pragma once
+
+#include <sched.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "testcase.hh"
+#include "cacheutils.hh"
+#include "logger.hh"
+#include "utils.hh"
+#include "mapping.hh"
+#include "msr_controller.hh"
+#include "search.hh"
+#include "topology.hh"
+
+#include "testcase_sharing_sharingexperiment.hh"
+
+using json11::Json;
+using std::pair;
+using std::string;
+using std::vector;
+
+// Column of the measuring CPU itself (before the topology levels)
+#define SHARING_SELF "self"
+
+/**
+ * Test case for sharing of prefetcher state between logical CPUs: SMT
+ * siblings, cores that share the L2 cache (clusters, e.g., Cortex-A72 or
+ * Apple M1), cores that share only the last-level cache, and cores that
+ * share no cache.
+ *
+ * A stream and a stride pattern are trained by a partner thread on a CPU
+ * of each topology level (see SharingExperiment, SharingPartner). Two
+ * things are tested per level:
+ * - tables: the measuring CPU removes the trained lines, accesses the
+ *   next element of the pattern and probes the elements after it. If
+ *   they are prefetched more often than without the training, the
+ *   prefetcher of the measuring CPU uses the state trained by the
+ *   partner.
+ * - fills: the partner also accesses the next element, the measuring CPU
+ *   probes the elements after it. If they are cached more often than
+ *   untouched lines, the lines the partner's prefetcher fetched are
+ *   visible to the measuring CPU (and the latency tells from which
+ *   level).
+ * Training on the measuring CPU itself is the positive control; the
+ * testcase is identified if it prefetches the pattern after the flush.
+ */
+class TestCaseSharing : public TestCaseBase {
+private:
+	size_t const fr_thresh;
+	size_t const noise_thresh;
+	bool const use_nanosleep;
+	Topology const topology;
+	// CPU of the counter thread (not used as partner), -1 if there is none
+	int const ctr_cpu;
+	// measuring CPU and partner CPU per topology level (-1: none),
+	// determined in pre_test()
+	int measurement_cpu = -1;
+	int partner_cpus[NO_TOPOLOGY_LEVELS];
+
+	static vector<pair<string, size_t>> patterns() {
+		return { {"stream", 1}, {"stride", 3} };
+	}
+
+public:
+	TestCaseSharing(size_t fr_thresh, size_t noise_thresh, bool use_nanosleep, Topology const& topology, int ctr_cpu)
+	: fr_thresh {fr_thresh}
+	, noise_thresh {noise_thresh}
+	, use_nanosleep {use_nanosleep}
+	, topology {topology}
+	#if defined(COUNTER_THREAD)
+	, ctr_cpu {ctr_cpu}
+	#else
+	, ctr_cpu {-1}
+	#endif
+	{
+		std::fill(std::begin(partner_cpus), std::end(partner_cpus), -1);
+	}
+
+	virtual string id() override {
+		return "sharing";
+	}
+
+private:
+	/**
+	 * Trains a pattern on a CPU and checks whether the prefetcher tables
+	 * and the prefetched lines are shared with the measuring CPU.
+	 *
+	 * @param      mapping             The mapping
+	 * @param      experiment          The experiment (pattern)
+	 * @param      pattern             The pattern name
+	 * @param      baseline_histogram  The histogram of the baseline (no
+	 *                                 training)
+	 * @param[in]  column              The topology level or SHARING_SELF
+	 * @param[in]  partner_cpu         The CPU to train on (-1: the
+	 *                                 measuring CPU)
+	 * @param[in]  no_repetitions      Number of repetitions
+	 *
+	 * @return     JSON structure describing the result.
+	 */
+	Json test_sharing(Mapping const& mapping, SharingExperiment& experiment, string const& pattern, CacheHistogram const& baseline_histogram, string const& column, int partner_cpu, size_t no_repetitions) {
+		L::info("Test: %s (%s, %s, CPU %d)\n", __FUNCTION__, pattern.c_str(), column.c_str(), (partner_cpu == -1) ? measurement_cpu : partner_cpu);
+		std::unique_ptr<SharingPartner> partner;
+		if (partner_cpu != -1) {
+			partner.reset(new SharingPartner {partner_cpu});
+		}
+
+		CacheHistogram tables_histogram = experiment.collect_cache_histogram(mapping, SHARING_MODE_TABLES, partner.get(), no_repetitions);
+		experiment.dump(tables_histogram, SHARING_MODE_TABLES, partner_cpu, "trace-sharing-" + pattern + "-tables-" + column + ".json");
+		verdict_t tables = experiment.compare_slots(tables_histogram, experiment.signal_slots(), baseline_histogram, experiment.signal_slots());
+
+		CacheHistogram fills_histogram = experiment.collect_cache_histogram(mapping, SHARING_MODE_FILLS, partner.get(), no_repetitions);
+		experiment.dump(fills_histogram, SHARING_MODE_FILLS, partner_cpu, "trace-sharing-" + pattern + "-fills-" + column + ".json");
+		verdict_t fills = experiment.compare_slots(fills_histogram, experiment.signal_slots(), fills_histogram, experiment.reference_slots());
+		cache_level_t fill_level = fills_histogram.fill_level(experiment.signal_slots()[0]);
+
+		L::debug("%s, %s: tables %s, fills %s (%s)\n", pattern.c_str(), column.c_str(), verdict_to_string(tables), verdict_to_string(fills), cache_level_to_string(fill_level));
+		return Json::object {
+			{"status", "completed"},
+			{"partner_cpu", (partner_cpu == -1) ? measurement_cpu : partner_cpu},
+			{"tables_verdict", verdict_to_string(tables)},
+			{"tables_shared", tables == VERDICT_YES},
+			{"fills_verdict", verdict_to_string(fills)},
+			{"fills_shared", fills == VERDICT_YES},
+			{"fill_level", cache_level_to_string(fill_level)},
+		};
+	}
+
+	/**
+	 * Runs test_sharing() for each pattern on the measuring CPU and on the
+	 * partner of each given topology level.
+	 *
+	 * @param      mapping         The mapping
+	 * @param[in]  levels          The topology levels
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure with the results per pattern and column.
+	 */
+	Json test_patterns(Mapping const& mapping, vector<topology_level_t> const& levels, size_t no_repetitions) {
+		Json::object results;
+		for (pair<string, size_t> const& pattern : patterns()) {
+			SharingExperiment experiment { pattern.second, use_nanosleep, fr_thresh, noise_thresh };
+			CacheHistogram baseline_histogram = experiment.collect_cache_histogram(mapping, SHARING_MODE_BASELINE, nullptr, no_repetitions);
+			experiment.dump(baseline_histogram, SHARING_MODE_BASELINE, -1, "trace-sharing-" + pattern.first + "-baseline.json");
+
+			Json::object columns;
+			columns[SHARING_SELF] = test_sharing(mapping, experiment, pattern.first, baseline_histogram, SHARING_SELF, -1, no_repetitions);
+			for (topology_level_t level : levels) {
+				string column = topology_level_to_string(level);
+				if (partner_cpus[level] == -1) {
+					columns[column] = Json::object {
+						{"status", "no CPU at this topology level"},
+					};
+					continue;
+				}
+				columns[column] = test_sharing(mapping, experiment, pattern.first, baseline_histogram, column, partner_cpus[level], no_repetitions);
+			}
+			results[pattern.first] = columns;
+		}
+		return results;
+	}
+
+protected:
+	virtual Json pre_test() override {
+		measurement_cpu = sched_getcpu();
+		Json::object partners;
+		for (size_t level = 0; level < NO_TOPOLOGY_LEVELS; level++) {
+			partner_cpus[level] = topology.select_partner_cpu(measurement_cpu, (topology_level_t)level, ctr_cpu);
+			partners[topology_level_to_string((topology_level_t)level)] = partner_cpus[level];
+		}
+		architecture_t arch = get_arch();
+		if (arch == ARCH_INTEL) {
+			// the prefetchers of the partners train as well
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
+			for (int cpu : partner_cpus) {
+				if (cpu != -1) {
+					set_intel_prefetchers(cpu, INTEL_ALL_PREFETCHERS);
+				}
+			}
+		} else if (arch == ARCH_ARM) {
+		}
+		return Json::object {
+			{"architecture", arch},
+			{"measurement_cpu", measurement_cpu},
+			{"partner_cpus", partners},
+		};
+	}
+
+	virtual Json post_test() override {
+		return Json::object {};
+	}
+
+	virtual Json identify() override {
+		size_t no_repetitions = 2000;
+		Mapping mapping = allocate_mapping(SharingExperiment::mapping_size());
+		flush_mapping(mapping);
+		Json results = test_patterns(mapping, {}, no_repetitions);
+		unmap_mapping(mapping);
+
+		bool identified = false;
+		for (pair<string const, Json> const& pattern : results.object_items()) {
+			identified |= pattern.second[SHARING_SELF]["tables_shared"].bool_value();
+		}
+		return Json::object {
+			{ "identified", identified },
+			{ "test_self", results },
+		};
+	}
+
+	virtual Json characterize() override {
+		size_t no_repetitions = 2000;
+		vector<topology_level_t> levels;
+		for (size_t level = 0; level < NO_TOPOLOGY_LEVELS; level++) {
+			levels.push_back((topology_level_t)level);
+		}
+		Mapping mapping = allocate_mapping(SharingExperiment::mapping_size());
+		flush_mapping(mapping);
+		Json results = test_patterns(mapping, levels, no_repetitions);
+		unmap_mapping(mapping);
+
+		// matrix: what is shared at which topology level (null: no CPU at
+		// this level), printed as a table
+		vector<string> columns {SHARING_SELF};
+		for (topology_level_t level : levels) {
+			columns.push_back(topology_level_to_string(level));
+		}
+		L::info("Sharing of prefetcher state (columns:");
+		for (string const& column : columns) {
+			L::info(" %s", column.c_str());
+		}
+		L::info(")\n");
+		Json::object matrix;
+		Json::object shared_up_to;
+		for (pair<string, size_t> const& pattern : patterns()) {
+			Json::object kinds;
+			for (string kind : {"tables", "fills"}) {
+				Json::object row;
+				string row_string;
+				string farthest = "none";
+				for (string const& column : columns) {
+					Json const& result = results[pattern.first][column];
+					if (result["status"].string_value() != "completed") {
+						row[column] = nullptr;
+						row_string += " -";
+						continue;
+					}
+					bool shared = result[kind + "_shared"].bool_value();
+					row[column] = shared;
+					row_string += shared ? " 1" : " 0";
+					if (shared) {
+						farthest = column;
+					}
+				}
+				kinds[kind] = row;
+				shared_up_to[pattern.first + "." + kind] = farthest;
+				L::info("  %-20s%s\n", (pattern.first + "." + kind).c_str(), row_string.c_str());
+			}
+			matrix[pattern.first] = kinds;
+		}
+
+		return Json::object {
+			{ "matrix", matrix },
+			{ "shared_up_to", shared_up_to },
+			{ "test_sharing", results },
+		};
+	}
+};
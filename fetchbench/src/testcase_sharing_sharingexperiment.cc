@@ -0,0 +1,294 @@
+#include <numeric>
+
+#include "testcase_sharing_sharingexperiment.hh"
+#include "logger.hh"
+
+using json11::Json;
+using std::vector;
+
+char const* sharing_mode_to_string(sharing_mode_t mode) {
+	switch (mode) {
+		case SHARING_MODE_BASELINE: return "baseline";
+		case SHARING_MODE_TABLES: return "tables";
+		case SHARING_MODE_FILLS: return "fills";
+	}
+	return "unknown";
+}
+
+/**
+ * Hints the core that the thread is busy-waiting (frees resources for an
+ * SMT sibling).
+ */
+static inline void cpu_relax() {
+	#if defined(__x86_64__)
+		asm volatile("pause");
+	#elif defined(__aarch64__)
+		asm volatile("yield");
+	#endif
+}
+
+/**
+ * Starts the partner thread on the given CPU.
+ *
+ * @param[in]  cpu   The CPU
+ */
+SharingPartner::SharingPartner(int cpu)
+: cpu {cpu}
+, thread {&SharingPartner::work, this}
+{}
+
+SharingPartner::~SharingPartner() {
+	running = false;
+	thread.join();
+}
+
+/**
+ * The function that is executed in the partner thread: pins the thread to
+ * its CPU, then runs the requested jobs until the partner is destroyed.
+ */
+void SharingPartner::work() {
+	if (pin_process_to_cpu(0, cpu) != 0) {
+		L::warn("Sharing partner: could not pin the thread to CPU %d\n", cpu);
+	}
+	size_t done = 0;
+	while (running) {
+		if (requested.load(std::memory_order_acquire) == done) {
+			cpu_relax();
+			continue;
+		}
+		job();
+		done++;
+		completed.store(done, std::memory_order_release);
+	}
+}
+
+/**
+ * Runs a job on the partner CPU and waits for it to finish.
+ *
+ * @param      job   The job
+ */
+void SharingPartner::run(std::function<void()> const& job) {
+	this->job = job;
+	size_t request = requested.load(std::memory_order_relaxed) + 1;
+	requested.store(request, std::memory_order_release);
+	while (completed.load(std::memory_order_acquire) != request) {
+		cpu_relax();
+	}
+}
+
+SharingExperiment::SharingExperiment(size_t stride_lines, bool use_nanosleep, size_t fr_thresh, size_t noise_thresh)
+: stride_lines {stride_lines}
+, use_nanosleep {use_nanosleep}
+, fr_thresh {fr_thresh}
+, noise_thresh {noise_thresh}
+, t_req { .tv_sec = 0, .tv_nsec = 1000 /* 1µs */ }
+{
+	assert((SHARING_TRAINING_LENGTH + SHARING_NO_SIGNAL_SLOTS + 1) * stride_lines * CACHE_LINE_SIZE <= PAGE_SIZE);
+	for (size_t idx = 0; idx < SHARING_TRAINING_LENGTH; idx++) {
+		training_offsets.push_back(idx * stride_lines * CACHE_LINE_SIZE);
+	}
+	trigger_offset = SHARING_TRAINING_LENGTH * stride_lines * CACHE_LINE_SIZE;
+	// signal: the elements after the trigger
+	for (size_t idx = 1; idx <= SHARING_NO_SIGNAL_SLOTS; idx++) {
+		slot_offsets.push_back(trigger_offset + idx * stride_lines * CACHE_LINE_SIZE);
+	}
+	// reference: the same lines in the untouched pages after the pattern
+	// pages
+	for (size_t idx = 1; idx <= SHARING_NO_SIGNAL_SLOTS; idx++) {
+		slot_offsets.push_back(SHARING_NO_PATTERN_PAGES * PAGE_SIZE + trigger_offset + idx * stride_lines * CACHE_LINE_SIZE);
+	}
+}
+
+/**
+ * Returns the size of the mapping required by the experiment.
+ */
+size_t SharingExperiment::mapping_size() {
+	return 2 * SHARING_NO_PATTERN_PAGES * PAGE_SIZE;
+}
+
+vector<size_t> SharingExperiment::signal_slots() const {
+	vector<size_t> slots(SHARING_NO_SIGNAL_SLOTS);
+	std::iota(slots.begin(), slots.end(), 0);
+	return slots;
+}
+
+vector<size_t> SharingExperiment::reference_slots() const {
+	vector<size_t> slots(slot_offsets.size() - SHARING_NO_SIGNAL_SLOTS);
+	std::iota(slots.begin(), slots.end(), SHARING_NO_SIGNAL_SLOTS);
+	return slots;
+}
+
+/**
+ * Accesses a line. All accesses of the pattern use this function, i.e.,
+ * the same load instruction, on every CPU.
+ */
+__attribute__((noinline)) static void access_line(uint8_t* ptr) {
+	maccess(ptr);
+	// serialize the misses, such that the prefetcher observes them in
+	// order
+	mfence();
+}
+
+/**
+ * Accesses the training elements of the pattern (and the trigger
+ * element).
+ *
+ * @param      page     The pattern page
+ * @param[in]  trigger  Whether to access the trigger element as well
+ */
+void SharingExperiment::train(uint8_t* page, bool trigger) const {
+	for (size_t offset : training_offsets) {
+		access_line(page + offset);
+	}
+	if (trigger) {
+		access_line(page + trigger_offset);
+	}
+}
+
+/**
+ * Collects a cache histogram over the slots. In each repetition, all
+ * lines of the pattern page are flushed, and the pattern is trained and
+ * triggered according to the mode. The partner (if any, otherwise the
+ * measuring CPU itself) runs the training. Then, a single slot is probed.
+ *
+ * @param      mapping         The mapping (see mapping_size())
+ * @param[in]  mode            The mode
+ * @param      partner         The partner (nullptr: train on the
+ *                             measuring CPU)
+ * @param[in]  no_repetitions  Number of repetitions
+ *
+ * @return     Cache histogram (absolute counters per slot)
+ */
+CacheHistogram SharingExperiment::collect_cache_histogram(Mapping const& mapping, sharing_mode_t mode, SharingPartner* partner, size_t no_repetitions) {
+	assert(mapping.size >= mapping_size());
+
+	CacheHistogram cache_histogram (slot_offsets.size());
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
+	for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+		uint8_t* page = mapping.base_addr + (repetition % SHARING_NO_PATTERN_PAGES) * PAGE_SIZE;
+		auto flush_lines = [&]() {
+			for (size_t offset : training_offsets) {
+				flush(page + offset);
+			}
+			flush(page + trigger_offset);
+			for (size_t offset : slot_offsets) {
+				flush(page + offset);
+			}
+			mfence();
+		};
+		flush_lines();
+
+		noise_monitor.begin_window();
+		if (mode != SHARING_MODE_BASELINE) {
+			bool trigger = (mode == SHARING_MODE_FILLS);
+			if (partner != nullptr) {
+				partner->run([&]() { train(page, trigger); });
+			} else {
+				train(page, trigger);
+			}
+		}
+		if (mode != SHARING_MODE_FILLS) {
+			// let the prefetches of the training complete, such that they
+			// do not refill the lines after the flush
+			uint64_t settle_begin = rdtsc();
+			while (rdtsc() - settle_begin < SHARING_SETTLE_TICKS);
+
+			// remove the lines the training accessed or prefetched, then
+			// trigger on the measuring CPU
+			flush_lines();
+			access_line(page + trigger_offset);
+		}
+
+		// sleep a while to give the prefetcher some time to work
+		if (use_nanosleep) {
+			nanosleep(&t_req, &t_rem);
+		}
+
+		// probe a single slot, keep the result only if the repetition was
+		// not disturbed
+		size_t slot = repetition % slot_offsets.size();
+		probe_result_t result = probe_single(page + slot_offsets[slot]);
+		if (noise_monitor.end_window(noise_stats)) {
+			cache_histogram.record(slot, result);
+		}
+	}
+	return cache_histogram;
+}
+
+/**
+ * Decides whether the signal slots (pooled) have a significantly higher
+ * hit rate than the reference slots (pooled, possibly of another
+ * histogram). In addition to the z-test of compare_proportions(), the
+ * hit rate has to exceed the reference hit rate by
+ * SHARING_MIN_HIT_RATE_INCREASE.
+ *
+ * @param      signal_histogram     The histogram of the signal slots
+ * @param      signal_slots         The signal slots
+ * @param      reference_histogram  The histogram of the reference slots
+ * @param      reference_slots      The reference slots
+ *
+ * @return     The verdict.
+ */
+verdict_t SharingExperiment::compare_slots(CacheHistogram const& signal_histogram, vector<size_t> const& signal_slots, CacheHistogram const& reference_histogram, vector<size_t> const& reference_slots) const {
+	size_t signal_hits = 0, signal_probes = 0;
+	for (size_t slot : signal_slots) {
+		signal_hits += signal_histogram.hit_count(slot);
+		signal_probes += signal_histogram.probe_count(slot);
+	}
+	size_t reference_hits = 0, reference_probes = 0;
+	for (size_t slot : reference_slots) {
+		reference_hits += reference_histogram.hit_count(slot);
+		reference_probes += reference_histogram.probe_count(slot);
+	}
+	verdict_t verdict = compare_proportions(signal_hits, signal_probes, reference_hits, reference_probes);
+	if (verdict == VERDICT_YES && signal_probes > 0 && reference_probes > 0) {
+		double increase = (double)signal_hits / signal_probes - (double)reference_hits / reference_probes;
+		if (increase < SHARING_MIN_HIT_RATE_INCREASE) {
+			return VERDICT_NO;
+		}
+	}
+	return verdict;
+}
+
+/**
+ * Dumps the experiment and the cache histogram to a JSON file.
+ *
+ * @param      cache_histogram  The cache histogram
+ * @param[in]  mode             The mode of the collection
+ * @param[in]  partner_cpu      The CPU that trained (-1: the measuring
+ *                              CPU)
+ * @param      filepath         The file path to the JSON file
+ */
+void SharingExperiment::dump(CacheHistogram const& cache_histogram, sharing_mode_t mode, int partner_cpu, string const& filepath) const {
+	Json::array training_offsets_json;
+	for (size_t offset : training_offsets) {
+		training_offsets_json.push_back((int)offset);
+	}
+	Json::array slot_offsets_json;
+	for (size_t offset : slot_offsets) {
+		slot_offsets_json.push_back((int)offset);
+	}
+
+	Json j = Json::object {
+		{ "stride_lines", (int)stride_lines },
+		{ "mode", sharing_mode_to_string(mode) },
+		{ "partner_cpu", partner_cpu },
+		{ "training_offsets", training_offsets_json },
+		{ "trigger_offset", (int)trigger_offset },
+		{ "slot_offsets", slot_offsets_json },
+		{ "no_signal_slots", SHARING_NO_SIGNAL_SLOTS },
+		{ "use_nanosleep", use_nanosleep },
+		{ "fr_thresh", (int)fr_thresh },
+		{ "noise_thresh", (int)noise_thresh },
+		{ "cache_histogram", cache_histogram.normalized_to_json() },
+		{ "cache_histogram_hits", cache_histogram.hits_to_json() },
+		{ "cache_histogram_probes", cache_histogram.probes_to_json() },
+		{ "cache_histogram_levels", cache_histogram.levels_to_json() },
+		{ "probe_fr_thresh", (int)probe_fr_thresh },
+		{ "noise", noise_stats.to_json() },
+		{ "numa_node", get_mapping_numa_node() },
+	};
+	json_dump_to_file(j, filepath);
+}
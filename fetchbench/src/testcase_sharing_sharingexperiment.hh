@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "json11.hpp"
+
+#include "utils.hh"
+#include "cacheutils.hh"
+#include "mapping.hh"
+#include "cache_histogram.hh"
+#include "noise_monitor.hh"
+#include "frequency_guard.hh"
+#include "search.hh"
+
+using json11::Json;
+using std::string;
+using std::vector;
+
+// Number of training accesses of a pattern
+#define SHARING_TRAINING_LENGTH 8
+// Number of pattern elements after the trigger access that are probed
+#define SHARING_NO_SIGNAL_SLOTS 2
+// Number of pages the pattern rotates through (one per repetition), the
+// reference lines are in the pages after them
+#define SHARING_NO_PATTERN_PAGES 16
+// Time to wait for in-flight prefetches of the training before flushing
+// the lines (in rdtsc() ticks)
+#define SHARING_SETTLE_TICKS 2000
+// Minimum increase of the hit rate of the signal slots (over the
+// baseline or the reference slots) to count them as prefetched
+#define SHARING_MIN_HIT_RATE_INCREASE 0.1
+
+typedef enum {
+	// no training, the measuring CPU triggers and probes
+	SHARING_MODE_BASELINE = 0,
+	// the partner trains, the measuring CPU flushes the lines, triggers
+	// and probes
+	SHARING_MODE_TABLES = 1,
+	// the partner trains and triggers, the measuring CPU probes
+	SHARING_MODE_FILLS = 2,
+} sharing_mode_t;
+
+char const* sharing_mode_to_string(sharing_mode_t mode);
+
+/**
+ * Thread on another logical CPU that runs jobs for the measuring thread,
+ * synchronized via two counters in shared memory: run() publishes a job
+ * and increments `requested`, the partner busy-waits for the increment,
+ * runs the job and sets `completed`, which run() busy-waits for. Neither
+ * side sleeps or makes a system call, such that the job runs right
+ * between two steps of a repetition.
+ */
+class SharingPartner {
+private:
+	int const cpu;
+	std::function<void()> job;
+	std::atomic<size_t> requested {0};
+	std::atomic<size_t> completed {0};
+	std::atomic<bool> running {true};
+	std::thread thread;
+
+	void work();
+
+public:
+	explicit SharingPartner(int cpu);
+	~SharingPartner();
+
+	inline int get_cpu() const {
+		return cpu;
+	}
+
+	void run(std::function<void()> const& job);
+};
+
+/**
+ * Experiment for sharing of prefetcher state between logical CPUs. A
+ * pattern of SHARING_TRAINING_LENGTH accesses with a constant stride
+ * (in cache lines, 1: stream) is trained from a single load instruction,
+ * either by the measuring CPU itself or by a SharingPartner on another
+ * CPU. Then, depending on the mode (see sharing_mode_t), the measuring
+ * CPU accesses the next element of the pattern (trigger) and probes the
+ * SHARING_NO_SIGNAL_SLOTS elements after it. Each repetition uses
+ * another page, so state left by previous repetitions does not matter.
+ * Before the lines are flushed after the training, we wait
+ * SHARING_SETTLE_TICKS, such that prefetches the training issued (on
+ * either CPU) cannot fill the slots after the flush and look like shared
+ * tables.
+ *
+ * The probed lines ("slots") are the elements after the trigger (signal)
+ * and the same lines in an untouched page (reference). The cache
+ * histogram of the experiment is indexed by slot.
+ */
+class SharingExperiment {
+public:
+	// stride of the pattern in cache lines
+	size_t const stride_lines;
+	// wait before probing or not
+	bool const use_nanosleep;
+	// Flush+Reload threshold
+	size_t const fr_thresh;
+	// Flush+Reload noise threshold
+	size_t const noise_thresh;
+	// structs for nanosleep
+	struct timespec const t_req;
+	struct timespec t_rem;
+	// repetitions discarded because of noise (see NoiseMonitor)
+	NoiseStats noise_stats;
+	// Flush+Reload threshold used by the last collection (fr_thresh,
+	// scaled if the frequency changed, see FrequencyGuard)
+	size_t probe_fr_thresh = 0;
+
+private:
+	// offsets within a pattern page
+	vector<size_t> training_offsets;
+	size_t trigger_offset;
+	// offsets of the probed lines within a pattern page, signal slots first
+	vector<size_t> slot_offsets;
+
+public:
+	SharingExperiment(size_t stride_lines, bool use_nanosleep, size_t fr_thresh, size_t noise_thresh);
+
+	static size_t mapping_size();
+
+	vector<size_t> signal_slots() const;
+	vector<size_t> reference_slots() const;
+
+private:
+	inline probe_result_t probe_single(uint8_t* ptr) const __attribute__((always_inline)) {
+		size_t time = flush_reload_t(ptr);
+		return { time < probe_fr_thresh, LatencyBands::get().classify(time) };
+	}
+
+	void train(uint8_t* page, bool trigger) const;
+
+public:
+	CacheHistogram collect_cache_histogram(Mapping const& mapping, sharing_mode_t mode, SharingPartner* partner, size_t no_repetitions);
+
+	verdict_t compare_slots(CacheHistogram const& signal_histogram, vector<size_t> const& signal_slots, CacheHistogram const& reference_histogram, vector<size_t> const& reference_slots) const;
+
+	void dump(CacheHistogram const& cache_histogram, sharing_mode_t mode, int partner_cpu, string const& filepath) const;
+};
@@ -15,7 +15,9 @@
 #include "logger.hh"
 #include "utils.hh"
 #include "mapping.hh"
+#include "msr_controller.hh"
 
+#include "search.hh"
 #include "testcase_sms_smsexperiment.hh"
 
 using json11::Json;
@@ -44,10 +46,7 @@ protected:
 	virtual Json pre_test() override {
 		architecture_t arch = get_arch();
 		if (arch == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, false);
+			set_intel_prefetchers(USE_CURRENT_CPU, 0);
 		} else if (arch == ARCH_ARM) {
 		}
 		return Json::object {
@@ -57,10 +56,7 @@ protected:
 
 	virtual Json post_test() override {
 		if (get_arch() == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, true);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
 		}
 		return Json::object {};
 	}
@@ -94,19 +90,19 @@ protected:
 		// run experiments: once with accessing additional regions between
 		// training and triggering, once without.
 		bool access_regions = false;
-		vector<size_t> cache_histogram_noacc = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_same_pc_same_memory, &access_regions);
+		CacheHistogram cache_histogram_noacc = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_same_pc_same_memory, &access_regions);
 		flush_mapping(mapping);
 		random_activity(mapping2);
 		access_regions = true;
-		vector<size_t> cache_histogram_acc = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_same_pc_same_memory, &access_regions);
+		CacheHistogram cache_histogram_acc = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_same_pc_same_memory, &access_regions);
 
 		// evaluate
-		vector<bool> prefetch_vector_noacc = experiment.evaluate_cache_histogram(cache_histogram_noacc, no_repetitions);
-		vector<bool> prefetch_vector_acc = experiment.evaluate_cache_histogram(cache_histogram_acc, no_repetitions);
+		PrefetchVector prefetch_vector_noacc = experiment.evaluate_cache_histogram(cache_histogram_noacc, no_repetitions);
+		PrefetchVector prefetch_vector_acc = experiment.evaluate_cache_histogram(cache_histogram_acc, no_repetitions);
 		experiment.dump(cache_histogram_noacc, prefetch_vector_noacc, "trace-sms-test_trigger_same_pc_same_memory-noacc.json");
 		experiment.dump(cache_histogram_acc, prefetch_vector_acc, "trace-sms-test_trigger_same_pc_same_memory-acc.json");
-		size_t prefetch_count_noacc = std::count(prefetch_vector_noacc.begin(), prefetch_vector_noacc.end(), true);
-		size_t prefetch_count_acc = std::count(prefetch_vector_acc.begin(), prefetch_vector_acc.end(), true);
+		size_t prefetch_count_noacc = prefetch_vector_noacc.count();
+		size_t prefetch_count_acc = prefetch_vector_acc.count();
 
 		// plot
 		plot_sms(__FUNCTION__, {
@@ -148,14 +144,16 @@ protected:
 		};
 		vector<size_t> trigger_offsets { training_offsets[0] };
 		SMSExperiment experiment { training_offsets, trigger_offsets, use_nanosleep, fr_thresh, noise_thresh };
+		experiment.access_kind = access_kind;
 
 		// run experiment
-		vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_same_pc_different_memory, nullptr);
-		vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
-		experiment.dump(cache_histogram, prefetch_vector, "trace-sms-test_trigger_same_pc_different_memory.json");
-		size_t prefetch_count = std::count(prefetch_vector.begin(), prefetch_vector.end(), true);
+		CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_same_pc_different_memory, nullptr);
+		PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+		string dump_filename = "trace-sms-test_trigger_same_pc_different_memory" + access_kind_suffix() + ".json";
+		experiment.dump(cache_histogram, prefetch_vector, dump_filename);
+		size_t prefetch_count = prefetch_vector.count();
 
-		plot_sms(__FUNCTION__, {"trace-sms-test_trigger_same_pc_different_memory.json"});
+		plot_sms(__FUNCTION__ + access_kind_suffix(), {dump_filename});
 
 		unmap_mapping(mapping);
 		
@@ -190,28 +188,31 @@ protected:
 		};
 		vector<size_t> trigger_offsets { training_offsets[0] };
 		SMSExperiment experiment { training_offsets, trigger_offsets, use_nanosleep, fr_thresh, noise_thresh };
+		experiment.access_kind = access_kind;
 
 		// run experiments: once with accessing additional regions between
 		// training and triggering, once without.
 		bool access_regions = false;
-		vector<size_t> cache_histogram_noacc = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_different_pc_same_memory, &access_regions);
+		CacheHistogram cache_histogram_noacc = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_different_pc_same_memory, &access_regions);
 		flush_mapping(mapping);
 		random_activity(mapping2);
 		access_regions = true;
-		vector<size_t> cache_histogram_acc = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_different_pc_same_memory, &access_regions);
+		CacheHistogram cache_histogram_acc = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_different_pc_same_memory, &access_regions);
 
 		// evaluate
-		vector<bool> prefetch_vector_noacc = experiment.evaluate_cache_histogram(cache_histogram_noacc, no_repetitions);
-		vector<bool> prefetch_vector_acc = experiment.evaluate_cache_histogram(cache_histogram_acc, no_repetitions);
-		experiment.dump(cache_histogram_noacc, prefetch_vector_noacc, "trace-sms-test_trigger_different_pc_same_memory-noacc.json");
-		experiment.dump(cache_histogram_acc, prefetch_vector_acc, "trace-sms-test_trigger_different_pc_same_memory-acc.json");
-		size_t prefetch_count_noacc = std::count(prefetch_vector_noacc.begin(), prefetch_vector_noacc.end(), true);
-		size_t prefetch_count_acc = std::count(prefetch_vector_acc.begin(), prefetch_vector_acc.end(), true);
+		PrefetchVector prefetch_vector_noacc = experiment.evaluate_cache_histogram(cache_histogram_noacc, no_repetitions);
+		PrefetchVector prefetch_vector_acc = experiment.evaluate_cache_histogram(cache_histogram_acc, no_repetitions);
+		string dump_filename_noacc = "trace-sms-test_trigger_different_pc_same_memory-noacc" + access_kind_suffix() + ".json";
+		string dump_filename_acc = "trace-sms-test_trigger_different_pc_same_memory-acc" + access_kind_suffix() + ".json";
+		experiment.dump(cache_histogram_noacc, prefetch_vector_noacc, dump_filename_noacc);
+		experiment.dump(cache_histogram_acc, prefetch_vector_acc, dump_filename_acc);
+		size_t prefetch_count_noacc = prefetch_vector_noacc.count();
+		size_t prefetch_count_acc = prefetch_vector_acc.count();
 
 		// plot
-		plot_sms(__FUNCTION__, {
-			"trace-sms-test_trigger_different_pc_same_memory-noacc.json",
-			"trace-sms-test_trigger_different_pc_same_memory-acc.json"
+		plot_sms(__FUNCTION__ + access_kind_suffix(), {
+			dump_filename_noacc,
+			dump_filename_acc
 		});
 
 		unmap_mapping(mapping);
@@ -250,10 +251,10 @@ protected:
 		SMSExperiment experiment { training_offsets, trigger_offsets, use_nanosleep, fr_thresh, noise_thresh };
 
 		// run experiment
-		vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_different_pc_different_memory, nullptr);
-		vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+		CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_different_pc_different_memory, nullptr);
+		PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
 		experiment.dump(cache_histogram, prefetch_vector, "trace-sms-test_trigger_different_pc_different_memory.json");
-		size_t prefetch_count = std::count(prefetch_vector.begin(), prefetch_vector.end(), true);
+		size_t prefetch_count = prefetch_vector.count();
 
 		plot_sms(__FUNCTION__, {"trace-sms-test_trigger_different_pc_different_memory.json"});
 
@@ -296,14 +297,14 @@ protected:
 			L::debug("colliding_bits = %zu\n", colliding_bits);
 			
 			// run experiment
-			vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_pc_collision, &colliding_bits);
+			CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_pc_collision, &colliding_bits);
 			
 			// evaluate
-			vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+			PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
 			string dump_filename = "trace-sms-test_pc_collision-coll_" + zero_pad(colliding_bits, 2) + ".json";
 			experiment.dump(cache_histogram, prefetch_vector, dump_filename);
 			json_dumps_file_paths.push_back(dump_filename);
-			size_t prefetch_count = std::count(prefetch_vector.begin(), prefetch_vector.end(), true);
+			size_t prefetch_count = prefetch_vector.count();
 			if (prefetch_count > 0 && min_colliding_bits == -1) {
 				L::debug("Found min_colliding_bits: %zd\n", min_colliding_bits);
 				min_colliding_bits = colliding_bits;
@@ -389,10 +390,10 @@ protected:
 				SMSExperiment experiment { training_offsets, trigger_offsets, use_nanosleep, fr_thresh, noise_thresh };
 
 				// run experiments
-				vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_same_pc_different_memory, nullptr);
+				CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_same_pc_different_memory, nullptr);
 				random_activity(mapping);
 				flush_mapping(mapping);
-				vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+				PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
 
 				// Dump cache histogram
 				string sign_string = ((sign > 0)? "pos_":"neg_");
@@ -403,9 +404,9 @@ protected:
 				// Count prefetches
 				size_t prefetch_count;
 				if (sign > 0)
-					prefetch_count = std::count(std::next(prefetch_vector.begin(), 1), std::next(prefetch_vector.begin(), region_size + 1), true);
+					prefetch_count = prefetch_vector.count(1, region_size + 1);
 				else
-					prefetch_count = std::count(std::prev(prefetch_vector.end(), region_size+2), std::prev(prefetch_vector.end(), 1), true);
+					prefetch_count = prefetch_vector.count(prefetch_vector.size() - (region_size + 2), prefetch_vector.size() - 1);
 
 				L::debug("prefetched: %zu \n", prefetch_count);
 				training_offsets.clear();
@@ -434,7 +435,13 @@ protected:
 	}
 
 	/**
-	 * Tests the region boundary of sms prefetcher.
+	 * Tests the region boundary of sms prefetcher. We train a pattern that
+	 * starts at the beginning of a page and ends with a far access at
+	 * (boundary - CACHE_LINE_SIZE). The far access is only part of the
+	 * recorded pattern (and thus prefetched on a trigger) if it is located
+	 * in the same region as the first access. This is a monotone
+	 * predicate, so the largest boundary for which the far access is
+	 * prefetched, i.e., the region size, is searched with find_boundary().
 	 *
 	 * @param[in]  no_repetitions  Number of repetitions
 	 *
@@ -448,97 +455,94 @@ protected:
 
 		Mapping mapping1 { mapping.base_addr, 4 * PAGE_SIZE };
 		Mapping mapping2 { mapping.base_addr + 4 * PAGE_SIZE, 4 * PAGE_SIZE };
-		size_t base_prefetch = 0;
-		int region_boundary = 0;
 		vector<string> dump_filenames;
-		vector<size_t> training_offsets;
-		size_t first_access_offset;
 		size_t region_size = 5;
 
-		// Test region boundary for 8 * CACHE_LINE_SIZE, and keep
-		// incrementing by CACHE_LINE_SIZE until the SMS prefetcher stops
-		// learning pattern
-		size_t boundary_start = 8 * CACHE_LINE_SIZE;
-		for (size_t boundary = boundary_start; boundary <= PAGE_SIZE && region_boundary == 0; boundary += CACHE_LINE_SIZE) {
-			base_prefetch = 0;
-			for (size_t test_id : {0, 1}) {
-				// generate a pseudo-random access order
-				first_access_offset = boundary - (region_size + 1) * CACHE_LINE_SIZE + test_id * CACHE_LINE_SIZE;
-				assert(first_access_offset < boundary); // make sure there is no overflow
-
-				training_offsets.push_back(first_access_offset);
-				L::debug("Boundary: %zu (%s) access order: ", boundary, test_id? "test":"base");
-				L::debug("%zu ", first_access_offset / CACHE_LINE_SIZE);
-				while (training_offsets.size() <= region_size) {
-					size_t index = first_access_offset + random_uint32(1, region_size) * CACHE_LINE_SIZE;
-					if (std::find(training_offsets.begin(), training_offsets.end(), index) == training_offsets.end()) {
-						training_offsets.push_back(index);
-						L::debug("%zu ", index / CACHE_LINE_SIZE);
-					}
+		// The near part of the pattern lies within the first 8 cache lines,
+		// which we assume to be the minimum region size. It stays the same
+		// for all probe points.
+		vector<size_t> near_offsets { 0 };
+		L::debug("access order: 0 ");
+		while (near_offsets.size() <= region_size) {
+			size_t offset = random_uint32(1, region_size) * CACHE_LINE_SIZE;
+			if (std::find(near_offsets.begin(), near_offsets.end(), offset) == near_offsets.end()) {
+				near_offsets.push_back(offset);
+				L::debug("%zu ", offset / CACHE_LINE_SIZE);
+			}
+		}
+		L::debug("\n");
+
+		// make sure the pseudo-random order does not contain a stride pattern
+		for (size_t i = 2; i < near_offsets.size(); i++) {
+			ssize_t deltas[2] = {
+				(ssize_t)near_offsets[i - 1] - (ssize_t)near_offsets[i - 2],
+				(ssize_t)near_offsets[i - 0] - (ssize_t)near_offsets[i - 1]
+			};
+			if (deltas[0] == deltas[1]) {
+				std::shuffle(std::next(near_offsets.begin()), near_offsets.end(), *get_rng());
+				i = 2;
+				L::debug("Shuffled offsets because the list contained a stride, new access order: ");
+				for (size_t near_offset : near_offsets) {
+					L::debug("%zu ", near_offset);
 				}
 				L::debug("\n");
+			}
+		}
 
-				// make sure the pseudo-random order does not contain a stride pattern
-				for (size_t i = 2; i < training_offsets.size(); i++) {
-					ssize_t deltas[2] = {
-						(ssize_t)training_offsets[i - 1] - (ssize_t)training_offsets[i - 2],
-						(ssize_t)training_offsets[i - 0] - (ssize_t)training_offsets[i - 1]
-					};
-					if (deltas[0] == deltas[1]) {
-						std::shuffle(training_offsets.begin(), training_offsets.end(), *get_rng());
-						i = 2;
-						L::debug("Shuffled offsets because the list contained a stride, new access order: ");
-						for (size_t training_offset : training_offsets) {
-							L::debug("%zu ", training_offset);
-						}
-						L::debug("\n");
-					}
-				}
-
-				// set up the experiment
-				vector<size_t> trigger_offsets { training_offsets[0] };
-				SMSExperiment experiment { training_offsets, trigger_offsets, use_nanosleep, fr_thresh, noise_thresh };
-
-				// run experiments
-				vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_same_pc_different_memory, nullptr);
-				random_activity(mapping);
-				flush_mapping(mapping);
-				vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+		// boundary in cache lines -> verdict whether the far access is
+		// prefetched
+		probe_func_t far_access_prefetched = [&](size_t boundary_cls, size_t attempt) -> verdict_t {
+			size_t boundary = boundary_cls * CACHE_LINE_SIZE;
+			size_t repetitions = no_repetitions * (attempt + 1);
+			vector<size_t> training_offsets = near_offsets;
+			training_offsets.push_back(boundary - CACHE_LINE_SIZE);
+			vector<size_t> trigger_offsets { training_offsets[0] };
+			SMSExperiment experiment { training_offsets, trigger_offsets, use_nanosleep, fr_thresh, noise_thresh };
+
+			// run experiments
+			CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, repetitions, workload_sms_same_pc_different_memory, nullptr);
+			random_activity(mapping);
+			flush_mapping(mapping);
+			PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, repetitions);
 
-				// Dump cache histogram
-				string test_type = ((test_id == 0)? "base_":"test_");
-				string dump_filename = "trace-sms-test_region_boundary_" + test_type + zero_pad(boundary, 4) + ".json";
-				experiment.dump(cache_histogram, prefetch_vector, dump_filename);
+			// Dump cache histogram
+			string dump_filename = "trace-sms-test_region_boundary_" + zero_pad(boundary, 4) + ".json";
+			experiment.dump(cache_histogram, prefetch_vector, dump_filename);
+			if (std::find(dump_filenames.begin(), dump_filenames.end(), dump_filename) == dump_filenames.end()) {
 				dump_filenames.push_back(dump_filename);
+			}
 
-				// Count prefetches
-				size_t prefetch_count;
-				if (test_id > 0)
-					prefetch_count = std::count(std::next(prefetch_vector.begin(), boundary/CACHE_LINE_SIZE - region_size), std::next(prefetch_vector.begin(), boundary/CACHE_LINE_SIZE + 1), true);
-				else
-					prefetch_count = std::count(std::next(prefetch_vector.begin(), boundary/CACHE_LINE_SIZE - region_size - 1), std::next(prefetch_vector.begin(), boundary/CACHE_LINE_SIZE), true);
-
-				L::debug("prefetched: %zu\n", prefetch_count);
-				training_offsets.clear();
-
-				if (test_id == 0) {
-					base_prefetch = prefetch_count;
-				} else if (base_prefetch != prefetch_count){
-					region_boundary = boundary;
-				}
-				// No SMS prefetcher detected
-				if (base_prefetch == 0) {
-					region_boundary = -1;
-					break;
+			// compare the far access against all lines that were not
+			// accessed at all
+			vector<size_t> signal_indices { (boundary - CACHE_LINE_SIZE) / CACHE_LINE_SIZE };
+			vector<size_t> reference_indices;
+			for (size_t cl_idx = 0; cl_idx < cache_histogram.size(); cl_idx++) {
+				if ( ! experiment.cl_accessed(cl_idx) && experiment.cl_potential_prefetch(cl_idx) == SMS_NO_PREFETCH) {
+					reference_indices.push_back(cl_idx);
 				}
 			}
+			verdict_t verdict = compare_hit_rates(cache_histogram, signal_indices, reference_indices);
+			L::debug("boundary: %zu, far access prefetched: %s\n", boundary, verdict_to_string(verdict));
+			return verdict;
+		};
+
+		// The far access is placed at least one line after the near part
+		// of the pattern.
+		BoundarySearchResult search = find_boundary(region_size + 2, PAGE_SIZE / CACHE_LINE_SIZE, far_access_prefetched);
+		int region_boundary;
+		if ( ! search.holds_at_lower) {
+			// No SMS prefetcher detected
+			region_boundary = -1;
+		} else {
+			region_boundary = search.last_true * CACHE_LINE_SIZE;
 		}
 		plot_sms(__FUNCTION__, dump_filenames);
 		unmap_mapping(mapping);
 
 		return Json::object {
 			{"status", "completed"},
-			{"region_boundary", (int)region_boundary},
+			{"region_boundary", region_boundary},
+			{"search", boundary_search_to_json(search)},
 		};
 	}
 
@@ -572,15 +576,15 @@ protected:
 		// run experiments: once with accessing additional regions between
 		// training and triggering to observe the eviction of training entry.
 		for (entries = 2; entries < 15; entries++) {
-			vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_training_entries, &entries);
+			CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_sms_training_entries, &entries);
 			flush_mapping(mapping);
 			random_activity(mapping2);
 			// evaluate
-			vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+			PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
 			string dump_filename = "trace-sms-test_training_entries_" + zero_pad(entries, 4) + ".json";
 			experiment.dump(cache_histogram, prefetch_vector, dump_filename);
 			dump_filenames.push_back(dump_filename);
-			size_t prefetch_count = std::count(prefetch_vector.begin(), prefetch_vector.end(), true);
+			size_t prefetch_count = prefetch_vector.count();
 			L::debug("prefetch count: %zu entries: %zu\n\n", prefetch_count, entries);
 
 			// break as soon as the prefetching < training
@@ -602,18 +606,18 @@ protected:
 	virtual Json identify() override {
 		size_t no_repetitions = 40000 * (PAGE_SIZE / 4096);
 		
-		Json test_results_pc = test_trigger_same_pc_different_memory(no_repetitions);
-		Json test_results_mem = test_trigger_different_pc_same_memory(no_repetitions);
-		bool identified = (test_results_pc["triggers_prefetch"].bool_value() == true
-				|| test_results_mem["triggers_prefetch_with_additional_region_accesses"].bool_value() == true);
-
-
-		return Json::object {
-			{ "identified", identified },
-			{ "test_result_same_pc", test_results_pc },
-			{ "test_result_same_mem", test_results_mem },
-
-		};
+		return identify_per_access_kind([&]() {
+			Json test_results_pc = test_trigger_same_pc_different_memory(no_repetitions);
+			Json test_results_mem = test_trigger_different_pc_same_memory(no_repetitions);
+			bool identified = (test_results_pc["triggers_prefetch"].bool_value() == true
+					|| test_results_mem["triggers_prefetch_with_additional_region_accesses"].bool_value() == true);
+
+			return Json::object {
+				{ "identified", identified },
+				{ "test_result_same_pc", test_results_pc },
+				{ "test_result_same_mem", test_results_mem },
+			};
+		});
 	}
 
 	virtual Json characterize() override {
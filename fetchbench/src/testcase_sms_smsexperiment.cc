@@ -101,9 +101,8 @@ exit_loop:
  * execution of the workload. The probed cache line moves by +1 in each
  * iteration, and wraps around once the end of the memory area is
  * reached. The cache histogram represents the cache state after the
- * experiment. It is a vector<size_t>, where each entry represents one
- * of the cache lines. The value indicates the number of hits seen in
- * this cache line.
+ * experiment. For each of the cache lines, it counts the number of
+ * probes and the number of hits seen in this cache line.
  *
  * @param      mapping         The mapping to execute the workload on
  * @param[in]  no_repetitions  Number of repetitions
@@ -111,15 +110,20 @@ exit_loop:
  *
  * @return     Cache histogram (absolute counters per cache line)
  */
-vector<size_t> SMSExperiment::collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(SMSExperiment const&, Mapping const&, void*), void* additional_info) {
+CacheHistogram SMSExperiment::collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(SMSExperiment const&, Mapping const&, void*), void* additional_info) {
 	// ensure the maximum offset is in bounds of the mapping
 	assert(training_offsets.size() > 0);
 	vector<size_t>::const_iterator max_it = std::max_element(training_offsets.begin(), training_offsets.end());
 	assert(max_it != training_offsets.end());
 	assert(mapping.base_addr + *max_it < mapping.base_addr + mapping.size);
 	
-	vector<size_t> cache_histogram (mapping.size / CACHE_LINE_SIZE, 0);
+	CacheHistogram cache_histogram (mapping.size / CACHE_LINE_SIZE);
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
 	for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+		noise_monitor.begin_window();
+
 		// flush mappings
 		flush_mapping(mapping);
 		
@@ -134,13 +138,13 @@ vector<size_t> SMSExperiment::collect_cache_histogram(Mapping const& mapping, si
 			nanosleep(&t_req, &t_rem);
 		}
 
-		// probe probe array
+		// probe probe array, keep the result only if the repetition was
+		// not disturbed
 		size_t probe_idx = repetition % (cache_histogram.size());
-		probe_single(cache_histogram, probe_idx, mapping.base_addr + (probe_idx * CACHE_LINE_SIZE));
-	}
-	// normalize cache histogram
-	for (size_t& hist_value : cache_histogram) {
-		hist_value = hist_value * 1000 / (no_repetitions / cache_histogram.size());
+		probe_result_t result = probe_single(mapping.base_addr + (probe_idx * CACHE_LINE_SIZE));
+		if (noise_monitor.end_window(noise_stats)) {
+			cache_histogram.record(probe_idx, result);
+		}
 	}
 	return cache_histogram;
 }
@@ -157,15 +161,20 @@ vector<size_t> SMSExperiment::collect_cache_histogram(Mapping const& mapping, si
  *
  * @return     Cache histogram (absolute counters per cache line)
  */
-vector<size_t> SMSExperiment::collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(SMSExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info) {
+CacheHistogram SMSExperiment::collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(SMSExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info) {
 	// ensure the maximum offset is in bounds of both mappings
 	assert(training_offsets.size() > 0);
 	vector<size_t>::const_iterator max_it = std::max_element(training_offsets.begin(), training_offsets.end());
 	assert(mapping1.base_addr + *max_it < mapping1.base_addr + mapping1.size);
 	assert(mapping2.base_addr + *max_it < mapping2.base_addr + mapping2.size);
 
-	vector<size_t> cache_histogram (mapping2.size / CACHE_LINE_SIZE, 0);
+	CacheHistogram cache_histogram (mapping2.size / CACHE_LINE_SIZE);
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
 	for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+		noise_monitor.begin_window();
+
 		// flush mappings
 		flush_mapping(mapping1);
 		flush_mapping(mapping2);
@@ -181,29 +190,28 @@ vector<size_t> SMSExperiment::collect_cache_histogram(Mapping const& mapping1, M
 			nanosleep(&t_req, &t_rem);
 		}
 
-		// probe probe array
+		// probe probe array, keep the result only if the repetition was
+		// not disturbed
 		size_t probe_idx = repetition % (cache_histogram.size());
-		probe_single(cache_histogram, probe_idx, mapping2.base_addr + (probe_idx * CACHE_LINE_SIZE));
-	}
-	// normalize cache histogram
-	for (size_t& hist_value : cache_histogram) {
-		hist_value = hist_value * 1000 / (no_repetitions / cache_histogram.size());
+		probe_result_t result = probe_single(mapping2.base_addr + (probe_idx * CACHE_LINE_SIZE));
+		if (noise_monitor.end_window(noise_stats)) {
+			cache_histogram.record(probe_idx, result);
+		}
 	}
 	return cache_histogram;
 }
 
 /**
- * Reduces a cache histogram, i.e., vector<size_t>, to a vector<bool>
- * of same size. Cache lines where prefetches were both _expected_ AND
- * _observed_ are marked as `true` in the returned "prefetch vector".
- * All other lines are marked `false`.
+ * Reduces a cache histogram to a PrefetchVector of same size. Cache
+ * lines where prefetches were both _expected_ AND _observed_ are marked
+ * in the returned "prefetch vector". All other lines are unmarked.
  *
  * @param      cache_histogram       The cache histogram
  * @param[in]  threshold_multiplier  The threshold multiplier
  *
  * @return     prefetch vector.
  */
-vector<bool> SMSExperiment::evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const {
+PrefetchVector SMSExperiment::evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const {
 	// compute averages for (a) all locations where we expect hits,
 	// (b) all locations where we expect misses
 	size_t hit_avg = 0, hit_n = 0;
@@ -239,7 +247,7 @@ vector<bool> SMSExperiment::evaluate_cache_histogram(vector<size_t> const& cache
 
 	// iterate over the possible prefetch locations and use the prefetch_threshold
 	// to decide whether this is a prefetch or not.
-	vector<bool> prefetch_vector (cache_histogram.size(), false);
+	PrefetchVector prefetch_vector (cache_histogram.size());
 	for (size_t cl_idx = 0; cl_idx < cache_histogram.size(); cl_idx++) {
 		// check whether this is a prefetch location or not
 		sms_prefetch_state_t is_prefetch_cl = cl_potential_prefetch(cl_idx);
@@ -251,7 +259,7 @@ vector<bool> SMSExperiment::evaluate_cache_histogram(vector<size_t> const& cache
 				// check whether the value exceeds the prefetch threshold
 				if (cache_histogram[cl_idx] >= prefetch_thresh) {
 					L::debug(" *** I think this is a prefetch (%zu >= %zu). ***\n", cache_histogram[cl_idx], prefetch_thresh);
-					prefetch_vector[cl_idx] = true;
+					prefetch_vector.set(cl_idx);
 				}
 			}
 		}
@@ -268,27 +276,21 @@ vector<bool> SMSExperiment::evaluate_cache_histogram(vector<size_t> const& cache
  *
  * @return     prefetch vector.
  */
-vector<bool> SMSExperiment::evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions) const {
+PrefetchVector SMSExperiment::evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions) const {
 	return evaluate_cache_histogram(cache_histogram, no_repetitions, 1.0/64);
 }
 
 /**
  * Dumps an experiment and a cache histogram to a JSON file.
+ * The fill levels of the prefetched lines are added to the
+ * FillLevelSummary, the degree, distance, coverage and timeliness of
+ * the prefetches to the PrefetchMetrics.
  *
  * @param      cache_histogram  The cache histogram
  * @param[in]  prefetch_vector  The prefetch vector
  * @param      filepath         The file path to the JSON file
  */
-void SMSExperiment::dump(vector<size_t> const& cache_histogram, vector<bool> prefetch_vector, string const& filepath) const {
-	// Build a JSON array from the cache histogram numbers
-	Json::array cache_histogram_values {};
-	for (size_t i = 0; i < cache_histogram.size(); i++) {
-		cache_histogram_values.push_back((int)cache_histogram[i]);
-	}
-	Json::array prefetch_vector_values {};
-	for (size_t i = 0; i < prefetch_vector.size(); i++) {
-		prefetch_vector_values.push_back((bool)prefetch_vector[i]);
-	}
+void SMSExperiment::dump(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector, string const& filepath) const {
 	Json::array training_offsets_values {};
 	for (size_t i = 0; i < training_offsets.size(); i++) {
 		training_offsets_values.push_back((int)training_offsets[i]);
@@ -304,10 +306,24 @@ void SMSExperiment::dump(vector<size_t> const& cache_histogram, vector<bool> pre
 		{ "use_nanosleep", use_nanosleep },
 		{ "fr_thresh", (int)fr_thresh },
 		{ "noise_thresh", (int)noise_thresh },
-		{ "cache_histogram", cache_histogram_values },
-		{ "prefetch_vector", prefetch_vector },
+		{ "cache_histogram", cache_histogram.normalized_to_json() },
+		{ "cache_histogram_hits", cache_histogram.hits_to_json() },
+		{ "cache_histogram_probes", cache_histogram.probes_to_json() },
+		{ "cache_histogram_levels", cache_histogram.levels_to_json() },
+		{ "prefetch_vector", prefetch_vector.to_json() },
+		{ "prefetch_fill_levels", cache_histogram.fill_levels_to_json(prefetch_vector) },
 		{ "cache_line_size", CACHE_LINE_SIZE },
+		{ "probe_fr_thresh", (int)probe_fr_thresh },
+		{ "noise", noise_stats.to_json() },
+		{ "numa_node", get_mapping_numa_node() },
+		{ "access_kind", access_kind_to_string(access_kind) },
 	};
+	FillLevelSummary::get().add(cache_histogram, prefetch_vector);
+	PrefetchVector potential_vector (cache_histogram.size());
+	for (size_t cl_idx = 0; cl_idx < cache_histogram.size(); cl_idx++) {
+		potential_vector.set(cl_idx, cl_potential_prefetch(cl_idx) != SMS_NO_PREFETCH);
+	}
+	PrefetchMetrics::get().add(cache_histogram, prefetch_vector, potential_vector, (trigger_offsets.empty() ? training_offsets.back() : trigger_offsets.back()) / CACHE_LINE_SIZE);
 	
 	json_dump_to_file(j, filepath);
 }
@@ -319,7 +335,7 @@ void SMSExperiment::dump(vector<size_t> const& cache_histogram, vector<bool> pre
  *
  * @return     Pair of stride experiment object and cache histogram.
  */
-pair<SMSExperiment, vector<size_t>> SMSExperiment::restore(string const& filepath) {
+pair<SMSExperiment, CacheHistogram> SMSExperiment::restore(string const& filepath) {
 	std::ifstream file;
 	file.open(filepath);
 	string line;
@@ -351,11 +367,9 @@ pair<SMSExperiment, vector<size_t>> SMSExperiment::restore(string const& filepat
 		(size_t)json["fr_thresh"].int_value(),
 		(size_t)json["noise_thresh"].int_value(),
 	};
-
-	vector<size_t> cache_histogram;
-	for (Json value : json["cache_histogram"].array_items()) {
-		cache_histogram.push_back((size_t)value.int_value());
+	if (json["access_kind"].is_string()) {
+		experiment.access_kind = access_kind_from_string(json["access_kind"].string_value());
 	}
-	
-	return {experiment, cache_histogram};
+
+	return {experiment, CacheHistogram::from_json(json)};
 }
\ No newline at end of file
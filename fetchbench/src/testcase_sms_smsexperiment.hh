@@ -12,6 +12,11 @@
 #include "utils.hh"
 #include "aligned_maccess.hh"
 #include "mapping.hh"
+#include "cache_histogram.hh"
+#include "prefetch_metrics.hh"
+#include "noise_monitor.hh"
+#include "frequency_guard.hh"
+#include "access_kind.hh"
 
 using json11::Json;
 using std::vector;
@@ -57,6 +62,13 @@ public:
 	// structs for nanosleep
 	struct timespec const t_req;
 	struct timespec t_rem;
+	// repetitions discarded because of noise (see NoiseMonitor)
+	NoiseStats noise_stats;
+	// Flush+Reload threshold used by the last collection (fr_thresh,
+	// scaled if the frequency changed, see FrequencyGuard)
+	size_t probe_fr_thresh = 0;
+	// kind of the accesses of the workload (see maccess_kind())
+	access_kind_t access_kind = ACCESS_KIND_LOAD;
 
 private:
 	// relative distances of later training loads to the first training load
@@ -70,19 +82,18 @@ public:
 	sms_prefetch_state_t cl_potential_prefetch(size_t cl_idx) const;
 
 private:
-	inline void probe_single(vector<size_t>& cache_histogram, size_t idx, uint8_t* ptr) const __attribute__((always_inline)) {
-		assert(idx < cache_histogram.size());
+	inline probe_result_t probe_single(uint8_t* ptr) const __attribute__((always_inline)) {
 		size_t time = flush_reload_t(ptr);
-		cache_histogram[idx] += (time < fr_thresh) ? 1 : 0;
+		return { time < probe_fr_thresh, LatencyBands::get().classify(time) };
 	}
 
 public:
-	vector<size_t> collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(SMSExperiment const&, Mapping const&, void*), void* additional_info);
-	vector<size_t> collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(SMSExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info);
-	vector<bool> evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const;
-	vector<bool> evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions) const;
-	void dump(vector<size_t> const& cache_histogram, vector<bool> prefetch_vector, string const& filepath) const;
-	static pair<SMSExperiment, vector<size_t>> restore(string const& filepath);
+	CacheHistogram collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(SMSExperiment const&, Mapping const&, void*), void* additional_info);
+	CacheHistogram collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(SMSExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info);
+	PrefetchVector evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const;
+	PrefetchVector evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions) const;
+	void dump(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector, string const& filepath) const;
+	static pair<SMSExperiment, CacheHistogram> restore(string const& filepath);
 };
 
 // ===== WORKLOADS =====
@@ -107,7 +118,7 @@ __attribute__((always_inline)) inline void workload_sms_same_pc_same_memory(SMSE
 
 	// Training in mapping2
 	for (size_t offset : experiment.training_offsets) {
-		maccess_noinline(mapping2.base_addr + offset);
+		maccess_kind_noinline(experiment.access_kind, mapping2.base_addr + offset);
 	}
 	mfence();
 
@@ -125,7 +136,7 @@ __attribute__((always_inline)) inline void workload_sms_same_pc_same_memory(SMSE
 
 	// Trigger in mapping2 (same PC)
 	for (size_t offset : experiment.trigger_offsets) {
-		maccess_noinline(mapping2.base_addr + offset);
+		maccess_kind_noinline(experiment.access_kind, mapping2.base_addr + offset);
 	}
 }
 
@@ -144,13 +155,13 @@ __attribute__((always_inline)) inline void workload_sms_same_pc_different_memory
 
 	// Training in mapping1
 	for (size_t offset : experiment.training_offsets) {
-		maccess_noinline(mapping1.base_addr + offset);
+		maccess_kind_noinline(experiment.access_kind, mapping1.base_addr + offset);
 	}
 	mfence();
 
 	// Trigger in mapping2
 	for (size_t offset : experiment.trigger_offsets) {
-		maccess_noinline(mapping2.base_addr + offset);
+		maccess_kind_noinline(experiment.access_kind, mapping2.base_addr + offset);
 	}
 }
 
@@ -174,7 +185,7 @@ __attribute__((always_inline)) inline void workload_sms_different_pc_same_memory
 
 	// Training in mapping2
 	for (size_t offset : experiment.training_offsets) {
-		maccess(mapping2.base_addr + offset);
+		maccess_kind(experiment.access_kind, mapping2.base_addr + offset);
 	}
 	mfence();
 
@@ -192,7 +203,7 @@ __attribute__((always_inline)) inline void workload_sms_different_pc_same_memory
 
 	// Trigger in mapping2 (different PC)
 	for (size_t offset : experiment.trigger_offsets) {
-		maccess(mapping2.base_addr + offset);
+		maccess_kind(experiment.access_kind, mapping2.base_addr + offset);
 	}
 }
 
@@ -15,6 +15,7 @@
 #include "logger.hh"
 #include "utils.hh"
 #include "mapping.hh"
+#include "msr_controller.hh"
 
 #include "testcase_stream_streamexperiment.hh"
 
@@ -44,10 +45,7 @@ protected:
 	virtual Json pre_test() override {
 		architecture_t arch = get_arch();
 		if (arch == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, false);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_L2_HW_PREFETCHER);
 		} else if (arch == ARCH_ARM) {
 		}
 		return Json::object {
@@ -57,10 +55,7 @@ protected:
 
 	virtual Json post_test() override {
 		if (get_arch() == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, true);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
 		}
 		return Json::object {};
 	}
@@ -102,16 +97,17 @@ protected:
 
 			trigger_offsets.push_back(first_access);
 			StreamExperiment experiment { training_offsets, trigger_offsets, use_nanosleep, fr_thresh, noise_thresh };
+			experiment.access_kind = access_kind;
 
 			random_activity(mapping);
 			flush_mapping(mapping);
 			// run experiments
-			vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stream_basic, nullptr);
-			vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+			CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stream_basic, nullptr);
+			PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
 
 			// Dump cache histogram
 			string test_sign = (sign == 1)? "pos" : "neg";
-			string dump_filename = "trace-stream_"+test_sign+".json";
+			string dump_filename = "trace-stream_"+test_sign+access_kind_suffix()+".json";
 			experiment.dump(cache_histogram, prefetch_vector, dump_filename);
 			dump_filenames.push_back(dump_filename);
 
@@ -133,7 +129,7 @@ protected:
 			training_offsets.clear();
 			trigger_offsets.clear();
 		}
-		plot_stream(string{__FUNCTION__}, dump_filenames);
+		plot_stream(string{__FUNCTION__} + access_kind_suffix(), dump_filenames);
 		unmap_mapping(mapping);
 		printf("prefetch[+1,+2]/load  (+ve): %zu/%zu (-ve): %zu/%zu\n", prefetch_count_pos, pos_size, prefetch_count_neg, neg_size);
 
@@ -149,13 +145,15 @@ protected:
 		// Low repetition as gem5 is slow and has less noise
 		size_t no_repetitions = 40000 * (PAGE_SIZE / 4096);
 		
-		Json test_results = test_base_test(no_repetitions);
-		bool identified = (test_results["stream_existence"].bool_value());
-
-		return Json::object {
-			{ "identified", identified },
-			{ "test_base_test", test_results },
-		};
+		return identify_per_access_kind([&]() {
+			Json test_results = test_base_test(no_repetitions);
+			bool identified = (test_results["stream_existence"].bool_value());
+
+			return Json::object {
+				{ "identified", identified },
+				{ "test_base_test", test_results },
+			};
+		});
 	}
 
 	virtual Json characterize() override {
@@ -71,9 +71,8 @@ bool StreamExperiment::cl_potential_prefetch(size_t cl_idx) const {
  * execution of the workload. The probed cache line moves by +1 in each
  * iteration, and wraps around once the end of the memory area is
  * reached. The cache histogram represents the cache state after the
- * experiment. It is a vector<size_t>, where each entry represents one
- * of the cache lines. The value indicates the number of hits seen in
- * this cache line.
+ * experiment. For each of the cache lines, it counts the number of
+ * probes and the number of hits seen in this cache line.
  *
  * @param      mapping         The mapping to execute the workload on
  * @param[in]  no_repetitions  Number of repetitions
@@ -81,15 +80,20 @@ bool StreamExperiment::cl_potential_prefetch(size_t cl_idx) const {
  *
  * @return     Cache histogram (absolute counters per cache line)
  */
-vector<size_t> StreamExperiment::collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(StreamExperiment const&, Mapping const&, void*), void* additional_info) {
+CacheHistogram StreamExperiment::collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(StreamExperiment const&, Mapping const&, void*), void* additional_info) {
 	// ensure the maximum offset is in bounds of the mapping
 	assert(training_offsets.size() > 0);
 	vector<size_t>::const_iterator max_it = std::max_element(training_offsets.begin(), training_offsets.end());
 	assert(max_it != training_offsets.end());
 	assert(mapping.base_addr + *max_it < mapping.base_addr + mapping.size);
 	
-	vector<size_t> cache_histogram (mapping.size / CACHE_LINE_SIZE, 0);
+	CacheHistogram cache_histogram (mapping.size / CACHE_LINE_SIZE);
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
 	for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+		noise_monitor.begin_window();
+
 		// flush mappings
 		flush_mapping(mapping);
 		
@@ -104,13 +108,13 @@ vector<size_t> StreamExperiment::collect_cache_histogram(Mapping const& mapping,
 			nanosleep(&t_req, &t_rem);
 		}
 
-		// probe probe array
+		// probe probe array, keep the result only if the repetition was
+		// not disturbed
 		size_t probe_idx = repetition % (cache_histogram.size());
-		probe_single(cache_histogram, probe_idx, mapping.base_addr + (probe_idx * CACHE_LINE_SIZE));
-	}
-	// normalize cache histogram
-	for (size_t& hist_value : cache_histogram) {
-		hist_value = hist_value * 1000 / (no_repetitions / cache_histogram.size());
+		probe_result_t result = probe_single(mapping.base_addr + (probe_idx * CACHE_LINE_SIZE));
+		if (noise_monitor.end_window(noise_stats)) {
+			cache_histogram.record(probe_idx, result);
+		}
 	}
 	return cache_histogram;
 }
@@ -127,15 +131,20 @@ vector<size_t> StreamExperiment::collect_cache_histogram(Mapping const& mapping,
  *
  * @return     Cache histogram (absolute counters per cache line)
  */
-vector<size_t> StreamExperiment::collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(StreamExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info) {
+CacheHistogram StreamExperiment::collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(StreamExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info) {
 	// ensure the maximum offset is in bounds of both mappings
 	assert(training_offsets.size() > 0);
 	vector<size_t>::const_iterator max_it = std::max_element(training_offsets.begin(), training_offsets.end());
 	assert(mapping1.base_addr + *max_it < mapping1.base_addr + mapping1.size);
 	assert(mapping2.base_addr + *max_it < mapping2.base_addr + mapping2.size);
 
-	vector<size_t> cache_histogram (mapping2.size / CACHE_LINE_SIZE, 0);
+	CacheHistogram cache_histogram (mapping2.size / CACHE_LINE_SIZE);
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
 	for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+		noise_monitor.begin_window();
+
 		// flush mappings
 		flush_mapping(mapping1);
 		flush_mapping(mapping2);
@@ -151,29 +160,28 @@ vector<size_t> StreamExperiment::collect_cache_histogram(Mapping const& mapping1
 			nanosleep(&t_req, &t_rem);
 		}
 
-		// probe probe array
+		// probe probe array, keep the result only if the repetition was
+		// not disturbed
 		size_t probe_idx = repetition % (cache_histogram.size());
-		probe_single(cache_histogram, probe_idx, mapping2.base_addr + (probe_idx * CACHE_LINE_SIZE));
-	}
-	// normalize cache histogram
-	for (size_t& hist_value : cache_histogram) {
-		hist_value = hist_value * 1000 / (no_repetitions / cache_histogram.size());
+		probe_result_t result = probe_single(mapping2.base_addr + (probe_idx * CACHE_LINE_SIZE));
+		if (noise_monitor.end_window(noise_stats)) {
+			cache_histogram.record(probe_idx, result);
+		}
 	}
 	return cache_histogram;
 }
 
 /**
- * Reduces a cache histogram, i.e., vector<size_t>, to a vector<bool>
- * of same size. Cache lines where prefetches were both _expected_ AND
- * _observed_ are marked as `true` in the returned "prefetch vector".
- * All other lines are marked `false`.
+ * Reduces a cache histogram to a PrefetchVector of same size. Cache
+ * lines where prefetches were both _expected_ AND _observed_ are marked
+ * in the returned "prefetch vector". All other lines are unmarked.
  *
  * @param      cache_histogram       The cache histogram
  * @param[in]  threshold_multiplier  The threshold multiplier
  *
  * @return     prefetch vector.
  */
-vector<bool> StreamExperiment::evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const {
+PrefetchVector StreamExperiment::evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const {
 	// compute averages for (a) all locations where we expect hits,
 	// (b) all locations where we expect misses
 	size_t hit_avg = 0, hit_n = 0;
@@ -209,7 +217,7 @@ vector<bool> StreamExperiment::evaluate_cache_histogram(vector<size_t> const& ca
 
 	// iterate over the possible prefetch locations and use the prefetch_threshold
 	// to decide whether this is a prefetch or not.
-	vector<bool> prefetch_vector (cache_histogram.size(), false);
+	PrefetchVector prefetch_vector (cache_histogram.size());
 	for (size_t cl_idx = 0; cl_idx < cache_histogram.size(); cl_idx++) {
 		// check whether this is a prefetch location or not
 		if (cl_potential_prefetch(cl_idx)) {
@@ -220,7 +228,7 @@ vector<bool> StreamExperiment::evaluate_cache_histogram(vector<size_t> const& ca
 				// check whether the value exceeds the prefetch threshold
 				if (cache_histogram[cl_idx] >= prefetch_thresh) {
 					L::debug(" *** I think this is a prefetch (%zu >= %zu). ***\n", cache_histogram[cl_idx], prefetch_thresh);
-					prefetch_vector[cl_idx] = true;
+					prefetch_vector.set(cl_idx);
 				}
 			}
 		}
@@ -237,27 +245,21 @@ vector<bool> StreamExperiment::evaluate_cache_histogram(vector<size_t> const& ca
  *
  * @return     prefetch vector.
  */
-vector<bool> StreamExperiment::evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions) const {
+PrefetchVector StreamExperiment::evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions) const {
 	return evaluate_cache_histogram(cache_histogram, no_repetitions, 1.0/64);
 }
 
 /**
  * Dumps a Stream Experiment and a cache histogram to a JSON file.
+ * The fill levels of the prefetched lines are added to the
+ * FillLevelSummary, the degree, distance, coverage and timeliness of
+ * the prefetches to the PrefetchMetrics.
  *
  * @param      cache_histogram  The cache histogram
  * @param[in]  prefetch_vector  The prefetch vector
  * @param      filepath         The file path to the JSON file
  */
-void StreamExperiment::dump(vector<size_t> const& cache_histogram, vector<bool> prefetch_vector, string const& filepath) const {
-	// Build a JSON array from the cache histogram numbers
-	Json::array cache_histogram_values {};
-	for (size_t i = 0; i < cache_histogram.size(); i++) {
-		cache_histogram_values.push_back((int)cache_histogram[i]);
-	}
-	Json::array prefetch_vector_values {};
-	for (size_t i = 0; i < prefetch_vector.size(); i++) {
-		prefetch_vector_values.push_back((bool)prefetch_vector[i]);
-	}
+void StreamExperiment::dump(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector, string const& filepath) const {
 	Json::array training_offsets_values {};
 	for (size_t i = 0; i < training_offsets.size(); i++) {
 		training_offsets_values.push_back((int)training_offsets[i]);
@@ -273,10 +275,24 @@ void StreamExperiment::dump(vector<size_t> const& cache_histogram, vector<bool>
 		{ "use_nanosleep", use_nanosleep },
 		{ "fr_thresh", (int)fr_thresh },
 		{ "noise_thresh", (int)noise_thresh },
-		{ "cache_histogram", cache_histogram_values },
-		{ "prefetch_vector", prefetch_vector },
+		{ "cache_histogram", cache_histogram.normalized_to_json() },
+		{ "cache_histogram_hits", cache_histogram.hits_to_json() },
+		{ "cache_histogram_probes", cache_histogram.probes_to_json() },
+		{ "cache_histogram_levels", cache_histogram.levels_to_json() },
+		{ "prefetch_vector", prefetch_vector.to_json() },
+		{ "prefetch_fill_levels", cache_histogram.fill_levels_to_json(prefetch_vector) },
 		{ "cache_line_size", CACHE_LINE_SIZE },
+		{ "probe_fr_thresh", (int)probe_fr_thresh },
+		{ "noise", noise_stats.to_json() },
+		{ "numa_node", get_mapping_numa_node() },
+		{ "access_kind", access_kind_to_string(access_kind) },
 	};
+	FillLevelSummary::get().add(cache_histogram, prefetch_vector);
+	PrefetchVector potential_vector (cache_histogram.size());
+	for (size_t cl_idx = 0; cl_idx < cache_histogram.size(); cl_idx++) {
+		potential_vector.set(cl_idx, cl_potential_prefetch(cl_idx));
+	}
+	PrefetchMetrics::get().add(cache_histogram, prefetch_vector, potential_vector, (trigger_offsets.empty() ? training_offsets.back() : trigger_offsets.back()) / CACHE_LINE_SIZE);
 	
 	// write JSON to file
 	std::ofstream file;
@@ -292,7 +308,7 @@ void StreamExperiment::dump(vector<size_t> const& cache_histogram, vector<bool>
  *
  * @return     Pair of stride experiment object and cache histogram.
  */
-pair<StreamExperiment, vector<size_t>> StreamExperiment::restore(string const& filepath) {
+pair<StreamExperiment, CacheHistogram> StreamExperiment::restore(string const& filepath) {
 	std::ifstream file;
 	file.open(filepath);
 	string line;
@@ -324,11 +340,9 @@ pair<StreamExperiment, vector<size_t>> StreamExperiment::restore(string const& f
 		(size_t)json["fr_thresh"].int_value(),
 		(size_t)json["noise_thresh"].int_value(),
 	};
-
-	vector<size_t> cache_histogram;
-	for (Json value : json["cache_histogram"].array_items()) {
-		cache_histogram.push_back((size_t)value.int_value());
+	if (json["access_kind"].is_string()) {
+		experiment.access_kind = access_kind_from_string(json["access_kind"].string_value());
 	}
-	
-	return {experiment, cache_histogram};
+
+	return {experiment, CacheHistogram::from_json(json)};
 }
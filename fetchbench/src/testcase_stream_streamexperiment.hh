@@ -13,31 +13,18 @@
 #include "utils.hh"
 #include "aligned_maccess.hh"
 #include "mapping.hh"
+#include "cache_histogram.hh"
+#include "prefetch_metrics.hh"
+#include "noise_monitor.hh"
+#include "frequency_guard.hh"
+#include "access_kind.hh"
 
 using json11::Json;
 using std::vector;
 
-// Array of maccess used for creating entries in stream prefetcher
-static void (*maccess_stream_array [20]) (void *p) = { maccess_1,
-						maccess_2,
-						maccess_3,
-						maccess_4,
-						maccess_5,
-						maccess_6,
-						maccess_7,
-						maccess_8,
-						maccess_9,
-						maccess_10,
-						maccess_11,
-						maccess_12,
-						maccess_13,
-						maccess_14,
-						maccess_15,
-						maccess_16,
-						maccess_17,
-						maccess_18,
-						maccess_19,
-						maccess_20, };
+// Distinct access functions used for creating entries in stream
+// prefetcher (see maccess_kind_n())
+static vector<maccess_kind_func_t> const maccess_stream_functions = get_maccess_kind_functions<20>();
 
 class StreamExperiment {
 public:
@@ -56,6 +43,13 @@ public:
 	// structs for nanosleep
 	struct timespec const t_req;
 	struct timespec t_rem;
+	// repetitions discarded because of noise (see NoiseMonitor)
+	NoiseStats noise_stats;
+	// Flush+Reload threshold used by the last collection (fr_thresh,
+	// scaled if the frequency changed, see FrequencyGuard)
+	size_t probe_fr_thresh = 0;
+	// kind of the accesses of the workload (see maccess_kind())
+	access_kind_t access_kind = ACCESS_KIND_LOAD;
 
 private:
 	// relative distances of later training loads to the first training load
@@ -69,26 +63,25 @@ public:
 	bool cl_potential_prefetch(size_t cl_idx) const;
 
 private:
-	inline void probe_single(vector<size_t>& cache_histogram, size_t idx, uint8_t* ptr) const __attribute__((always_inline)) {
-		assert(idx < cache_histogram.size());
+	inline probe_result_t probe_single(uint8_t* ptr) const __attribute__((always_inline)) {
 		size_t time = flush_reload_t(ptr);
-		cache_histogram[idx] += (time < fr_thresh) ? 1 : 0;
+		return { time < probe_fr_thresh, LatencyBands::get().classify(time) };
 	}
 
 public:
-	vector<size_t> collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(StreamExperiment const&, Mapping const&, void*), void* additional_info);
-	vector<size_t> collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(StreamExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info);
-	vector<bool> evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const;
-	vector<bool> evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions) const;
-	void dump(vector<size_t> const& cache_histogram, vector<bool> prefetch_vector, string const& filepath) const;
-	static pair<StreamExperiment, vector<size_t>> restore(string const& filepath);
+	CacheHistogram collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(StreamExperiment const&, Mapping const&, void*), void* additional_info);
+	CacheHistogram collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(StreamExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info);
+	PrefetchVector evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const;
+	PrefetchVector evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions) const;
+	void dump(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector, string const& filepath) const;
+	static pair<StreamExperiment, CacheHistogram> restore(string const& filepath);
 };
 
 // ===== WORKLOADS =====
 
 /**
- * Basic stream prefetcher workload. Uses different PCs to load from the
- * offsets specified in .training_offsets.
+ * Basic stream prefetcher workload. Uses different PCs to access (with the
+ * experiment's access kind) the offsets specified in .training_offsets.
  *
  * @param      experiment       The experiment
  * @param      mapping1         The mapping to work in
@@ -97,12 +90,12 @@ public:
  */
 __attribute__((always_inline)) inline void workload_stream_basic(StreamExperiment const& experiment, Mapping const& mapping1, void* additional_info) {
 	assert(additional_info == nullptr);
-	int i = 0;
-	int max = sizeof(maccess_stream_array)/sizeof(maccess_stream_array[0]);
+	size_t i = 0;
+	size_t max = maccess_stream_functions.size();
 
-	// every load is unique to ensure different PC
+	// every access is unique to ensure different PC
 	for (size_t offset : experiment.training_offsets) {
-		maccess_stream_array[i % max](mapping1.base_addr + offset);
+		maccess_stream_functions[i % max](experiment.access_kind, mapping1.base_addr + offset);
 		i++;
 	}
 	mfence();
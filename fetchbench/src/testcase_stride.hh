@@ -16,7 +16,11 @@
 #include "logger.hh"
 #include "utils.hh"
 #include "mapping.hh"
+#include "msr_controller.hh"
 
+#include "generated_maccess.hh"
+#include "result_cache.hh"
+#include "search.hh"
 #include "testcase_stride_strideexperiment.hh"
 
 using json11::Json;
@@ -29,26 +33,33 @@ private:
 	size_t const fr_thresh;
 	size_t const noise_thresh;
 	bool use_nanosleep = false;
+	// baseline cache histograms shared between tests
+	ResultCache<CacheHistogram> result_cache;
+	// use the incremental sweep in test_overview
+	bool incremental_overview = false;
 
 public:
-	TestCaseStride(size_t fr_thresh, size_t noise_thresh, bool use_nanosleep)
+	TestCaseStride(size_t fr_thresh, size_t noise_thresh, bool use_nanosleep, size_t result_cache_max_age_min, bool incremental_overview)
 	: fr_thresh {fr_thresh}
 	, noise_thresh {noise_thresh}
 	, use_nanosleep {use_nanosleep}
+	, result_cache {result_cache_max_age_min}
+	, incremental_overview {incremental_overview}
 	{}
 
 	virtual string id() override {
 		return "stride";
 	}
 
+	virtual void invalidate_cached_results() override {
+		result_cache.invalidate();
+	}
+
 protected:
 	virtual Json pre_test() override {
 		architecture_t arch = get_arch();
 		if (arch == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, false);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, true);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_DCU_IP_PREFETCHER);
 		} else if (arch == ARCH_ARM) {
 		}
 		return Json::object {
@@ -58,24 +69,42 @@ protected:
 
 	virtual Json post_test() override {
 		if (get_arch() == ARCH_INTEL) {
-			set_intel_prefetcher(-1, INTEL_L2_HW_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_L2_ADJACENT_CL_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_PREFETCHER, true);
-			set_intel_prefetcher(-1, INTEL_DCU_IP_PREFETCHER, true);
+			set_intel_prefetchers(USE_CURRENT_CPU, INTEL_ALL_PREFETCHERS);
 		}
-		return Json::object {};
+		return Json::object {
+			{"result_cache", result_cache.stats()},
+		};
+	}
+
+	/**
+	 * Collects a cache histogram of the standard workload
+	 * (workload_stride_loop). If an identical experiment was run before,
+	 * e.g., as baseline of another test, and its result is still fresh,
+	 * the cached cache histogram is returned instead.
+	 *
+	 * @param      experiment      The experiment
+	 * @param      mapping         The mapping
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     The cache histogram.
+	 */
+	CacheHistogram collect_cache_histogram_cached(StrideExperiment& experiment, Mapping const& mapping, size_t no_repetitions) {
+		string key = result_cache_key(experiment.cache_key(), "workload_stride_loop", {mapping}, no_repetitions);
+		return result_cache.fetch(key, [&]() {
+			return experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+		});
 	}
 
-	vector<double> compute_diff_factors(vector<bool> const& prefetch_vector_a, vector<bool> const& prefetch_vector_b, StrideExperiment const& experiment_b) {
+	vector<double> compute_diff_factors(PrefetchVector const& prefetch_vector_a, PrefetchVector const& prefetch_vector_b, StrideExperiment const& experiment_b) {
 		// ensure both prefetch vectors have same length
 		assert(prefetch_vector_a.size() == prefetch_vector_b.size());
 
+		// lines that are only prefetched in b
+		PrefetchVector new_prefetches = prefetch_vector_b.andnot(prefetch_vector_a);
 		vector<double> diff_factors;
-		for (size_t cl_idx = 0; cl_idx < prefetch_vector_a.size(); cl_idx++) {
-			if (prefetch_vector_a[cl_idx] == false && prefetch_vector_b[cl_idx] == true) {
-				double delta_multiple_of_stride = ((ssize_t)(cl_idx * CACHE_LINE_SIZE - experiment_b.offset_last_access())) / experiment_b.stride;
-				diff_factors.push_back(delta_multiple_of_stride);
-			}
+		for (size_t cl_idx = new_prefetches.find_first(); cl_idx < new_prefetches.size(); cl_idx = new_prefetches.find_next(cl_idx)) {
+			double delta_multiple_of_stride = ((ssize_t)(cl_idx * CACHE_LINE_SIZE - experiment_b.offset_last_access())) / experiment_b.stride;
+			diff_factors.push_back(delta_multiple_of_stride);
 		}
 		return diff_factors;
 	}
@@ -110,36 +139,36 @@ protected:
 		// run experiments
 		size_t no_accesses_on_mapping2 = 1;
 		// (step-1) loads in mapping1, 1 load in mapping2
-		vector<size_t> cache_histogram_diffmem_1acc = experiment_diffmem.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_stride_same_pc_different_memory, &no_accesses_on_mapping2);
+		CacheHistogram cache_histogram_diffmem_1acc = experiment_diffmem.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_stride_same_pc_different_memory, &no_accesses_on_mapping2);
 		random_activity(mapping1);
 		random_activity(mapping2);
 		flush_mapping(mapping1);
 		flush_mapping(mapping2);
 		no_accesses_on_mapping2 = 2;
 		// (step-2) loads in mapping1, 2 loads in mapping2
-		vector<size_t> cache_histogram_diffmem_2acc = experiment_diffmem.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_stride_same_pc_different_memory, &no_accesses_on_mapping2);
+		CacheHistogram cache_histogram_diffmem_2acc = experiment_diffmem.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_stride_same_pc_different_memory, &no_accesses_on_mapping2);
 		random_activity(mapping1);
 		random_activity(mapping2);
 		flush_mapping(mapping1);
 		flush_mapping(mapping2);
 		// baseline: 1 load in mapping1
-		vector<size_t> cache_histogram_baseline_1acc = experiment_baseline_1acc.collect_cache_histogram(mapping1, no_repetitions, workload_stride_loop, nullptr);
+		CacheHistogram cache_histogram_baseline_1acc = collect_cache_histogram_cached(experiment_baseline_1acc, mapping1, no_repetitions);
 		random_activity(mapping1);
 		random_activity(mapping2);
 		flush_mapping(mapping1);
 		flush_mapping(mapping2);
 		// baseline: 2 loads in mapping1
-		vector<size_t> cache_histogram_baseline_2acc = experiment_baseline_2acc.collect_cache_histogram(mapping1, no_repetitions, workload_stride_loop, nullptr);
+		CacheHistogram cache_histogram_baseline_2acc = collect_cache_histogram_cached(experiment_baseline_2acc, mapping1, no_repetitions);
 
 		// evaluate the recorded trace: count the number of prefetches
 		L::debug("- Baseline: 1 access\n");
-		vector<bool> prefetch_vector_baseline_1acc = experiment_baseline_1acc.evaluate_cache_histogram(cache_histogram_baseline_1acc, no_repetitions);
+		PrefetchVector prefetch_vector_baseline_1acc = experiment_baseline_1acc.evaluate_cache_histogram(cache_histogram_baseline_1acc, no_repetitions);
 		L::debug("- Baseline: 2 accesses\n");
-		vector<bool> prefetch_vector_baseline_2acc = experiment_baseline_2acc.evaluate_cache_histogram(cache_histogram_baseline_2acc, no_repetitions);
+		PrefetchVector prefetch_vector_baseline_2acc = experiment_baseline_2acc.evaluate_cache_histogram(cache_histogram_baseline_2acc, no_repetitions);
 		L::debug("- Different memory areas: 1 access\n");
-		vector<bool> prefetch_vector_diffmem_1acc = experiment_diffmem.evaluate_cache_histogram(cache_histogram_diffmem_1acc, no_repetitions);
+		PrefetchVector prefetch_vector_diffmem_1acc = experiment_diffmem.evaluate_cache_histogram(cache_histogram_diffmem_1acc, no_repetitions);
 		L::debug("- Different memory areas: 2 accesses\n");
-		vector<bool> prefetch_vector_diffmem_2acc = experiment_diffmem.evaluate_cache_histogram(cache_histogram_diffmem_2acc, no_repetitions);
+		PrefetchVector prefetch_vector_diffmem_2acc = experiment_diffmem.evaluate_cache_histogram(cache_histogram_diffmem_2acc, no_repetitions);
 
 		experiment_baseline_1acc.dump(cache_histogram_baseline_1acc, prefetch_vector_baseline_1acc, "trace-stride-test_trigger_same_pc_different_memory-baseline1.json");
 		experiment_baseline_2acc.dump(cache_histogram_baseline_2acc, prefetch_vector_baseline_2acc, "trace-stride-test_trigger_same_pc_different_memory-baseline2.json");
@@ -152,10 +181,10 @@ protected:
 			"trace-stride-test_trigger_same_pc_different_memory-diffmem2.json",
  		});
 
-		size_t prefetch_count_baseline_1acc = std::count(prefetch_vector_baseline_1acc.begin(), prefetch_vector_baseline_1acc.end(), true);
-		size_t prefetch_count_baseline_2acc = std::count(prefetch_vector_baseline_2acc.begin(), prefetch_vector_baseline_2acc.end(), true);
-		size_t prefetch_count_diffmem_1acc = std::count(prefetch_vector_diffmem_1acc.begin(), prefetch_vector_diffmem_1acc.end(), true);
-		size_t prefetch_count_diffmem_2acc = std::count(prefetch_vector_diffmem_2acc.begin(), prefetch_vector_diffmem_2acc.end(), true);
+		size_t prefetch_count_baseline_1acc = prefetch_vector_baseline_1acc.count();
+		size_t prefetch_count_baseline_2acc = prefetch_vector_baseline_2acc.count();
+		size_t prefetch_count_diffmem_1acc = prefetch_vector_diffmem_1acc.count();
+		size_t prefetch_count_diffmem_2acc = prefetch_vector_diffmem_2acc.count();
 
 		L::info("Prefetch count baseline 1 access:   %zu\n", prefetch_count_baseline_1acc);
 		L::info("Prefetch count baseline 2 accesses: %zu\n", prefetch_count_baseline_2acc);
@@ -195,18 +224,18 @@ protected:
 		StrideExperiment experiment_base { stride, step, 0, use_nanosleep, fr_thresh, noise_thresh };
 		
 		// run experiment; perform (step) loads with (step) different PCs
-		vector<size_t> cache_histogram_diffpc = experiment_base.collect_cache_histogram(mapping, no_repetitions, workload_stride_different_pc_same_memory, nullptr);
+		CacheHistogram cache_histogram_diffpc = experiment_base.collect_cache_histogram(mapping, no_repetitions, workload_stride_different_pc_same_memory, nullptr);
 		random_activity(mapping);
 		flush_mapping(mapping);
 		// run baseline experiment: perform (step) loads with same PC
-		vector<size_t> cache_histogram_baseline_base = experiment_base.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+		CacheHistogram cache_histogram_baseline_base = collect_cache_histogram_cached(experiment_base, mapping, no_repetitions);
 		
 		// Compare traces.
 		// If PC is irrelevant, expect baseline_stm1 < baseline_base && diffpc == baseline_base.
 		L::debug("- Baseline %zu (same PC)\n", experiment_base.step);
-		vector<bool> prefetch_vector_baseline_base = experiment_base.evaluate_cache_histogram(cache_histogram_baseline_base, no_repetitions);
+		PrefetchVector prefetch_vector_baseline_base = experiment_base.evaluate_cache_histogram(cache_histogram_baseline_base, no_repetitions);
 		L::debug("- Different PCs\n");
-		vector<bool> prefetch_vector_diffpc = experiment_base.evaluate_cache_histogram(cache_histogram_diffpc, no_repetitions);
+		PrefetchVector prefetch_vector_diffpc = experiment_base.evaluate_cache_histogram(cache_histogram_diffpc, no_repetitions);
 
 		experiment_base.dump(cache_histogram_baseline_base, prefetch_vector_baseline_base, "trace-stride-test_trigger_different_pc_same_memory-baseline-base.json");
 		experiment_base.dump(cache_histogram_diffpc, prefetch_vector_diffpc, "trace-stride-test_trigger_different_pc_same_memory-diffpc.json");
@@ -216,7 +245,7 @@ protected:
  		});
 
 		// Count prefetches in the experiment with different PCs
-		size_t prefetch_count_diffpc = std::count(prefetch_vector_diffpc.begin(), prefetch_vector_diffpc.end(), true);
+		size_t prefetch_count_diffpc = prefetch_vector_diffpc.count();
 
 		unmap_mapping(mapping);
 
@@ -257,36 +286,36 @@ protected:
 		// run experiments
 		size_t no_accesses_on_mapping2 = 1;
 		// (step-1) loads in mapping1, 1 load in mapping2
-		vector<size_t> cache_histogram_diff_1acc = experiment_diff.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_stride_different_pc_different_memory, &no_accesses_on_mapping2);
+		CacheHistogram cache_histogram_diff_1acc = experiment_diff.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_stride_different_pc_different_memory, &no_accesses_on_mapping2);
 		random_activity(mapping1);
 		random_activity(mapping2);
 		flush_mapping(mapping1);
 		flush_mapping(mapping2);
 		no_accesses_on_mapping2 = 2;
 		// (step-2) loads in mapping1, 2 loads in mapping2
-		vector<size_t> cache_histogram_diff_2acc = experiment_diff.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_stride_different_pc_different_memory, &no_accesses_on_mapping2);
+		CacheHistogram cache_histogram_diff_2acc = experiment_diff.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_stride_different_pc_different_memory, &no_accesses_on_mapping2);
 		random_activity(mapping1);
 		random_activity(mapping2);
 		flush_mapping(mapping1);
 		flush_mapping(mapping2);
 		// baseline: 1 load in mapping1
-		vector<size_t> cache_histogram_baseline_1acc = experiment_baseline_1acc.collect_cache_histogram(mapping1, no_repetitions, workload_stride_loop, nullptr);
+		CacheHistogram cache_histogram_baseline_1acc = collect_cache_histogram_cached(experiment_baseline_1acc, mapping1, no_repetitions);
 		random_activity(mapping1);
 		random_activity(mapping2);
 		flush_mapping(mapping1);
 		flush_mapping(mapping2);
 		// baseline: 2 loads in mapping1
-		vector<size_t> cache_histogram_baseline_2acc = experiment_baseline_2acc.collect_cache_histogram(mapping1, no_repetitions, workload_stride_loop, nullptr);
+		CacheHistogram cache_histogram_baseline_2acc = collect_cache_histogram_cached(experiment_baseline_2acc, mapping1, no_repetitions);
 
 		// evaluate the recorded trace: count the number of prefetches
 		L::debug("- Baseline: 1 access\n");
-		vector<bool> prefetch_vector_baseline_1acc = experiment_baseline_1acc.evaluate_cache_histogram(cache_histogram_baseline_1acc, no_repetitions);
+		PrefetchVector prefetch_vector_baseline_1acc = experiment_baseline_1acc.evaluate_cache_histogram(cache_histogram_baseline_1acc, no_repetitions);
 		L::debug("- Baseline: 2 accesses\n");
-		vector<bool> prefetch_vector_baseline_2acc = experiment_baseline_2acc.evaluate_cache_histogram(cache_histogram_baseline_2acc, no_repetitions);
+		PrefetchVector prefetch_vector_baseline_2acc = experiment_baseline_2acc.evaluate_cache_histogram(cache_histogram_baseline_2acc, no_repetitions);
 		L::debug("- Different memory areas: 1 access\n");
-		vector<bool> prefetch_vector_diff_1acc = experiment_diff.evaluate_cache_histogram(cache_histogram_diff_1acc, no_repetitions);
+		PrefetchVector prefetch_vector_diff_1acc = experiment_diff.evaluate_cache_histogram(cache_histogram_diff_1acc, no_repetitions);
 		L::debug("- Different memory areas: 2 accesses\n");
-		vector<bool> prefetch_vector_diff_2acc = experiment_diff.evaluate_cache_histogram(cache_histogram_diff_2acc, no_repetitions);
+		PrefetchVector prefetch_vector_diff_2acc = experiment_diff.evaluate_cache_histogram(cache_histogram_diff_2acc, no_repetitions);
 
 		experiment_baseline_1acc.dump(cache_histogram_baseline_1acc, prefetch_vector_baseline_1acc, "trace-stride-test_trigger_different_pc_different_memory-baseline1.json");
 		experiment_baseline_2acc.dump(cache_histogram_baseline_2acc, prefetch_vector_baseline_2acc, "trace-stride-test_trigger_different_pc_different_memory-baseline2.json");
@@ -299,10 +328,10 @@ protected:
 			"trace-stride-test_trigger_different_pc_different_memory-diffmem2.json",
  		});
 
-		size_t prefetch_count_baseline_1acc = std::count(prefetch_vector_baseline_1acc.begin(), prefetch_vector_baseline_1acc.end(), true);
-		size_t prefetch_count_baseline_2acc = std::count(prefetch_vector_baseline_2acc.begin(), prefetch_vector_baseline_2acc.end(), true);
-		size_t prefetch_count_diff_1acc = std::count(prefetch_vector_diff_1acc.begin(), prefetch_vector_diff_1acc.end(), true);
-		size_t prefetch_count_diff_2acc = std::count(prefetch_vector_diff_2acc.begin(), prefetch_vector_diff_2acc.end(), true);
+		size_t prefetch_count_baseline_1acc = prefetch_vector_baseline_1acc.count();
+		size_t prefetch_count_baseline_2acc = prefetch_vector_baseline_2acc.count();
+		size_t prefetch_count_diff_1acc = prefetch_vector_diff_1acc.count();
+		size_t prefetch_count_diff_2acc = prefetch_vector_diff_2acc.count();
 
 		L::info("Prefetch count baseline 1 access:   %zu\n", prefetch_count_baseline_1acc);
 		L::info("Prefetch count baseline 2 accesses: %zu\n", prefetch_count_baseline_2acc);
@@ -324,13 +353,18 @@ protected:
 
 	/**
 	 * "Test" to generate data that can be plotted in a nice overview
-	 * heatmap.
+	 * heatmap. In incremental mode, all steps of a stride are measured
+	 * in a single collection that only probes the lines that can newly
+	 * become prefetched after each step (see
+	 * collect_cache_histograms_incremental()) instead of running one
+	 * independent experiment per step.
 	 *
 	 * @param[in]  no_repetitions  No repetitions
+	 * @param[in]  incremental     Use the incremental sweep
 	 *
 	 * @return     { description_of_the_return_value }
 	 */
-	Json test_overview(size_t no_repetitions) {
+	Json test_overview(size_t no_repetitions, bool incremental) {
 		L::info("Test: %s\n", __FUNCTION__);
 		Mapping mapping = allocate_mapping(8 * PAGE_SIZE);
 		random_activity(mapping);
@@ -345,20 +379,31 @@ protected:
 		// different step sizes to test for prefetching in both directions
 		for (ssize_t const sign : {-1, 1}) { // for positive and for negative direction (stride)
 			for (ssize_t stride = sign * CACHE_LINE_SIZE; std::abs(stride) <= (PAGE_SIZE / 2); stride *= 2) {
-				vector<bool> previous_prefetch_vector(mapping.size / CACHE_LINE_SIZE, false);
+				PrefetchVector previous_prefetch_vector (mapping.size / CACHE_LINE_SIZE);
+				// for negative strides, start at the end of the memory area
+				size_t first_access_offset = (sign == 1) ? 0 : (mapping.size - CACHE_LINE_SIZE);
+				vector<CacheHistogram> cache_histograms;
+				if (incremental) {
+					L::info("stride = %zd, steps = 1..14\n", stride);
+					StrideExperiment experiment { stride, 14, first_access_offset, use_nanosleep, fr_thresh, noise_thresh };
+					cache_histograms = experiment.collect_cache_histograms_incremental(mapping, no_repetitions);
+					random_activity(mapping);
+					flush_mapping(mapping);
+				}
 				for (size_t step = 1; step <= 14; step++) {
-					L::info("stride = %zd, step = %zu\n", stride, step);
-					
-					// for negative strides, start at the end of the memory area
-					size_t first_access_offset = (sign == 1) ? 0 : (mapping.size - CACHE_LINE_SIZE);
 					// run the experiment
 					StrideExperiment experiment { stride, step, first_access_offset, use_nanosleep, fr_thresh, noise_thresh };
-					vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+					CacheHistogram cache_histogram;
+					if (incremental) {
+						cache_histogram = cache_histograms[step - 1];
+					} else {
+						L::info("stride = %zd, step = %zu\n", stride, step);
+						cache_histogram = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+						random_activity(mapping);
+						flush_mapping(mapping);
+					}
 					// evaluate the trace
-					vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
-					
-					random_activity(mapping);
-					flush_mapping(mapping);
+					PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
 				
 					// compare the recorded trace to the trace of the previous
 					// experiment (= same stride, step-1). Identify the newly
@@ -393,6 +438,7 @@ protected:
 
 		return Json::object {
 			{"status", "completed"},
+			{"incremental", incremental},
 		};
 	}
 
@@ -415,28 +461,32 @@ protected:
 		size_t step = 12;
 		StrideExperiment experiment_pos { stride, step, 0, use_nanosleep, fr_thresh, noise_thresh };
 		StrideExperiment experiment_neg { -stride, step, mapping.size - CACHE_LINE_SIZE, use_nanosleep, fr_thresh, noise_thresh };
+		experiment_pos.access_kind = access_kind;
+		experiment_neg.access_kind = access_kind;
 
 		// run experiments
-		vector<size_t> cache_histogram_pos = experiment_pos.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+		CacheHistogram cache_histogram_pos = collect_cache_histogram_cached(experiment_pos, mapping, no_repetitions);
 		random_activity(mapping);
 		flush_mapping(mapping);
-		vector<size_t> cache_histogram_neg = experiment_neg.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+		CacheHistogram cache_histogram_neg = experiment_neg.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
 
 		// evaluate the recorded trace: count the number of prefetches
 		L::debug("- Direction: positive\n");
-		vector<bool> prefetch_vector_pos = experiment_pos.evaluate_cache_histogram(cache_histogram_pos, no_repetitions);
+		PrefetchVector prefetch_vector_pos = experiment_pos.evaluate_cache_histogram(cache_histogram_pos, no_repetitions);
 		L::debug("- Direction: negative\n");
-		vector<bool> prefetch_vector_neg = experiment_neg.evaluate_cache_histogram(cache_histogram_neg, no_repetitions);
-
-		experiment_pos.dump(cache_histogram_pos, prefetch_vector_pos, "trace-stride-test_direction-pos.json");
-		experiment_neg.dump(cache_histogram_neg, prefetch_vector_neg, "trace-stride-test_direction-neg.json");
-		plot_stride(string{__FUNCTION__}, {
-			"trace-stride-test_direction-pos.json",
-			"trace-stride-test_direction-neg.json",
+		PrefetchVector prefetch_vector_neg = experiment_neg.evaluate_cache_histogram(cache_histogram_neg, no_repetitions);
+
+		string dump_filename_pos = "trace-stride-test_direction-pos" + access_kind_suffix() + ".json";
+		string dump_filename_neg = "trace-stride-test_direction-neg" + access_kind_suffix() + ".json";
+		experiment_pos.dump(cache_histogram_pos, prefetch_vector_pos, dump_filename_pos);
+		experiment_neg.dump(cache_histogram_neg, prefetch_vector_neg, dump_filename_neg);
+		plot_stride(string{__FUNCTION__} + access_kind_suffix(), {
+			dump_filename_pos,
+			dump_filename_neg,
  		});
 
-		size_t prefetch_count_pos = std::count(prefetch_vector_pos.begin(), prefetch_vector_pos.end(), true);
-		size_t prefetch_count_neg = std::count(prefetch_vector_neg.begin(), prefetch_vector_neg.end(), true);
+		size_t prefetch_count_pos = prefetch_vector_pos.count();
+		size_t prefetch_count_neg = prefetch_vector_neg.count();
 
 		L::info("Prefetch count positive direction: %zu\n", prefetch_count_pos);
 		L::info("Prefetch count negative direction: %zu\n", prefetch_count_neg);
@@ -468,15 +518,15 @@ protected:
 		random_activity(mapping);
 		flush_mapping(mapping);
 
-		vector<pair<StrideExperiment, vector<bool>>> results;
+		vector<pair<StrideExperiment, PrefetchVector>> results;
 		vector<string> dump_filenames;
 		ssize_t stride = 3 * CACHE_LINE_SIZE;
 		for (size_t step = 1; step <= 20; step++) {
 			// insert a progressive pattern 1, 2, 3 ... steps
 			StrideExperiment experiment { stride, step, 0, use_nanosleep, fr_thresh, noise_thresh };
-			vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+			CacheHistogram cache_histogram = collect_cache_histogram_cached(experiment, mapping, no_repetitions);
 			// probe number of prefetches
-			vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+			PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
 			results.push_back({experiment, prefetch_vector});
 
 			string dump_filename = "trace-stride-test_load_pref_corr-step_" + zero_pad(step, 2) + ".json";
@@ -494,8 +544,8 @@ protected:
 		Json::array results_json;
 		for (size_t i = 1; i < results.size(); i++) {
 			StrideExperiment const& experiment = results[i].first;
-			vector<bool> const& prefetch_vector = results[i].second;
-			vector<bool> const& previous_prefetch_vector = results[i-1].second;
+			PrefetchVector const& prefetch_vector = results[i].second;
+			PrefetchVector const& previous_prefetch_vector = results[i-1].second;
 
 			vector<double> diffs = compute_diff_factors(previous_prefetch_vector, prefetch_vector, experiment);
 			L::debug("step = %zu; diffs: ", experiment.step);
@@ -547,9 +597,9 @@ protected:
 		vector<string> dump_filenames;
 		for (size_t step = 2; step <= 48; step++) {
 			StrideExperiment experiment { stride, step, 0, use_nanosleep, fr_thresh, noise_thresh };
-			vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
-			vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
-			size_t count = std::count(prefetch_vector.begin(), prefetch_vector.end(), true);
+			CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+			PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+			size_t count = prefetch_vector.count();
 			set_or_increment<size_t,size_t>(no_prefetch_hist, count, 1);
 		
 			string dump_filename = "trace-stride-test_no_prefetches-step_" + zero_pad(step, 2) + ".json";
@@ -606,7 +656,11 @@ protected:
 	
 	/**
 	 * Find the minimum/maximum stride in range [CACHE_LINE_SIZE,
-	 * 4*PAGE_SIZE].
+	 * 4*PAGE_SIZE]. Whether a stride triggers prefetching is monotone on
+	 * both sides of the supported range, so instead of sweeping all
+	 * power-of-two strides, we search the boundaries with
+	 * find_boundary(). Each probe point trains 12 steps and compares the
+	 * lines right after the last access with lines far beyond it.
 	 *
 	 * @param[in]  no_repetitions  Number of repetitions
 	 *
@@ -617,64 +671,92 @@ protected:
 		Mapping mapping = allocate_mapping(129 * PAGE_SIZE);
 		flush_mapping(mapping);
 
-		// start with 1 cache line and hop by multiple of twos power
-		// map<stride, max. prefetch count across all "steps" iterations>
-		map<ssize_t, size_t> stride_hist;
+		size_t const step = 12;
+		// strides are CACHE_LINE_SIZE << exponent
+		size_t const max_exponent = __builtin_ctzl(4 * PAGE_SIZE / CACHE_LINE_SIZE);
+
 		vector<string> dump_filenames;
+		Json::object searches_json;
+		// map<sign, pair<min stride, max stride>>
+		map<ssize_t, pair<ssize_t, ssize_t>> stride_limits;
 		for (ssize_t sign : {-1, 1}) {
-			for (ssize_t stride = sign * CACHE_LINE_SIZE; std::abs(stride) <= 4 * PAGE_SIZE; stride *= 2){
-				for (size_t step = 5; step <= 12; step++) {
-					L::debug("Testing stride: %zd, steps: %zu\n", stride, step);
-					
-					// work in a sub_mapping, since probing a large mapping takes time
-					Mapping sub_mapping { .base_addr = mapping.base_addr, .size = ((std::abs(stride) * (step + 20)) + CACHE_LINE_SIZE) };
-					assert(sub_mapping.size <= mapping.size);
-
-					// run the experiment
-					// for negative strides, start at the end of the memory area
-					size_t first_access_offset = (sign == 1) ? 0 : (sub_mapping.size - CACHE_LINE_SIZE);
-					StrideExperiment experiment { stride, step, first_access_offset, use_nanosleep, fr_thresh, noise_thresh };
-					vector<size_t> cache_histogram = experiment.collect_cache_histogram_lazy(sub_mapping, no_repetitions, workload_stride_loop, nullptr);
-
-					// evaluate
-					vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
-					size_t count = std::count(prefetch_vector.begin(), prefetch_vector.end(), true);
-					L::debug("step: %zu, count: %zu\n", step, count);
+			probe_func_t triggers_prefetch = [&](size_t exponent, size_t attempt) -> verdict_t {
+				ssize_t stride = sign * (CACHE_LINE_SIZE << exponent);
+				size_t repetitions = no_repetitions * (attempt + 1);
+				L::debug("Testing stride: %zd, steps: %zu\n", stride, step);
+
+				// work in a sub_mapping, since probing a large mapping takes time
+				Mapping sub_mapping { .base_addr = mapping.base_addr, .size = ((std::abs(stride) * (step + 20)) + CACHE_LINE_SIZE) };
+				assert(sub_mapping.size <= mapping.size);
+
+				// run the experiment
+				// for negative strides, start at the end of the memory area
+				size_t first_access_offset = (sign == 1) ? 0 : (sub_mapping.size - CACHE_LINE_SIZE);
+				StrideExperiment experiment { stride, step, first_access_offset, use_nanosleep, fr_thresh, noise_thresh };
+				CacheHistogram cache_histogram = experiment.collect_cache_histogram_lazy(sub_mapping, repetitions, workload_stride_loop, nullptr);
+
+				// evaluate: the first few multiples of the stride after the
+				// last access are compared against multiples far beyond
+				PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, repetitions);
+				vector<size_t> signal_indices;
+				vector<size_t> reference_indices;
+				for (ssize_t multiple = 1; multiple <= 4; multiple++) {
+					signal_indices.push_back((experiment.offset_last_access() + multiple * stride) / CACHE_LINE_SIZE);
+					reference_indices.push_back((experiment.offset_last_access() + (multiple + 15) * stride) / CACHE_LINE_SIZE);
+				}
+				verdict_t verdict = compare_hit_rates(cache_histogram, signal_indices, reference_indices);
+				L::debug("stride: %zd, count: %zu\n", stride, (size_t)prefetch_vector.count());
 
-					string dump_filename = "trace-stride-test_min_max_stride-stride_" + zero_pad(stride, 5) + "-step_" + zero_pad(step, 2) + ".json";
-					experiment.dump(cache_histogram, prefetch_vector, dump_filename);
+				string dump_filename = "trace-stride-test_min_max_stride-stride_" + zero_pad(stride, 5) + "-step_" + zero_pad(step, 2) + ".json";
+				experiment.dump(cache_histogram, prefetch_vector, dump_filename);
+				if (std::find(dump_filenames.begin(), dump_filenames.end(), dump_filename) == dump_filenames.end()) {
 					dump_filenames.push_back(dump_filename);
-					if (stride_hist[stride] < count) {
-						stride_hist[stride] = count;
-					}
-					// random_activity(mapping); // takes a long time in our huge memory area
-					flush_mapping(mapping);
 				}
+				// random_activity(mapping); // takes a long time in our huge memory area
+				flush_mapping(mapping);
+				return verdict;
+			};
+			probe_func_t no_prefetch = [&](size_t exponent, size_t attempt) -> verdict_t {
+				return negate_verdict(triggers_prefetch(exponent, attempt));
+			};
+
+			// Usually, a single cache line already triggers prefetching, so
+			// we directly search for the maximum stride. Otherwise, we first
+			// search the last stride without prefetching.
+			size_t min_exponent = 0;
+			BoundarySearchResult search_max = find_boundary(0, max_exponent, triggers_prefetch);
+			if ( ! search_max.holds_at_lower) {
+				BoundarySearchResult search_min = find_boundary(0, max_exponent, no_prefetch);
+				searches_json[(sign == 1) ? "min_positive" : "min_negative"] = boundary_search_to_json(search_min);
+				if (search_min.holds_across_range) {
+					// no prefetching for any stride
+					stride_limits[sign] = {0, 0};
+					continue;
+				}
+				min_exponent = search_min.last_true + 1;
+				search_max = find_boundary(min_exponent, max_exponent, triggers_prefetch);
+			}
+			searches_json[(sign == 1) ? "max_positive" : "max_negative"] = boundary_search_to_json(search_max);
+			if (search_max.holds_at_lower) {
+				stride_limits[sign] = {
+					sign * (CACHE_LINE_SIZE << min_exponent),
+					sign * (CACHE_LINE_SIZE << search_max.last_true),
+				};
+			} else {
+				stride_limits[sign] = {0, 0};
 			}
+			L::debug("Sign: %zd, min. stride: %zd, max. stride: %zd\n", sign, stride_limits[sign].first, stride_limits[sign].second);
 		}
 		plot_stride_minmax(string {__FUNCTION__}, dump_filenames);
-
-		ssize_t min_stride_neg = std::numeric_limits<ssize_t>::min();
-		ssize_t min_stride_pos = std::numeric_limits<ssize_t>::max();
-		ssize_t max_stride_neg = std::numeric_limits<ssize_t>::max();
-		ssize_t max_stride_pos = std::numeric_limits<ssize_t>::min();
-		for (pair<ssize_t const, size_t> const& stride_hist_pair : stride_hist) {
-			ssize_t const& stride = stride_hist_pair.first;
-			size_t const& max_count = stride_hist_pair.second;
-			if (stride > 0 && stride < min_stride_pos && max_count > 0) { min_stride_pos = stride; }
-			if (stride < 0 && stride > min_stride_neg && max_count > 0) { min_stride_neg = stride; }
-			if (max_stride_pos < stride && max_count > 0) { max_stride_pos = stride; }
-			if (max_stride_neg > stride && max_count > 0) { max_stride_neg = stride; }
-			L::debug("Stride: %zd, max. count: %zu\n", stride, max_count);
-		}
 		unmap_mapping(mapping);
 
 		return Json::object {
 			{"status", "completed"},
-			{"min_stride_negative", (min_stride_neg != std::numeric_limits<ssize_t>::min()) ? (int)min_stride_neg : 0},
-			{"min_stride_positive", (min_stride_pos != std::numeric_limits<ssize_t>::max()) ? (int)min_stride_pos : 0},
-			{"max_stride_negative", (max_stride_neg < 0) ? (int)max_stride_neg : 0},
-			{"max_stride_positive", (max_stride_pos > 0) ? (int)max_stride_pos : 0},
+			{"min_stride_negative", (int)stride_limits[-1].first},
+			{"min_stride_positive", (int)stride_limits[1].first},
+			{"max_stride_negative", (int)stride_limits[-1].second},
+			{"max_stride_positive", (int)stride_limits[1].second},
+			{"searches", searches_json},
 		};
 	}
 
@@ -706,9 +788,9 @@ protected:
 			size_t step = 12;
 			StrideExperiment experiment { stride, step, 0, use_nanosleep, fr_thresh, noise_thresh };
 			pair<size_t, size_t> ai_collidingbits_noaccesses { colliding_bits, no_accesses_on_mapping2 };
-			vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_stride_pc_collision, &ai_collidingbits_noaccesses);
-			vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions, 0.7);
-			size_t count = std::count(prefetch_vector.begin(), prefetch_vector.end(), true);
+			CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, no_repetitions, workload_stride_pc_collision, &ai_collidingbits_noaccesses);
+			PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions, 0.7);
+			size_t count = prefetch_vector.count();
 
 			if (count > 0 && min_colliding_bits == -1) {
 				min_colliding_bits = colliding_bits;
@@ -758,10 +840,10 @@ protected:
 		// Run experiment with stride = CACHE_LINE_SIZE / 4 and 4 steps,
 		// i.e., performing 4 accesses within the same cache line
 		StrideExperiment experiment_sub_cl { CACHE_LINE_SIZE/4, 4, 0, use_nanosleep, fr_thresh, noise_thresh };
-		vector<size_t> cache_histogram_sub_cl = experiment_sub_cl.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
-		vector<bool> prefetch_vector_sub_cl = experiment_sub_cl.evaluate_cache_histogram(cache_histogram_sub_cl, no_repetitions);
+		CacheHistogram cache_histogram_sub_cl = experiment_sub_cl.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+		PrefetchVector prefetch_vector_sub_cl = experiment_sub_cl.evaluate_cache_histogram(cache_histogram_sub_cl, no_repetitions);
 		experiment_sub_cl.dump(cache_histogram_sub_cl, prefetch_vector_sub_cl, "trace-stride-test_stride_less_than_cl_size-sub_cl.json");
-		size_t count_sub_cl = std::count(prefetch_vector_sub_cl.begin(), prefetch_vector_sub_cl.end(), true);
+		size_t count_sub_cl = prefetch_vector_sub_cl.count();
 
 		random_activity(mapping);
 		flush_mapping(mapping);
@@ -772,10 +854,10 @@ protected:
 		// one. Otherwise, if the prefetcher detects the small stride, we
 		// expect more prefetching on the previous experiment than here.
 		StrideExperiment experiment_cl { CACHE_LINE_SIZE, 1, 0, use_nanosleep, fr_thresh, noise_thresh };
-		vector<size_t> cache_histogram_cl = experiment_cl.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
-		vector<bool> prefetch_vector_cl = experiment_cl.evaluate_cache_histogram(cache_histogram_cl, no_repetitions);
+		CacheHistogram cache_histogram_cl = experiment_cl.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+		PrefetchVector prefetch_vector_cl = experiment_cl.evaluate_cache_histogram(cache_histogram_cl, no_repetitions);
 		experiment_cl.dump(cache_histogram_cl, prefetch_vector_cl, "trace-stride-test_stride_less_than_cl_size-cl.json");
-		size_t count_cl = std::count(prefetch_vector_cl.begin(), prefetch_vector_cl.end(), true);
+		size_t count_cl = prefetch_vector_cl.count();
 		
 		plot_stride(string{__FUNCTION__}, {
 			"trace-stride-test_stride_less_than_cl_size-cl.json",
@@ -818,8 +900,8 @@ protected:
 				
 				// Run experiment. The workload will make sure to access random
 				// locations within the cache lines.
-				vector<size_t> cache_histogram_random = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_random_offset_within_cl, nullptr);
-				vector<bool> prefetch_vector_random = experiment.evaluate_cache_histogram(cache_histogram_random, no_repetitions);
+				CacheHistogram cache_histogram_random = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_random_offset_within_cl, nullptr);
+				PrefetchVector prefetch_vector_random = experiment.evaluate_cache_histogram(cache_histogram_random, no_repetitions);
 				string dump_filename_random = "trace-stride-test_random_offset_within_cl-stride_" + zero_pad(stride, 5) + "-random.json";
 				experiment.dump(cache_histogram_random, prefetch_vector_random, dump_filename_random);
 				dump_filenames.push_back(dump_filename_random);
@@ -829,8 +911,8 @@ protected:
 
 				// Run baseline experiment (accessing offset 0 within all the
 				// cache lines)
-				vector<size_t> cache_histogram_baseline = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
-				vector<bool> prefetch_vector_baseline = experiment.evaluate_cache_histogram(cache_histogram_baseline, no_repetitions);
+				CacheHistogram cache_histogram_baseline = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+				PrefetchVector prefetch_vector_baseline = experiment.evaluate_cache_histogram(cache_histogram_baseline, no_repetitions);
 				string dump_filename_baseline = "trace-stride-test_random_offset_within_cl-stride_" + zero_pad(stride, 5) + "-baseline.json";
 				experiment.dump(cache_histogram_baseline, prefetch_vector_baseline, dump_filename_baseline);
 				dump_filenames.push_back(dump_filename_baseline);
@@ -838,8 +920,8 @@ protected:
 				random_activity(mapping);
 				flush_mapping(mapping);
 
-				size_t prefetch_count_random = std::count(prefetch_vector_random.begin(), prefetch_vector_random.end(), true);
-				size_t prefetch_count_baseline = std::count(prefetch_vector_random.begin(), prefetch_vector_random.end(), true);
+				size_t prefetch_count_random = prefetch_vector_random.count();
+				size_t prefetch_count_baseline = prefetch_vector_random.count();
 
 				results[stride] = (prefetch_count_baseline > 0 && prefetch_count_random > 0);
 			}
@@ -883,13 +965,13 @@ protected:
 		size_t first_access_offset = PAGE_SIZE - step * stride;
 
 		StrideExperiment experiment { stride, step, first_access_offset, use_nanosleep, fr_thresh, noise_thresh };
-		vector<size_t> cache_histogram = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
-		vector<bool> prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
+		CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping, no_repetitions, workload_stride_loop, nullptr);
+		PrefetchVector prefetch_vector = experiment.evaluate_cache_histogram(cache_histogram, no_repetitions);
 		experiment.dump(cache_histogram, prefetch_vector, "trace-stride-test_cross_page_boundary.json");
 		
 		// count prefetches. if any prefetches are observed, the prefetcher
 		// crossed the page boundary.
-		size_t count = std::count(prefetch_vector.begin(), prefetch_vector.end(), true);
+		size_t count = prefetch_vector.count();
 		
 		plot_stride(string{__FUNCTION__}, {"trace-stride-test_cross_page_boundary.json"});
 
@@ -901,20 +983,120 @@ protected:
 		};
 	}
 
-	virtual Json identify() override {
-		size_t no_repetitions = 40000 * (PAGE_SIZE / 4096);
+	/**
+	 * Determines how many independent stride patterns (i.e., patterns
+	 * trained from distinct PCs) the prefetcher tracks at the same time.
+	 * We train N patterns in an interleaved fashion and check whether the
+	 * first one still triggers prefetching afterwards. N is first
+	 * increased exponentially until prefetching stops, then the capacity
+	 * is narrowed down with a binary search. The load instructions are
+	 * generated at runtime, so N is not limited by the number of
+	 * statically compiled maccess functions.
+	 *
+	 * @param[in]  no_repetitions  Number of repetitions
+	 *
+	 * @return     JSON structure describing the results
+	 */
+	Json test_table_capacity(size_t no_repetitions) {
+		L::info("Test: %s\n", __FUNCTION__);
+		size_t const max_no_patterns = 1024;
+		GeneratedMaccessFunctions generated = generate_maccess_functions(max_no_patterns);
 
-		Json test_results = test_direction(no_repetitions);
-		bool identified = (
-			test_results["positive_direction"].bool_value() == true
-			|| test_results["negative_direction"].bool_value() == true
-		);
+		// patterns 1..N-1 use one page each in the lower part of the
+		// mapping, pattern 0 is trained and probed in mapping2
+		Mapping mapping = allocate_mapping((max_no_patterns - 1 + 256 + 1) * PAGE_SIZE);
+		Mapping mapping2 { mapping.base_addr + (max_no_patterns - 1 + 256) * PAGE_SIZE, PAGE_SIZE };
+		random_activity(mapping2);
+		flush_mapping(mapping2);
+
+		ssize_t stride = 3 * CACHE_LINE_SIZE;
+		size_t step = 8;
+		StrideExperiment experiment { stride, step, 0, use_nanosleep, fr_thresh, noise_thresh };
+		// after the workload, only the final access of pattern 0 is an
+		// architectural hit in mapping2
+		StrideExperiment experiment_trigger { stride, 1, (step-1)*stride, use_nanosleep, fr_thresh, noise_thresh };
+
+		// lines right after the final access of pattern 0 are compared
+		// against all lines where we expect misses
+		vector<size_t> signal_indices;
+		vector<size_t> reference_indices;
+		for (size_t cl_idx = 0; cl_idx < mapping2.size / CACHE_LINE_SIZE; cl_idx++) {
+			if (experiment_trigger.cl_potential_prefetch(cl_idx)) {
+				if (cl_idx * CACHE_LINE_SIZE <= experiment_trigger.offset_last_access() + 4 * stride) {
+					signal_indices.push_back(cl_idx);
+				}
+			} else if ( ! experiment_trigger.cl_accessed(cl_idx)) {
+				reference_indices.push_back(cl_idx);
+			}
+		}
+
+		// map<no_patterns, prefetch count>
+		map<size_t, size_t> results;
+		vector<string> dump_filenames;
+		probe_func_t triggers_prefetch = [&](size_t no_patterns, size_t attempt) -> verdict_t {
+			Mapping mapping1 { mapping.base_addr, std::max<size_t>(no_patterns - 1, 1) * PAGE_SIZE };
+			vector<maccess_func_t> funcs (generated.funcs.begin(), generated.funcs.begin() + no_patterns);
+			size_t repetitions = no_repetitions * (attempt + 1);
+
+			CacheHistogram cache_histogram = experiment.collect_cache_histogram(mapping1, mapping2, repetitions, workload_stride_table_capacity, &funcs);
+			PrefetchVector prefetch_vector = experiment_trigger.evaluate_cache_histogram(cache_histogram, repetitions);
+			size_t count = prefetch_vector.count();
+			verdict_t verdict = compare_hit_rates(cache_histogram, signal_indices, reference_indices);
+			L::info("patterns: %zu, prefetch count: %zu\n", no_patterns, count);
+
+			string dump_filename = "trace-stride-test_table_capacity-patterns_" + zero_pad(no_patterns, 4) + ".json";
+			experiment_trigger.dump(cache_histogram, prefetch_vector, dump_filename);
+			if (std::find(dump_filenames.begin(), dump_filenames.end(), dump_filename) == dump_filenames.end()) {
+				dump_filenames.push_back(dump_filename);
+			}
+			results[no_patterns] = count;
+
+			random_activity(mapping2);
+			flush_mapping(mapping2);
+			return verdict;
+		};
+
+		// exponential search for the first N without prefetching, followed
+		// by a binary search between the last N with and the first N
+		// without prefetching
+		BoundarySearchResult search = find_boundary(1, max_no_patterns, triggers_prefetch);
+		size_t capacity = search.holds_at_lower ? search.last_true : 0;
+		L::info("Table capacity: %zu%s\n", capacity, search.holds_across_range ? " (or more)" : "");
+
+		plot_stride(string{__FUNCTION__}, dump_filenames);
+		unmap_mapping(mapping);
+		release_maccess_functions(generated);
+
+		Json::object results_json;
+		for (pair<size_t const, size_t> const& results_pair : results) {
+			results_json[std::to_string(results_pair.first)] = Json {(int)results_pair.second};
+		}
 		return Json::object {
-			{ "identified", identified },
-			{ "test_direction", test_results },
+			{"status", "completed"},
+			{"capacity", (int)capacity},
+			{"capacity_exceeds_search_range", search.holds_across_range},
+			{"max_no_patterns", (int)max_no_patterns},
+			{"prefetch_counts", results_json},
+			{"search", boundary_search_to_json(search)},
 		};
 	}
 
+	virtual Json identify() override {
+		size_t no_repetitions = 40000 * (PAGE_SIZE / 4096);
+
+		return identify_per_access_kind([&]() {
+			Json test_results = test_direction(no_repetitions);
+			bool identified = (
+				test_results["positive_direction"].bool_value() == true
+				|| test_results["negative_direction"].bool_value() == true
+			);
+			return Json::object {
+				{ "identified", identified },
+				{ "test_direction", test_results },
+			};
+		});
+	}
+
 	virtual Json characterize() override {
 		size_t no_repetitions = 40000 * (PAGE_SIZE / 4096);
 
@@ -922,7 +1104,7 @@ protected:
 			{ "test_trigger_same_pc_different_memory", test_trigger_same_pc_different_memory(no_repetitions) },
 			{ "test_trigger_different_pc_same_memory", test_trigger_different_pc_same_memory(no_repetitions) },
 			{ "test_trigger_different_pc_different_memory", test_trigger_different_pc_different_memory(no_repetitions) },
-			{ "test_overview", test_overview(no_repetitions) },
+			{ "test_overview", test_overview(no_repetitions, incremental_overview) },
 			{ "test_load_pref_corr", test_load_pref_corr(no_repetitions) },
 			{ "test_no_prefetches", test_no_prefetches(no_repetitions) },
 			{ "test_min_max_stride", test_min_max_stride(no_repetitions) },
@@ -931,6 +1113,7 @@ protected:
 			{ "test_stride_less_than_cl_size", test_stride_less_than_cl_size(no_repetitions) },
 			{ "test_random_offset_within_cl", test_random_offset_within_cl(no_repetitions) },
 			{ "test_cross_page_boundary", test_cross_page_boundary(no_repetitions) },
+			{ "test_table_capacity", test_table_capacity(no_repetitions) },
 		};
 	}
 };
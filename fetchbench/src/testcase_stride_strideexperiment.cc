@@ -54,6 +54,25 @@ bool StrideExperiment::cl_potential_prefetch(size_t cl_idx) const {
 	return false;
 }
 
+/**
+ * Describes the experiment parameters, incl. the calibration values, for
+ * use as part of a result cache key (see result_cache_key()).
+ *
+ * @return     The description.
+ */
+string StrideExperiment::cache_key() const {
+	std::ostringstream key;
+	key << "StrideExperiment(stride=" << stride
+		<< ",step=" << step
+		<< ",first_access_offset=" << first_access_offset
+		<< ",use_nanosleep=" << use_nanosleep
+		<< ",fr_thresh=" << fr_thresh
+		<< ",noise_thresh=" << noise_thresh
+		<< ",access_kind=" << access_kind_to_string(access_kind)
+		<< ")";
+	return key.str();
+}
+
 /**
  * Collects a cache histogram. To this end, this function runs the
  * provided `workload` `no_repetition` times in the memory area
@@ -63,9 +82,8 @@ bool StrideExperiment::cl_potential_prefetch(size_t cl_idx) const {
  * execution of the workload. The probed cache line moves by +1 in each
  * iteration, and wraps around once the end of the memory area is
  * reached. The cache histogram represents the cache state after the
- * experiment. It is a vector<size_t>, where each entry represents one
- * of the cache lines. The value indicates the number of hits seen in
- * this cache line.
+ * experiment. For each of the cache lines, it counts the number of
+ * probes and the number of hits seen in this cache line.
  *
  * @param      mapping         The mapping to execute the workload on
  * @param[in]  no_repetitions  Number of repetitions
@@ -73,15 +91,20 @@ bool StrideExperiment::cl_potential_prefetch(size_t cl_idx) const {
  *
  * @return     Cache histogram (absolute counters per cache line)
  */
-vector<size_t> StrideExperiment::collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, void*), void* additional_info) {
+CacheHistogram StrideExperiment::collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, void*), void* additional_info) {
 	// ensure the first and last access are in bounds of the mapping
 	uint8_t* ptr_begin = get_ptr_begin(mapping);
 	uint8_t* ptr_last = get_ptr_end(mapping) - stride;
 	assert(ptr_begin >= mapping.base_addr && ptr_begin < mapping.base_addr + mapping.size);
 	assert(ptr_last >= mapping.base_addr && ptr_last < mapping.base_addr + mapping.size);
 	
-	vector<size_t> cache_histogram (mapping.size / CACHE_LINE_SIZE, 0);
+	CacheHistogram cache_histogram (mapping.size / CACHE_LINE_SIZE);
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
 	for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+		noise_monitor.begin_window();
+
 		// flush mappings
 		flush_mapping(mapping);
 		
@@ -96,13 +119,13 @@ vector<size_t> StrideExperiment::collect_cache_histogram(Mapping const& mapping,
 			nanosleep(&t_req, &t_rem);
 		}
 
-		// probe probe array
+		// probe probe array, keep the result only if the repetition was
+		// not disturbed
 		size_t probe_idx = repetition % (cache_histogram.size());
-		probe_single(cache_histogram, probe_idx, mapping.base_addr + (probe_idx * CACHE_LINE_SIZE));
-	}
-	// normalize cache histogram
-	for (size_t& hist_value : cache_histogram) {
-		hist_value = hist_value * 1000 / (no_repetitions / cache_histogram.size());
+		probe_result_t result = probe_single(mapping.base_addr + (probe_idx * CACHE_LINE_SIZE));
+		if (noise_monitor.end_window(noise_stats)) {
+			cache_histogram.record(probe_idx, result);
+		}
 	}
 	return cache_histogram;
 }
@@ -119,7 +142,7 @@ vector<size_t> StrideExperiment::collect_cache_histogram(Mapping const& mapping,
  *
  * @return     Cache histogram (absolute counters per cache line)
  */
-vector<size_t> StrideExperiment::collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info) {
+CacheHistogram StrideExperiment::collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info) {
 	// ensure the first and last access are in bounds of the mapping
 	uint8_t* ptr_begin_1 = get_ptr_begin(mapping1);
 	uint8_t* ptr_last_1 = get_ptr_end(mapping1) - stride;
@@ -130,8 +153,13 @@ vector<size_t> StrideExperiment::collect_cache_histogram(Mapping const& mapping1
 	assert(ptr_begin_2 >= mapping2.base_addr && ptr_begin_2 < mapping2.base_addr + mapping2.size);
 	assert(ptr_last_2 >= mapping2.base_addr && ptr_last_2 < mapping2.base_addr + mapping2.size);
 
-	vector<size_t> cache_histogram (mapping2.size / CACHE_LINE_SIZE, 0);
+	CacheHistogram cache_histogram (mapping2.size / CACHE_LINE_SIZE);
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
 	for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+		noise_monitor.begin_window();
+
 		// flush mappings
 		flush_mapping(mapping1);
 		flush_mapping(mapping2);
@@ -147,13 +175,13 @@ vector<size_t> StrideExperiment::collect_cache_histogram(Mapping const& mapping1
 			nanosleep(&t_req, &t_rem);
 		}
 
-		// probe probe array
+		// probe probe array, keep the result only if the repetition was
+		// not disturbed
 		size_t probe_idx = repetition % (cache_histogram.size());
-		probe_single(cache_histogram, probe_idx, mapping2.base_addr + (probe_idx * CACHE_LINE_SIZE));
-	}
-	// normalize cache histogram
-	for (size_t& hist_value : cache_histogram) {
-		hist_value = hist_value * 1000 / (no_repetitions / cache_histogram.size());
+		probe_result_t result = probe_single(mapping2.base_addr + (probe_idx * CACHE_LINE_SIZE));
+		if (noise_monitor.end_window(noise_stats)) {
+			cache_histogram.record(probe_idx, result);
+		}
 	}
 	return cache_histogram;
 }
@@ -165,17 +193,16 @@ vector<size_t> StrideExperiment::collect_cache_histogram(Mapping const& mapping1
  * prefetching). So we would waste a lot of iterations (and therefore
  * time) on probing cache lines where we expect misses. In this
  * variant, we only probe the locations where prefetching is expected,
- * and ignore all other locations (will be reported as 0). Further,
- * the resulting histogram reports relative values (from 0..1000) instead of the
- * absolute number of hits for each cache line.
+ * and ignore all other locations (they have no probes and are
+ * reported as 0).
  *
  * @param      mapping         The mapping to execute the workload on
  * @param[in]  no_repetitions  Number of repetitions
  * @param[in]  workload        The workload to run
  *
- * @return     Cache histogram (relative counters \in [0, 1000] per cache line)
+ * @return     Cache histogram
  */
-vector<size_t> StrideExperiment::collect_cache_histogram_lazy(Mapping const& mapping, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, void*), void* additional_info) {
+CacheHistogram StrideExperiment::collect_cache_histogram_lazy(Mapping const& mapping, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, void*), void* additional_info) {
 	// ensure the first and last access are in bounds of the mapping
 	uint8_t* ptr_begin = get_ptr_begin(mapping);
 	uint8_t* ptr_last = get_ptr_end(mapping) - stride;
@@ -198,8 +225,13 @@ vector<size_t> StrideExperiment::collect_cache_histogram_lazy(Mapping const& map
 	) {
 		indices_to_probe.push_back(offset / CACHE_LINE_SIZE);
 	}
-	vector<size_t> cache_histogram (mapping.size / CACHE_LINE_SIZE, 0);
+	CacheHistogram cache_histogram (mapping.size / CACHE_LINE_SIZE);
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
 	for (size_t repetition = 0; repetition < no_repetitions; repetition++) {
+		noise_monitor.begin_window();
+
 		// flush mapping
 		for (size_t i = 0; i < indices_to_probe.size(); i++) {
 			flush(mapping.base_addr + CACHE_LINE_SIZE * indices_to_probe[i]);
@@ -219,27 +251,129 @@ vector<size_t> StrideExperiment::collect_cache_histogram_lazy(Mapping const& map
 
 		// probe probe array
 		size_t probe_idx = indices_to_probe[repetition % indices_to_probe.size()];
-		probe_single(cache_histogram, probe_idx, mapping.base_addr + (probe_idx * CACHE_LINE_SIZE));
-	}
-	// normalize cache histogram
-	for (size_t const& idx : indices_to_probe) {
-		cache_histogram[idx] = cache_histogram[idx] * 1000 / (no_repetitions / indices_to_probe.size());
+		probe_result_t result = probe_single(mapping.base_addr + (probe_idx * CACHE_LINE_SIZE));
+		if (noise_monitor.end_window(noise_stats)) {
+			cache_histogram.record(probe_idx, result);
+		}
 	}
 	return cache_histogram;
 }
 
 /**
- * Reduces a cache histogram, i.e., vector<size_t>, to a vector<bool>
- * of same size. Cache lines where prefetches were both _expected_ AND
- * _observed_ are marked as `true` in the returned "prefetch vector".
- * All other lines are marked `false`.
+ * Collects one cache histogram per step 1..(step), like running
+ * collect_cache_histogram() with workload_stride_loop once per step, but
+ * without probing lines whose state cannot change from one step to the
+ * next. Each repetition performs the strided accesses of one step count
+ * (from a single load instruction) and probes a single cache line
+ * afterwards, so the probes never interleave with the training. After
+ * one step, all lines are probed (as in collect_cache_histogram()).
+ * After s > 1 steps, only the newest access and the lines ahead of it at
+ * multiples of the stride are probed, as only these can newly become
+ * prefetched (see cl_potential_prefetch()). All other lines keep the
+ * value of step s-1. Every probed line is probed as often as in
+ * collect_cache_histogram() with the same number of repetitions.
+ *
+ * @param      mapping         The mapping to execute the workload on
+ * @param[in]  no_repetitions  Number of repetitions of a single step
+ *
+ * @return     Cache histograms, index s-1 holds the histogram after s
+ *             steps.
+ */
+vector<CacheHistogram> StrideExperiment::collect_cache_histograms_incremental(Mapping const& mapping, size_t no_repetitions) {
+	// ensure the first and last access are in bounds of the mapping
+	uint8_t* ptr_begin = get_ptr_begin(mapping);
+	uint8_t* ptr_last = get_ptr_end(mapping) - stride;
+	assert(ptr_begin >= mapping.base_addr && ptr_begin < mapping.base_addr + mapping.size);
+	assert(ptr_last >= mapping.base_addr && ptr_last < mapping.base_addr + mapping.size);
+	assert(std::abs(stride) >= CACHE_LINE_SIZE);
+
+	// all multiples of the stride ahead of the first access (including the
+	// first access)
+	vector<size_t> indices_ahead;
+	for (
+		ssize_t offset = first_access_offset;
+		(stride > 0) ? (offset < (ssize_t)mapping.size) : (offset >= 0);
+		offset += stride
+	) {
+		indices_ahead.push_back(offset / CACHE_LINE_SIZE);
+	}
+	assert(indices_ahead.size() >= step);
+
+	// (step index, line) to probe, each repetition probes the next one
+	size_t no_cls = mapping.size / CACHE_LINE_SIZE;
+	vector<pair<size_t, size_t>> schedule;
+	for (size_t cl_idx = 0; cl_idx < no_cls; cl_idx++) {
+		schedule.emplace_back(0, cl_idx);
+	}
+	for (size_t s = 1; s < step; s++) {
+		for (size_t i = s; i < indices_ahead.size(); i++) {
+			schedule.emplace_back(s, indices_ahead[i]);
+		}
+	}
+	size_t no_passes = std::max<size_t>(1, (no_repetitions + no_cls - 1) / no_cls);
+
+	vector<CacheHistogram> cache_histograms (step, CacheHistogram (no_cls));
+	probe_fr_thresh = FrequencyGuard::get().fr_thresh(fr_thresh);
+	NoiseMonitor& noise_monitor = NoiseMonitor::get();
+	noise_monitor.begin_collection();
+	for (size_t repetition = 0; repetition < no_passes * schedule.size(); repetition++) {
+		size_t s = schedule[repetition % schedule.size()].first;
+		size_t probe_idx = schedule[repetition % schedule.size()].second;
+		noise_monitor.begin_window();
+
+		// flush mapping
+		flush_mapping(mapping);
+
+		// induce pattern (s+1 accesses)
+		uint8_t* ptr_end = ptr_begin + stride * (ssize_t)(s + 1);
+		for (
+			uint8_t* ptr = ptr_begin;
+			(stride > 0) ? (ptr < ptr_end) : (ptr > ptr_end);
+			ptr += stride
+		) {
+			maccess_kind(access_kind, ptr);
+		}
+		mfence();
+
+		// sleep a while to give the prefetcher some time to work
+		if (use_nanosleep) {
+			nanosleep(&t_req, &t_rem);
+		}
+
+		// probe probe array, keep the result only if the repetition was
+		// not disturbed
+		probe_result_t result = probe_single(mapping.base_addr + (probe_idx * CACHE_LINE_SIZE));
+		if (noise_monitor.end_window(noise_stats)) {
+			cache_histograms[s].record(probe_idx, result);
+		}
+	}
+
+	// lines that were not probed keep the value of the previous step
+	for (size_t s = 1; s < step; s++) {
+		vector<bool> probed (no_cls, false);
+		for (size_t i = s; i < indices_ahead.size(); i++) {
+			probed[indices_ahead[i]] = true;
+		}
+		for (size_t cl_idx = 0; cl_idx < no_cls; cl_idx++) {
+			if ( ! probed[cl_idx]) {
+				cache_histograms[s].copy_line(cache_histograms[s - 1], cl_idx);
+			}
+		}
+	}
+	return cache_histograms;
+}
+
+/**
+ * Reduces a cache histogram to a PrefetchVector of same size. Cache
+ * lines where prefetches were both _expected_ AND _observed_ are marked
+ * in the returned "prefetch vector". All other lines are unmarked.
  *
  * @param      cache_histogram       The cache histogram
  * @param[in]  threshold_multiplier  The threshold multiplier
  *
  * @return     prefetch vector.
  */
-vector<bool> StrideExperiment::evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const {
+PrefetchVector StrideExperiment::evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const {
 	// compute averages for (a) all locations where we expect hits,
 	// (b) all locations where we expect misses
 	size_t hit_avg = 0, hit_n = 0;
@@ -275,7 +409,7 @@ vector<bool> StrideExperiment::evaluate_cache_histogram(vector<size_t> const& ca
 
 	// iterate over the possible prefetch locations and use the prefetch_threshold
 	// to decide whether this is a prefetch or not.
-	vector<bool> prefetch_vector (cache_histogram.size(), false);
+	PrefetchVector prefetch_vector (cache_histogram.size());
 	for (size_t cl_idx = 0; cl_idx < cache_histogram.size(); cl_idx++) {
 		// check whether this is a prefetch location or not
 		if (cl_potential_prefetch(cl_idx)) {
@@ -286,7 +420,7 @@ vector<bool> StrideExperiment::evaluate_cache_histogram(vector<size_t> const& ca
 				// check whether the value exceeds the prefetch threshold
 				if (cache_histogram[cl_idx] >= prefetch_thresh) {
 					L::debug(" *** I think this is a prefetch (%zu >= %zu). ***\n", cache_histogram[cl_idx], prefetch_thresh);
-					prefetch_vector[cl_idx] = true;
+					prefetch_vector.set(cl_idx);
 				}
 			}
 		}
@@ -303,27 +437,21 @@ vector<bool> StrideExperiment::evaluate_cache_histogram(vector<size_t> const& ca
  *
  * @return     prefetch vector.
  */
-vector<bool> StrideExperiment::evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions) const {
+PrefetchVector StrideExperiment::evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions) const {
 	return evaluate_cache_histogram(cache_histogram, no_repetitions, 1.0/64);
 }
 
 /**
  * Dumps a Stride Experiment and a cache histogram to a JSON file.
+ * The fill levels of the prefetched lines are added to the
+ * FillLevelSummary, the degree, distance, coverage and timeliness of
+ * the prefetches to the PrefetchMetrics.
  *
  * @param      cache_histogram  The cache histogram
  * @param[in]  prefetch_vector  The prefetch vector
  * @param      filepath         The file path to the JSON file
  */
-void StrideExperiment::dump(vector<size_t> const& cache_histogram, vector<bool> prefetch_vector, string const& filepath) const {
-	// Build a JSON array from the cache histogram numbers
-	Json::array cache_histogram_values {};
-	for (size_t i = 0; i < cache_histogram.size(); i++) {
-		cache_histogram_values.push_back((int)cache_histogram[i]);
-	}
-	Json::array prefetch_vector_values {};
-	for (size_t i = 0; i < prefetch_vector.size(); i++) {
-		prefetch_vector_values.push_back((bool)prefetch_vector[i]);
-	}
+void StrideExperiment::dump(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector, string const& filepath) const {
 
 	Json j = Json::object {
 		{ "stride", (int)stride },
@@ -332,10 +460,24 @@ void StrideExperiment::dump(vector<size_t> const& cache_histogram, vector<bool>
 		{ "use_nanosleep", use_nanosleep },
 		{ "fr_thresh", (int)fr_thresh },
 		{ "noise_thresh", (int)noise_thresh },
-		{ "cache_histogram", cache_histogram_values },
-		{ "prefetch_vector", prefetch_vector },
+		{ "cache_histogram", cache_histogram.normalized_to_json() },
+		{ "cache_histogram_hits", cache_histogram.hits_to_json() },
+		{ "cache_histogram_probes", cache_histogram.probes_to_json() },
+		{ "cache_histogram_levels", cache_histogram.levels_to_json() },
+		{ "prefetch_vector", prefetch_vector.to_json() },
+		{ "prefetch_fill_levels", cache_histogram.fill_levels_to_json(prefetch_vector) },
 		{ "cache_line_size", CACHE_LINE_SIZE },
+		{ "probe_fr_thresh", (int)probe_fr_thresh },
+		{ "noise", noise_stats.to_json() },
+		{ "numa_node", get_mapping_numa_node() },
+		{ "access_kind", access_kind_to_string(access_kind) },
 	};
+	FillLevelSummary::get().add(cache_histogram, prefetch_vector);
+	PrefetchVector potential_vector (cache_histogram.size());
+	for (size_t cl_idx = 0; cl_idx < cache_histogram.size(); cl_idx++) {
+		potential_vector.set(cl_idx, cl_potential_prefetch(cl_idx));
+	}
+	PrefetchMetrics::get().add(cache_histogram, prefetch_vector, potential_vector, offset_last_access() / CACHE_LINE_SIZE);
 	
 	// write JSON to file
 	json_dump_to_file(j, filepath);
@@ -348,7 +490,7 @@ void StrideExperiment::dump(vector<size_t> const& cache_histogram, vector<bool>
  *
  * @return     Pair of stride experiment object and cache histogram.
  */
-pair<StrideExperiment, vector<size_t>> StrideExperiment::restore(string const& filepath) {
+pair<StrideExperiment, CacheHistogram> StrideExperiment::restore(string const& filepath) {
 	std::ifstream file;
 	file.open(filepath);
 	string line;
@@ -372,11 +514,9 @@ pair<StrideExperiment, vector<size_t>> StrideExperiment::restore(string const& f
 		(size_t)json["fr_thresh"].int_value(),
 		(size_t)json["noise_thresh"].int_value(),
 	};
-
-	vector<size_t> cache_histogram;
-	for (Json value : json["cache_histogram"].array_items()) {
-		cache_histogram.push_back((size_t)value.int_value());
+	if (json["access_kind"].is_string()) {
+		experiment.access_kind = access_kind_from_string(json["access_kind"].string_value());
 	}
-	
-	return {experiment, cache_histogram};
+
+	return {experiment, CacheHistogram::from_json(json)};
 }
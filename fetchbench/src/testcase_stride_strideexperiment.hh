@@ -11,6 +11,11 @@
 #include "utils.hh"
 #include "aligned_maccess.hh"
 #include "mapping.hh"
+#include "cache_histogram.hh"
+#include "prefetch_metrics.hh"
+#include "noise_monitor.hh"
+#include "frequency_guard.hh"
+#include "access_kind.hh"
 
 using json11::Json;
 using std::vector;
@@ -32,6 +37,13 @@ public:
 	// structs for nanosleep
 	struct timespec const t_req;
 	struct timespec t_rem;
+	// repetitions discarded because of noise (see NoiseMonitor)
+	NoiseStats noise_stats;
+	// Flush+Reload threshold used by the last collection (fr_thresh,
+	// scaled if the frequency changed, see FrequencyGuard)
+	size_t probe_fr_thresh = 0;
+	// kind of the accesses of the workload (see maccess_kind())
+	access_kind_t access_kind = ACCESS_KIND_LOAD;
 
 	StrideExperiment(ssize_t stride, size_t step, size_t first_access_offset, bool use_nanosleep, size_t fr_thresh, size_t noise_thresh)
 	: stride {stride}
@@ -47,6 +59,7 @@ public:
 	bool offset_potential_prefetch(size_t offset) const;
 	bool cl_accessed(size_t cl_idx) const;
 	bool cl_potential_prefetch(size_t cl_idx) const;
+	string cache_key() const;
 
 	// Helper functions to get first and (last+1*stride) address to access.
 
@@ -63,29 +76,30 @@ public:
 	}
 
 private:
-	inline void probe_single(vector<size_t>& cache_histogram, size_t idx, uint8_t* ptr) const __attribute__((always_inline)) {
-		assert(idx < cache_histogram.size());
+	inline probe_result_t probe_single(uint8_t* ptr) const __attribute__((always_inline)) {
 		size_t time = flush_reload_t(ptr);
-		cache_histogram[idx] += (time < fr_thresh) ? 1 : 0;
+		return { time < probe_fr_thresh, LatencyBands::get().classify(time) };
 	}
 
 public:
-	vector<size_t> collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, void*), void* additional_info);
-	vector<size_t> collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info);
-	vector<size_t> collect_cache_histogram_lazy(Mapping const& mapping, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, void*), void* additional_info);
+	CacheHistogram collect_cache_histogram(Mapping const& mapping, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, void*), void* additional_info);
+	CacheHistogram collect_cache_histogram(Mapping const& mapping1, Mapping const& mapping2, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, Mapping const&, void*), void* additional_info);
+	CacheHistogram collect_cache_histogram_lazy(Mapping const& mapping, size_t no_repetitions, void (*workload)(StrideExperiment const&, Mapping const&, void*), void* additional_info);
+	vector<CacheHistogram> collect_cache_histograms_incremental(Mapping const& mapping, size_t no_repetitions);
 
-	vector<bool> evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const;
-	vector<bool> evaluate_cache_histogram(vector<size_t> const& cache_histogram, size_t no_repetitions) const;
+	PrefetchVector evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions, double threshold_multiplier) const;
+	PrefetchVector evaluate_cache_histogram(CacheHistogram const& cache_histogram, size_t no_repetitions) const;
 
-	void dump(vector<size_t> const& cache_histogram, vector<bool> prefetch_vector, string const& filepath) const;
-	static pair<StrideExperiment, vector<size_t>> restore(string const& filepath);
+	void dump(CacheHistogram const& cache_histogram, PrefetchVector const& prefetch_vector, string const& filepath) const;
+	static pair<StrideExperiment, CacheHistogram> restore(string const& filepath);
 };
 
 // ===== WORKLOADS =====
 
 /**
- * Standard workload for most tests. A loop with a single load in the loop
- * body. Supports positive and negative strides.
+ * Standard workload for most tests. A loop with a single access (of the
+ * experiment's access kind) in the loop body. Supports positive and
+ * negative strides.
  *
  * @param      experiment       The experiment
  * @param      mapping          The mapping
@@ -102,7 +116,7 @@ __attribute__((always_inline)) inline void workload_stride_loop(StrideExperiment
 		(ptr_end > ptr_begin) ? (ptr < ptr_end) : (ptr > ptr_end);
 		ptr += experiment.stride
 	) {
-		maccess(ptr);
+		maccess_kind(experiment.access_kind, ptr);
 	}
 }
 
@@ -120,18 +134,18 @@ __attribute__((always_inline)) inline void workload_stride_different_pc_same_mem
 	assert(experiment.step == 12);
 	
 	uint8_t* ptr_begin = experiment.get_ptr_begin(mapping);
-	maccess(ptr_begin +  0 * experiment.stride);
-	maccess(ptr_begin +  1 * experiment.stride);
-	maccess(ptr_begin +  2 * experiment.stride);
-	maccess(ptr_begin +  3 * experiment.stride);
-	maccess(ptr_begin +  4 * experiment.stride);
-	maccess(ptr_begin +  5 * experiment.stride);
-	maccess(ptr_begin +  6 * experiment.stride);
-	maccess(ptr_begin +  7 * experiment.stride);
-	maccess(ptr_begin +  8 * experiment.stride);
-	maccess(ptr_begin +  9 * experiment.stride);
-	maccess(ptr_begin + 10 * experiment.stride);
-	maccess(ptr_begin + 11 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin +  0 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin +  1 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin +  2 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin +  3 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin +  4 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin +  5 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin +  6 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin +  7 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin +  8 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin +  9 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin + 10 * experiment.stride);
+	maccess_kind(experiment.access_kind, ptr_begin + 11 * experiment.stride);
 }
 
 /**
@@ -159,10 +173,10 @@ __attribute__((always_inline)) inline void workload_stride_same_pc_different_mem
 	uint8_t* ptr_end_2 = experiment.get_ptr_end(mapping2);
 
 	for (uint8_t* ptr = ptr_begin_1; ptr < ptr_end_1; ptr += experiment.stride) {
-		maccess_noinline(ptr);
+		maccess_kind_noinline(experiment.access_kind, ptr);
 	}
 	for (uint8_t* ptr = ptr_begin_2; ptr < ptr_end_2; ptr += experiment.stride) {
-		maccess_noinline(ptr);
+		maccess_kind_noinline(experiment.access_kind, ptr);
 	}
 }
 
@@ -190,10 +204,10 @@ __attribute__((always_inline)) inline void workload_stride_different_pc_differen
 	uint8_t* ptr_end_2 = experiment.get_ptr_end(mapping2);
 
 	for (uint8_t* ptr = ptr_begin_1; ptr < ptr_end_1; ptr += experiment.stride) {
-		maccess(ptr);
+		maccess_kind(experiment.access_kind, ptr);
 	}
 	for (uint8_t* ptr = ptr_begin_2; ptr < ptr_end_2; ptr += experiment.stride) {
-		maccess(ptr);
+		maccess_kind(experiment.access_kind, ptr);
 	}
 }
 
@@ -270,6 +284,47 @@ __attribute__((always_inline)) inline void workload_stride_random_offset_within_
 		(ptr_end > ptr_begin) ? (ptr < ptr_end) : (ptr > ptr_end);
 		ptr += experiment.stride
 	) {
-		maccess(ptr + random_offsets[random_idx++]);
+		maccess_kind(experiment.access_kind, ptr + random_offsets[random_idx++]);
 	}
 }
+
+/**
+ * Trains N interleaved stride patterns from N distinct PCs, where N is the
+ * number of maccess functions in additional_info. Pattern 0 is trained in
+ * mapping2 with the first function, patterns 1..N-1 are trained in
+ * mapping1, one page per pattern. All patterns perform (step-1) accesses
+ * in round-robin order. Afterwards, mapping2 is flushed and pattern 0
+ * performs its final access. If the entry of pattern 0 survived the
+ * training of the other N-1 patterns, this final access triggers
+ * prefetching in mapping2.
+ *
+ * @param      experiment       The experiment
+ * @param      mapping1         The mapping 1 (at least (N-1) pages)
+ * @param      mapping2         The mapping 2
+ * @param      additional_info  The additional information (expects pointer
+ *                              to vector<maccess_func_t> with the N
+ *                              functions to use)
+ */
+__attribute__((always_inline)) inline void workload_stride_table_capacity(StrideExperiment const& experiment, Mapping const& mapping1, Mapping const& mapping2, void* additional_info)  {
+	assert(additional_info != nullptr);
+	assert(experiment.stride > 0);
+	assert(experiment.step * experiment.stride <= PAGE_SIZE);
+
+	vector<maccess_func_t> const& funcs = *((vector<maccess_func_t>*)additional_info);
+	size_t no_patterns = funcs.size();
+	assert(no_patterns >= 1);
+	assert(mapping1.size >= (no_patterns - 1) * PAGE_SIZE);
+
+	// interleaved training: (step-1) rounds over all patterns
+	for (size_t step = 0; step < experiment.step - 1; step++) {
+		funcs[0](experiment.get_ptr_begin(mapping2) + step * experiment.stride);
+		for (size_t pattern = 1; pattern < no_patterns; pattern++) {
+			funcs[pattern](experiment.get_ptr_begin(mapping1) + (pattern - 1) * PAGE_SIZE + step * experiment.stride);
+		}
+	}
+
+	// remove everything that was prefetched during the training, then
+	// trigger pattern 0 again
+	flush_mapping(mapping2);
+	funcs[0](experiment.get_ptr_end(mapping2) - experiment.stride);
+}
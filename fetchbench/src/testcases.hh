@@ -6,4 +6,9 @@
 #include "testcase_sms.hh"
 #include "testcase_dcreplay.hh"
 #include "testcase_parr.hh"
-#include "testcase_pchase.hh"
\ No newline at end of file
+#include "testcase_pchase.hh"
+#include "testcase_icache.hh"
+#include "testcase_page.hh"
+#include "testcase_correlation.hh"
+#include "testcase_sharing.hh"
+#include "testcase_pollution.hh"
\ No newline at end of file
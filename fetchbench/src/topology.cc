@@ -0,0 +1,372 @@
+#include <sched.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+#include "topology.hh"
+#include "logger.hh"
+#include "utils.hh"
+
+using std::map;
+
+#define SYSFS_CPU_PATH "/sys/devices/system/cpu/"
+#define SYSFS_NODE_PATH "/sys/devices/system/node/"
+
+/**
+ * Reads the first line of a (sysfs) file.
+ *
+ * @param      path  The path
+ *
+ * @return     The line ("" if the file does not exist).
+ */
+static string read_line(string const& path) {
+	std::ifstream file {path};
+	string line;
+	if ( ! (file && std::getline(file, line))) {
+		return "";
+	}
+	return line;
+}
+
+/**
+ * Reads an integer from a (sysfs) file.
+ *
+ * @param      path           The path
+ * @param[in]  default_value  Value to return if the file does not exist
+ *
+ * @return     The value.
+ */
+static int64_t read_int(string const& path, int64_t default_value) {
+	string line = read_line(path);
+	return line.empty() ? default_value : strtoll(line.c_str(), NULL, 10);
+}
+
+/**
+ * Counts the interrupts handled by each CPU so far.
+ *
+ * @return     Map of CPU ID to number of interrupts (empty if
+ *             /proc/interrupts is not available).
+ */
+static map<int, uint64_t> read_interrupt_counts() {
+	map<int, uint64_t> counts;
+	std::ifstream file {"/proc/interrupts"};
+	string line;
+	if ( ! (file && std::getline(file, line))) {
+		return counts;
+	}
+	// header: one column per online CPU, e.g., "CPU0 CPU1 ..."
+	vector<int> columns;
+	std::istringstream header {line};
+	string column;
+	while (header >> column) {
+		columns.push_back(atoi(column.c_str() + 3));
+	}
+	// rows: "<irq>: <count per CPU> <description>"
+	while (std::getline(file, line)) {
+		std::istringstream row {line};
+		string irq;
+		row >> irq;
+		for (int cpu : columns) {
+			uint64_t count;
+			if ( ! (row >> count)) {
+				break;
+			}
+			counts[cpu] += count;
+		}
+	}
+	return counts;
+}
+
+/**
+ * Discovers the topology of the online CPUs the process may run on.
+ *
+ * @return     The topology.
+ */
+Topology Topology::discover() {
+	Topology topology;
+
+	cpu_set_t affinity;
+	CPU_ZERO(&affinity);
+	bool has_affinity = (sched_getaffinity(0, sizeof(affinity), &affinity) == 0);
+	vector<int> isolated = parse_cpu_list(read_line(SYSFS_CPU_PATH "isolated"));
+	vector<int> nohz_full = parse_cpu_list(read_line(SYSFS_CPU_PATH "nohz_full"));
+	isolated.insert(isolated.end(), nohz_full.begin(), nohz_full.end());
+	map<int, uint64_t> interrupts = read_interrupt_counts();
+	map<int, int> numa_nodes;
+	for (int node : parse_cpu_list(read_line(SYSFS_NODE_PATH "online"))) {
+		for (int cpu : parse_cpu_list(read_line(SYSFS_NODE_PATH "node" + std::to_string(node) + "/cpulist"))) {
+			numa_nodes[cpu] = node;
+		}
+	}
+	topology.memory_nodes = parse_cpu_list(read_line(SYSFS_NODE_PATH "has_memory"));
+
+	for (int cpu : parse_cpu_list(read_line(SYSFS_CPU_PATH "online"))) {
+		if (has_affinity && ! CPU_ISSET(cpu, &affinity)) {
+			continue;
+		}
+		string cpu_path = SYSFS_CPU_PATH "cpu" + std::to_string(cpu) + "/";
+		cpu_info_t info;
+		info.cpu = cpu;
+		info.package_id = read_int(cpu_path + "topology/physical_package_id", 0);
+		info.core_id = read_int(cpu_path + "topology/core_id", cpu);
+		info.thread_siblings = parse_cpu_list(read_line(cpu_path + "topology/thread_siblings_list"));
+		if (info.thread_siblings.empty()) {
+			info.thread_siblings.push_back(cpu);
+		}
+		// data/unified caches: the L2 and the highest level
+		int llc_level = 0;
+		for (size_t index = 0; ; index++) {
+			string cache_path = cpu_path + "cache/index" + std::to_string(index) + "/";
+			int level = read_int(cache_path + "level", -1);
+			if (level == -1) {
+				break;
+			}
+			if (read_line(cache_path + "type") == "Instruction") {
+				continue;
+			}
+			vector<int> shared_cpus = parse_cpu_list(read_line(cache_path + "shared_cpu_list"));
+			if (level == 2) {
+				info.l2_shared_cpus = shared_cpus;
+			}
+			if (level > llc_level) {
+				llc_level = level;
+				info.llc_shared_cpus = shared_cpus;
+			}
+		}
+		info.capacity = read_int(cpu_path + "cpu_capacity", 0);
+		if (info.capacity == 0) {
+			info.capacity = read_int(cpu_path + "cpufreq/cpuinfo_max_freq", 0);
+		}
+		info.numa_node = numa_nodes.count(cpu) ? numa_nodes.at(cpu) : -1;
+		info.isolated = std::find(isolated.begin(), isolated.end(), cpu) != isolated.end();
+		info.interrupts = interrupts.count(cpu) ? interrupts.at(cpu) : 0;
+		topology.cpus.push_back(info);
+	}
+	return topology;
+}
+
+cpu_info_t const* Topology::find(int cpu) const {
+	for (cpu_info_t const& info : cpus) {
+		if (info.cpu == cpu) {
+			return &info;
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Selects the CPU for the measurement process: the isolated performance
+ * core with the fewest interrupts, or (if no performance core is
+ * isolated) the performance core with the fewest interrupts.
+ *
+ * @return     The CPU ID (0 if the topology is unknown).
+ */
+int Topology::select_measurement_cpu() const {
+	if (cpus.empty()) {
+		return 0;
+	}
+	cpu_info_t const& best = *std::min_element(cpus.begin(), cpus.end(), [](cpu_info_t const& a, cpu_info_t const& b) {
+		// higher capacity first, then isolated, then fewer interrupts
+		return std::make_tuple(-(int64_t)a.capacity, ! a.isolated, a.interrupts, a.cpu)
+			< std::make_tuple(-(int64_t)b.capacity, ! b.isolated, b.interrupts, b.cpu);
+	});
+	return best.cpu;
+}
+
+/**
+ * Selects the CPU for the counter thread, see Topology. Falls back to an
+ * SMT sibling of the measurement CPU if there is no other core.
+ *
+ * @param[in]  measurement_cpu  The measurement CPU
+ *
+ * @return     The CPU ID (measurement_cpu + 1 if the topology is
+ *             unknown).
+ */
+int Topology::select_counter_cpu(int measurement_cpu) const {
+	cpu_info_t const* measurement = find(measurement_cpu);
+	if (measurement == nullptr) {
+		return measurement_cpu + 1;
+	}
+	auto contains = [](vector<int> const& list, int cpu) {
+		return std::find(list.begin(), list.end(), cpu) != list.end();
+	};
+	cpu_info_t const* best = nullptr;
+	auto key = [&](cpu_info_t const& info) {
+		bool is_sibling = contains(measurement->thread_siblings, info.cpu);
+		return std::make_tuple(
+			is_sibling,
+			! contains(measurement->l2_shared_cpus, info.cpu),
+			! contains(measurement->llc_shared_cpus, info.cpu),
+			-(int64_t)info.capacity,
+			! info.isolated,
+			info.interrupts,
+			info.cpu
+		);
+	};
+	for (cpu_info_t const& info : cpus) {
+		if (info.cpu == measurement_cpu) {
+			continue;
+		}
+		if (best == nullptr || key(info) < key(*best)) {
+			best = &info;
+		}
+	}
+	return (best == nullptr) ? measurement_cpu : best->cpu;
+}
+
+/**
+ * Selects the CPUs for background load threads (see BackgroundLoad): all
+ * CPUs except the measurement CPU, its SMT siblings (which would compete
+ * for the core instead of the memory system) and the counter thread CPU.
+ * CPUs that share the LLC with the measurement CPU come first, such that
+ * few threads already contend for the same LLC and memory controller.
+ *
+ * @param[in]  measurement_cpu  The measurement CPU
+ * @param[in]  ctr_cpu          The counter thread CPU
+ *
+ * @return     The CPU IDs (empty if there are no other cores).
+ */
+vector<int> Topology::select_load_cpus(int measurement_cpu, int ctr_cpu) const {
+	cpu_info_t const* measurement = find(measurement_cpu);
+	auto contains = [](vector<int> const& list, int cpu) {
+		return std::find(list.begin(), list.end(), cpu) != list.end();
+	};
+	vector<cpu_info_t const*> candidates;
+	for (cpu_info_t const& info : cpus) {
+		if (info.cpu == measurement_cpu || info.cpu == ctr_cpu || (measurement != nullptr && contains(measurement->thread_siblings, info.cpu))) {
+			continue;
+		}
+		candidates.push_back(&info);
+	}
+	std::sort(candidates.begin(), candidates.end(), [&](cpu_info_t const* a, cpu_info_t const* b) {
+		bool a_shares_llc = (measurement != nullptr && contains(measurement->llc_shared_cpus, a->cpu));
+		bool b_shares_llc = (measurement != nullptr && contains(measurement->llc_shared_cpus, b->cpu));
+		return std::make_tuple( ! a_shares_llc, a->cpu) < std::make_tuple( ! b_shares_llc, b->cpu);
+	});
+	vector<int> load_cpus;
+	for (cpu_info_t const* info : candidates) {
+		load_cpus.push_back(info->cpu);
+	}
+	return load_cpus;
+}
+
+char const* topology_level_to_string(topology_level_t level) {
+	switch (level) {
+		case TOPOLOGY_SAME_CORE: return "same_core";
+		case TOPOLOGY_SAME_L2: return "same_l2";
+		case TOPOLOGY_SAME_LLC: return "same_llc";
+		case TOPOLOGY_REMOTE: return "remote";
+		default: return "unknown";
+	}
+}
+
+/**
+ * Determines what two different CPUs share.
+ *
+ * @param[in]  cpu        The CPU
+ * @param[in]  other_cpu  The other CPU
+ *
+ * @return     The closest level they share (TOPOLOGY_REMOTE if the CPU is
+ *             not part of the topology).
+ */
+topology_level_t Topology::level_between(int cpu, int other_cpu) const {
+	cpu_info_t const* info = find(cpu);
+	if (info == nullptr) {
+		return TOPOLOGY_REMOTE;
+	}
+	auto contains = [](vector<int> const& list, int cpu) {
+		return std::find(list.begin(), list.end(), cpu) != list.end();
+	};
+	if (contains(info->thread_siblings, other_cpu)) {
+		return TOPOLOGY_SAME_CORE;
+	} else if (contains(info->l2_shared_cpus, other_cpu)) {
+		return TOPOLOGY_SAME_L2;
+	} else if (contains(info->llc_shared_cpus, other_cpu)) {
+		return TOPOLOGY_SAME_LLC;
+	}
+	return TOPOLOGY_REMOTE;
+}
+
+/**
+ * Selects a CPU at the given topology level from a CPU, e.g., its SMT
+ * sibling, preferring the CPU with the fewest interrupts.
+ *
+ * @param[in]  cpu           The CPU
+ * @param[in]  level         The topology level
+ * @param[in]  excluded_cpu  A CPU not to select (e.g., the counter
+ *                           thread CPU, -1 for none)
+ *
+ * @return     The CPU ID (-1 if there is no such CPU).
+ */
+int Topology::select_partner_cpu(int cpu, topology_level_t level, int excluded_cpu) const {
+	cpu_info_t const* best = nullptr;
+	for (cpu_info_t const& info : cpus) {
+		if (info.cpu == cpu || info.cpu == excluded_cpu || level_between(cpu, info.cpu) != level) {
+			continue;
+		}
+		if (best == nullptr || std::make_tuple(info.interrupts, info.cpu) < std::make_tuple(best->interrupts, best->cpu)) {
+			best = &info;
+		}
+	}
+	return (best == nullptr) ? -1 : best->cpu;
+}
+
+/**
+ * Returns the NUMA node of a CPU, i.e., the node its memory is local to.
+ *
+ * @param[in]  cpu   The CPU
+ *
+ * @return     The node (-1 if unknown).
+ */
+int Topology::numa_node_of_cpu(int cpu) const {
+	cpu_info_t const* info = find(cpu);
+	return (info == nullptr) ? -1 : info->numa_node;
+}
+
+/**
+ * Selects a NUMA node with memory that is remote to a CPU, i.e., not its
+ * own node.
+ *
+ * @param[in]  cpu   The CPU
+ *
+ * @return     The node (-1 if there is no such node, e.g., on systems with
+ *             a single node).
+ */
+int Topology::select_remote_numa_node(int cpu) const {
+	int local_node = numa_node_of_cpu(cpu);
+	for (int node : memory_nodes) {
+		if (node != local_node) {
+			return node;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Describes a CPU (for recording the placement in the results).
+ *
+ * @param[in]  cpu   The CPU ID
+ *
+ * @return     JSON structure with the properties of the CPU (only the ID
+ *             if the CPU is not part of the topology).
+ */
+Json Topology::cpu_to_json(int cpu) const {
+	cpu_info_t const* info = find(cpu);
+	if (info == nullptr) {
+		return Json::object {{"cpu", cpu}};
+	}
+	return Json::object {
+		{"cpu", cpu},
+		{"package_id", info->package_id},
+		{"core_id", info->core_id},
+		{"thread_siblings", info->thread_siblings},
+		{"l2_shared_cpus", info->l2_shared_cpus},
+		{"llc_shared_cpus", info->llc_shared_cpus},
+		{"numa_node", info->numa_node},
+		{"capacity", (int)info->capacity},
+		{"isolated", info->isolated},
+		{"interrupts", (double)info->interrupts},
+	};
+}
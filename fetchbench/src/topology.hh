@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "json11.hpp"
+
+using json11::Json;
+using std::string;
+using std::vector;
+
+/**
+ * Properties of a logical CPU that matter for placing the measurement
+ * process and the counter thread (from sysfs and /proc/interrupts).
+ */
+typedef struct {
+	int cpu;
+	int package_id;
+	int core_id;
+	// logical CPUs of the same physical core (incl. this one)
+	vector<int> thread_siblings;
+	// logical CPUs sharing the L2 cache (e.g., a cluster of efficiency
+	// cores) and the last-level cache (empty if unknown)
+	vector<int> l2_shared_cpus;
+	vector<int> llc_shared_cpus;
+	// NUMA node of the CPU (-1 if unknown)
+	int numa_node;
+	// relative performance: cpu_capacity (ARM) or the maximum frequency in
+	// kHz (hybrid x86); 0 if unknown
+	size_t capacity;
+	// excluded from the scheduler's load balancing (isolcpus) or
+	// tickless (nohz_full)
+	bool isolated;
+	// number of interrupts handled so far
+	uint64_t interrupts;
+} cpu_info_t;
+
+/**
+ * How close two logical CPUs are in the topology, i.e., what they share.
+ */
+typedef enum {
+	// SMT siblings (same physical core)
+	TOPOLOGY_SAME_CORE = 0,
+	// different cores sharing the L2 cache (e.g., a cluster)
+	TOPOLOGY_SAME_L2 = 1,
+	// different cores sharing only the last-level cache
+	TOPOLOGY_SAME_LLC = 2,
+	// no shared cache (e.g., another package or LLC slice group)
+	TOPOLOGY_REMOTE = 3,
+	NO_TOPOLOGY_LEVELS = 4,
+} topology_level_t;
+
+char const* topology_level_to_string(topology_level_t level);
+
+/**
+ * CPU topology of the system, restricted to the online CPUs the process
+ * may run on. Used to select the CPUs for the measurement process and the
+ * counter thread automatically:
+ * - Measurement: a performance core (highest capacity), preferably an
+ *   isolated one, with the fewest interrupts.
+ * - Counter thread: a performance core that is not an SMT sibling of the
+ *   measurement CPU (which would slow it down) and shares as much of the
+ *   cache hierarchy with it as possible (such that reading the counter is
+ *   cheap), again preferring isolated CPUs with few interrupts.
+ */
+class Topology {
+private:
+	vector<cpu_info_t> cpus;
+	// NUMA nodes with memory
+	vector<int> memory_nodes;
+
+	cpu_info_t const* find(int cpu) const;
+
+public:
+	static Topology discover();
+
+	inline size_t size() const {
+		return cpus.size();
+	}
+
+	int select_measurement_cpu() const;
+	int select_counter_cpu(int measurement_cpu) const;
+	vector<int> select_load_cpus(int measurement_cpu, int ctr_cpu) const;
+	topology_level_t level_between(int cpu, int other_cpu) const;
+	int select_partner_cpu(int cpu, topology_level_t level, int excluded_cpu) const;
+	int numa_node_of_cpu(int cpu) const;
+	int select_remote_numa_node(int cpu) const;
+	Json cpu_to_json(int cpu) const;
+};
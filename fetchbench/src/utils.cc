@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <sstream>
 
 #include "utils.hh"
 #include "testcase_stride_strideexperiment.hh"
@@ -107,37 +108,12 @@ void plot_stream(string const& name, vector<string> const& json_dumps_file_paths
 	_plot_call("plot_sms_stream.py", "stream_" + name, json_dumps_file_paths);
 }
 
-void _plot_call_ext(string const& script_filepath, string const& name, string const& program_output_file_path) {
-	L::info("Plotting data...\n");
-	fflush(stdout);
-	pid_t pid = fork();
-	switch(pid) {
-		case -1:
-			perror("fork() failed.");
-			exit(EXIT_FAILURE);
-		case 0: { // child
-			vector<char const *> argv {
-				"python3", script_filepath.data(),
-				program_output_file_path.data(), name.data(), NULL
-			};
-			execvp(const_cast<char* const>(argv.data()[0]), const_cast<char* const*>(argv.data()));
-			break;
-		}
-		default: // parent
-			L::info("Waiting for plot script to finish...\n");
-			waitpid(pid, NULL, 0);
-			break;
-	}
-	L::info("Plot finished.\n");
-}
-
-
-void plot_parr(string const& name, string const& program_output_file_path) {
-	_plot_call_ext("plot_parr.py", name, program_output_file_path);
+void plot_parr(string const& name, vector<string> const& json_dumps_file_paths) {
+	_plot_call("plot_parr.py", "parr_" + name, json_dumps_file_paths);
 }
 
-void plot_pchase(string const& name, string const& program_output_file_path) {
-	_plot_call_ext("plot_pchase.py", name, program_output_file_path);
+void plot_pchase(string const& name, vector<string> const& json_dumps_file_paths) {
+	_plot_call("plot_pchase.py", "pchase_" + name, json_dumps_file_paths);
 }
 
 /**
@@ -238,6 +214,28 @@ void json_dump_to_file(Json const& j, string const& filepath) {
 	file.close();
 }
 
+/**
+ * Reads a JSON structure from a file.
+ *
+ * @param      filepath  The filepath
+ *
+ * @return     The JSON structure (null if the file can not be read or
+ *             parsed).
+ */
+Json json_load_from_file(string const& filepath) {
+	std::ifstream file;
+	file.open(filepath);
+	if ( ! file.is_open()) {
+		return Json {};
+	}
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	file.close();
+
+	string json_err;
+	return Json::parse(buffer.str(), json_err);
+}
+
 /**
  * Returns pointer to the random number generator. The pointer points to a
  * singleton instance (local static variable in this function.)
@@ -284,3 +282,56 @@ string zero_pad(int64_t no, size_t min_digits) {
 	string str_padded_no = string(min_digits - std::min(min_digits, str_no.length()), '0') + str_no;
 	return str_sign + str_padded_no;
 }
+
+/**
+ * Reads the current frequency of a CPU core from the cpufreq sysfs
+ * interface.
+ *
+ * @param[in]  cpu   The processor ID. If USE_CURRENT_CPU, the CPU the
+ *                   current process is running on will be used.
+ *
+ * @return     The frequency in kHz, or 0 if it is not available (e.g.,
+ *             cpufreq is not supported on the system).
+ */
+size_t read_cpu_frequency_khz(int cpu) {
+	if (cpu == USE_CURRENT_CPU) {
+		cpu = sched_getcpu();
+	}
+	std::ifstream f {"/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/scaling_cur_freq"};
+	size_t frequency_khz = 0;
+	if ( ! (f >> frequency_khz)) {
+		return 0;
+	}
+	return frequency_khz;
+}
+
+/**
+ * Parses a list of CPU IDs in the format used by sysfs and taskset, i.e.,
+ * comma-separated IDs and ranges (e.g., "0,4" or "0-3,8").
+ *
+ * @param      list  The list
+ *
+ * @return     The CPU IDs (in the order of the list). Exits on invalid
+ *             input.
+ */
+vector<int> parse_cpu_list(string const& list) {
+	vector<int> cpus;
+	std::istringstream stream {list};
+	string range;
+	while (std::getline(stream, range, ',')) {
+		char* end;
+		long first = strtol(range.c_str(), &end, 10);
+		long last = first;
+		if (*end == '-') {
+			last = strtol(end + 1, &end, 10);
+		}
+		if (range.empty() || *end != '\0' || first < 0 || last < first) {
+			L::err("Invalid CPU list: \"%s\"\n", list.c_str());
+			exit(1);
+		}
+		for (long cpu = first; cpu <= last; cpu++) {
+			cpus.push_back((int)cpu);
+		}
+	}
+	return cpus;
+}
@@ -171,27 +171,16 @@ enum intel_prefetcher_t {
 	INTEL_DCU_IP_PREFETCHER         = 0b1000ULL,
 };
 
-/**
- * Enables or disables a specific prefetcher on Intel CPUs.
- *
- * @param[in]  cpu         The processor ID
- * @param[in]  prefetcher  The prefetcher to enable/disable.
- * @param[in]  enabled     true to enable, false to disable the prefetcher
- */
-static inline void set_intel_prefetcher(int cpu, intel_prefetcher_t prefetcher, bool enabled) {
-	#ifndef INTEL_DONT_DISABLE_OTHER_PREFETCHERS
-		uint32_t msr_reg = INTEL_MSR_MISC_FEATURE_CONTROL;
-		uint64_t msr_value = rdmsr(cpu, msr_reg);
-		if ( ! enabled) {
-			msr_value |= prefetcher;
-		} else {
-			msr_value &= ~(prefetcher);
-		}
-		printf("set_intel_prefetcher: Writing 0x%lx into 0x%x.\n", msr_value, msr_reg);
-		wrmsr(cpu, msr_reg, msr_value);
-		assert(rdmsr(cpu, msr_reg) == msr_value);
-	#endif
-}
+// AMD prefetcher control (PrefetchControl, see the Processor Programming
+// Reference of Zen 4 and later CPUs)
+// Register:
+#define AMD_MSR_PREFETCH_CONTROL (0xC0000108)
+// Bits (set to disable the prefetcher):
+#define AMD_L1_STREAM_PREFETCHER  (1ULL << 0)
+#define AMD_L1_STRIDE_PREFETCHER  (1ULL << 1)
+#define AMD_L1_REGION_PREFETCHER  (1ULL << 2)
+#define AMD_L2_STREAM_PREFETCHER  (1ULL << 3)
+#define AMD_L2_UP_DOWN_PREFETCHER (1ULL << 5)
 
 /**
  * Enum to describe the architecture of a CPU.
@@ -238,13 +227,17 @@ void plot_stride(string const& name, vector<string> const& json_dumps_file_paths
 void plot_stride_minmax(string const& name, vector<string> const& json_dumps_file_paths);
 void plot_sms(string const& name, vector<string> const& json_dumps_file_paths);
 void plot_stream(string const& name, vector<string> const& json_dumps_file_paths);
-void plot_parr(string const& name, string const& program_output_file_path);
-void plot_pchase(string const& name, string const& program_output_file_path);
+void plot_parr(string const& name, vector<string> const& json_dumps_file_paths);
+void plot_pchase(string const& name, vector<string> const& json_dumps_file_paths);
 
 string json_pretty_print(string const& json_in);
 void json_dump_to_file(Json const& j, string const& filepath);
+Json json_load_from_file(string const& filepath);
 
 std::shared_ptr<std::mt19937> get_rng();
 std::mt19937::result_type random_uint32(std::mt19937::result_type lower, std::mt19937::result_type upper);
 
 string zero_pad(int64_t no, size_t min_digits);
+
+size_t read_cpu_frequency_khz(int cpu);
+vector<int> parse_cpu_list(string const& list);